@@ -0,0 +1,1703 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+
+/*
+ * Micro-benchmarks for the buffer manager.
+ *
+ * misses: for every pool size the pool is filled with distinct pages and then a fixed number
+ *   of further pages is pinned and unpinned once each, so that every pin is a miss that has to
+ *   choose a victim. The page file is sparse, so the reads cost the same for every pool size
+ *   and any growth in the per-miss time comes from the buffer manager itself.
+ *   Arguments: [maxFrames [missesPerSize]], default 1000000 frames (about 4 GB of frames at
+ *   the largest size) and 100000 misses.
+ *
+ * scan: replays a trace of sequential table scans mixed with point lookups on a small hot set,
+ *   the way next() and B+ tree lookups share a pool, and reports the hit ratio of each
+ *   replacement strategy overall and for the point lookups alone, with the scan going through
+ *   the shared pool or through a scan ring.
+ *
+ * cleaner: dirties every page it pins, with a short pause between pins as if a client worked
+ *   on the page, and reports how many misses had to write back a dirty victim themselves and
+ *   the average miss time, with and without a background cleaner.
+ *
+ * threads: 1, 2, 4, ... threads share one pool and each pins random pages, reads them under a
+ *   shared content latch and unpins them. Throughput is reported for CLOCK, whose hits only take
+ *   a page table partition latch, for LRU, whose hits also take the pool lock to reorder its
+ *   list, and for CLOCK with a working set four times the pool, where most pins are misses.
+ *   Arguments: [maxThreads [pinsPerThread]], default every online core and 1000000 pins.
+ *
+ * io: writes and then reads every page of a file, one blocking call per page and through the
+ *   storage manager's I/O queues, which keep up to depth pages in flight. On a fast device the
+ *   queues overlap the requests; with the file in the page cache they mostly show the cost per
+ *   request of each backend.
+ *   Arguments: [numPages [depth]], default 16384 pages (64 MB) and 64.
+ *
+ * direct: pins random pages of a file four times the size of the pool, once with the page file
+ *   buffered by the OS and once with direct I/O (setPoolDirectIO), starting each run with the
+ *   file out of the page cache. Reports pins per second and the memory holding the file's
+ *   pages: the pool's frames plus what the page cache keeps of the file (counted with mincore).
+ *   Arguments: [numPages [numPins]], default 32768 pages (128 MB) and 200000 pins.
+ *
+ * mapped: reads every page of a file held in the page cache, in order and then at random,
+ *   through a pool of SCAN_POOL_FRAMES frames (the record manager's size), through a pool
+ *   holding the whole file, and through a mapped pool (initMappedBufferPool). Reports the time
+ *   from setting up the pool to the first pinned page, pins per second for each pass, and the
+ *   pages copied into the pool.
+ *   Arguments: [numPages [numPins]], default 32768 pages (128 MB) and 200000 random pins.
+ *
+ * pagesize: for page sizes from 4 KB to 64 KB, lays a table of PAGESIZE_RECORD-byte records
+ *   out in a file of that page size and reads it through a pool of PAGESIZE_POOL_MB, starting
+ *   with the file out of the page cache: once in a scan with readahead, then with point lookups
+ *   of random records. Reports scan MB/s and lookups per second.
+ *   Arguments: [fileMB [numLookups]], default 128 MB and 50000 lookups.
+ *
+ * compress: writes a table of COMPRESS_RECORD-byte records laid out like the record manager's,
+ *   with zero-padded string fields, to a plain and to a compressed page file
+ *   (createCompressedPageFile), then scans each with readahead through a pool of
+ *   PAGESIZE_POOL_MB, starting with the file out of the page cache. Reports the file size, the
+ *   bytes read per page, scan MB/s of pages and the time spent decompressing each page.
+ *   Arguments: [fileMB], default 128 MB.
+ *
+ * churn: fills a file with pages, then in every round empties a random quarter of the pages in
+ *   use and writes as many new ones, as deletes and inserts do to a table. Once with emptied
+ *   pages left in place and new pages appended, once with emptied pages freed (freePoolPage)
+ *   and new pages taken from the free ones (allocatePoolPage). Reports the file size, the disk
+ *   space it takes, and the pages a scan that skips free pages (isPoolPageFree) reads, and how fast.
+ *   Arguments: [fileMB [rounds]], default 64 MB and 8 rounds.
+ *
+ * segments: writes a file in runs of SEGMENT_WRITE_PAGES pages, then reads random pages of it
+ *   starting with the file out of the page cache, once as a single page file and once as a
+ *   segmented one (createSegmentedPageFile) with segments of segmentMB. With more segments than
+ *   SEGMENT_FDS_MAX, random reads keep closing and opening segment files; reports the files,
+ *   write MB/s, random reads per second and how many times a segment file was opened.
+ *   Arguments: [fileMB [segmentMB [numReads]]], default 128 MB, 4 MB and 20000 reads.
+ *
+ * metrics: pins random pages of a sparse file through a CLOCK pool of METRICS_POOL_FRAMES
+ *   frames, once with a working set that fits the pool, so every pin after the first round is
+ *   a hit, and once with a working set four times the pool. Reports ns per pin and unpin and
+ *   the pool's metrics (getPoolMetrics): hits, misses, evictions and the p50/p99 latency of
+ *   pin hits, pin misses and reads. Comparing ns per hit with a build before the metrics shows
+ *   what counting and sampled timing cost the hit path.
+ *   Arguments: [numPins], default 2000000 pins.
+ *
+ * mrc: pins pages of a sparse file through a CLOCK pool of MRC_POOL_FRAMES frames, a mix of
+ *   lookups on MRC_HOT_PAGES hot pages and reads of MRC_COLD_PAGES others, then replays the same
+ *   pins through LRU pools of 1/8 to 16 times that size. Reports, per size, the miss ratio the
+ *   first pool's estimator predicted (getPoolMissRatioCurve) next to the one the LRU pool had.
+ *   Arguments: [numPins], default 400000 pins.
+ *
+ * resize: pins a mix of lookups on RESIZE_HOT_PAGES hot pages and reads of RESIZE_COLD_PAGES
+ *   others through an LRU pool that shrinks from RESIZE_POOL_FRAMES frames to an eighth and
+ *   grows back, once resized online (resizeBufferPool) and once shut down and set up again at
+ *   the new size, with numPins pins before each step. Reports for each step the time it took
+ *   and the hit ratio of the first twentieth of the pins after it, where the pages the pool
+ *   kept make the difference. Then RESIZE_THREADS threads pin random pages while the main thread keeps
+ *   shrinking the pool to a quarter and growing it back, and pins per second are reported
+ *   next to those of the same threads with the pool left alone.
+ *   Arguments: [numPins], default 200000 pins.
+ *
+ * shared: SHARED_FILES files are used in turn, SHARED_HOT_PERCENT of the pins of a phase going
+ *   to SHARED_HOT_PAGES pages of the file in use and the rest to SHARED_IDLE_PAGES pages of each
+ *   other file. The same pins go through an LRU pool of its own per file, splitting
+ *   SHARED_POOL_FRAMES frames evenly, and through views of one shared LRU pool of that many
+ *   frames (initPoolView). Reports per phase the hit ratio and ns per pin of both.
+ *   Arguments: [numPins], default 400000 pins per phase.
+ *
+ * Usage: bench_buffer_mgr [misses [maxFrames [missesPerSize]] | scan | cleaner |
+ *                          threads [maxThreads [pinsPerThread]] | io [numPages [depth]] |
+ *                          direct [numPages [numPins]] | mapped [numPages [numPins]] |
+ *                          pagesize [fileMB [numLookups]] | compress [fileMB] |
+ *                          churn [fileMB [rounds]] | segments [fileMB [segmentMB [numReads]]] |
+ *                          metrics [numPins] | mrc [numPins] | resize [numPins] |
+ *                          shared [numPins]]
+ * Without arguments every benchmark runs with its defaults.
+ */
+
+#define BENCH_FILE "benchbuffer.bin"
+
+// shape of the scan trace
+#define SCAN_POOL_FRAMES 100
+#define SCAN_HOT_PAGES 80       // pages 0 .. SCAN_HOT_PAGES-1 are looked up at random
+#define SCAN_FIRST_PAGE 1000    // the scanned table starts here
+#define SCAN_TABLE_PAGES 5000
+#define SCAN_PASSES 4
+#define SCAN_PINS_PER_PAGE 3    // next() pins a page once per record
+
+// shape of the cleaner workload
+#define CLEANER_POOL_FRAMES 100
+#define CLEANER_PAGES 20000
+#define CLEANER_THINK_MICROS 20 // pause between pins
+
+// shape of the multi-threaded workload
+#define THREAD_POOL_FRAMES 1000
+
+// shape of the page size sweep: the pool has the same memory for every page size
+#define PAGESIZE_POOL_MB 8
+#define PAGESIZE_RECORD 100
+
+// shape of the compressed table: an int key, two strings of COMPRESS_NAME and COMPRESS_CITY
+// bytes holding much shorter values, and an int amount
+#define COMPRESS_RECORD 84
+#define COMPRESS_NAME 40
+#define COMPRESS_CITY 32
+
+// shape of the churn workload: pages emptied and written again per round
+#define CHURN_FRACTION 4        // one page in this many
+
+// pages written per writeBlocks call by the segments benchmark
+#define SEGMENT_WRITE_PAGES 64
+
+// pool size of the metrics benchmark
+#define METRICS_POOL_FRAMES 1000
+
+// shape of the miss ratio curve workload: MRC_HOT_PERCENT of the pins go to the hot pages
+#define MRC_POOL_FRAMES 1000
+#define MRC_HOT_PAGES 2000
+#define MRC_COLD_PAGES 40000
+#define MRC_HOT_PERCENT 80
+
+// shape of the resize workload: RESIZE_HOT_PERCENT of the pins go to the hot pages
+#define RESIZE_POOL_FRAMES 4000
+#define RESIZE_HOT_PAGES 400
+#define RESIZE_COLD_PAGES 40000
+#define RESIZE_HOT_PERCENT 90
+#define RESIZE_THREADS 4
+
+// shape of the shared pool workload: SHARED_HOT_PERCENT of the pins go to the file in use
+#define SHARED_FILES 4
+#define SHARED_POOL_FRAMES 2000
+#define SHARED_HOT_PAGES 1500
+#define SHARED_IDLE_PAGES 100
+#define SHARED_HOT_PERCENT 95
+
+// I/O queue backends compared by the io benchmark, -1 standing for one blocking call per page
+static const int ioBackends[] = { -1, SM_IO_THREADS, SM_IO_URING };
+static const char *ioBackendNames[] = { "blocking", "threads", "io_uring" };
+
+// time in nanoseconds from a monotonic clock
+static long long
+nowNanos (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// create a sparse page file holding numPages pages
+static RC
+createSparseFile (char *fileName, long long numPages)
+{
+  struct stat st;
+  RC rc;
+
+  // a new file holds its header and one page; keep the header and extend the pages
+  if ((rc = createPageFile(fileName)) != RC_OK)
+    return rc;
+  if (stat(fileName, &st) != 0
+      || truncate(fileName, st.st_size - PAGE_SIZE + (off_t) numPages * PAGE_SIZE) != 0)
+    return RC_WRITE_FAILED;
+  return RC_OK;
+}
+
+// average nanoseconds per miss for one pool size and strategy, or -1 on error
+static double
+benchMissPath (int numFrames, int numMisses, ReplacementStrategy strategy)
+{
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  long long start, elapsed;
+  int i;
+
+  if (initBufferPool(&bm, BENCH_FILE, numFrames, strategy, NULL) != RC_OK)
+    return -1;
+
+  // fill every frame so that the measured pins all have to evict
+  for (i = 0; i < numFrames; i++)
+    {
+      if (pinPage(&bm, &h, i) != RC_OK || unpinPage(&bm, &h) != RC_OK)
+        return -1;
+    }
+
+  start = nowNanos();
+  for (i = 0; i < numMisses; i++)
+    {
+      if (pinPage(&bm, &h, numFrames + i) != RC_OK || unpinPage(&bm, &h) != RC_OK)
+        return -1;
+    }
+  elapsed = nowNanos() - start;
+
+  if (shutdownBufferPool(&bm) != RC_OK)
+    return -1;
+
+  return (double) elapsed / numMisses;
+}
+
+// time the miss path for pool sizes from 100 frames up to maxFrames
+static int
+benchMisses (int maxFrames, int numMisses)
+{
+  int numFrames;
+
+  if (maxFrames < 100 || numMisses < 1)
+    {
+      fprintf(stderr, "misses: need maxFrames >= 100 and missesPerSize >= 1\n");
+      return 1;
+    }
+
+  initStorageManager();
+  if (createSparseFile(BENCH_FILE, (long long) maxFrames + numMisses) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+
+  printf("%10s %14s %14s\n", "frames", "LRU ns/miss", "FIFO ns/miss");
+  for (numFrames = 100; numFrames <= maxFrames; numFrames *= 10)
+    {
+      double lru = benchMissPath(numFrames, numMisses, RS_LRU);
+      double fifo = benchMissPath(numFrames, numMisses, RS_FIFO);
+
+      if (lru < 0 || fifo < 0)
+        {
+          fprintf(stderr, "benchmark failed at %d frames\n", numFrames);
+          destroyPageFile(BENCH_FILE);
+          return 1;
+        }
+      printf("%10d %14.1f %14.1f\n", numFrames, lru, fifo);
+    }
+
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// pin and unpin one page, through the ring if one is given, counting it as a hit if it caused no read
+static RC
+tracePin (BM_BufferPool *bm, BM_ScanRing *ring, PageNumber pageNum, int *hits)
+{
+  BM_PageHandle h;
+  int reads = getNumReadIO(bm);
+  RC rc;
+
+  rc = ring ? pinPageScan(bm, ring, &h, pageNum) : pinPage(bm, &h, pageNum);
+  if (rc != RC_OK)
+    return rc;
+  if (getNumReadIO(bm) == reads)
+    (*hits)++;
+  return unpinPage(bm, &h);
+}
+
+// replay the scan trace against one strategy, scanning through a ring if asked; returns -1 on error
+static int
+replayScanTrace (ReplacementStrategy strategy, void *stratData, bool useRing,
+                 double *hitRatio, double *lookupHitRatio)
+{
+  BM_BufferPool bm;
+  BM_ScanRing ring;
+  unsigned int seed = 42;
+  int hits = 0, pins = 0, lookupHits = 0, lookups = 0;
+  int pass, p, i;
+
+  if (initBufferPool(&bm, BENCH_FILE, SCAN_POOL_FRAMES, strategy, stratData) != RC_OK)
+    return -1;
+  if (useRing && initScanRing(&bm, &ring, SCAN_RING_FRAMES) != RC_OK)
+    return -1;
+
+  for (pass = 0; pass < SCAN_PASSES; pass++)
+    for (p = 0; p < SCAN_TABLE_PAGES; p++)
+      {
+        // read every record on the next table page
+        for (i = 0; i < SCAN_PINS_PER_PAGE; i++, pins++)
+          if (tracePin(&bm, useRing ? &ring : NULL, SCAN_FIRST_PAGE + p, &hits) != RC_OK)
+            return -1;
+
+        // then an index lookup lands on a random hot page
+        seed = seed * 1103515245u + 12345u;
+        if (tracePin(&bm, NULL, (seed >> 16) % SCAN_HOT_PAGES, &lookupHits) != RC_OK)
+          return -1;
+        lookups++;
+      }
+
+  if (useRing)
+    freeScanRing(&ring);
+  if (shutdownBufferPool(&bm) != RC_OK)
+    return -1;
+
+  *hitRatio = (double) (hits + lookupHits) / (pins + lookups);
+  *lookupHitRatio = (double) lookupHits / lookups;
+  return 0;
+}
+
+// hit ratios of each strategy on a scan plus point lookup trace
+static int
+benchScan (void)
+{
+  BM_LRUKParams lru2 = { 2, SCAN_PINS_PER_PAGE, SCAN_POOL_FRAMES };
+  struct { const char *name; ReplacementStrategy strategy; void *stratData; bool useRing; } runs[] = {
+    { "LRU", RS_LRU, NULL, false },
+    { "CLOCK", RS_CLOCK, NULL, false },
+    { "LRU-2", RS_LRU_K, &lru2, false },
+    { "ARC", RS_ARC, NULL, false },
+    { "2Q", RS_2Q, NULL, false },
+    { "LRU+ring", RS_LRU, NULL, true },
+    { "CLOCK+ring", RS_CLOCK, NULL, true },
+  };
+  int r;
+
+  initStorageManager();
+  if (createSparseFile(BENCH_FILE, SCAN_FIRST_PAGE + SCAN_TABLE_PAGES) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+
+  printf("%d frames, %d hot pages, %d passes over %d table pages\n",
+         SCAN_POOL_FRAMES, SCAN_HOT_PAGES, SCAN_PASSES, SCAN_TABLE_PAGES);
+  printf("%10s %14s %14s\n", "strategy", "hit ratio", "lookup hits");
+  for (r = 0; r < (int) (sizeof(runs) / sizeof(runs[0])); r++)
+    {
+      double all, lookups;
+
+      if (replayScanTrace(runs[r].strategy, runs[r].stratData, runs[r].useRing, &all, &lookups) != 0)
+        {
+          fprintf(stderr, "scan trace failed for %s\n", runs[r].name);
+          destroyPageFile(BENCH_FILE);
+          return 1;
+        }
+      printf("%10s %13.1f%% %13.1f%%\n", runs[r].name, 100 * all, 100 * lookups);
+    }
+
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// dirty CLEANER_PAGES pages through a small pool, optionally with a cleaner; returns -1 on error
+static int
+runDirtyWorkload (bool withCleaner, BM_CleanerStats *stats, double *nanosPerMiss)
+{
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  long long start, inPin = 0;
+  int i;
+
+  if (initBufferPool(&bm, BENCH_FILE, CLEANER_POOL_FRAMES, RS_LRU, NULL) != RC_OK)
+    return -1;
+  if (withCleaner && startPoolCleaner(&bm, CLEANER_POOL_FRAMES / 10, CLEANER_POOL_FRAMES / 4) != RC_OK)
+    return -1;
+
+  for (i = 0; i < CLEANER_PAGES; i++)
+    {
+      start = nowNanos();
+      if (pinPage(&bm, &h, i) != RC_OK)
+        return -1;
+      inPin += nowNanos() - start;
+
+      memset(h.data, i & 0xff, PAGE_SIZE);
+      if (markDirty(&bm, &h) != RC_OK || unpinPage(&bm, &h) != RC_OK)
+        return -1;
+      usleep(CLEANER_THINK_MICROS);
+    }
+
+  if (getCleanerStats(&bm, stats) != RC_OK || shutdownBufferPool(&bm) != RC_OK)
+    return -1;
+
+  *nanosPerMiss = (double) inPin / CLEANER_PAGES;
+  return 0;
+}
+
+// synchronous write-backs on the miss path with and without a background cleaner
+static int
+benchCleaner (void)
+{
+  int withCleaner;
+
+  initStorageManager();
+  if (createSparseFile(BENCH_FILE, CLEANER_PAGES) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+
+  printf("%d frames, %d dirtied pages, %d us between pins\n",
+         CLEANER_POOL_FRAMES, CLEANER_PAGES, CLEANER_THINK_MICROS);
+  printf("%10s %14s %14s %14s\n", "cleaner", "sync writes", "cleaner writes", "ns/miss");
+  for (withCleaner = 0; withCleaner <= 1; withCleaner++)
+    {
+      BM_CleanerStats stats;
+      double perMiss;
+
+      if (runDirtyWorkload(withCleaner, &stats, &perMiss) != 0)
+        {
+          fprintf(stderr, "dirty workload failed\n");
+          destroyPageFile(BENCH_FILE);
+          return 1;
+        }
+      printf("%10s %14d %14d %14.1f\n", withCleaner ? "on" : "off",
+             stats.syncWrites, stats.pagesWritten, perMiss);
+    }
+
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// one thread's share of the multi-threaded workload
+typedef struct PinWorker
+{
+  BM_BufferPool *bm;
+  int workingSet;
+  int numPins;
+  unsigned int seed;
+  RC rc;
+} PinWorker;
+
+static void *
+pinWorkerMain (void *arg)
+{
+  PinWorker *w = (PinWorker *) arg;
+  BM_PageHandle h;
+  volatile char sink;
+  int i;
+
+  for (i = 0; i < w->numPins; i++)
+    {
+      w->seed = w->seed * 1103515245u + 12345u;
+      if ((w->rc = pinPage(w->bm, &h, (w->seed >> 8) % w->workingSet)) != RC_OK)
+        return NULL;
+      latchPage(w->bm, &h, BM_LATCH_SHARED);
+      sink = h.data[i % PAGE_SIZE];
+      unlatchPage(w->bm, &h);
+      if ((w->rc = unpinPage(w->bm, &h)) != RC_OK)
+        return NULL;
+    }
+  (void) sink;
+  return NULL;
+}
+
+// millions of pins per second with numThreads threads sharing one pool, or -1 on error
+static double
+runPinWorkers (ReplacementStrategy strategy, int workingSet, int numThreads, int numPins)
+{
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  PinWorker *workers = malloc(sizeof(PinWorker) * numThreads);
+  pthread_t *threads = malloc(sizeof(pthread_t) * numThreads);
+  long long start, elapsed;
+  int i, t, failed = 0;
+
+  if (workers == NULL || threads == NULL
+      || initBufferPool(&bm, BENCH_FILE, THREAD_POOL_FRAMES, strategy, NULL) != RC_OK)
+    {
+      free(workers);
+      free(threads);
+      return -1;
+    }
+
+  // warm the pool so the working set that fits is measured as hits only
+  for (i = 0; i < workingSet && i < THREAD_POOL_FRAMES; i++)
+    if (pinPage(&bm, &h, i) != RC_OK || unpinPage(&bm, &h) != RC_OK)
+      failed = 1;
+
+  start = nowNanos();
+  for (t = 0; t < numThreads && !failed; t++)
+    {
+      workers[t].bm = &bm;
+      workers[t].workingSet = workingSet;
+      workers[t].numPins = numPins;
+      workers[t].seed = 42 + t;
+      workers[t].rc = RC_OK;
+      if (pthread_create(&threads[t], NULL, pinWorkerMain, &workers[t]) != 0)
+        break;
+    }
+  numThreads = t;
+  for (t = 0; t < numThreads; t++)
+    {
+      pthread_join(threads[t], NULL);
+      if (workers[t].rc != RC_OK)
+        failed = 1;
+    }
+  elapsed = nowNanos() - start;
+
+  if (shutdownBufferPool(&bm) != RC_OK)
+    failed = 1;
+  free(workers);
+  free(threads);
+  if (failed || numThreads == 0)
+    return -1;
+  return (double) numThreads * numPins * 1000.0 / elapsed;
+}
+
+// pin throughput as threads are added
+static int
+benchThreads (int maxThreads, int numPins)
+{
+  int numThreads;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  double base[3] = { 0, 0, 0 };
+
+  if (maxThreads < 1 || numPins < 1)
+    {
+      fprintf(stderr, "threads: need maxThreads >= 1 and pinsPerThread >= 1\n");
+      return 1;
+    }
+
+  initStorageManager();
+  if (createSparseFile(BENCH_FILE, 4 * THREAD_POOL_FRAMES) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+
+  printf("%d frames, %d pins per thread, %ld online cores\n", THREAD_POOL_FRAMES, numPins, cores);
+  printf("%8s %18s %18s %18s\n", "threads", "CLOCK Mpins/s", "LRU Mpins/s", "CLOCK 4x Mpins/s");
+  for (numThreads = 1; ; numThreads = numThreads * 2 < maxThreads ? numThreads * 2 : maxThreads)
+    {
+      double r[3];
+      int k;
+
+      r[0] = runPinWorkers(RS_CLOCK, THREAD_POOL_FRAMES, numThreads, numPins);
+      r[1] = runPinWorkers(RS_LRU, THREAD_POOL_FRAMES, numThreads, numPins);
+      r[2] = runPinWorkers(RS_CLOCK, 4 * THREAD_POOL_FRAMES, numThreads, numPins / 10 > 0 ? numPins / 10 : 1);
+      if (r[0] < 0 || r[1] < 0 || r[2] < 0)
+        {
+          fprintf(stderr, "benchmark failed with %d threads\n", numThreads);
+          destroyPageFile(BENCH_FILE);
+          return 1;
+        }
+
+      printf("%8d", numThreads);
+      for (k = 0; k < 3; k++)
+        {
+          if (numThreads == 1)
+            base[k] = r[k];
+          printf(" %10.2f (%4.1fx)", r[k], r[k] / base[k]);
+        }
+      printf("\n");
+      if (numThreads == maxThreads)
+        break;
+    }
+
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// nanoseconds to read or write every page through one backend, or -1 on error
+static long long
+runPageIO (SM_FileHandle *fh, int backend, int isWrite, int numPages, int depth, char *buffers)
+{
+  SM_IOQueue queue;
+  SM_IORequest *requests, **batch, *done[64];
+  long long start, elapsed;
+  int i, n, next = 0, completed = 0;
+  RC rc = RC_OK;
+
+  if (backend < 0)
+    {
+      start = nowNanos();
+      for (i = 0; i < numPages && rc == RC_OK; i++)
+        rc = isWrite ? writeBlock(i, fh, buffers + (size_t) (i % depth) * PAGE_SIZE)
+          : readBlock(i, fh, buffers + (size_t) (i % depth) * PAGE_SIZE);
+      return rc == RC_OK ? nowNanos() - start : -1;
+    }
+
+  if (initIOQueue(&queue, fh, depth, (SM_IOBackend) backend) != RC_OK)
+    return -1;
+  requests = malloc(sizeof(SM_IORequest) * numPages);
+  batch = malloc(sizeof(SM_IORequest *) * numPages);
+  for (i = 0; i < numPages; i++)
+    {
+      // the requests share depth buffers; what they read is not looked at
+      requests[i].pageNum = i;
+      requests[i].memPage = buffers + (size_t) (i % depth) * PAGE_SIZE;
+      requests[i].isWrite = isWrite;
+      batch[i] = &requests[i];
+    }
+
+  start = nowNanos();
+  while (completed < numPages)
+    {
+      n = submitIO(&queue, batch + next, numPages - next);
+      if (n < 0)
+        break;
+      next += n;
+      n = completeIO(&queue, done, 64, 1);
+      for (i = 0; i < n; i++)
+        {
+          if (done[i]->rc != RC_OK)
+            rc = done[i]->rc;
+        }
+      completed += n;
+    }
+  elapsed = nowNanos() - start;
+
+  shutdownIOQueue(&queue);
+  free(requests);
+  free(batch);
+  return completed == numPages && rc == RC_OK ? elapsed : -1;
+}
+
+// page write and read throughput of blocking calls and of the I/O queue backends
+static int
+benchIO (int numPages, int depth)
+{
+  SM_FileHandle fh;
+  char *buffers = NULL;
+  int b, isWrite;
+
+  if (numPages < 1 || depth < 1)
+    {
+      fprintf(stderr, "io: need numPages >= 1 and depth >= 1\n");
+      return 1;
+    }
+
+  initStorageManager();
+  if (createPageFile(BENCH_FILE) != RC_OK || openPageFile(BENCH_FILE, &fh) != RC_OK
+      || ensureCapacity(numPages, &fh) != RC_OK
+      || posix_memalign((void **) &buffers, PAGE_SIZE, (size_t) depth * PAGE_SIZE) != 0)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+  memset(buffers, 0x5a, (size_t) depth * PAGE_SIZE);
+
+  printf("%d pages, queue depth %d\n", numPages, depth);
+  printf("%10s %14s %14s\n", "backend", "write MB/s", "read MB/s");
+  for (b = 0; b < (int) (sizeof(ioBackends) / sizeof(ioBackends[0])); b++)
+    {
+      double mbps[2];
+
+      for (isWrite = 1; isWrite >= 0; isWrite--)
+        {
+          long long nanos = runPageIO(&fh, ioBackends[b], isWrite, numPages, depth, buffers);
+
+          mbps[1 - isWrite] = nanos > 0 ? (double) numPages * PAGE_SIZE * 1000.0 / nanos : -1;
+        }
+      if (mbps[0] < 0 || mbps[1] < 0)
+        printf("%10s %14s %14s\n", ioBackendNames[b], "n/a", "n/a");
+      else
+        printf("%10s %14.1f %14.1f\n", ioBackendNames[b], mbps[0], mbps[1]);
+    }
+
+  free(buffers);
+  closePageFile(&fh);
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// drop the file's pages from the page cache, after writing back any dirty ones
+static void
+evictFromPageCache (char *fileName)
+{
+  int fd = open(fileName, O_RDONLY);
+
+  if (fd < 0)
+    return;
+  fsync(fd);
+#ifdef POSIX_FADV_DONTNEED
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+  close(fd);
+}
+
+// number of the file's first numPages pages the page cache holds, or -1 if unknown
+static long
+pagesInPageCache (char *fileName, int numPages)
+{
+  size_t length = (size_t) numPages * PAGE_SIZE;
+  long sysPage = sysconf(_SC_PAGESIZE), resident = 0;
+  size_t i, numSysPages = (length + sysPage - 1) / sysPage;
+  unsigned char *vec = malloc(numSysPages);
+  void *map;
+  int fd = open(fileName, O_RDONLY);
+
+  if (fd < 0 || vec == NULL)
+    {
+      free(vec);
+      return -1;
+    }
+  map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED || mincore(map, length, (void *) vec) != 0)
+    resident = -1;
+  for (i = 0; resident >= 0 && i < numSysPages; i++)
+    resident += vec[i] & 1;
+  if (map != MAP_FAILED)
+    munmap(map, length);
+  free(vec);
+  return resident < 0 ? -1 : resident * sysPage / PAGE_SIZE;
+}
+
+// random pins over a file four times the pool, buffered by the OS and with direct I/O
+static int
+benchDirect (int numPages, int numPins)
+{
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  int numFrames = numPages / 4, direct, i;
+
+  if (numFrames < 1 || numPins < 1)
+    {
+      fprintf(stderr, "direct: need numPages >= 4 and numPins >= 1\n");
+      return 1;
+    }
+
+  // a file written out in full, unlike the sparse ones, so that reads go to the device
+  initStorageManager();
+  if (initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK
+      || createPageFile(BENCH_FILE) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+  for (i = 0; i < numPages; i++)
+    {
+      if (pinPage(&bm, &h, i) != RC_OK)
+        return 1;
+      memset(h.data, i & 0xff, PAGE_SIZE);
+      markDirty(&bm, &h);
+      unpinPage(&bm, &h);
+    }
+  if (shutdownBufferPool(&bm) != RC_OK)
+    return 1;
+
+  printf("%d pages, %d frames, %d random pins\n", numPages, numFrames, numPins);
+  printf("%10s %12s %10s %14s %10s %10s\n", "mode", "pins/s", "reads", "page cache MB",
+         "pool MB", "total MB");
+  for (direct = 0; direct <= 1; direct++)
+    {
+      long long start, elapsed;
+      long cached;
+      int reads;
+      bool inUse;
+
+      evictFromPageCache(BENCH_FILE);
+      srand(42);
+      if (initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK
+          || setPoolDirectIO(&bm, direct) != RC_OK)
+        return 1;
+
+      start = nowNanos();
+      for (i = 0; i < numPins; i++)
+        {
+          if (pinPage(&bm, &h, rand() % numPages) != RC_OK || unpinPage(&bm, &h) != RC_OK)
+            return 1;
+        }
+      elapsed = nowNanos() - start;
+
+      inUse = getPoolDirectIO(&bm);
+      reads = getNumReadIO(&bm);
+      cached = pagesInPageCache(BENCH_FILE, numPages);
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+
+      printf("%10s %12.0f %10d %14.1f %10.1f %10.1f%s\n", direct ? "direct" : "buffered",
+             numPins * 1e9 / elapsed, reads, cached * (double) PAGE_SIZE / (1 << 20),
+             numFrames * (double) PAGE_SIZE / (1 << 20),
+             (cached + numFrames) * (double) PAGE_SIZE / (1 << 20),
+             direct && !inUse ? " (direct I/O not allowed here, buffered)" : "");
+    }
+
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// one pass over the pool's pages, in order or at random, as pins per second; the page's first
+// byte is read so that a mapped page is really brought in; -1 on error
+static double
+benchReadPass (BM_BufferPool *bm, int numPages, int numPins, bool random, long *checksum)
+{
+  BM_PageHandle h;
+  long long start = nowNanos();
+  int i;
+
+  for (i = 0; i < numPins; i++)
+    {
+      if (pinPage(bm, &h, random ? rand() % numPages : i % numPages) != RC_OK)
+        return -1;
+      *checksum += h.data[0];
+      if (unpinPage(bm, &h) != RC_OK)
+        return -1;
+    }
+  return numPins * 1e9 / (nowNanos() - start);
+}
+
+// reads of a cached file through a small pool, a pool the size of the file and a mapped pool
+static int
+benchMapped (int numPages, int numPins)
+{
+  static const char *names[] = { "pool", "full pool", "mapped" };
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  long checksum = 0;
+  int i, kind;
+
+  if (numPages < 1 || numPins < 1)
+    {
+      fprintf(stderr, "mapped: need numPages >= 1 and numPins >= 1\n");
+      return 1;
+    }
+
+  initStorageManager();
+  if (initBufferPool(&bm, BENCH_FILE, SCAN_POOL_FRAMES, RS_CLOCK, NULL) != RC_OK
+      || createPageFile(BENCH_FILE) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+  for (i = 0; i < numPages; i++)
+    {
+      if (pinPage(&bm, &h, i) != RC_OK)
+        return 1;
+      memset(h.data, i & 0xff, PAGE_SIZE);
+      markDirty(&bm, &h);
+      unpinPage(&bm, &h);
+    }
+  if (shutdownBufferPool(&bm) != RC_OK)
+    return 1;
+
+  printf("%d pages in the page cache, %d random pins\n", numPages, numPins);
+  printf("%10s %8s %14s %14s %14s %12s\n", "pool", "frames", "first pin us", "scan pins/s",
+         "random pins/s", "pages copied");
+  for (kind = 0; kind < 3; kind++)
+    {
+      int frames = kind == 0 ? SCAN_POOL_FRAMES : kind == 1 ? numPages : 0;
+      long long start, firstPin;
+      double scan, random;
+      int reads;
+      RC rc;
+
+      srand(42);
+      start = nowNanos();
+      rc = kind == 2 ? initMappedBufferPool(&bm, BENCH_FILE, BM_ACCESS_NORMAL)
+                     : initBufferPool(&bm, BENCH_FILE, frames, RS_CLOCK, NULL);
+      if (rc != RC_OK || pinPage(&bm, &h, 0) != RC_OK || unpinPage(&bm, &h) != RC_OK)
+        return 1;
+      firstPin = nowNanos() - start;
+
+      scan = benchReadPass(&bm, numPages, numPages, false, &checksum);
+      random = benchReadPass(&bm, numPages, numPins, true, &checksum);
+      reads = getNumReadIO(&bm);
+      if (scan < 0 || random < 0 || shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+
+      printf("%10s %8d %14.1f %14.0f %14.0f %12d\n", names[kind], frames, firstPin / 1e3,
+             scan, random, reads);
+    }
+
+  destroyPageFile(BENCH_FILE);
+  return checksum == -1;
+}
+
+// a scan and point lookups over the same table laid out in pages of 4 KB to 64 KB
+static int
+benchPageSizes (int fileMB, int numLookups)
+{
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  BM_Readahead ra;
+  long checksum = 0;
+  int pageSize, i, r;
+
+  if (fileMB < 1 || numLookups < 1)
+    {
+      fprintf(stderr, "pagesize: need fileMB >= 1 and numLookups >= 1\n");
+      return 1;
+    }
+
+  initStorageManager();
+  printf("%d MB of %d-byte records, %d MB pool, %d random lookups\n", fileMB, PAGESIZE_RECORD,
+         PAGESIZE_POOL_MB, numLookups);
+  printf("%10s %8s %8s %12s %14s\n", "page size", "pages", "frames", "scan MB/s", "lookups/s");
+  for (pageSize = MIN_PAGE_SIZE; pageSize <= MAX_PAGE_SIZE; pageSize *= 2)
+    {
+      int numPages = (int) ((long long) fileMB * (1 << 20) / pageSize);
+      int numFrames = PAGESIZE_POOL_MB * (1 << 20) / pageSize;
+      int perPage = pageSize / PAGESIZE_RECORD;
+      long long start, scanNanos, lookupNanos;
+
+      // a file written out in full, so that reads go to the device
+      if (createPageFileWithPageSize(BENCH_FILE, pageSize) != RC_OK
+          || initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK)
+        {
+          fprintf(stderr, "could not create %s\n", BENCH_FILE);
+          return 1;
+        }
+      for (i = 0; i < numPages; i++)
+        {
+          if (pinPage(&bm, &h, i) != RC_OK)
+            return 1;
+          memset(h.data, i & 0xff, pageSize);
+          markDirty(&bm, &h);
+          unpinPage(&bm, &h);
+        }
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+
+      // scan every record, prefetching ahead like a table scan
+      evictFromPageCache(BENCH_FILE);
+      if (initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK)
+        return 1;
+      initReadahead(&ra);
+      start = nowNanos();
+      for (i = 0; i < numPages; i++)
+        {
+          readahead(&bm, &ra, NULL, i);
+          if (pinPage(&bm, &h, i) != RC_OK)
+            return 1;
+          for (r = 0; r < perPage; r++)
+            checksum += h.data[r * PAGESIZE_RECORD];
+          unpinPage(&bm, &h);
+        }
+      scanNanos = nowNanos() - start;
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+
+      // look records up at random
+      evictFromPageCache(BENCH_FILE);
+      srand(42);
+      if (initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK)
+        return 1;
+      start = nowNanos();
+      for (i = 0; i < numLookups; i++)
+        {
+          long record = ((long) rand() * RAND_MAX + rand()) % ((long) numPages * perPage);
+
+          if (pinPage(&bm, &h, (int) (record / perPage)) != RC_OK)
+            return 1;
+          checksum += h.data[(record % perPage) * PAGESIZE_RECORD];
+          unpinPage(&bm, &h);
+        }
+      lookupNanos = nowNanos() - start;
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+      destroyPageFile(BENCH_FILE);
+
+      printf("%10d %8d %8d %12.1f %14.0f\n", pageSize, numPages, numFrames,
+             (double) numPages * pageSize * 1000.0 / scanNanos, numLookups * 1e9 / lookupNanos);
+    }
+  return checksum == -1;
+}
+
+// a record of the compressed table, its strings padded with zeros as getRecord leaves them
+static void
+fillRecord (char *record, int key)
+{
+  static const char *cities[] = { "Chicago", "Springfield", "Naperville", "Evanston", "Peoria" };
+  int amount = key * 37 % 10000;
+
+  memset(record, 0, COMPRESS_RECORD);
+  memcpy(record, &key, sizeof(int));
+  snprintf(record + sizeof(int), COMPRESS_NAME, "customer-%d", key);
+  strcpy(record + sizeof(int) + COMPRESS_NAME, cities[key % 5]);
+  memcpy(record + sizeof(int) + COMPRESS_NAME + COMPRESS_CITY, &amount, sizeof(int));
+}
+
+static int
+benchCompression (int fileMB)
+{
+  int numPages = (int) ((long long) fileMB * (1 << 20) / PAGE_SIZE);
+  int numFrames = PAGESIZE_POOL_MB * (1 << 20) / PAGE_SIZE;
+  int perPage = PAGE_SIZE / COMPRESS_RECORD;
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  BM_Readahead ra;
+  BM_CompressionStats stats;
+  struct stat st;
+  long checksum = 0;
+  int compressed, i, r;
+
+  if (fileMB < 1)
+    {
+      fprintf(stderr, "compress: need fileMB >= 1\n");
+      return 1;
+    }
+
+  initStorageManager();
+  printf("%d MB of %d-byte records, %d MB pool\n", fileMB, COMPRESS_RECORD, PAGESIZE_POOL_MB);
+  printf("%12s %10s %14s %12s %12s %16s\n", "file", "MB", "bytes/page", "write MB/s", "scan MB/s",
+         "decompress ns");
+  for (compressed = 0; compressed <= 1; compressed++)
+    {
+      long long start, writeNanos, scanNanos;
+
+      if ((compressed ? createCompressedPageFile(BENCH_FILE, PAGE_SIZE) : createPageFile(BENCH_FILE)) != RC_OK
+          || initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK)
+        {
+          fprintf(stderr, "could not create %s\n", BENCH_FILE);
+          return 1;
+        }
+      start = nowNanos();
+      for (i = 0; i < numPages; i++)
+        {
+          if (pinPage(&bm, &h, i) != RC_OK)
+            return 1;
+          memset(h.data, 0, PAGE_SIZE);
+          for (r = 0; r < perPage; r++)
+            fillRecord(h.data + r * COMPRESS_RECORD, i * perPage + r);
+          markDirty(&bm, &h);
+          unpinPage(&bm, &h);
+        }
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+      writeNanos = nowNanos() - start;
+      stat(BENCH_FILE, &st);
+
+      // scan every record, prefetching ahead like a table scan
+      evictFromPageCache(BENCH_FILE);
+      if (initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK)
+        return 1;
+      initReadahead(&ra);
+      start = nowNanos();
+      for (i = 0; i < numPages; i++)
+        {
+          readahead(&bm, &ra, NULL, i);
+          if (pinPage(&bm, &h, i) != RC_OK)
+            return 1;
+          for (r = 0; r < perPage; r++)
+            checksum += h.data[r * COMPRESS_RECORD + sizeof(int)];
+          unpinPage(&bm, &h);
+        }
+      scanNanos = nowNanos() - start;
+      getCompressionStats(&bm, &stats);
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+      destroyPageFile(BENCH_FILE);
+
+      printf("%12s %10.1f %14.0f %12.1f %12.1f %16.0f\n", compressed ? "compressed" : "plain",
+             st.st_size / 1048576.0,
+             compressed ? (double) stats.bytesRead / stats.pagesRead : (double) PAGE_SIZE,
+             (double) numPages * PAGE_SIZE * 1000.0 / writeNanos,
+             (double) numPages * PAGE_SIZE * 1000.0 / scanNanos,
+             compressed ? (double) stats.decompressNanos / stats.pagesRead : 0.0);
+    }
+  return checksum == -1;
+}
+
+static int
+benchChurn (int fileMB, int rounds)
+{
+  int numPages = (int) ((long long) fileMB * (1 << 20) / PAGE_SIZE);
+  int numFrames = PAGESIZE_POOL_MB * (1 << 20) / PAGE_SIZE;
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  BM_Readahead ra;
+  struct stat st;
+  char *live;
+  long checksum = 0;
+  int reuse, round, i, p, filePages, scanned;
+
+  if (fileMB < 1 || rounds < 0)
+    {
+      fprintf(stderr, "churn: need fileMB >= 1 and rounds >= 0\n");
+      return 1;
+    }
+
+  initStorageManager();
+  printf("%d MB of pages, %d rounds emptying and refilling 1/%d of them, %d MB pool\n", fileMB, rounds,
+         CHURN_FRACTION, PAGESIZE_POOL_MB);
+  printf("%12s %10s %10s %14s %12s\n", "pages", "file MB", "disk MB", "pages scanned", "scan ms");
+  for (reuse = 0; reuse <= 1; reuse++)
+    {
+      long long start, scanNanos;
+      int total = numPages;
+
+      // the emptied pages of the first run stay in the file, so it grows by a quarter per round
+      live = calloc((size_t) numPages + (size_t) rounds * (numPages / CHURN_FRACTION) + 1, 1);
+      if (live == NULL || createPageFile(BENCH_FILE) != RC_OK
+          || initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK)
+        {
+          fprintf(stderr, "could not create %s\n", BENCH_FILE);
+          return 1;
+        }
+      srand(19);
+      for (i = 0; i < numPages; i++)
+        {
+          if (pinPage(&bm, &h, i) != RC_OK)
+            return 1;
+          memset(h.data, 'a' + i % 26, PAGE_SIZE);
+          markDirty(&bm, &h);
+          unpinPage(&bm, &h);
+          live[i] = 1;
+        }
+
+      for (round = 0; round < rounds; round++)
+        {
+          // page 0 holds the table's header and stays
+          for (i = 0; i < numPages / CHURN_FRACTION; i++)
+            {
+              do
+                p = 1 + rand() % (total - 1);
+              while (!live[p]);
+              live[p] = 0;
+              if (reuse)
+                {
+                  if (freePoolPage(&bm, p) != RC_OK)
+                    return 1;
+                  continue;
+                }
+              if (pinPage(&bm, &h, p) != RC_OK)
+                return 1;
+              memset(h.data, 0, PAGE_SIZE);
+              markDirty(&bm, &h);
+              unpinPage(&bm, &h);
+            }
+          for (i = 0; i < numPages / CHURN_FRACTION; i++)
+            {
+              if (reuse)
+                {
+                  if (allocatePoolPage(&bm, &p) != RC_OK)
+                    return 1;
+                }
+              else
+                p = total;
+              if (p == total)
+                total++;
+              if (pinPage(&bm, &h, p) != RC_OK)
+                return 1;
+              memset(h.data, 'a' + p % 26, PAGE_SIZE);
+              markDirty(&bm, &h);
+              unpinPage(&bm, &h);
+              live[p] = 1;
+            }
+        }
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+      stat(BENCH_FILE, &st);
+      filePages = (int) ((st.st_size - PAGE_SIZE) / PAGE_SIZE);
+
+      // scan the file from disk, reading only the pages in use
+      evictFromPageCache(BENCH_FILE);
+      if (initBufferPool(&bm, BENCH_FILE, numFrames, RS_CLOCK, NULL) != RC_OK)
+        return 1;
+      initReadahead(&ra);
+      scanned = 0;
+      start = nowNanos();
+      for (i = 0; i < filePages; i++)
+        {
+          if (isPoolPageFree(&bm, i))
+            continue;
+          readahead(&bm, &ra, NULL, i);
+          if (pinPage(&bm, &h, i) != RC_OK)
+            return 1;
+          checksum += h.data[0];
+          unpinPage(&bm, &h);
+          scanned++;
+        }
+      scanNanos = nowNanos() - start;
+      if (shutdownBufferPool(&bm) != RC_OK)
+        return 1;
+      destroyPageFile(BENCH_FILE);
+      free(live);
+
+      printf("%12s %10.1f %10.1f %14d %12.1f\n", reuse ? "freed" : "left empty", st.st_size / 1048576.0,
+             st.st_blocks * 512 / 1048576.0, scanned, scanNanos / 1e6);
+    }
+  return checksum == -1;
+}
+
+// drop the pages of a file and of its segment files from the page cache
+static void
+evictSegmentsFromPageCache (char *fileName)
+{
+  char path[256];
+  int seg;
+
+  evictFromPageCache(fileName);
+  for (seg = 1;; seg++)
+    {
+      snprintf(path, sizeof(path), "%s.%d", fileName, seg);
+      if (access(path, F_OK) != 0)
+        break;
+      evictFromPageCache(path);
+    }
+}
+
+static int
+benchSegments (int fileMB, int segmentMB, int numReads)
+{
+  int numPages = (int) ((long long) fileMB * (1 << 20) / PAGE_SIZE);
+  SM_SegmentLayout layout = { (int) ((long long) segmentMB * (1 << 20) / PAGE_SIZE), 0, NULL };
+  SM_SegmentStats stats;
+  SM_FileHandle fh;
+  char *buffer, *pages[SEGMENT_WRITE_PAGES];
+  long checksum = 0;
+  int segmented, i;
+
+  if (fileMB < 1 || segmentMB < 1 || numReads < 1 || segmentMB > fileMB)
+    {
+      fprintf(stderr, "segments: need fileMB >= segmentMB >= 1 and numReads >= 1\n");
+      return 1;
+    }
+  if (posix_memalign((void **) &buffer, PAGE_SIZE, PAGE_SIZE) != 0)
+    return 1;
+  memset(buffer, 0x5a, PAGE_SIZE);
+  for (i = 0; i < SEGMENT_WRITE_PAGES; i++)
+    pages[i] = buffer;
+
+  initStorageManager();
+  printf("%d MB file, %d MB segments, %d random reads\n", fileMB, segmentMB, numReads);
+  printf("%12s %8s %12s %14s %14s\n", "layout", "files", "write MB/s", "reads/s", "segment opens");
+  for (segmented = 0; segmented <= 1; segmented++)
+    {
+      long long start, writeNanos, readNanos;
+      RC rc = segmented ? createSegmentedPageFile(BENCH_FILE, PAGE_SIZE, &layout) : createPageFile(BENCH_FILE);
+
+      if (rc != RC_OK || openPageFile(BENCH_FILE, &fh) != RC_OK || ensureCapacity(numPages, &fh) != RC_OK)
+        {
+          fprintf(stderr, "could not create %s\n", BENCH_FILE);
+          return 1;
+        }
+      start = nowNanos();
+      for (i = 0; i < numPages; i += SEGMENT_WRITE_PAGES)
+        {
+          if (writeBlocks(i, numPages - i < SEGMENT_WRITE_PAGES ? numPages - i : SEGMENT_WRITE_PAGES, &fh, pages) != RC_OK)
+            return 1;
+        }
+      if (closePageFile(&fh) != RC_OK)
+        return 1;
+      writeNanos = nowNanos() - start;
+
+      // random reads from disk, through as many segment files as there are
+      evictSegmentsFromPageCache(BENCH_FILE);
+      if (openPageFile(BENCH_FILE, &fh) != RC_OK)
+        return 1;
+      srand(20);
+      start = nowNanos();
+      for (i = 0; i < numReads; i++)
+        {
+          if (readBlock(rand() % numPages, &fh, buffer) != RC_OK)
+            return 1;
+          checksum += buffer[0];
+        }
+      readNanos = nowNanos() - start;
+      getPageFileSegmentStats(&fh, &stats);
+      closePageFile(&fh);
+      destroyPageFile(BENCH_FILE);
+
+      printf("%12s %8d %12.1f %14.0f %14lld\n", segmented ? "segmented" : "single file",
+             segmented ? stats.numSegments : 1, (double) numPages * PAGE_SIZE * 1000.0 / writeNanos,
+             numReads * 1e9 / readNanos, stats.segmentOpens);
+    }
+  free(buffer);
+  return checksum == -1;
+}
+
+static int
+benchMetrics (int numPins)
+{
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  BM_PoolMetrics m;
+  int workingSet, i;
+
+  if (numPins < 1)
+    {
+      fprintf(stderr, "metrics: need numPins >= 1\n");
+      return 1;
+    }
+  initStorageManager();
+  if (createSparseFile(BENCH_FILE, 4 * METRICS_POOL_FRAMES) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+
+  printf("%d frames, %d pins, CLOCK\n", METRICS_POOL_FRAMES, numPins);
+  printf("%12s %10s %10s %10s %10s %10s %14s %14s %14s\n", "working set", "ns/pin", "hits", "misses",
+         "dirty ev", "clean ev", "hit p50/p99", "miss p50/p99", "read p50/p99");
+  for (workingSet = METRICS_POOL_FRAMES; workingSet <= 4 * METRICS_POOL_FRAMES; workingSet *= 4)
+    {
+      long long start, nanos;
+      char hit[32], miss[32], read[32];
+
+      if (initBufferPool(&bm, BENCH_FILE, METRICS_POOL_FRAMES, RS_CLOCK, NULL) != RC_OK)
+        return 1;
+      srand(21);
+      start = nowNanos();
+      for (i = 0; i < numPins; i++)
+        {
+          if (pinPage(&bm, &h, rand() % workingSet) != RC_OK)
+            return 1;
+          if (i % 16 == 0)
+            markDirty(&bm, &h);
+          unpinPage(&bm, &h);
+        }
+      nanos = nowNanos() - start;
+      getPoolMetrics(&bm, &m);
+      shutdownBufferPool(&bm);
+
+      snprintf(hit, sizeof(hit), "%lld/%lld", latencyPercentile(&m.pinHit, 0.5), latencyPercentile(&m.pinHit, 0.99));
+      snprintf(miss, sizeof(miss), "%lld/%lld", latencyPercentile(&m.pinMiss, 0.5), latencyPercentile(&m.pinMiss, 0.99));
+      snprintf(read, sizeof(read), "%lld/%lld", latencyPercentile(&m.read, 0.5), latencyPercentile(&m.read, 0.99));
+      printf("%12d %10.1f %10lld %10lld %10lld %10lld %14s %14s %14s\n", workingSet, (double) nanos / numPins,
+             m.hits, m.misses, m.dirtyEvictions, m.cleanEvictions, hit, miss, read);
+    }
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// pin the miss ratio curve workload through a pool; returns the pool's misses, or -1 on error
+static long long
+replayMRCWorkload (BM_BufferPool *bm, int numPins)
+{
+  BM_PageHandle h;
+  BM_PoolMetrics m;
+  int i;
+
+  srand(23);
+  for (i = 0; i < numPins; i++)
+    {
+      int page = rand() % 100 < MRC_HOT_PERCENT ? rand() % MRC_HOT_PAGES : MRC_HOT_PAGES + rand() % MRC_COLD_PAGES;
+
+      if (pinPage(bm, &h, page) != RC_OK || unpinPage(bm, &h) != RC_OK)
+        return -1;
+    }
+  getPoolMetrics(bm, &m);
+  return m.misses;
+}
+
+static int
+benchMRC (int numPins)
+{
+  BM_BufferPool bm;
+  BM_MissRatioCurve curve;
+  int frames;
+
+  if (numPins < 1)
+    {
+      fprintf(stderr, "mrc: need numPins >= 1\n");
+      return 1;
+    }
+  initStorageManager();
+  if (createSparseFile(BENCH_FILE, MRC_HOT_PAGES + MRC_COLD_PAGES) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+
+  // estimate the curve from one pool
+  if (initBufferPool(&bm, BENCH_FILE, MRC_POOL_FRAMES, RS_CLOCK, NULL) != RC_OK
+      || replayMRCWorkload(&bm, numPins) < 0)
+    return 1;
+  getPoolMissRatioCurve(&bm, &curve);
+  printf("%d pins, %d%% on %d hot pages, the rest on %d others; estimated from a %d-frame pool at sampling rate %.4f\n",
+         numPins, MRC_HOT_PERCENT, MRC_HOT_PAGES, MRC_COLD_PAGES, MRC_POOL_FRAMES, curve.samplingRate);
+  printf("%10s %12s %12s\n", "frames", "estimated", "LRU");
+  for (frames = MRC_POOL_FRAMES / 8; frames <= 16 * MRC_POOL_FRAMES; frames *= 2)
+    {
+      BM_BufferPool lru;
+      double estimate;
+      long long misses;
+
+      getPoolMissRatio(&bm, frames, &estimate);
+      if (initBufferPool(&lru, BENCH_FILE, frames, RS_LRU, NULL) != RC_OK
+          || (misses = replayMRCWorkload(&lru, numPins)) < 0)
+        return 1;
+      shutdownBufferPool(&lru);
+      printf("%10d %11.1f%% %11.1f%%\n", frames, 100 * estimate, 100.0 * misses / numPins);
+    }
+  shutdownBufferPool(&bm);
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// pin the resize workload through a pool; returns the hit ratio of the pins, or -1 on error
+static double
+replayResizeWorkload (BM_BufferPool *bm, int numPins, unsigned int seed)
+{
+  BM_PageHandle h;
+  BM_PoolMetrics before, after;
+  int i;
+
+  getPoolMetrics(bm, &before);
+  for (i = 0; i < numPins; i++)
+    {
+      int page;
+
+      seed = seed * 1103515245u + 12345u;
+      page = (seed >> 8) % 100 < RESIZE_HOT_PERCENT ? (seed >> 12) % RESIZE_HOT_PAGES
+        : RESIZE_HOT_PAGES + (seed >> 12) % RESIZE_COLD_PAGES;
+      if (pinPage(bm, &h, page) != RC_OK || unpinPage(bm, &h) != RC_OK)
+        return -1;
+    }
+  getPoolMetrics(bm, &after);
+  return (double) (after.hits - before.hits) / numPins;
+}
+
+// a pin worker that tells the resizing thread when it is done
+static atomic_int resizeWorkersDone;
+
+static void *
+resizeWorkerMain (void *arg)
+{
+  pinWorkerMain(arg);
+  atomic_fetch_add(&resizeWorkersDone, 1);
+  return NULL;
+}
+
+// millions of pins per second of RESIZE_THREADS threads, the pool resized meanwhile or not; -1 on error
+static double
+runResizeWorkers (int numPins, bool resize, int *numResizes)
+{
+  BM_BufferPool bm;
+  PinWorker workers[RESIZE_THREADS];
+  pthread_t threads[RESIZE_THREADS];
+  long long start, elapsed;
+  int t, failed = 0;
+
+  if (initBufferPool(&bm, BENCH_FILE, RESIZE_POOL_FRAMES, RS_LRU, NULL) != RC_OK)
+    return -1;
+  atomic_store(&resizeWorkersDone, 0);
+  start = nowNanos();
+  for (t = 0; t < RESIZE_THREADS; t++)
+    {
+      workers[t].bm = &bm;
+      workers[t].workingSet = RESIZE_POOL_FRAMES / 2;
+      workers[t].numPins = numPins;
+      workers[t].seed = 42 + t;
+      workers[t].rc = RC_OK;
+      pthread_create(&threads[t], NULL, resizeWorkerMain, &workers[t]);
+    }
+  for (*numResizes = 0; resize && atomic_load(&resizeWorkersDone) < RESIZE_THREADS; (*numResizes)++)
+    if (resizeBufferPool(&bm, *numResizes % 2 == 0 ? RESIZE_POOL_FRAMES / 4 : RESIZE_POOL_FRAMES) != RC_OK)
+      failed = 1;
+  for (t = 0; t < RESIZE_THREADS; t++)
+    {
+      pthread_join(threads[t], NULL);
+      if (workers[t].rc != RC_OK)
+        failed = 1;
+    }
+  elapsed = nowNanos() - start;
+  if (shutdownBufferPool(&bm) != RC_OK || failed)
+    return -1;
+  return (double) RESIZE_THREADS * numPins * 1000.0 / elapsed;
+}
+
+static int
+benchResize (int numPins)
+{
+  static const int sizes[] = { RESIZE_POOL_FRAMES, RESIZE_POOL_FRAMES / 8, RESIZE_POOL_FRAMES };
+  BM_BufferPool online, restarted;
+  double onlineHits, restartedHits, still, resizing;
+  long long start, onlineNanos, restartNanos;
+  char step[32];
+  int s, numResizes;
+
+  if (numPins < 1)
+    {
+      fprintf(stderr, "resize: need numPins >= 1\n");
+      return 1;
+    }
+  initStorageManager();
+  if (createSparseFile(BENCH_FILE, RESIZE_HOT_PAGES + RESIZE_COLD_PAGES) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", BENCH_FILE);
+      return 1;
+    }
+
+  printf("%d pins per step, %d%% on %d hot pages, the rest on %d others, LRU\n",
+         numPins, RESIZE_HOT_PERCENT, RESIZE_HOT_PAGES, RESIZE_COLD_PAGES);
+  printf("%14s %12s %12s %12s %12s\n", "frames", "online ms", "restart ms", "online hits", "restart hits");
+  if (initBufferPool(&online, BENCH_FILE, sizes[0], RS_LRU, NULL) != RC_OK
+      || initBufferPool(&restarted, BENCH_FILE, sizes[0], RS_LRU, NULL) != RC_OK
+      || replayResizeWorkload(&online, numPins, 1) < 0 || replayResizeWorkload(&restarted, numPins, 1) < 0)
+    return 1;
+  for (s = 1; s < 3; s++)
+    {
+      start = nowNanos();
+      if (resizeBufferPool(&online, sizes[s]) != RC_OK)
+        return 1;
+      onlineNanos = nowNanos() - start;
+      start = nowNanos();
+      if (shutdownBufferPool(&restarted) != RC_OK
+          || initBufferPool(&restarted, BENCH_FILE, sizes[s], RS_LRU, NULL) != RC_OK)
+        return 1;
+      restartNanos = nowNanos() - start;
+
+      // the first pins after the step show what the pool kept, the rest warm it for the next one
+      onlineHits = replayResizeWorkload(&online, numPins / 20 + 1, s + 1);
+      restartedHits = replayResizeWorkload(&restarted, numPins / 20 + 1, s + 1);
+      if (onlineHits < 0 || restartedHits < 0
+          || replayResizeWorkload(&online, numPins, s + 1) < 0 || replayResizeWorkload(&restarted, numPins, s + 1) < 0)
+        return 1;
+      snprintf(step, sizeof(step), "%d -> %d", sizes[s - 1], sizes[s]);
+      printf("%14s %12.2f %12.2f %11.1f%% %11.1f%%\n", step, onlineNanos / 1e6, restartNanos / 1e6,
+             100 * onlineHits, 100 * restartedHits);
+    }
+  shutdownBufferPool(&online);
+  shutdownBufferPool(&restarted);
+
+  still = runResizeWorkers(numPins, false, &numResizes);
+  resizing = runResizeWorkers(numPins, true, &numResizes);
+  if (still < 0 || resizing < 0)
+    return 1;
+  printf("%d threads pinning %d pages: %.2f Mpins/s, %.2f Mpins/s during %d resizes between %d and %d frames\n",
+         RESIZE_THREADS, RESIZE_POOL_FRAMES / 2, still, resizing, numResizes, RESIZE_POOL_FRAMES / 4, RESIZE_POOL_FRAMES);
+  destroyPageFile(BENCH_FILE);
+  return 0;
+}
+
+// hits of the pools of the shared pool workload, which are views of one pool or pools of their own
+static long long
+sharedHits (BM_BufferPool *pools, bool shared)
+{
+  BM_PoolMetrics m;
+  long long hits = 0;
+  int f;
+
+  for (f = 0; f < (shared ? 1 : SHARED_FILES); f++)
+    {
+      getPoolMetrics(&pools[f], &m);
+      hits += m.hits;
+    }
+  return hits;
+}
+
+// pin the shared pool workload with file hot in use; returns the hit ratio of the pins, or -1 on error
+static double
+replaySharedWorkload (BM_BufferPool *pools, bool shared, int hot, int numPins, unsigned int seed)
+{
+  BM_PageHandle h;
+  long long before = sharedHits(pools, shared);
+  int i;
+
+  for (i = 0; i < numPins; i++)
+    {
+      int file = hot, page;
+
+      seed = seed * 1103515245u + 12345u;
+      if ((seed >> 8) % 100 < SHARED_HOT_PERCENT)
+        page = (seed >> 12) % SHARED_HOT_PAGES;
+      else
+        {
+          file = (hot + 1 + (seed >> 12) % (SHARED_FILES - 1)) % SHARED_FILES;
+          page = (seed >> 16) % SHARED_IDLE_PAGES;
+        }
+      if (pinPage(&pools[file], &h, page) != RC_OK || unpinPage(&pools[file], &h) != RC_OK)
+        return -1;
+    }
+  return (double) (sharedHits(pools, shared) - before) / numPins;
+}
+
+static int
+benchShared (int numPins)
+{
+  BM_BufferPool privatePools[SHARED_FILES], views[SHARED_FILES];
+  char names[SHARED_FILES][32];
+  double privateHits, sharedHitRatio;
+  long long start, privateNanos, sharedNanos;
+  int f;
+
+  if (numPins < 1)
+    {
+      fprintf(stderr, "shared: need numPins >= 1\n");
+      return 1;
+    }
+  initStorageManager();
+  for (f = 0; f < SHARED_FILES; f++)
+    {
+      snprintf(names[f], sizeof(names[f]), "benchshared%d.bin", f);
+      if (createSparseFile(names[f], SHARED_HOT_PAGES) != RC_OK)
+        {
+          fprintf(stderr, "could not create %s\n", names[f]);
+          return 1;
+        }
+    }
+  if (initSharedBufferPool(SHARED_POOL_FRAMES, RS_LRU, NULL) != RC_OK)
+    return 1;
+  for (f = 0; f < SHARED_FILES; f++)
+    if (initBufferPool(&privatePools[f], names[f], SHARED_POOL_FRAMES / SHARED_FILES, RS_LRU, NULL) != RC_OK
+        || initPoolView(&views[f], names[f]) != RC_OK)
+      return 1;
+
+  printf("%d pins per phase, %d%% on %d pages of the file in use, the rest on %d pages of each other file, LRU\n",
+         numPins, SHARED_HOT_PERCENT, SHARED_HOT_PAGES, SHARED_IDLE_PAGES);
+  printf("%d files with %d frames each or sharing %d frames\n",
+         SHARED_FILES, SHARED_POOL_FRAMES / SHARED_FILES, SHARED_POOL_FRAMES);
+  printf("%8s %14s %14s %14s %14s\n", "in use", "private hits", "shared hits", "private ns/pin", "shared ns/pin");
+  for (f = 0; f < SHARED_FILES; f++)
+    {
+      start = nowNanos();
+      privateHits = replaySharedWorkload(privatePools, false, f, numPins, f + 1);
+      privateNanos = nowNanos() - start;
+      start = nowNanos();
+      sharedHitRatio = replaySharedWorkload(views, true, f, numPins, f + 1);
+      sharedNanos = nowNanos() - start;
+      if (privateHits < 0 || sharedHitRatio < 0)
+        return 1;
+      printf("%8d %13.1f%% %13.1f%% %14.0f %14.0f\n", f, 100 * privateHits, 100 * sharedHitRatio,
+             (double) privateNanos / numPins, (double) sharedNanos / numPins);
+    }
+  for (f = 0; f < SHARED_FILES; f++)
+    {
+      shutdownBufferPool(&privatePools[f]);
+      shutdownBufferPool(&views[f]);
+      destroyPageFile(names[f]);
+    }
+  shutdownSharedBufferPool();
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc == 1)
+    return benchMisses(1000000, 100000) || benchScan() || benchCleaner()
+      || benchThreads((int) sysconf(_SC_NPROCESSORS_ONLN), 1000000) || benchIO(16384, 64) || benchDirect(32768, 200000)
+      || benchMapped(32768, 200000) || benchPageSizes(128, 50000) || benchCompression(128)
+      || benchChurn(64, 8) || benchSegments(128, 4, 20000) || benchMetrics(2000000)
+      || benchMRC(400000) || benchResize(200000) || benchShared(400000);
+
+  if (strcmp(argv[1], "misses") == 0)
+    return benchMisses(argc > 2 ? atoi(argv[2]) : 1000000, argc > 3 ? atoi(argv[3]) : 100000);
+  if (strcmp(argv[1], "scan") == 0)
+    return benchScan();
+  if (strcmp(argv[1], "cleaner") == 0)
+    return benchCleaner();
+  if (strcmp(argv[1], "threads") == 0)
+    return benchThreads(argc > 2 ? atoi(argv[2]) : (int) sysconf(_SC_NPROCESSORS_ONLN),
+                        argc > 3 ? atoi(argv[3]) : 1000000);
+  if (strcmp(argv[1], "io") == 0)
+    return benchIO(argc > 2 ? atoi(argv[2]) : 16384, argc > 3 ? atoi(argv[3]) : 64);
+  if (strcmp(argv[1], "direct") == 0)
+    return benchDirect(argc > 2 ? atoi(argv[2]) : 32768, argc > 3 ? atoi(argv[3]) : 200000);
+  if (strcmp(argv[1], "mapped") == 0)
+    return benchMapped(argc > 2 ? atoi(argv[2]) : 32768, argc > 3 ? atoi(argv[3]) : 200000);
+  if (strcmp(argv[1], "pagesize") == 0)
+    return benchPageSizes(argc > 2 ? atoi(argv[2]) : 128, argc > 3 ? atoi(argv[3]) : 50000);
+  if (strcmp(argv[1], "compress") == 0)
+    return benchCompression(argc > 2 ? atoi(argv[2]) : 128);
+  if (strcmp(argv[1], "churn") == 0)
+    return benchChurn(argc > 2 ? atoi(argv[2]) : 64, argc > 3 ? atoi(argv[3]) : 8);
+  if (strcmp(argv[1], "segments") == 0)
+    return benchSegments(argc > 2 ? atoi(argv[2]) : 128, argc > 3 ? atoi(argv[3]) : 4,
+                         argc > 4 ? atoi(argv[4]) : 20000);
+  if (strcmp(argv[1], "metrics") == 0)
+    return benchMetrics(argc > 2 ? atoi(argv[2]) : 2000000);
+  if (strcmp(argv[1], "mrc") == 0)
+    return benchMRC(argc > 2 ? atoi(argv[2]) : 400000);
+  if (strcmp(argv[1], "resize") == 0)
+    return benchResize(argc > 2 ? atoi(argv[2]) : 200000);
+  if (strcmp(argv[1], "shared") == 0)
+    return benchShared(argc > 2 ? atoi(argv[2]) : 400000);
+
+  fprintf(stderr, "usage: %s [misses [maxFrames [missesPerSize]] | scan | cleaner | "
+          "threads [maxThreads [pinsPerThread]] | io [numPages [depth]] | "
+          "direct [numPages [numPins]] | mapped [numPages [numPins]] | "
+          "pagesize [fileMB [numLookups]] | compress [fileMB] | churn [fileMB [rounds]] | "
+          "segments [fileMB [segmentMB [numReads]]] | metrics [numPins] | mrc [numPins] | "
+          "resize [numPins] | shared [numPins]]\n", argv[0]);
+  return 1;
+}
@@ -37,7 +37,25 @@ RC initIndexManager(void *mgmtData) {
  */
 
 RC createBtree(char *idxId, DataType keyType, int n) {
-    int maxNodes = PAGE_SIZE / sizeof(Node);
+    return createBtreeWithPageSize(idxId, keyType, n, PAGE_SIZE);
+}
+
+
+/**
+ * @brief Creates a new B+ Tree like createBtree, in a page file with pages of the given size.
+ *
+ * The order a tree can have grows with the page size, so bigger pages allow a larger fanout.
+ *
+ * @param[in] idxId    The name of the B+ Tree.
+ * @param[in] keyType  The datatype of the key.
+ * @param[in] n        The order of the B+ Tree.
+ * @param[in] pageSize Bytes per page, a power of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE.
+ *
+ * @return RC_OK on success, RC_INVALID_PAGE_SIZE if the page size is not supported,
+ *         RC_ORDER_TOO_HIGH_FOR_PAGE if n nodes do not fit a page, or another error code on failure.
+ */
+RC createBtreeWithPageSize(char *idxId, DataType keyType, int n, int pageSize) {
+    int maxNodes = pageSize / sizeof(Node);
 
     // Return error if we cannot accommodate a B++ Tree of that order.
     if (n > maxNodes) {
@@ -61,10 +79,8 @@ RC createBtree(char *idxId, DataType keyType, int n) {
     SM_FileHandle fHandler;
     RC result;
 
-    char data[PAGE_SIZE];
-
     // Create page file. Return error code if error occurs.
-    if ((result = createPageFile(idxId)) != RC_OK)
+    if ((result = createPageFileWithPageSize(idxId, pageSize)) != RC_OK)
         return result;
 
     // Open page file.  Return error code if error occurs.
@@ -72,7 +88,10 @@ RC createBtree(char *idxId, DataType keyType, int n) {
         return result;
 
     // Write empty content to page.  Return error code if error occurs.
-    if ((result = writeBlock(0, &fHandler, data)) != RC_OK)
+    char *data = calloc(pageSize, 1);
+    result = data != NULL ? writeBlock(0, &fHandler, data) : RC_ERROR;
+    free(data);
+    if (result != RC_OK)
         return result;
 
     // Close page file.  Return error code if error occurs.
@@ -86,11 +105,14 @@ RC createBtree(char *idxId, DataType keyType, int n) {
 /**
  * @brief Shuts down the Index Manager.
  *
- * This function shuts down the Index Manager by setting the tree manager pointer to NULL.
+ * This function shuts down the Index Manager by releasing the shared buffer pool, if no table or
+ * index has it open, and setting the tree manager pointer to NULL.
  *
  * @return RC_OK on success, or an error code on failure.
  */
 RC shutdownIndexManager() {
+    // Release the shared buffer pool once no table or index has it open
+    shutdownSharedBufferPool();
     treeMgr = NULL;
     return RC_OK;
 }
@@ -204,8 +226,11 @@ RC openBtree(BTreeHandle **tree, char *idx) {
     // Assign the metadata structure to the B+ Tree handle
     (*tree)->mgmtData = treeMgr; // Assuming 'treeMgr' is a global variable or defined elsewhere
 
-    // Initialize a Buffer Pool using the Buffer Manager
-    RC result = initBufferPool(&treeMgr->bufferPool, idx, 1000, RS_FIFO, NULL);
+    // Open the index on the shared buffer pool, or, if the index cannot join it, on a pool of
+    // its own; ARC adapts to the index's access pattern by itself
+    RC result = initPoolView(&treeMgr->bufferPool, idx);
+    if (result != RC_OK)
+        result = initBufferPool(&treeMgr->bufferPool, idx, 1000, RS_ARC, NULL);
     
     // Check if the Buffer Pool initialization was successful
     if (result == RC_OK) {
@@ -1,741 +1,5548 @@
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
+#include<pthread.h>
+#include<stdatomic.h>
+#include<errno.h>
+#include<limits.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sched.h>
+#include<sys/mman.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 #include <math.h>
+#include <time.h>
 
 
+// Page number as the pool keys it: for the shared pool, the file's slot above the page number
+typedef long long PoolKey;
+
 typedef struct PageFrame
 {
 	SM_PageHandle data;
-	PageNumber pageNum;
-	int isDirtyBit; 
-	int fixCount; 
-	int lruCnt;   
-	int lfuCnt; 
+	PoolKey pageNum; // Changed only under the pool lock, while no page table partition maps the frame
+	atomic_int isDirtyBit; 
+	atomic_int fixCount; 
+	atomic_int lruCnt;   
+	atomic_int lfuCnt; 
+	atomic_int loading; // Set while the page is read in; pinners wait for it on the pool's ioDone
+	RC loadRc;          // Result of the frame's last read; a failed read leaves the frame empty
+	atomic_int prefetched; // Read in by prefetchPages and not pinned since
+	atomic_int writing; // Set while forceFlushPool's asynchronous write of the page is in flight
+	RC writeRc;         // Result of that write, set under the pool's ioLock as writing is cleared
+	SM_IORequest io;    // The frame's asynchronous read or write; a frame has at most one in flight
+	int hashNext; // Next frame in the same page table bucket (NO_FRAME terminates the chain)
+	int list;     // Recency list the frame is on (NO_LIST if none)
+	int lruPrev;  // Neighbour towards the most recently used end of that list
+	int lruNext;  // Neighbour towards the least recently used end of that list
+	pthread_rwlock_t latch; // Content latch (see latchPage)
+	bool retired; // Emptied by a shrinking resizeBufferPool and kept pinned until the pool drops it
 } PageFrame;
 
+#define NO_FRAME -1
+#define NO_LIST -1
+
+// Head, tail and length of a doubly-linked recency list, most recently used at the head
+typedef struct RecencyList
+{
+	int head;
+	int tail;
+	int size;
+} RecencyList;
+
+// A page number remembered after its page left the pool (ARC and 2Q only)
+typedef struct GhostEntry
+{
+	PoolKey pageNum;
+	int hashNext; // Next entry in the same bucket
+	int list;     // Ghost list the entry is on (NO_LIST for a free entry)
+	int prev;     // Neighbour towards the most recently evicted end of that list
+	int next;     // Neighbour towards the least recently evicted end, or the next free entry
+} GhostEntry;
+
+// Ghost lists with a hash index on page number: ARC's B1 and B2, 2Q's A1out
+typedef struct GhostDir
+{
+	GhostEntry *entries;
+	int *buckets;          // Bucket heads, each the first entry in the bucket's chain
+	int bits;              // The index has (1 << bits) buckets
+	int freeEntry;         // First free entry, free entries chained through next
+	int capacity;          // Number of entries
+	RecencyList lists[2];
+} GhostDir;
+
+// ARC lists: resident T1 (seen once) and T2 (seen again), ghost B1 and B2
+#define ARC_T1 0
+#define ARC_T2 1
+#define ARC_B1 0
+#define ARC_B2 1
+
+// 2Q lists: resident A1in (FIFO of new pages) and Am (LRU of re-referenced pages), ghost A1out
+#define TWOQ_A1IN 0
+#define TWOQ_AM 1
+#define TWOQ_A1OUT 0
+
+// LRU-K defaults used when initBufferPool is given no BM_LRUKParams
+#define LRUK_DEFAULT_K 2
+#define LRUK_DEFAULT_CORRELATED_PERIOD 4
+
+// RS_LRU_K bookkeeping: reference histories of resident pages plus retained histories of evicted ones
+typedef struct LRUKState
+{
+	int k;                // Number of uncorrelated references remembered per page
+	int correlatedPeriod; // References closer than this to the previous one are correlated
+	int now;              // Logical clock, advanced on every pin
+	int *hist;            // hist[f * k + j] is frame f's (j+1)-th most recent uncorrelated reference (0 = none)
+	int *last;            // last[f] is frame f's most recent reference, correlated or not
+
+	// Histories of evicted pages live in a ring of historySize slots; the oldest slot is reused
+	int historySize;
+	int historyBits;      // The history index has (1 << historyBits) buckets
+	int historyNext;      // Ring slot to be reused next
+	int *historyTable;    // Bucket heads, each the first slot in the bucket's chain
+	PoolKey *histPage; // Page whose history a slot holds (NO_PAGE for an empty slot)
+	int *histChain;       // Next slot in the same bucket
+	int *histTimes;       // histTimes[s * k + j] is the retained hist of slot s
+} LRUKState;
+
+// The miss ratio estimator tracks at most this many sampled pages, lowering its sampling rate
+// to stay within them (fixed-size SHARDS)
+#define MRC_MAX_SAMPLES 2048
+#define MRC_TABLE_BITS 12
+
+// Sampling hashes lie in [0, MRC_HASH_RANGE); a page is sampled while its hash is below the threshold
+#define MRC_HASH_RANGE (1u << 24)
+
+// Fraction of pages sampled at first is 1 / MRC_INITIAL_RATE_DIVISOR; a sampled pin costs about
+// as much as a hit, so this keeps the average cost of a pin down to a few ns
+#define MRC_INITIAL_RATE_DIVISOR 8
+
+// Buckets of the reuse distance histogram, each as wide as the histogram needs
+#define MRC_BUCKETS 1024
+
+// Logical times handed out before the tracked pages are renumbered
+#define MRC_CLOCK_RANGE (4 * MRC_MAX_SAMPLES)
+
+// Online estimate of a pool's LRU miss ratio curve from the reuse distances of sampled pages
+typedef struct MRCEstimator
+{
+	pthread_mutex_t lock;   // Guards all but the threshold
+	atomic_uint threshold;  // Pages hashing below this are sampled; only ever lowered
+	long long sampled;      // Sampled references
+
+	// Tracked pages, one per slot, with a hash index on page number
+	PoolKey pages[MRC_MAX_SAMPLES];
+	unsigned int hashes[MRC_MAX_SAMPLES];
+	int lastUse[MRC_MAX_SAMPLES]; // Logical time of the slot's last reference
+	int chain[MRC_MAX_SAMPLES];   // Next slot in the same bucket, or the next free slot
+	int table[1 << MRC_TABLE_BITS];
+	int freeSlot;
+	int numTracked;
+
+	// Fenwick tree over logical times holding a 1 at the last reference of every tracked page,
+	// so the pages referenced since a time are counted in O(log n)
+	int clock;
+	int tree[MRC_CLOCK_RANGE + 1];
+
+	// Sampled references by reuse distance, scaled to all pages; rescaled when the rate drops
+	double histogram[MRC_BUCKETS];
+	long long bucketWidth;  // Distances per bucket, doubled when a distance falls past the last
+	double coldReferences;  // First references, which miss at any size
+	double totalReferences;
+} MRCEstimator;
+
+// The page table's buckets are split into this many partitions, each with its own latch. A
+// page's partition is the top bits of its hash, so it stays the same when the table is resized
+#define PAGE_TABLE_PARTITION_BITS 6
+#define PAGE_TABLE_PARTITIONS (1 << PAGE_TABLE_PARTITION_BITS)
+
+// A page table partition's latch and hit counter, padded to a cache line so that partitions never share one
+typedef union PageTablePartition
+{
+	struct
+	{
+		pthread_mutex_t latch;
+		long long hits; // Pins that found their page in the partition, counted under the latch
+	};
+	char pad[64];
+} PageTablePartition;
+
+// A latency histogram updated without locks (see BM_LatencyHist)
+typedef struct LatencyHist
+{
+	atomic_llong count;
+	atomic_llong sumNanos;
+	atomic_llong buckets[BM_HIST_BUCKETS];
+} LatencyHist;
+
+// Pins a pool's trace buffers before writing them to its file
+#define TRACE_BUFFER_RECORDS 4096
+
+// A trace file starts with TRACE_MAGIC, the page size and the number of frames, followed by one
+// record per pin: the slot of the page's file, the page number and the time since the trace
+// started, shifted left by one with the hit in the low bit. All are in host byte order
+#define TRACE_MAGIC "BMTRACE2"
+#define TRACE_HEADER_BYTES 16
+#define TRACE_RECORD_BYTES 16
 
-int HIT = 0;
-int CLOCK_POINTER = 0;
-int LFU_POINTER = 0;
-int BUFFER_SIZE = 0;
-int REAR_INDEX = 0;
-int WRITE_COUNT = 0;
+// A pool's access trace being recorded (see startPoolTrace)
+typedef struct PoolTrace
+{
+	pthread_mutex_t lock; // Guards the buffer and the file
+	int fd;
+	long long start;      // Clock reading when the trace started
+	int numBuffered;      // Records in the buffer
+	bool failed;          // A write to the file failed; later records are dropped
+	char buffer[TRACE_BUFFER_RECORDS * TRACE_RECORD_BYTES];
+} PoolTrace;
+
+// Pages the cleaner snapshots and writes per round trip through the pool lock
+#define CLEANER_BATCH 16
+
+// Background writer of a pool (see startPoolCleaner)
+typedef struct PoolCleaner
+{
+	pthread_t thread;
+	pthread_cond_t wake;  // Signalled by pinPage when clean frames run low, and to stop
+	int lowWatermark;     // Start cleaning when fewer frames than this are clean
+	int highWatermark;    // Stop once this many frames are clean
+	bool stop;            // Set by stopPoolCleaner
+	bool writing;         // A batch is pinned and being written with the pool lock released
+	char *buffers;        // CLEANER_BATCH page-aligned snapshots being written
+} PoolCleaner;
+
+// A pool's I/O queue has room for every frame, up to this many
+#define POOL_IO_MAX_DEPTH 1024
+
+// Completions the reaper takes from the queue at a time
+#define POOL_IO_BATCH 64
+
+// Asynchronous I/O of a pool's page file: a storage manager I/O queue plus a thread reaping its completions
+typedef struct PoolIO
+{
+	SM_IOQueue queue;
+	struct BufferPoolMgr *mgr; // The pool whose frames the requests read into or write from
+	pthread_t reaper;
+	pthread_cond_t work; // Signalled, under the pool's ioLock, when requests are submitted, and to stop
+	int pending;         // Requests submitted whose completion the reaper has not handled; guarded by ioLock
+	bool stop;           // Set by shutdownBufferPool; the reaper exits once nothing is pending
+} PoolIO;
+
+// A page file whose pages a pool holds: the pool's own, or one per view of the shared pool
+typedef struct PoolFile
+{
+	char *name;               // Name of the page file
+	SM_FileHandle fileHandle; // Opened on first use and kept open until the file leaves the pool
+	bool directIO;            // Page I/O bypasses the OS page cache (see setPoolDirectIO)
+	PoolIO *io;               // Started by the first prefetch or flush of the file's pages, NULL until then
+	pthread_mutex_t lock;     // Serializes opening the file and changing its size, which the storage manager leaves to its callers
+	atomic_bool isOpen;       // Set once fileHandle is open, so finding the open file takes no lock
+} PoolFile;
+
+// The shared pool keys its frames by (file, page): the file's slot goes above the
+// POOL_FILE_PAGE_BITS bits of the page number, so every page number of every file has a key of
+// its own and the page table, the strategies and the estimators work on keys unchanged. A pool
+// of its own has its file in slot 0, so its keys are its page numbers.
+#define POOL_FILE_PAGE_BITS 32
+#define POOL_FILE_PAGE_MASK ((1LL << POOL_FILE_PAGE_BITS) - 1)
+#define POOL_MAX_FILES 128
+
+// fileSlot of the shared pool's own handle, whose calls cover every file
+#define NO_FILE -1
+
+// Times its initial size a pool reserves address space for, so that resizeBufferPool can grow
+// it without moving its frames; only the frames in use take memory. BM_POOL_MAX_FRAMES_ENV
+// sets the limit instead
+#define POOL_GROWTH_FACTOR 8
+
+// Frames resizeBufferPool retires per hold of the pool lock while shrinking a pool
+#define RESIZE_BATCH 16
+
+// Bookkeeping kept in bm->mgmtData: the frames plus a page table mapping page numbers to frames
+typedef struct BufferPoolMgr
+{
+	bool shared;        // The process-wide pool of initPoolView, keyed by (file, page)
+	PoolFile *files[POOL_MAX_FILES]; // Page files by slot, changed under the pool lock; a pool of its own only has files[0]
+	PageFrame *frames;  // Reserved for capacity frames, of which [0, bufferSize) are usable
+	char *arena;        // One page-aligned slab holding every frame's page buffer, reserved likewise
+	int capacity;       // Frames the reservations have room for
+	int *pageTable;     // Bucket heads, each the index of the first frame in the bucket's chain
+	int pageTableBits;  // The page table has (1 << pageTableBits) buckets, at least one per partition
+	PageTablePartition *partitions; // Bucket b is guarded by partitions[b >> (pageTableBits - PAGE_TABLE_PARTITION_BITS)]
+	int numUsedFrames;  // Frames are filled in order, so frames [0, numUsedFrames) have held pages
+	bool mapped;        // Pins point into the mapped page file instead of frames (see initMappedBufferPool)
+	atomic_int mappedPins; // Pins held on a mapped pool's pages
+
+	// Replacement state, counters and sizing, kept per pool so several pools can coexist
+	RecencyList lists[2]; // Resident frames: RS_LRU uses lists[0], ARC keeps T1/T2, 2Q keeps A1in/Am
+	GhostDir *ghosts;   // ARC and 2Q only, NULL otherwise
+	int adaptTarget;    // ARC: target size of T1, adapted on ghost hits; 2Q: maximum size of A1in
+	int ghostLimit;     // 2Q: maximum size of A1out
+	int pendingGhost;   // Ghost entry of the page being brought in by pinPage, or NO_FRAME
+	atomic_int clockPointer; // CLOCK hand, also advanced by hits
+	int lfuPointer;     // Where the next LFU search starts
+	atomic_int bufferSize; // Number of frames in the pool, those a shrink is still retiring included
+	atomic_int targetSize; // Number of frames the pool keeps; less than bufferSize while shrinking
+	int rearIndex;      // Number of frames taken for pages, minus one; FIFO's hand
+	atomic_int writeCount; // Number of pages written back to the page file
+	LRUKState *lruk;    // RS_LRU_K only, NULL otherwise
+
+	// The pool lock guards the replacement state above, which frame holds which page and the
+	// cleaner. Hits only take it for strategies that reorder lists or histories on every pin.
+	pthread_mutex_t lock;
+	atomic_int numDirty; // Frames with isDirtyBit set
+	int victimWrites;    // Dirty victims misses are writing back with the pool lock released
+	pthread_cond_t victimWritten; // Signalled, under the pool lock, whenever one of those writes is done
+	PoolCleaner *cleaner; // NULL unless startPoolCleaner was called
+	atomic_int cleanerLowWatermark; // The cleaner's low watermark, 0 while none runs
+	BM_CleanerStats cleanerStats; // Kept across cleaner restarts
+
+	// Pinners of a page still being read in wait on ioDone until its frame stops loading, and
+	// forceFlushPool until its writes are done
+	pthread_mutex_t ioLock;
+	pthread_cond_t ioDone;
+
+	// Metrics (see getPoolMetrics); hits are counted by the page table partitions, misses and
+	// evictions under the pool lock, the rest with relaxed atomics
+	long long misses;
+	long long dirtyEvictions;
+	long long cleanEvictions;
+	atomic_llong pinWaits;
+	atomic_llong readCount; // Pages read from the page file, counted when the read is issued
+	LatencyHist pinHitLatency;
+	LatencyHist pinMissLatency;
+	LatencyHist readLatency;
+	LatencyHist writeLatency;
+	PoolTrace *trace;   // NULL unless the pool's pins are traced
+	MRCEstimator *mrc;  // Miss ratio curve of the pool's pins (see getPoolMissRatioCurve)
+} BufferPoolMgr;
+
+// The process-wide pool views are opened on (see initPoolView); mgmtData is NULL until it exists
+static BM_BufferPool sharedPool;
+
+// Serializes creating and shutting down the shared pool and opening and closing its views
+static pthread_mutex_t sharedPoolLock = PTHREAD_MUTEX_INITIALIZER;
+
+static RC closePoolView(BM_BufferPool *const bm);
 
 
 /**
- * @brief Retrieves the number of pages read from disk since the buffer pool was initialized.
+ * @brief Hashes a frame key into a table of (1 << bits) buckets.
  *
- * This function calculates the number of pages read from disk by adding one to the REAR_INDEX value,
- * which represents the index of the last page read into the buffer pool.
+ * @param pageNum Page number as the pool keys it.
+ * @param bits Number of bits of bucket index.
+ * @return The bucket index for the page.
+ */
+static inline int fibHash(PoolKey pageNum, int bits)
+{
+    if (bits == 0)
+        return 0;
+    return (int)(((unsigned long long)pageNum * 11400714819323198485ull) >> (64 - bits));
+}
+
+
+/**
+ * @brief Hashes a page number to a page table bucket.
  *
- * @param bm Pointer to the buffer pool structure.
- * @return The number of pages read from disk.
+ * Uses Fibonacci (multiplicative) hashing and keeps the top pageTableBits bits, so that
+ * consecutive page numbers are spread over the whole table.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param pageNum Page number to hash.
+ * @return The bucket index for the page.
  */
-extern int getNumReadIO(BM_BufferPool *const bm)
+static inline int hashPageNum(BufferPoolMgr *mgr, PoolKey pageNum)
 {
-    // Adding one to REAR_INDEX because indexing starts from 0
-    return (REAR_INDEX + 1);
+    return fibHash(pageNum, mgr->pageTableBits);
 }
 
 
 /**
- * @brief Retrieves the number of pages written to the page file since the buffer pool was initialized.
+ * @brief Returns the page table partition a page number hashes to.
  *
- * This function simply returns the value of WRITE_COUNT, which records the number of writes done by the buffer manager.
+ * The partition is the top PAGE_TABLE_PARTITION_BITS bits of the page's hash, which are the top
+ * bits of its bucket whatever the size of the table, so all pages of a bucket share a partition.
  *
- * @param bm Pointer to the buffer pool structure.
- * @return The number of pages written to the page file.
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param pageNum Page number to hash.
+ * @return The partition, whose latch guards every lookup or change of the page's bucket.
  */
-extern int getNumWriteIO(BM_BufferPool *const bm)
+static inline PageTablePartition *pagePartition(BufferPoolMgr *mgr, PoolKey pageNum)
 {
-    return WRITE_COUNT;
+    return &mgr->partitions[fibHash(pageNum, PAGE_TABLE_PARTITION_BITS)];
 }
 
 
 /**
- * @brief Retrieves an array of page numbers representing the contents of the buffer pool.
+ * @brief Returns the latch of the page table partition a page number hashes to.
  *
- * This function allocates memory for an array of page numbers and populates it with the page numbers of pages currently stored in the buffer pool.
- * If a page frame is empty (unpinned), it is represented by the value NO_PAGE.
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param pageNum Page number to hash.
+ * @return The partition's latch, which guards every lookup or change of the page's bucket.
+ */
+static inline pthread_mutex_t *partitionLatch(BufferPoolMgr *mgr, PoolKey pageNum)
+{
+    return &pagePartition(mgr, pageNum)->latch;
+}
+
+
+/**
+ * @brief Returns the slot of the file a frame key belongs to.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param key Page number as the pool keys it.
+ * @return The slot in mgr->files, 0 for a pool of its own.
+ */
+static inline int keyFile(BufferPoolMgr *mgr, PoolKey key)
+{
+    return mgr->shared ? (int)(key >> POOL_FILE_PAGE_BITS) : 0;
+}
+
+
+/**
+ * @brief Returns the page number within its file of a frame key.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param key Page number as the pool keys it.
+ * @return The page number in the file, which is the key itself for a pool of its own.
+ */
+static inline PageNumber keyPage(BufferPoolMgr *mgr, PoolKey key)
+{
+    return (PageNumber)(mgr->shared ? key & POOL_FILE_PAGE_MASK : key);
+}
+
+
+/**
+ * @brief Returns the key under which the pool holds a page of a handle's file.
+ *
+ * @param bm Pointer to the buffer pool structure, a view for the shared pool.
+ * @param pageNum Page number in the file.
+ * @return The key, or NO_PAGE for a negative page number or the shared pool's own handle.
+ */
+static inline PoolKey pageKey(BM_BufferPool *const bm, PageNumber pageNum)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+    if (!mgr->shared)
+        return pageNum;
+    if (bm->fileSlot == NO_FILE || pageNum < 0)
+        return NO_PAGE;
+    return ((PoolKey)bm->fileSlot << POOL_FILE_PAGE_BITS) | pageNum;
+}
+
+
+/**
+ * @brief Tells whether a frame key is a page of the file a handle is for.
  *
  * @param bm Pointer to the buffer pool structure.
- * @return An array of page numbers representing the contents of the buffer pool.
+ * @param key Page number as the pool keys it, or NO_PAGE.
+ * @return true for any page through a pool's own handle, for the pages of its file through a view.
  */
-extern PageNumber *getFrameContents(BM_BufferPool *const bm)
+static inline bool inView(BM_BufferPool *const bm, PoolKey key)
 {
-    // Allocate memory for the array of page numbers
-    PageNumber *frmContents = malloc(sizeof(PageNumber) * BUFFER_SIZE);
-    // Retrieve the page frames from the buffer pool's management data
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-    
-    int i = 0;
-    // Iterate through all the pages in the buffer pool
-    while (i < BUFFER_SIZE)
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+    return key != NO_PAGE && (bm->fileSlot == NO_FILE || keyFile(mgr, key) == bm->fileSlot);
+}
+
+
+/**
+ * @brief Returns a monotonic clock reading in nanoseconds, for the pool's latency histograms.
+ */
+static inline long long nowNanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Records a latency in a histogram, in the bucket of its highest set bit.
+ *
+ * @param hist The histogram.
+ * @param nanos The latency in nanoseconds.
+ */
+static void histRecord(LatencyHist *hist, long long nanos)
+{
+    int bucket = nanos > 1 ? 63 - __builtin_clzll((unsigned long long)nanos) : 0;
+
+    if (bucket >= BM_HIST_BUCKETS)
+        bucket = BM_HIST_BUCKETS - 1;
+    atomic_fetch_add_explicit(&hist->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->sumNanos, nanos, memory_order_relaxed);
+    atomic_fetch_add_explicit(&hist->buckets[bucket], 1, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Copies a histogram into a snapshot.
+ */
+static void histSnapshot(LatencyHist *hist, BM_LatencyHist *snap)
+{
+    int b;
+
+    snap->count = atomic_load_explicit(&hist->count, memory_order_relaxed);
+    snap->sumNanos = atomic_load_explicit(&hist->sumNanos, memory_order_relaxed);
+    for (b = 0; b < BM_HIST_BUCKETS; b++)
+        snap->buckets[b] = atomic_load_explicit(&hist->buckets[b], memory_order_relaxed);
+}
+
+
+/**
+ * @brief Reads a page into a frame's buffer, counting and timing the read.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param key Page to read, as the pool keys it; its file is open.
+ * @param data Buffer to read the page into.
+ * @return The result of readBlock.
+ */
+static RC poolReadBlock(BufferPoolMgr *mgr, PoolKey key, SM_PageHandle data)
+{
+    long long start = nowNanos();
+    RC rc = readBlock(keyPage(mgr, key), &mgr->files[keyFile(mgr, key)]->fileHandle, data);
+
+    histRecord(&mgr->readLatency, nowNanos() - start);
+    atomic_fetch_add_explicit(&mgr->readCount, 1, memory_order_relaxed);
+    return rc;
+}
+
+
+/**
+ * @brief Writes a page from a buffer, timing the write. Callers count it in writeCount themselves.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param key Page to write, as the pool keys it; its file is open, as it is for any page the pool holds.
+ * @param data Buffer holding the page.
+ * @return The result of writeBlock.
+ */
+static RC poolWriteBlock(BufferPoolMgr *mgr, PoolKey key, SM_PageHandle data)
+{
+    long long start = nowNanos();
+    RC rc = writeBlock(keyPage(mgr, key), &mgr->files[keyFile(mgr, key)]->fileHandle, data);
+
+    histRecord(&mgr->writeLatency, nowNanos() - start);
+    return rc;
+}
+
+
+/**
+ * @brief Reserves address space for a pool's frames or page buffers, none of it usable yet.
+ *
+ * @param bytes Size of the reservation.
+ * @return The reservation, or NULL if the address space cannot be had.
+ */
+static void *reserveMemory(size_t bytes)
+{
+    void *p = mmap(NULL, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    return p == MAP_FAILED ? NULL : p;
+}
+
+
+/**
+ * @brief Rounds a size up to a whole number of system pages.
+ */
+static size_t systemPages(size_t bytes)
+{
+    size_t sysPage = (size_t)sysconf(_SC_PAGESIZE);
+
+    return (bytes + sysPage - 1) / sysPage * sysPage;
+}
+
+
+/**
+ * @brief Makes bytes [used, newUsed) of a reservation usable, bytes [0, used) being usable already.
+ *
+ * @param base The reservation.
+ * @param used Bytes in use so far.
+ * @param newUsed Bytes in use from now on.
+ * @return true on success, false if the memory cannot be committed.
+ */
+static bool commitMemory(void *base, size_t used, size_t newUsed)
+{
+    size_t from = systemPages(used), to = systemPages(newUsed);
+
+    return from >= to || mprotect((char *)base + from, to - from, PROT_READ | PROT_WRITE) == 0;
+}
+
+
+/**
+ * @brief Gives bytes [newUsed, used) of a reservation back to the system, keeping the address space.
+ *
+ * @param base The reservation.
+ * @param newUsed Bytes still in use.
+ * @param used Bytes in use so far.
+ */
+static void releaseMemory(void *base, size_t newUsed, size_t used)
+{
+    size_t from = systemPages(newUsed), to = systemPages(used);
+
+    if (from >= to)
+        return;
+    madvise((char *)base + from, to - from, MADV_DONTNEED);
+    mprotect((char *)base + from, to - from, PROT_NONE);
+}
+
+
+/**
+ * @brief Looks up the frame holding the given page. The caller holds the page's partition latch.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param pageNum Page number to look up.
+ * @return Index of the frame holding the page, or NO_FRAME if the page is not in the buffer pool.
+ */
+static int pageTableLookup(BufferPoolMgr *mgr, PoolKey pageNum)
+{
+    int frameIdx = mgr->pageTable[hashPageNum(mgr, pageNum)];
+
+    // Walk the bucket's chain until we find the page or run off the end
+    while (frameIdx != NO_FRAME && mgr->frames[frameIdx].pageNum != pageNum)
+        frameIdx = mgr->frames[frameIdx].hashNext;
+
+    return frameIdx;
+}
+
+
+/**
+ * @brief Adds a mapping from the frame's current page number to the frame.
+ *
+ * The caller holds the partition latch of the frame's page.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the frame whose pageNum has just been set.
+ */
+static void pageTableInsert(BufferPoolMgr *mgr, int frameIdx)
+{
+    int bucket = hashPageNum(mgr, mgr->frames[frameIdx].pageNum);
+
+    // Push the frame at the head of the bucket's chain
+    mgr->frames[frameIdx].hashNext = mgr->pageTable[bucket];
+    mgr->pageTable[bucket] = frameIdx;
+}
+
+
+/**
+ * @brief Removes the mapping for the page currently held in the given frame.
+ *
+ * The caller holds the partition latch of the frame's page.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the frame whose page is being dropped from the page table.
+ */
+static void pageTableRemove(BufferPoolMgr *mgr, int frameIdx)
+{
+    int *link = &mgr->pageTable[hashPageNum(mgr, mgr->frames[frameIdx].pageNum)];
+
+    // Find the link pointing at this frame and unhook the frame from the chain
+    while (*link != NO_FRAME)
     {
-        // Check if the page frame is occupied
-        if (pageFrame[i].pageNum != -1)
-        {
-            // If occupied, assign the page number to the corresponding index in frmContents
-            frmContents[i] = pageFrame[i].pageNum;
-        }
-        else
+        if (*link == frameIdx)
         {
-            // If not occupied, assign the value NO_PAGE to indicate an empty page frame
-            frmContents[i] = NO_PAGE;
+            *link = mgr->frames[frameIdx].hashNext;
+            break;
         }
-        i++;
+        link = &mgr->frames[*link].hashNext;
     }
-    return frmContents;
+    mgr->frames[frameIdx].hashNext = NO_FRAME;
 }
 
+
 /**
- * @brief Implementation of the CLOCK (Second Chance) replacement algorithm.
+ * @brief Rehashes the page table into (1 << bits) buckets.
  *
- * This function replaces a page frame in the buffer pool with a new page using the CLOCK algorithm.
- * The CLOCK algorithm simulates a clock hand that iterates over the page frames in a circular manner.
- * It gives pages a second chance by marking them as referenced (lruCnt = 0) when they are visited.
+ * Called with the pool lock held. Every partition latch is taken, in order, so no lookup sees
+ * the table half moved; pages keep their partitions, which do not depend on the table's size.
  *
- * @param bm Pointer to the buffer pool structure.
- * @param page Pointer to the new page to be added to the buffer pool.
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param bits Number of bits of bucket index, at least PAGE_TABLE_PARTITION_BITS.
+ * @return true on success, false if memory for the new table runs out.
  */
-extern void CLOCK(BM_BufferPool *const bm, PageFrame *page)
-{   
-    // Retrieve the array of page frames from the buffer pool's management data
-    PageFrame *pageFrames = (PageFrame *) bm->mgmtData;
-    
-    // Iterate over the page frames using the CLOCK algorithm
-    while(1)
-    {
-        // Ensure CLOCK_POINTER wraps around when reaching the end of the page frames array
-        CLOCK_POINTER = (CLOCK_POINTER % BUFFER_SIZE == 0) ? 0 : CLOCK_POINTER;
+static bool pageTableResize(BufferPoolMgr *mgr, int bits)
+{
+    int *table = malloc(sizeof(int) * (1 << bits));
+    int *old = mgr->pageTable;
+    int oldBits = mgr->pageTableBits;
+    int b, p, frameIdx, next;
 
-        // Check if the current page frame has not been referenced (lruCnt == 0)
-        if(pageFrames[CLOCK_POINTER].lruCnt == 0)
-        {
-            // If the page in memory has been modified (isDirtyBit = 1), write the page to disk
-            if(pageFrames[CLOCK_POINTER].isDirtyBit == 1)
-            {
-                SM_FileHandle fh;
-                openPageFile(bm->pageFile, &fh);
-                writeBlock(pageFrames[CLOCK_POINTER].pageNum, &fh, pageFrames[CLOCK_POINTER].data);
-                
-                // Increase the WRITE_COUNT which records the number of writes done by the buffer manager.
-                WRITE_COUNT++;
-            }
-            
-            // Set the content of the current page frame to the new page's content
-            pageFrames[CLOCK_POINTER].data = page->data;
-            pageFrames[CLOCK_POINTER].pageNum = page->pageNum;
-            pageFrames[CLOCK_POINTER].isDirtyBit = page->isDirtyBit;
-            pageFrames[CLOCK_POINTER].fixCount = page->fixCount;
-            pageFrames[CLOCK_POINTER].lruCnt = page->lruCnt;
-            CLOCK_POINTER++; // Move CLOCK_POINTER to the next page frame location
-            break; // Exit the loop
-        }
-        else
+    if (table == NULL)
+        return false;
+    for (b = 0; b < (1 << bits); b++)
+        table[b] = NO_FRAME;
+
+    for (p = 0; p < PAGE_TABLE_PARTITIONS; p++)
+        pthread_mutex_lock(&mgr->partitions[p].latch);
+    mgr->pageTable = table;
+    mgr->pageTableBits = bits;
+    for (b = 0; b < (1 << oldBits); b++)
+    {
+        for (frameIdx = old[b]; frameIdx != NO_FRAME; frameIdx = next)
         {
-            // Mark the current page frame as unreferenced (lruCnt = 0) and move to the next page frame
-            pageFrames[CLOCK_POINTER++].lruCnt = 0;     
+            next = mgr->frames[frameIdx].hashNext;
+            pageTableInsert(mgr, frameIdx);
         }
     }
+    for (p = PAGE_TABLE_PARTITIONS - 1; p >= 0; p--)
+        pthread_mutex_unlock(&mgr->partitions[p].latch);
+
+    free(old);
+    return true;
 }
 
 
 /**
- * @brief FIFO (First In First Out) replacement algorithm implementation.
+ * @brief Writes the records in a trace's buffer to its file. The caller holds the trace's lock.
  *
- * This function replaces a page frame in the buffer pool with a new page using the FIFO algorithm.
- * Pages are replaced based on the order they were added to the buffer pool.
- *
- * @param bufferPool Pointer to the buffer pool structure.
- * @param newPage Pointer to the new page to be added to the buffer pool.
+ * @param trace The trace.
  */
-extern void FIFO(BM_BufferPool *const bufferPool, PageFrame *newPage)
+static void traceFlush(PoolTrace *trace)
 {
-    // Retrieve the array of page frames from the buffer pool's management data
-    PageFrame *pageFrames = (PageFrame *) bufferPool->mgmtData;
-    
-    // Initialize variables for indexing the page frames
-    int index, frontIdx;
-    frontIdx = REAR_INDEX % BUFFER_SIZE;
+    size_t length = (size_t)trace->numBuffered * TRACE_RECORD_BYTES, done = 0;
+    ssize_t n;
 
-    // Iterate through all the page frames in the buffer pool
-    for(index = 0; index < BUFFER_SIZE; index++)
+    while (!trace->failed && done < length)
     {
-        // Check if the fix count for the current page frame is 0, indicating it's not pinned
-        if(pageFrames[frontIdx].fixCount == 0)
-        {
-            // If the page in memory has been modified (isDirtyBit = 1), write the page to disk
-            if(pageFrames[frontIdx].isDirtyBit == 1)
-            {
-                // Open the page file for writing
-                SM_FileHandle fileHandle;
-                openPageFile(bufferPool->pageFile, &fileHandle);
-                
-                // Write the page to disk
-                writeBlock(pageFrames[frontIdx].pageNum, &fileHandle, pageFrames[frontIdx].data);
-                
-                // Increase the WRITE_COUNT which records the number of writes done by the buffer manager.
-                WRITE_COUNT++;
-            }
-            
-            // Replace the content of the page frame with the content of the new page
-            pageFrames[frontIdx].isDirtyBit = newPage->isDirtyBit;
-            pageFrames[frontIdx].fixCount = newPage->fixCount;
-            pageFrames[frontIdx].data = newPage->data;
-            pageFrames[frontIdx].pageNum = newPage->pageNum;
-            break; // Exit the loop after finding a suitable page frame for replacement
-        }
-        else
-        {
-            // Move to the next page frame
-            frontIdx++;
-            frontIdx = (frontIdx % BUFFER_SIZE == 0) ? 0 : frontIdx; // Wrap around if necessary
-        }
+        n = write(trace->fd, trace->buffer + done, length - done);
+        if (n > 0)
+            done += n;
+        else if (n == 0 || errno != EINTR)
+            trace->failed = true;
     }
+    trace->numBuffered = 0;
+}
+
+
+/**
+ * @brief Appends a pin to a pool's trace.
+ *
+ * @param trace The pool's trace.
+ * @param fileSlot Slot of the page's file in a shared pool, 0 for other pools.
+ * @param pageNum Page pinned.
+ * @param hit Whether the page was found in a frame.
+ */
+static void traceRecord(PoolTrace *trace, int fileSlot, PageNumber pageNum, bool hit)
+{
+    long long stamp = (nowNanos() - trace->start) << 1 | (hit ? 1 : 0);
+    char *record;
+
+    pthread_mutex_lock(&trace->lock);
+    record = trace->buffer + (size_t)trace->numBuffered * TRACE_RECORD_BYTES;
+    memcpy(record, &fileSlot, sizeof(int));
+    memcpy(record + sizeof(int), &pageNum, sizeof(int));
+    memcpy(record + 2 * sizeof(int), &stamp, sizeof(long long));
+    if (++trace->numBuffered == TRACE_BUFFER_RECORDS)
+        traceFlush(trace);
+    pthread_mutex_unlock(&trace->lock);
+}
+
+
+/**
+ * @brief Pins the frame holding a page, if the page is in the pool.
+ *
+ * The pin is taken under the page's partition latch, so the frame cannot be handed over to
+ * another page between the lookup and the pin. A pin on behalf of a client counts as a hit
+ * in the partition, under the same latch.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param pageNum Page number to look up.
+ * @param hit Whether a pin counts as a hit.
+ * @return Index of the now pinned frame, or NO_FRAME if the page is not in the buffer pool.
+ */
+static int pinIfResident(BufferPoolMgr *mgr, PoolKey pageNum, bool hit)
+{
+    PageTablePartition *part = pagePartition(mgr, pageNum);
+    int frameIdx;
+
+    pthread_mutex_lock(&part->latch);
+    frameIdx = pageTableLookup(mgr, pageNum);
+    if (frameIdx != NO_FRAME)
+    {
+        mgr->frames[frameIdx].fixCount++;
+        if (hit)
+            part->hits++;
+    }
+    pthread_mutex_unlock(&part->latch);
+    return frameIdx;
+}
+
+
+/**
+ * @brief Waits until a pinned frame's page has been read in by the miss or prefetch that brought it in.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frame The pinned frame.
+ * @return true if the page was still being read in.
+ */
+static bool waitForLoad(BufferPoolMgr *mgr, PageFrame *frame)
+{
+    if (!frame->loading)
+        return false;
+
+    pthread_mutex_lock(&mgr->ioLock);
+    while (frame->loading)
+        pthread_cond_wait(&mgr->ioDone, &mgr->ioLock);
+    pthread_mutex_unlock(&mgr->ioLock);
+    return true;
+}
+
+
+/**
+ * @brief Marks a frame's page as read in and wakes the pinners waiting for it.
+ *
+ * The read may complete on another thread than the one that claimed the frame, which is why
+ * loads are waited for on a condition variable rather than on the frame's content latch.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frame The frame whose read has completed.
+ */
+static void finishLoad(BufferPoolMgr *mgr, PageFrame *frame)
+{
+    pthread_mutex_lock(&mgr->ioLock);
+    frame->loading = 0;
+    pthread_cond_broadcast(&mgr->ioDone);
+    pthread_mutex_unlock(&mgr->ioLock);
+}
+
+
+/**
+ * @brief Takes a victim frame away from its page so that pinPage can load another page into it.
+ *
+ * The replacement strategies pick victims without the partition latches, so a hit may have
+ * pinned the frame since; the fix count is checked again under the latch of the frame's page,
+ * and only an unpinned frame is unmapped. The frame is then pinned on behalf of the caller,
+ * which holds the pool lock.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the victim frame.
+ * @return true if the frame now belongs to the caller, false if it was pinned in the meantime.
+ */
+static bool claimFrame(BufferPoolMgr *mgr, int frameIdx)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    pthread_mutex_t *latch;
+
+    // An empty frame may still be pinned by those who waited for a read that failed (see failLoad)
+    if (frame->pageNum == NO_PAGE)
+    {
+        if (frame->fixCount != 0)
+            return false;
+        frame->fixCount = 1;
+        return true;
+    }
+
+    latch = partitionLatch(mgr, frame->pageNum);
+    pthread_mutex_lock(latch);
+    if (frame->fixCount != 0)
+    {
+        pthread_mutex_unlock(latch);
+        return false;
+    }
+    pageTableRemove(mgr, frameIdx);
+    frame->fixCount = 1;
+    pthread_mutex_unlock(latch);
+    return true;
+}
+
+
+/**
+ * @brief Writes back the page of a frame claimed by claimFrame, if it is dirty, before the page leaves the pool.
+ *
+ * Called with the pool lock held. A miss writes a dirty victim back before it claims it (see
+ * writePinnedVictim), so a page is only written here if it turned dirty after the victim was
+ * picked, or if a shrink evicts it. The page is marked not dirty before the write, as everywhere
+ * else, and dirty again if the write fails, so the change is not lost.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the claimed frame.
+ * @param writtenBack Whether the caller wrote the page back just before; its eviction then
+ *        counts as a dirty one.
+ * @return RC_OK if the page is clean now, or the error of the write.
+ */
+static RC writeBackVictim(BufferPoolMgr *mgr, int frameIdx, bool writtenBack)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    RC rc;
+
+    if (frame->pageNum == NO_PAGE)
+        return RC_OK;
+    if (atomic_exchange(&frame->isDirtyBit, 0) == 0)
+    {
+        if (writtenBack)
+            mgr->dirtyEvictions++;
+        else
+            mgr->cleanEvictions++;
+        return RC_OK;
+    }
+    mgr->numDirty--;
+    rc = poolWriteBlock(mgr, frame->pageNum, frame->data);
+    if (rc != RC_OK)
+    {
+        if (atomic_exchange(&frame->isDirtyBit, 1) == 0)
+            mgr->numDirty++;
+        return rc;
+    }
+
+    // With a cleaner running this should be rare, so count it; writeCount records the number of
+    // writes done by the buffer manager
+    mgr->dirtyEvictions++;
+    mgr->cleanerStats.syncWrites++;
+    mgr->writeCount++;
+    return RC_OK;
+}
+
+
+/**
+ * @brief Gives a frame claimed by claimFrame back to its page, whose write-back failed.
+ *
+ * Called with the pool lock held. The page goes back into the page table, still dirty, and the
+ * frame is unpinned, so a later flush or eviction tries the write again.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the claimed frame.
+ */
+static void keepVictim(BufferPoolMgr *mgr, int frameIdx)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    pthread_mutex_t *latch = partitionLatch(mgr, frame->pageNum);
+
+    pthread_mutex_lock(latch);
+    pageTableInsert(mgr, frameIdx);
+    frame->fixCount--;
+    pthread_mutex_unlock(latch);
+}
+
+
+/**
+ * @brief Pins a dirty victim in place, so that its page can be written back before the frame is claimed.
+ *
+ * Called with the pool lock held. As in claimFrame, the fix count is checked again under the
+ * latch of the frame's page, but the page stays in the page table.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the victim frame; it holds a page.
+ * @return true if the frame is now pinned by the caller, false if it was pinned in the meantime.
+ */
+static bool pinVictim(BufferPoolMgr *mgr, int frameIdx)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    pthread_mutex_t *latch = partitionLatch(mgr, frame->pageNum);
+    bool pinned;
+
+    pthread_mutex_lock(latch);
+    pinned = frame->fixCount == 0;
+    if (pinned)
+        frame->fixCount = 1;
+    pthread_mutex_unlock(latch);
+    return pinned;
+}
+
+
+/**
+ * @brief Writes back the page of a dirty victim pinned by pinVictim, with the pool lock released.
+ *
+ * Called without the pool lock, as the cleaner writes its batches: the page stays in the pool
+ * while it is written, so pins of it meanwhile are hits, and it is written under a shared
+ * content latch, so never half modified. The page is marked not dirty before the write and
+ * dirty again if the write fails.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the pinned frame.
+ * @param written Set if the page was written; someone else may have written it meanwhile.
+ * @return RC_OK, or the error of the write.
+ */
+static RC writePinnedVictim(BufferPoolMgr *mgr, int frameIdx, bool *written)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    RC rc = RC_OK;
+
+    *written = false;
+    pthread_rwlock_rdlock(&frame->latch);
+    if (atomic_exchange(&frame->isDirtyBit, 0) == 1)
+    {
+        mgr->numDirty--;
+        rc = poolWriteBlock(mgr, frame->pageNum, frame->data);
+        if (rc != RC_OK && atomic_exchange(&frame->isDirtyBit, 1) == 0)
+            mgr->numDirty++;
+        *written = rc == RC_OK;
+    }
+    pthread_rwlock_unlock(&frame->latch);
+    return rc;
+}
+
+
+/**
+ * @brief Unhooks a frame from the recency list it is on, if any.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the frame.
+ */
+static void listUnlink(BufferPoolMgr *mgr, int frameIdx)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    RecencyList *list;
+
+    if (frame->list == NO_LIST)
+        return;
+    list = &mgr->lists[frame->list];
+
+    if (frame->lruPrev != NO_FRAME)
+        mgr->frames[frame->lruPrev].lruNext = frame->lruNext;
+    else
+        list->head = frame->lruNext;
+
+    if (frame->lruNext != NO_FRAME)
+        mgr->frames[frame->lruNext].lruPrev = frame->lruPrev;
+    else
+        list->tail = frame->lruPrev;
+
+    list->size--;
+    frame->list = NO_LIST;
+    frame->lruPrev = frame->lruNext = NO_FRAME;
+}
+
+
+/**
+ * @brief Moves a frame to the most recently used end of a recency list.
+ *
+ * The frame is taken off whichever list it was on first, so this both adds newly filled
+ * frames and records repeated accesses.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param listId Index of the list in mgr->lists.
+ * @param frameIdx Index of the frame.
+ */
+static void listTouch(BufferPoolMgr *mgr, int listId, int frameIdx)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    RecencyList *list = &mgr->lists[listId];
+
+    if (list->head == frameIdx)
+        return;
+    listUnlink(mgr, frameIdx);
+
+    frame->list = listId;
+    frame->lruPrev = NO_FRAME;
+    frame->lruNext = list->head;
+    if (list->head != NO_FRAME)
+        mgr->frames[list->head].lruPrev = frameIdx;
+    else
+        list->tail = frameIdx;
+    list->head = frameIdx;
+    list->size++;
+}
+
+
+/**
+ * @brief Puts a frame at the least recently used end of a recency list, as the list's next victim.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param listId Index of the list in mgr->lists.
+ * @param frameIdx Index of the frame.
+ */
+static void listAppend(BufferPoolMgr *mgr, int listId, int frameIdx)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    RecencyList *list = &mgr->lists[listId];
+
+    listUnlink(mgr, frameIdx);
+    frame->list = listId;
+    frame->lruNext = NO_FRAME;
+    frame->lruPrev = list->tail;
+    if (list->tail != NO_FRAME)
+        mgr->frames[list->tail].lruNext = frameIdx;
+    else
+        list->head = frameIdx;
+    list->tail = frameIdx;
+    list->size++;
+}
+
+
+/**
+ * @brief Gives up on a page whose read failed: empties its frame and wakes the pinners waiting for it.
+ *
+ * Called with the frame pinned by the failed read, and without the pool lock. The page leaves
+ * the page table, so no one pins it any more, and its frame returns empty to where the next
+ * victim comes from, with no replacement history. The pinners already waiting for the read
+ * find the error in the frame's loadRc and drop their pins; the frame is reused only once
+ * they have.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param frameIdx Index of the frame the page was being read into.
+ * @param rc The error of the read.
+ */
+static void failLoad(BufferPoolMgr *mgr, int frameIdx, RC rc)
+{
+    PageFrame *frame = &mgr->frames[frameIdx];
+    pthread_mutex_t *latch;
+
+    pthread_mutex_lock(&mgr->lock);
+    latch = partitionLatch(mgr, frame->pageNum);
+    pthread_mutex_lock(latch);
+    pageTableRemove(mgr, frameIdx);
+    pthread_mutex_unlock(latch);
+
+    // Every list-based strategy takes its next victim from the end of list 0
+    if (mgr->lruk != NULL)
+    {
+        memset(&mgr->lruk->hist[(size_t)frameIdx * mgr->lruk->k], 0, sizeof(int) * mgr->lruk->k);
+        mgr->lruk->last[frameIdx] = 0;
+    }
+    if (frame->list != NO_LIST)
+    {
+        listUnlink(mgr, frameIdx);
+        listAppend(mgr, 0, frameIdx);
+    }
+    frame->pageNum = NO_PAGE;
+    frame->lruCnt = 0;
+    frame->lfuCnt = 0;
+    frame->prefetched = 0;
+    frame->loadRc = rc;
+
+    finishLoad(mgr, frame);
+    frame->fixCount--;
+    pthread_mutex_unlock(&mgr->lock);
+}
+
+
+/**
+ * @brief Puts a frame in another frame's place on its recency list, taking it off its own.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param oldIdx Index of the frame whose place is taken; it ends up on no list.
+ * @param newIdx Index of the frame taking it.
+ */
+static void listReplace(BufferPoolMgr *mgr, int oldIdx, int newIdx)
+{
+    PageFrame *old = &mgr->frames[oldIdx];
+    PageFrame *frame = &mgr->frames[newIdx];
+    RecencyList *list;
+
+    listUnlink(mgr, newIdx);
+    if (old->list == NO_LIST)
+        return;
+    list = &mgr->lists[old->list];
+
+    frame->list = old->list;
+    frame->lruPrev = old->lruPrev;
+    frame->lruNext = old->lruNext;
+    if (old->lruPrev != NO_FRAME)
+        mgr->frames[old->lruPrev].lruNext = newIdx;
+    else
+        list->head = newIdx;
+    if (old->lruNext != NO_FRAME)
+        mgr->frames[old->lruNext].lruPrev = newIdx;
+    else
+        list->tail = newIdx;
+
+    old->list = NO_LIST;
+    old->lruPrev = old->lruNext = NO_FRAME;
+}
+
+
+/**
+ * @brief Finds the least recently used frame on a recency list that is not pinned.
+ *
+ * Pinned frames near the least recently used end are skipped; there are only ever as many of
+ * them as concurrent pins.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param listId Index of the list in mgr->lists.
+ * @return Index of the frame, or NO_FRAME if every frame on the list is pinned.
+ */
+static int listVictim(BufferPoolMgr *mgr, int listId)
+{
+    int i;
+
+    for (i = mgr->lists[listId].tail; i != NO_FRAME; i = mgr->frames[i].lruPrev)
+    {
+        if (mgr->frames[i].fixCount == 0)
+            return i;
+    }
+    return NO_FRAME;
+}
+
+
+/**
+ * @brief Allocates the ghost lists of an ARC or 2Q pool.
+ *
+ * @param capacity Most ghost entries the pool keeps at once.
+ * @return The new directory, or NULL if memory runs out.
+ */
+static GhostDir *ghostCreate(int capacity)
+{
+    GhostDir *g = calloc(1, sizeof(GhostDir));
+    int i;
+
+    if (g == NULL)
+        return NULL;
+    while ((1 << g->bits) < capacity)
+        g->bits++;
+    g->entries = malloc(sizeof(GhostEntry) * capacity);
+    g->buckets = malloc(sizeof(int) * (1 << g->bits));
+    if (g->entries == NULL || g->buckets == NULL)
+    {
+        free(g->entries);
+        free(g->buckets);
+        free(g);
+        return NULL;
+    }
+
+    for (i = 0; i < (1 << g->bits); i++)
+        g->buckets[i] = NO_FRAME;
+    for (i = 0; i < capacity; i++)
+    {
+        g->entries[i].list = NO_LIST;
+        g->entries[i].next = i + 1 < capacity ? i + 1 : NO_FRAME;
+    }
+    g->freeEntry = 0;
+    g->capacity = capacity;
+    for (i = 0; i < 2; i++)
+    {
+        g->lists[i].head = g->lists[i].tail = NO_FRAME;
+        g->lists[i].size = 0;
+    }
+    return g;
+}
+
+
+/**
+ * @brief Frees the ghost lists of a pool.
+ *
+ * @param g Directory returned by ghostCreate (may be NULL).
+ */
+static void ghostDestroy(GhostDir *g)
+{
+    if (g == NULL)
+        return;
+    free(g->entries);
+    free(g->buckets);
+    free(g);
+}
+
+
+/**
+ * @brief Looks up the ghost entry of a page.
+ *
+ * @param g Ghost directory.
+ * @param pageNum Page number to look up.
+ * @return Index of the entry, or NO_FRAME if the page has no ghost.
+ */
+static int ghostLookup(GhostDir *g, PoolKey pageNum)
+{
+    int e = g->buckets[fibHash(pageNum, g->bits)];
+
+    while (e != NO_FRAME && g->entries[e].pageNum != pageNum)
+        e = g->entries[e].hashNext;
+    return e;
+}
+
+
+/**
+ * @brief Forgets a ghost entry, returning it to the free entries.
+ *
+ * @param g Ghost directory.
+ * @param e Index of an entry that is on a ghost list.
+ */
+static void ghostRemove(GhostDir *g, int e)
+{
+    GhostEntry *entry = &g->entries[e];
+    RecencyList *list = &g->lists[entry->list];
+    int *link = &g->buckets[fibHash(entry->pageNum, g->bits)];
+
+    while (*link != e)
+        link = &g->entries[*link].hashNext;
+    *link = entry->hashNext;
+
+    if (entry->prev != NO_FRAME)
+        g->entries[entry->prev].next = entry->next;
+    else
+        list->head = entry->next;
+    if (entry->next != NO_FRAME)
+        g->entries[entry->next].prev = entry->prev;
+    else
+        list->tail = entry->prev;
+    list->size--;
+
+    entry->list = NO_LIST;
+    entry->next = g->freeEntry;
+    g->freeEntry = e;
+}
+
+
+/**
+ * @brief Remembers an evicted page at the most recently evicted end of a ghost list.
+ *
+ * @param g Ghost directory.
+ * @param listId Ghost list to add the page to.
+ * @param pageNum The evicted page.
+ */
+static void ghostAdd(GhostDir *g, int listId, PoolKey pageNum)
+{
+    RecencyList *list = &g->lists[listId];
+    int bucket = fibHash(pageNum, g->bits);
+    int e = g->freeEntry;
+    GhostEntry *entry;
+
+    // The directory is sized so that trimming keeps a free entry; make room regardless
+    if (e == NO_FRAME)
+    {
+        ghostRemove(g, list->tail != NO_FRAME ? list->tail : g->lists[1 - listId].tail);
+        e = g->freeEntry;
+    }
+    entry = &g->entries[e];
+    g->freeEntry = entry->next;
+
+    entry->pageNum = pageNum;
+    entry->list = listId;
+    entry->hashNext = g->buckets[bucket];
+    g->buckets[bucket] = e;
+
+    entry->prev = NO_FRAME;
+    entry->next = list->head;
+    if (list->head != NO_FRAME)
+        g->entries[list->head].prev = e;
+    else
+        list->tail = e;
+    list->head = e;
+    list->size++;
+}
+
+
+/**
+ * @brief Moves a pool's ghost lists into a directory with room for more entries, keeping their order.
+ *
+ * @param g Ghost directory.
+ * @param capacity Most ghost entries the pool keeps from now on.
+ * @return The directory to use from now on, g itself if it is large enough (g is freed
+ *         otherwise), or NULL if memory runs out, g being kept.
+ */
+static GhostDir *ghostGrow(GhostDir *g, int capacity)
+{
+    GhostDir *grown;
+    int l, e;
+
+    if (capacity <= g->capacity)
+        return g;
+    grown = ghostCreate(capacity);
+    if (grown == NULL)
+        return NULL;
+
+    // Re-adding each list from its least recently evicted end leaves it in the same order
+    for (l = 0; l < 2; l++)
+        for (e = g->lists[l].tail; e != NO_FRAME; e = g->entries[e].prev)
+            ghostAdd(grown, l, g->entries[e].pageNum);
+    ghostDestroy(g);
+    return grown;
+}
+
+
+/**
+ * @brief Prepares the ARC or 2Q state for a miss on the given page.
+ *
+ * Looks the page up among the ghosts and, for ARC, adapts the target size of T1: a ghost hit
+ * in B1 means T1 was too small for the recency-heavy part of the workload, a hit in B2 that T2
+ * was too small for the frequency-heavy part.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param pageNum The page being pinned.
+ */
+static void adaptiveMiss(BM_BufferPool *const bm, PoolKey pageNum)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    GhostDir *g = mgr->ghosts;
+    int b1, b2;
+
+    mgr->pendingGhost = ghostLookup(g, pageNum);
+    if (bm->strategy != RS_ARC || mgr->pendingGhost == NO_FRAME)
+        return;
+
+    b1 = g->lists[ARC_B1].size;
+    b2 = g->lists[ARC_B2].size;
+    if (g->entries[mgr->pendingGhost].list == ARC_B1)
+    {
+        mgr->adaptTarget += b2 > b1 ? b2 / b1 : 1;
+        if (mgr->adaptTarget > mgr->bufferSize)
+            mgr->adaptTarget = mgr->bufferSize;
+    }
+    else
+    {
+        mgr->adaptTarget -= b1 > b2 ? b1 / b2 : 1;
+        if (mgr->adaptTarget < 0)
+            mgr->adaptTarget = 0;
+    }
+}
+
+
+/**
+ * @brief Moves a frame's ARC or 2Q bookkeeping over to a newly loaded page.
+ *
+ * The page leaving the frame becomes a ghost (ARC: in B1 or B2 according to the list it was
+ * on; 2Q: in A1out if it never left A1in). The incoming page goes to T2 or Am if it had a
+ * ghost and to T1 or A1in otherwise, after which the ghost lists are trimmed to their bounds.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param frameIdx Frame the page is being loaded into.
+ * @param oldPage Page leaving the frame, or NO_PAGE if the frame was empty.
+ */
+static void adaptiveLoad(BM_BufferPool *const bm, int frameIdx, PoolKey oldPage)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    GhostDir *g = mgr->ghosts;
+    int oldList = mgr->frames[frameIdx].list;
+    bool seenBefore = mgr->pendingGhost != NO_FRAME;
+
+    listUnlink(mgr, frameIdx);
+    if (seenBefore)
+        ghostRemove(g, mgr->pendingGhost);
+    mgr->pendingGhost = NO_FRAME;
+
+    if (bm->strategy == RS_ARC)
+    {
+        if (oldPage != NO_PAGE)
+            ghostAdd(g, oldList == ARC_T2 ? ARC_B2 : ARC_B1, oldPage);
+        listTouch(mgr, seenBefore ? ARC_T2 : ARC_T1, frameIdx);
+
+        // Keep |T1| + |B1| <= c and the four lists together <= 2c
+        while (g->lists[ARC_B1].size > 0
+               && mgr->lists[ARC_T1].size + g->lists[ARC_B1].size > mgr->bufferSize)
+            ghostRemove(g, g->lists[ARC_B1].tail);
+        while (g->lists[ARC_B1].size + g->lists[ARC_B2].size > mgr->bufferSize)
+            ghostRemove(g, g->lists[ARC_B2].size > 0 ? g->lists[ARC_B2].tail : g->lists[ARC_B1].tail);
+    }
+    else
+    {
+        if (oldPage != NO_PAGE && oldList == TWOQ_A1IN)
+            ghostAdd(g, TWOQ_A1OUT, oldPage);
+        listTouch(mgr, seenBefore ? TWOQ_AM : TWOQ_A1IN, frameIdx);
+
+        while (g->lists[TWOQ_A1OUT].size > mgr->ghostLimit)
+            ghostRemove(g, g->lists[TWOQ_A1OUT].tail);
+    }
+}
+
+
+/**
+ * @brief Drops the ARC or 2Q bookkeeping of a page leaving the pool with no page taking its frame.
+ *
+ * The page becomes a ghost as in adaptiveLoad, and its frame leaves the resident lists.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param frameIdx Frame the page is leaving; it holds a page.
+ */
+static void adaptiveEvict(BM_BufferPool *const bm, int frameIdx)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    GhostDir *g = mgr->ghosts;
+    int oldList = mgr->frames[frameIdx].list;
+    PoolKey oldPage = mgr->frames[frameIdx].pageNum;
+
+    listUnlink(mgr, frameIdx);
+    if (bm->strategy == RS_ARC)
+    {
+        ghostAdd(g, oldList == ARC_T2 ? ARC_B2 : ARC_B1, oldPage);
+        while (g->lists[ARC_B1].size + g->lists[ARC_B2].size > mgr->bufferSize)
+            ghostRemove(g, g->lists[ARC_B2].size > 0 ? g->lists[ARC_B2].tail : g->lists[ARC_B1].tail);
+    }
+    else if (oldList == TWOQ_A1IN)
+    {
+        ghostAdd(g, TWOQ_A1OUT, oldPage);
+        while (g->lists[TWOQ_A1OUT].size > mgr->ghostLimit)
+            ghostRemove(g, g->lists[TWOQ_A1OUT].tail);
+    }
+}
+
+
+/**
+ * @brief Allocates the LRU-K bookkeeping for a pool.
+ *
+ * @param numFrames Number of frames in the pool.
+ * @param params LRU-K parameters, or NULL for the defaults.
+ * @return The new state, or NULL if the parameters are invalid or memory runs out.
+ */
+static LRUKState *lrukCreate(int numFrames, const BM_LRUKParams *params)
+{
+    LRUKState *s;
+    int k = params ? params->k : LRUK_DEFAULT_K;
+    int period = params ? params->correlatedPeriod : LRUK_DEFAULT_CORRELATED_PERIOD;
+    int historySize = params ? params->historySize : numFrames;
+    int i;
+
+    if (k < 1 || period < 0 || historySize < 0)
+        return NULL;
+
+    s = calloc(1, sizeof(LRUKState));
+    if (s == NULL)
+        return NULL;
+    s->k = k;
+    s->correlatedPeriod = period;
+    s->historySize = historySize;
+    while ((1 << s->historyBits) < historySize)
+        s->historyBits++;
+
+    s->hist = calloc((size_t)numFrames * k, sizeof(int));
+    s->last = calloc(numFrames, sizeof(int));
+    s->historyTable = malloc(sizeof(int) * (1 << s->historyBits));
+    s->histPage = malloc(sizeof(PoolKey) * (historySize + 1));
+    s->histChain = malloc(sizeof(int) * (historySize + 1));
+    s->histTimes = calloc((size_t)(historySize + 1) * k, sizeof(int));
+    if (!s->hist || !s->last || !s->historyTable || !s->histPage || !s->histChain || !s->histTimes)
+    {
+        free(s->hist); free(s->last); free(s->historyTable);
+        free(s->histPage); free(s->histChain); free(s->histTimes);
+        free(s);
+        return NULL;
+    }
+
+    for (i = 0; i < (1 << s->historyBits); i++)
+        s->historyTable[i] = NO_FRAME;
+    for (i = 0; i < historySize; i++)
+        s->histPage[i] = NO_PAGE;
+    return s;
+}
+
+
+/**
+ * @brief Frees the LRU-K bookkeeping of a pool.
+ *
+ * @param s State returned by lrukCreate (may be NULL).
+ */
+static void lrukDestroy(LRUKState *s)
+{
+    if (s == NULL)
+        return;
+    free(s->hist); free(s->last); free(s->historyTable);
+    free(s->histPage); free(s->histChain); free(s->histTimes);
+    free(s);
+}
+
+
+/**
+ * @brief Makes room in the LRU-K bookkeeping for frames added to a pool, with no references yet.
+ *
+ * @param s LRU-K state.
+ * @param numFrames Number of frames the pool had.
+ * @param newNumFrames Number of frames it has from now on.
+ * @return true on success, false if memory runs out; the state is then unchanged.
+ */
+static bool lrukGrow(LRUKState *s, int numFrames, int newNumFrames)
+{
+    int *hist = realloc(s->hist, sizeof(int) * (size_t)newNumFrames * s->k);
+    int *last;
+
+    if (hist == NULL)
+        return false;
+    s->hist = hist;
+    last = realloc(s->last, sizeof(int) * newNumFrames);
+    if (last == NULL)
+        return false;
+    s->last = last;
+    memset(s->hist + (size_t)numFrames * s->k, 0, sizeof(int) * (size_t)(newNumFrames - numFrames) * s->k);
+    memset(s->last + numFrames, 0, sizeof(int) * (newNumFrames - numFrames));
+    return true;
+}
+
+
+/**
+ * @brief Removes a retained history slot from the history index and empties it.
+ *
+ * @param s LRU-K state.
+ * @param slot Slot to drop; it must hold a page.
+ */
+static void lrukDropHistory(LRUKState *s, int slot)
+{
+    int *link = &s->historyTable[fibHash(s->histPage[slot], s->historyBits)];
+
+    while (*link != slot)
+        link = &s->histChain[*link];
+    *link = s->histChain[slot];
+    s->histPage[slot] = NO_PAGE;
+}
+
+
+/**
+ * @brief Records an access to a resident page.
+ *
+ * A reference within the correlated reference period of the previous one only refreshes the
+ * page's last reference time. Otherwise it closes the correlated period: the older history is
+ * shifted by the period's length, so that a burst of re-pins counts as a single reference
+ * made at its start, and the new reference becomes the most recent one.
+ *
+ * @param s LRU-K state.
+ * @param frameIdx Frame holding the page.
+ */
+static void lrukReference(LRUKState *s, int frameIdx)
+{
+    int *h = &s->hist[(size_t)frameIdx * s->k];
+    int j;
+
+    s->now++;
+    if (s->now - s->last[frameIdx] > s->correlatedPeriod)
+    {
+        int correl = s->last[frameIdx] - h[0];
+
+        for (j = s->k - 1; j > 0; j--)
+            h[j] = h[j - 1] ? h[j - 1] + correl : 0;
+        h[0] = s->now;
+    }
+    s->last[frameIdx] = s->now;
+}
+
+
+/**
+ * @brief Records the first pin of a page that was prefetched.
+ *
+ * Being read ahead is not a reference: the pin restamps the reference lrukLoad recorded when
+ * the page was brought in, so a prefetched page is not taken for one referenced twice.
+ *
+ * @param s LRU-K state.
+ * @param frameIdx Frame holding the page.
+ */
+static void lrukFirstPin(LRUKState *s, int frameIdx)
+{
+    s->now++;
+    s->hist[(size_t)frameIdx * s->k] = s->now;
+    s->last[frameIdx] = s->now;
+}
+
+
+/**
+ * @brief Retains the history of a page leaving its frame, replacing the oldest retained history if the ring is full.
+ *
+ * @param s LRU-K state.
+ * @param frameIdx Frame the page is leaving.
+ * @param oldPage The page, or NO_PAGE if the frame was empty.
+ */
+static void lrukRetain(LRUKState *s, int frameIdx, PoolKey oldPage)
+{
+    int *h = &s->hist[(size_t)frameIdx * s->k];
+    int bucket, slot, j;
+
+    if (oldPage == NO_PAGE || s->historySize == 0)
+        return;
+    bucket = fibHash(oldPage, s->historyBits);
+
+    slot = s->historyNext;
+    s->historyNext = (s->historyNext + 1) % s->historySize;
+    if (s->histPage[slot] != NO_PAGE)
+        lrukDropHistory(s, slot);
+
+    s->histPage[slot] = oldPage;
+    s->histChain[slot] = s->historyTable[bucket];
+    s->historyTable[bucket] = slot;
+    for (j = 0; j < s->k; j++)
+        s->histTimes[(size_t)slot * s->k + j] = h[j];
+}
+
+
+/**
+ * @brief Moves a frame's LRU-K history over to a newly loaded page.
+ *
+ * The history of the page being evicted is retained, replacing the oldest retained history if
+ * the ring is full. If the incoming page has a retained history it is picked up again, so the
+ * new reference counts as that page's next one rather than its first.
+ *
+ * @param s LRU-K state.
+ * @param frameIdx Frame the page is being loaded into.
+ * @param oldPage Page leaving the frame, or NO_PAGE if the frame was empty.
+ * @param newPage Page being loaded.
+ */
+static void lrukLoad(LRUKState *s, int frameIdx, PoolKey oldPage, PoolKey newPage)
+{
+    int *h = &s->hist[(size_t)frameIdx * s->k];
+    int slot, j;
+
+    s->now++;
+    lrukRetain(s, frameIdx, oldPage);
+
+    // Look for the incoming page's retained history
+    slot = s->historySize > 0 ? s->historyTable[fibHash(newPage, s->historyBits)] : NO_FRAME;
+    while (slot != NO_FRAME && s->histPage[slot] != newPage)
+        slot = s->histChain[slot];
+
+    for (j = s->k - 1; j > 0; j--)
+        h[j] = slot != NO_FRAME ? s->histTimes[(size_t)slot * s->k + j - 1] : 0;
+    h[0] = s->now;
+    s->last[frameIdx] = s->now;
+
+    if (slot != NO_FRAME)
+        lrukDropHistory(s, slot);
+}
+
+
+/**
+ * @brief Hashes a frame key for the miss ratio estimator's sampling.
+ *
+ * Uses the 64-bit finalizer of MurmurHash3, so that any range of page numbers, in any file of
+ * the shared pool, samples evenly.
+ *
+ * @param pageNum Page number as the pool keys it.
+ * @return The hash, in [0, MRC_HASH_RANGE).
+ */
+static inline unsigned int mrcHash(PoolKey pageNum)
+{
+    unsigned long long h = (unsigned long long)pageNum;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return (unsigned int)(h & (MRC_HASH_RANGE - 1));
+}
+
+
+/**
+ * @brief Creates a miss ratio estimator that samples one page in MRC_INITIAL_RATE_DIVISOR until it tracks MRC_MAX_SAMPLES.
+ *
+ * @return The estimator, or NULL if it cannot be allocated.
+ */
+static MRCEstimator *mrcCreate(void)
+{
+    MRCEstimator *e = calloc(1, sizeof(MRCEstimator));
+    int i;
+
+    if (e == NULL)
+        return NULL;
+    pthread_mutex_init(&e->lock, NULL);
+    e->threshold = MRC_HASH_RANGE / MRC_INITIAL_RATE_DIVISOR;
+    for (i = 0; i < (1 << MRC_TABLE_BITS); i++)
+        e->table[i] = NO_FRAME;
+    for (i = 0; i < MRC_MAX_SAMPLES; i++)
+    {
+        e->pages[i] = NO_PAGE;
+        e->chain[i] = i + 1 < MRC_MAX_SAMPLES ? i + 1 : NO_FRAME;
+    }
+    e->freeSlot = 0;
+    e->bucketWidth = 1;
+    return e;
+}
+
+
+/**
+ * @brief Frees a miss ratio estimator.
+ *
+ * @param e Estimator returned by mrcCreate (may be NULL).
+ */
+static void mrcDestroy(MRCEstimator *e)
+{
+    if (e == NULL)
+        return;
+    pthread_mutex_destroy(&e->lock);
+    free(e);
+}
+
+
+/**
+ * @brief Adds delta at a logical time of the estimator's Fenwick tree.
+ */
+static void mrcTreeAdd(MRCEstimator *e, int time, int delta)
+{
+    for (; time <= MRC_CLOCK_RANGE; time += time & -time)
+        e->tree[time] += delta;
+}
+
+
+/**
+ * @brief Counts the tracked pages last referenced at or before a logical time.
+ */
+static int mrcTreeSum(MRCEstimator *e, int time)
+{
+    int sum = 0;
+
+    for (; time > 0; time -= time & -time)
+        sum += e->tree[time];
+    return sum;
+}
+
+
+/**
+ * @brief Orders (logical time, slot) pairs by time, for qsort.
+ */
+static int compareLastUse(const void *a, const void *b)
+{
+    return ((const int *)a)[0] - ((const int *)b)[0];
+}
+
+
+/**
+ * @brief Renumbers the tracked pages' last references 1, 2, ... in order, once the clock runs out.
+ *
+ * @param e The estimator.
+ */
+static void mrcRenumber(MRCEstimator *e)
+{
+    int order[MRC_MAX_SAMPLES][2];
+    int i, n = 0;
+
+    for (i = 0; i < MRC_MAX_SAMPLES; i++)
+    {
+        if (e->pages[i] != NO_PAGE)
+        {
+            order[n][0] = e->lastUse[i];
+            order[n++][1] = i;
+        }
+    }
+    qsort(order, n, sizeof(order[0]), compareLastUse);
+
+    memset(e->tree, 0, sizeof(e->tree));
+    for (i = 0; i < n; i++)
+    {
+        e->lastUse[order[i][1]] = i + 1;
+        mrcTreeAdd(e, i + 1, 1);
+    }
+    e->clock = n;
+}
+
+
+/**
+ * @brief Stops tracking the page in a slot.
+ *
+ * @param e The estimator.
+ * @param slot The slot.
+ */
+static void mrcUntrack(MRCEstimator *e, int slot)
+{
+    int *link = &e->table[fibHash(e->pages[slot], MRC_TABLE_BITS)];
+
+    while (*link != slot)
+        link = &e->chain[*link];
+    *link = e->chain[slot];
+
+    mrcTreeAdd(e, e->lastUse[slot], -1);
+    e->pages[slot] = NO_PAGE;
+    e->chain[slot] = e->freeSlot;
+    e->freeSlot = slot;
+    e->numTracked--;
+}
+
+
+/**
+ * @brief Lowers the sampling threshold to the largest hash tracked, dropping the pages with that hash.
+ *
+ * What was counted at the old rate is scaled down to the new one, so that old and new samples
+ * weigh the same.
+ *
+ * @param e The estimator, which tracks MRC_MAX_SAMPLES pages.
+ */
+static void mrcLowerThreshold(MRCEstimator *e)
+{
+    unsigned int oldThreshold = e->threshold, newThreshold = 0;
+    double scale;
+    int i;
+
+    for (i = 0; i < MRC_MAX_SAMPLES; i++)
+        if (e->pages[i] != NO_PAGE && e->hashes[i] > newThreshold)
+            newThreshold = e->hashes[i];
+    for (i = 0; i < MRC_MAX_SAMPLES; i++)
+        if (e->pages[i] != NO_PAGE && e->hashes[i] >= newThreshold)
+            mrcUntrack(e, i);
+
+    scale = (double)newThreshold / oldThreshold;
+    for (i = 0; i < MRC_BUCKETS; i++)
+        e->histogram[i] *= scale;
+    e->coldReferences *= scale;
+    e->totalReferences *= scale;
+    atomic_store_explicit(&e->threshold, newThreshold, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Counts a reuse distance, scaled to all pages, in the histogram.
+ *
+ * @param e The estimator.
+ * @param distance Distinct pages referenced since the page's last reference.
+ */
+static void mrcAddDistance(MRCEstimator *e, double distance)
+{
+    long long bucket = (long long)(distance / e->bucketWidth);
+    int i;
+
+    // Halve the histogram's resolution until the distance fits
+    while (bucket >= MRC_BUCKETS)
+    {
+        for (i = 0; i < MRC_BUCKETS / 2; i++)
+            e->histogram[i] = e->histogram[2 * i] + e->histogram[2 * i + 1];
+        for (; i < MRC_BUCKETS; i++)
+            e->histogram[i] = 0;
+        e->bucketWidth *= 2;
+        bucket = (long long)(distance / e->bucketWidth);
+    }
+    e->histogram[bucket] += 1;
+}
+
+
+/**
+ * @brief Records a reference to a sampled page: its reuse distance if it was seen before, else a cold miss.
+ *
+ * The reuse distance of a page is the number of distinct sampled pages referenced since its
+ * last reference; divided by the sampling rate, it estimates the distance among all pages, and
+ * an LRU pool of more frames than that would have hit.
+ *
+ * Pins of every thread sample into this one estimator, hits that take no other lock included,
+ * so a pin never waits for it: while another pin holds the lock, the reference is dropped. Only
+ * under contention does the estimate lose references, and the next reference of the page then
+ * measures its distance from the one before.
+ *
+ * @param e The estimator.
+ * @param pageNum The page.
+ * @param hash Its sampling hash, below the threshold when the caller checked.
+ */
+static void mrcRecord(MRCEstimator *e, PoolKey pageNum, unsigned int hash)
+{
+    int slot, now;
+
+    if (pthread_mutex_trylock(&e->lock) != 0)
+        return;
+    slot = e->table[fibHash(pageNum, MRC_TABLE_BITS)];
+    while (slot != NO_FRAME && e->pages[slot] != pageNum)
+        slot = e->chain[slot];
+
+    // Make room for a new page by sampling fewer pages; the page may not be sampled any more
+    if (slot == NO_FRAME)
+    {
+        while (e->numTracked >= MRC_MAX_SAMPLES && hash < e->threshold)
+            mrcLowerThreshold(e);
+        if (hash >= e->threshold)
+        {
+            pthread_mutex_unlock(&e->lock);
+            return;
+        }
+    }
+
+    if (e->clock == MRC_CLOCK_RANGE)
+        mrcRenumber(e);
+    now = ++e->clock;
+    e->sampled++;
+    e->totalReferences += 1;
+
+    if (slot != NO_FRAME)
+    {
+        int distance = mrcTreeSum(e, now - 1) - mrcTreeSum(e, e->lastUse[slot]);
+
+        mrcAddDistance(e, distance * ((double)MRC_HASH_RANGE / e->threshold));
+        mrcTreeAdd(e, e->lastUse[slot], -1);
+    }
+    else
+    {
+        int bucket = fibHash(pageNum, MRC_TABLE_BITS);
+
+        e->coldReferences += 1;
+        slot = e->freeSlot;
+        e->freeSlot = e->chain[slot];
+        e->pages[slot] = pageNum;
+        e->hashes[slot] = hash;
+        e->chain[slot] = e->table[bucket];
+        e->table[bucket] = slot;
+        e->numTracked++;
+    }
+    e->lastUse[slot] = now;
+    mrcTreeAdd(e, now, 1);
+    pthread_mutex_unlock(&e->lock);
+}
+
+
+/**
+ * @brief Estimates the fraction of references an LRU pool of the given size misses. The caller holds the lock.
+ *
+ * References whose distance falls in the bucket holding the size count in proportion.
+ *
+ * @param e The estimator.
+ * @param numFrames Pool size.
+ * @return The estimated miss ratio, 0 if nothing was sampled yet.
+ */
+static double mrcMissRatio(MRCEstimator *e, long long numFrames)
+{
+    double misses = e->coldReferences;
+    long long first = numFrames / e->bucketWidth;
+    int b;
+
+    if (e->totalReferences <= 0)
+        return 0;
+    if (first < MRC_BUCKETS)
+    {
+        // References at distance numFrames or more miss
+        misses += e->histogram[first] * (double)((first + 1) * e->bucketWidth - numFrames) / e->bucketWidth;
+        for (b = (int)first + 1; b < MRC_BUCKETS; b++)
+            misses += e->histogram[b];
+    }
+    return misses / e->totalReferences;
+}
+
+
+/**
+ * @brief Returns the pool's open handle on one of its page files, opening the file on first use.
+ *
+ * The file is opened lazily rather than in initBufferPool because callers such as createTable
+ * set up the pool before the page file exists. The handle then stays open until
+ * shutdownBufferPool, or until the shared pool's view of the file is shut down, so page I/O
+ * never pays for reopening the file. Called with the pool lock held.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param slot Slot of the file: bm->fileSlot, or keyFile of a page's key.
+ * @param fh Set to the file's handle on success.
+ * @return RC_OK on success, RC_PAGE_SIZE_MISMATCH if the file's pages are not the size of the
+ *         pool's frames, or the error returned by openPageFileMode.
+ */
+static RC poolFile(BM_BufferPool *const bm, int slot, SM_FileHandle **fh)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    PoolFile *file = mgr->files[slot];
+    RC rc = RC_OK;
+
+    if (!atomic_load_explicit(&file->isOpen, memory_order_acquire))
+    {
+        pthread_mutex_lock(&file->lock);
+        if (file->fileHandle.mgmtInfo == NULL)
+        {
+            rc = openPageFileMode(file->name, &file->fileHandle, file->directIO ? SM_FILE_DIRECT : SM_FILE_BUFFERED);
+
+            // The file was created with other pages after the pool was set up
+            if (rc == RC_OK && file->fileHandle.pageSize != bm->pageSize)
+            {
+                closePageFile(&file->fileHandle);
+                rc = RC_PAGE_SIZE_MISMATCH;
+            }
+        }
+        if (rc == RC_OK)
+            atomic_store_explicit(&file->isOpen, true, memory_order_release);
+        pthread_mutex_unlock(&file->lock);
+        if (rc != RC_OK)
+            return rc;
+    }
+    *fh = &file->fileHandle;
+    return RC_OK;
+}
+
+
+/**
+ * @brief Wakes the pool's cleaner, if it has one, once fewer frames are clean than its low watermark.
+ *
+ * Called with the pool lock held whenever a frame may have turned dirty or been reused.
+ *
+ * @param mgr The pool's bookkeeping.
+ */
+static void wakeCleaner(BufferPoolMgr *mgr)
+{
+    if (mgr->cleaner != NULL && mgr->bufferSize - mgr->numDirty < mgr->cleaner->lowWatermark)
+        pthread_cond_signal(&mgr->cleaner->wake);
+}
+
+
+/**
+ * @brief Handles a completed asynchronous read or write of a frame's page.
+ *
+ * A prefetch read publishes the page and drops the prefetch's pin. A flush write wakes the
+ * flushing thread, which still holds the frame; should the write have failed, the page is
+ * marked dirty again so it is written later.
+ *
+ * @param mgr The pool's bookkeeping.
+ * @param req The frame's request.
+ */
+static void ioFinished(BufferPoolMgr *mgr, SM_IORequest *req)
+{
+    PageFrame *frame = (PageFrame *)req->userData;
+
+    if (!req->isWrite)
+    {
+        if (req->rc != RC_OK)
+        {
+            failLoad(mgr, (int)(frame - mgr->frames), req->rc);
+            return;
+        }
+        finishLoad(mgr, frame);
+        frame->fixCount--;
+        return;
+    }
+
+    if (req->rc != RC_OK && atomic_exchange(&frame->isDirtyBit, 1) == 0)
+        mgr->numDirty++;
+    pthread_mutex_lock(&mgr->ioLock);
+    frame->writeRc = req->rc;
+    frame->writing = 0;
+    pthread_cond_broadcast(&mgr->ioDone);
+    pthread_mutex_unlock(&mgr->ioLock);
+}
+
+
+/**
+ * @brief Body of a reaper: handles completions of a page file's I/O queue until told to stop.
+ *
+ * The reaper only waits on the queue while requests are pending, so it never waits for a
+ * completion that cannot come.
+ *
+ * @param arg The file's PoolIO.
+ * @return NULL.
+ */
+static void *reaperMain(void *arg)
+{
+    PoolIO *io = (PoolIO *)arg;
+    BufferPoolMgr *mgr = io->mgr;
+    SM_IORequest *done[POOL_IO_BATCH];
+    int n, k;
+
+    pthread_mutex_lock(&mgr->ioLock);
+    for (;;)
+    {
+        while (io->pending <= 0 && !io->stop)
+            pthread_cond_wait(&io->work, &mgr->ioLock);
+        if (io->pending <= 0)
+            break;
+        pthread_mutex_unlock(&mgr->ioLock);
+
+        n = completeIO(&io->queue, done, POOL_IO_BATCH, 1);
+        for (k = 0; k < n; k++)
+            ioFinished(mgr, done[k]);
+
+        pthread_mutex_lock(&mgr->ioLock);
+        io->pending -= n;
+    }
+    pthread_mutex_unlock(&mgr->ioLock);
+    return NULL;
+}
+
+
+/**
+ * @brief Sets up a page file's I/O queue and starts its reaper. Called with the pool lock held and the file open.
+ *
+ * @param mgr The pool's bookkeeping.
+ * @param file The file.
+ * @return RC_OK on success, or RC_ERROR if the queue or the thread cannot be set up; callers then
+ *         do their I/O synchronously.
+ */
+static RC startPoolIO(BufferPoolMgr *mgr, PoolFile *file)
+{
+    PoolIO *io = calloc(1, sizeof(PoolIO));
+    int depth = mgr->bufferSize < POOL_IO_MAX_DEPTH ? mgr->bufferSize : POOL_IO_MAX_DEPTH;
+
+    if (io == NULL || initIOQueue(&io->queue, &file->fileHandle, depth, SM_IO_AUTO) != RC_OK)
+    {
+        free(io);
+        return RC_ERROR;
+    }
+    pthread_cond_init(&io->work, NULL);
+    io->mgr = mgr;
+    file->io = io;
+    if (pthread_create(&io->reaper, NULL, reaperMain, io) != 0)
+    {
+        file->io = NULL;
+        pthread_cond_destroy(&io->work);
+        shutdownIOQueue(&io->queue);
+        free(io);
+        return RC_ERROR;
+    }
+    return RC_OK;
+}
+
+
+/**
+ * @brief Waits for a page file's outstanding asynchronous I/O, then stops its reaper and releases its queue.
+ *
+ * @param mgr The pool's bookkeeping.
+ * @param file The file.
+ */
+static void stopPoolIO(BufferPoolMgr *mgr, PoolFile *file)
+{
+    PoolIO *io = file->io;
+
+    if (io == NULL)
+        return;
+
+    pthread_mutex_lock(&mgr->ioLock);
+    io->stop = true;
+    pthread_cond_signal(&io->work);
+    pthread_mutex_unlock(&mgr->ioLock);
+    pthread_join(io->reaper, NULL);
+
+    file->io = NULL;
+    shutdownIOQueue(&io->queue);
+    pthread_cond_destroy(&io->work);
+    free(io);
+}
+
+
+/**
+ * @brief Submits a batch of frame requests to a page file's I/O queue and tells the reaper about them.
+ *
+ * @param mgr The pool's bookkeeping.
+ * @param io The file's running I/O queue.
+ * @param requests Requests embedded in frames holding pages of the file.
+ * @param numRequests Number of requests.
+ * @return Number of requests submitted, from the start of the batch; the caller does the rest itself.
+ */
+static int submitPoolIO(BufferPoolMgr *mgr, PoolIO *io, SM_IORequest **requests, int numRequests)
+{
+    int n = submitIO(&io->queue, requests, numRequests);
+
+    // Counted only once submitted, so that pending requests are always ones the queue will complete
+    if (n > 0)
+    {
+        pthread_mutex_lock(&mgr->ioLock);
+        io->pending += n;
+        pthread_cond_signal(&io->work);
+        pthread_mutex_unlock(&mgr->ioLock);
+    }
+    return n < 0 ? 0 : n;
+}
+
+
+/**
+ * @brief Retrieves the number of pages read from disk since the buffer pool was initialized.
+ *
+ * Every read the pool issues is counted, by a miss or a prefetch, whether it went through the
+ * I/O queue or not; a prefetched read counts once submitted.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return The number of pages read from disk.
+ */
+extern int getNumReadIO(BM_BufferPool *const bm)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+    return (int)atomic_load_explicit(&mgr->readCount, memory_order_relaxed);
+}
+
+
+/**
+ * @brief Retrieves the number of pages written to the page file since the buffer pool was initialized.
+ *
+ * This function simply returns the value of writeCount, which records the number of writes done by the buffer manager.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return The number of pages written to the page file.
+ */
+extern int getNumWriteIO(BM_BufferPool *const bm)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    int numWritten;
+
+    pthread_mutex_lock(&mgr->lock);
+    numWritten = mgr->writeCount;
+    pthread_mutex_unlock(&mgr->lock);
+    return numWritten;
+}
+
+
+/**
+ * @brief Retrieves the number of frames the buffer pool holds.
+ *
+ * This is the pool's size, or more while a shrinking resizeBufferPool still has pinned frames to retire.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return The number of frames, which is also the length of the arrays of getFrameContents, getDirtyFlags and getFixCounts.
+ */
+extern int getNumFrames(BM_BufferPool *const bm)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+    return mgr->bufferSize;
+}
+
+
+/**
+ * @brief Retrieves an array of page numbers representing the contents of the buffer pool.
+ *
+ * This function allocates memory for an array of page numbers and populates it with the page numbers of pages currently stored in the buffer pool.
+ * If a page frame is empty (unpinned), it is represented by the value NO_PAGE. Through a view of the
+ * shared pool, frames holding pages of other files are shown as empty too.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return An array of page numbers representing the contents of the buffer pool.
+ */
+extern PageNumber *getFrameContents(BM_BufferPool *const bm)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    PageNumber *frmContents;
+    // Retrieve the page frames from the buffer pool's management data
+    PageFrame *pageFrame = mgr->frames;
+    
+    int i = 0;
+    pthread_mutex_lock(&mgr->lock);
+    // Allocate memory for the array of page numbers, one per frame while no resize can change them
+    frmContents = malloc(sizeof(PageNumber) * mgr->bufferSize);
+    // Iterate through all the pages in the buffer pool
+    while (i < mgr->bufferSize)
+    {
+        // Check if the page frame is occupied by a page of the handle's file
+        if (inView(bm, pageFrame[i].pageNum))
+        {
+            // If occupied, assign the page number to the corresponding index in frmContents
+            frmContents[i] = keyPage(mgr, pageFrame[i].pageNum);
+        }
+        else
+        {
+            // If not occupied, assign the value NO_PAGE to indicate an empty page frame
+            frmContents[i] = NO_PAGE;
+        }
+        i++;
+    }
+    pthread_mutex_unlock(&mgr->lock);
+    return frmContents;
+}
+
+/**
+ * @brief Implementation of the CLOCK (Second Chance) replacement algorithm.
+ *
+ * This function picks the frame to be reused for a new page using the CLOCK algorithm.
+ * The CLOCK algorithm simulates a clock hand that iterates over the page frames in a circular manner.
+ * It gives pages a second chance by marking them as unreferenced (lruCnt = 0) when they are visited.
+ * Pinned frames are never chosen.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return Index of the victim frame, or NO_FRAME if every frame is pinned.
+ */
+extern int CLOCK(BM_BufferPool *const bm)
+{   
+    // Retrieve the array of page frames from the buffer pool's management data
+    BufferPoolMgr *mgr = (BufferPoolMgr *) bm->mgmtData;
+    PageFrame *pageFrames = mgr->frames;
+    int n;
+
+    // Sweep with a copy of the hand: hits keep advancing clockPointer while we look
+    int hand = mgr->clockPointer;
+    
+    // Two sweeps are enough: the first one clears every reference bit
+    for(n = 0; n < 2 * mgr->bufferSize; n++)
+    {
+        // Ensure the hand wraps around when reaching the end of the page frames array
+        hand %= mgr->bufferSize;
+
+        // Check if the current page frame is unpinned and has not been referenced (lruCnt == 0)
+        if(pageFrames[hand].fixCount == 0 && pageFrames[hand].lruCnt == 0)
+        {
+            // Move clockPointer to the next page frame location and hand out the current one
+            mgr->clockPointer = hand + 1;
+            return hand;
+        }
+
+        // Mark the current page frame as unreferenced (lruCnt = 0) and move to the next page frame
+        pageFrames[hand++].lruCnt = 0;     
+    }
+    mgr->clockPointer = hand;
+    return NO_FRAME;
+}
+
+
+/**
+ * @brief FIFO (First In First Out) replacement algorithm implementation.
+ *
+ * This function picks the frame to be reused for a new page using the FIFO algorithm.
+ * Pages are replaced based on the order they were added to the buffer pool, skipping pinned frames.
+ *
+ * @param bufferPool Pointer to the buffer pool structure.
+ * @return Index of the victim frame, or NO_FRAME if every frame is pinned.
+ */
+extern int FIFO(BM_BufferPool *const bufferPool)
+{
+    // Retrieve the array of page frames from the buffer pool's management data
+    BufferPoolMgr *mgr = (BufferPoolMgr *) bufferPool->mgmtData;
+    PageFrame *pageFrames = mgr->frames;
+    
+    // Initialize variables for indexing the page frames
+    int index, frontIdx;
+    frontIdx = mgr->rearIndex % mgr->bufferSize;
+
+    // Iterate through all the page frames in the buffer pool
+    for(index = 0; index < mgr->bufferSize; index++)
+    {
+        // Check if the fix count for the current page frame is 0, indicating it's not pinned
+        if(pageFrames[frontIdx].fixCount == 0)
+            return frontIdx;
+
+        // Move to the next page frame, wrapping around if necessary
+        frontIdx = (frontIdx + 1) % mgr->bufferSize;
+    }
+    return NO_FRAME;
+}
+
+
+/**
+ * @brief Implementation of the LFU (Least Frequently Used) replacement algorithm.
+ *
+ * This function picks the unpinned frame with the smallest reference count (lfuCnt). The search
+ * starts just after the previous victim so that ties are broken round-robin.
+ *
+ * @param bufferPool Pointer to the buffer pool structure.
+ * @return Index of the victim frame, or NO_FRAME if every frame is pinned.
+ */
+extern int LFU(BM_BufferPool *const bufferPool)
+{
+
+    // Retrieve the array of page frames from the buffer pool's management data
+    BufferPoolMgr *mgr = (BufferPoolMgr *) bufferPool->mgmtData;
+    PageFrame *pageFrames = mgr->frames;
+    
+    int i, index, leastFreqIndex = NO_FRAME;
+    index = mgr->lfuPointer % mgr->bufferSize;	
+    
+    // Find the unpinned page frame having the minimum lfuCnt (i.e., it is used the least frequent)
+    for(i = 0; i < mgr->bufferSize; i++)
+    {
+        if(pageFrames[index].fixCount == 0 &&
+           (leastFreqIndex == NO_FRAME || pageFrames[index].lfuCnt < pageFrames[leastFreqIndex].lfuCnt))
+            leastFreqIndex = index;
+        index = (index + 1) % mgr->bufferSize;
+    }
+
+    if(leastFreqIndex != NO_FRAME)
+        mgr->lfuPointer = leastFreqIndex + 1;
+    return leastFreqIndex;
+}
+
+
+/**
+ * @brief Implementation of the LRU (Least Recently Used) replacement algorithm.
+ *
+ * Frames are kept on a doubly-linked recency list threaded through the frames and ordered by
+ * their last pin, so the victim is found from the least recently used end in O(1). Pinned
+ * frames near that end are skipped; there are only ever as many of them as concurrent pins.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return Index of the victim frame, or NO_FRAME if every frame is pinned.
+ */
+extern int LRU(BM_BufferPool *const bm)
+{	
+    BufferPoolMgr *mgr = (BufferPoolMgr *) bm->mgmtData;
+
+    return listVictim(mgr, 0);
+}
+
+
+/**
+ * @brief Implementation of the ARC (Adaptive Replacement Cache) replacement algorithm.
+ *
+ * Resident pages are split between T1, pages referenced once since they were brought in, and
+ * T2, pages referenced again. The victim comes from the least recently used end of T1 while T1
+ * is larger than its target size and from T2 otherwise. The target grows on hits in B1, the
+ * ghosts of pages evicted from T1, and shrinks on hits in B2, so the split follows the
+ * workload instead of being tuned by hand. Repeated pins of the page just brought into T1 do
+ * not promote it (see pinPage), otherwise a scan pinning each page once per record would fill T2.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return Index of the victim frame, or NO_FRAME if every frame is pinned.
+ */
+extern int ARC(BM_BufferPool *const bm)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *) bm->mgmtData;
+    int t1 = mgr->lists[ARC_T1].size;
+    bool inB2 = mgr->pendingGhost != NO_FRAME && mgr->ghosts->entries[mgr->pendingGhost].list == ARC_B2;
+    int from = (t1 > 0 && (t1 > mgr->adaptTarget || (inB2 && t1 == mgr->adaptTarget))) ? ARC_T1 : ARC_T2;
+    int victim = listVictim(mgr, from);
+
+    // Everything on the preferred list is pinned; take from the other one instead
+    if (victim == NO_FRAME)
+        victim = listVictim(mgr, 1 - from);
+    return victim;
+}
+
+
+/**
+ * @brief Implementation of the 2Q replacement algorithm.
+ *
+ * New pages enter A1in, a FIFO queue of about a quarter of the pool, and are remembered in the
+ * ghost queue A1out after they leave it. Only a page that is requested again while in A1out is
+ * promoted to Am, the LRU list holding the rest of the pool, so pages touched once by a scan
+ * never displace pages that are used repeatedly.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return Index of the victim frame, or NO_FRAME if every frame is pinned.
+ */
+extern int TWO_Q(BM_BufferPool *const bm)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *) bm->mgmtData;
+    int from = mgr->lists[TWOQ_A1IN].size > mgr->adaptTarget ? TWOQ_A1IN : TWOQ_AM;
+    int victim = listVictim(mgr, from);
+
+    if (victim == NO_FRAME)
+        victim = listVictim(mgr, 1 - from);
+    return victim;
+}
+
+
+/**
+ * @brief Implementation of the LRU-K replacement algorithm.
+ *
+ * Evicts the unpinned page whose K-th most recent uncorrelated reference lies furthest in the
+ * past. Pages referenced fewer than K times count as infinitely far and go first, oldest most
+ * recent reference first, which is what keeps a one-pass scan from pushing out pages that are
+ * looked up repeatedly. Pages still inside their correlated reference period are not eligible;
+ * if every unpinned page is, the least recently referenced one is taken.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return Index of the victim frame, or NO_FRAME if every frame is pinned.
+ */
+extern int LRU_K(BM_BufferPool *const bm)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *) bm->mgmtData;
+    PageFrame *pageFrames = mgr->frames;
+    LRUKState *s = mgr->lruk;
+    int victim = NO_FRAME, fallback = NO_FRAME;
+    int i;
+
+    for(i = 0; i < mgr->bufferSize; i++)
+    {
+        int *h = &s->hist[(size_t)i * s->k];
+
+        if(pageFrames[i].fixCount != 0)
+            continue;
+
+        if(fallback == NO_FRAME || s->last[i] < s->last[fallback])
+            fallback = i;
+
+        if(s->now - s->last[i] <= s->correlatedPeriod)
+            continue;
+
+        // Smaller K-th reference time means larger backward K-distance; ties go to the older page
+        if(victim == NO_FRAME)
+            victim = i;
+        else
+        {
+            int *v = &s->hist[(size_t)victim * s->k];
+
+            if(h[s->k - 1] < v[s->k - 1] || (h[s->k - 1] == v[s->k - 1] && h[0] < v[0]))
+                victim = i;
+        }
+    }
+    return victim != NO_FRAME ? victim : fallback;
+}
+
+
+/**
+ * @brief Starts tracing a new pool's pins if BM_TRACE_DIR_ENV names a directory.
+ *
+ * The trace is named after the page file, or "shared" for the shared pool, the process and the
+ * pools traced before it, so unmodified programs such as the test suites can be traced. Tracing is best effort: a pool
+ * whose trace cannot be created is not traced.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ */
+static void traceFromEnvironment(BM_BufferPool *const bm)
+{
+	static atomic_int numTraced;
+	const char *dir = getenv(BM_TRACE_DIR_ENV);
+	const char *base;
+	char path[4096];
+
+	if (dir == NULL || *dir == '\0')
+		return;
+	base = bm->pageFile != NULL ? strrchr(bm->pageFile, '/') : NULL;
+	base = base != NULL ? base + 1 : (bm->pageFile != NULL ? bm->pageFile : "shared");
+	snprintf(path, sizeof(path), "%s/%s.%d.%d.bmtrace", dir, base, (int)getpid(), atomic_fetch_add(&numTraced, 1));
+	startPoolTrace(bm, path);
+}
+
+
+/**
+ * @brief Returns the most frames a new pool of numPages frames may be grown to, its reservation.
+ *
+ * That is BM_POOL_MAX_FRAMES_ENV if it is set to a number of frames, or POOL_GROWTH_FACTOR times
+ * numPages otherwise, and never less than numPages.
+ */
+static int poolCapacity(int numPages)
+{
+    const char *env = getenv(BM_POOL_MAX_FRAMES_ENV);
+    long long maxFrames = (long long)numPages * POOL_GROWTH_FACTOR;
+
+    if (env != NULL && atoll(env) > 0)
+        maxFrames = atoll(env);
+    if (maxFrames < numPages)
+        maxFrames = numPages;
+    return maxFrames > INT_MAX ? INT_MAX : (int)maxFrames;
+}
+
+
+/**
+ * @brief Sets up frames [from, to) of a pool as empty frames, their memory being committed.
+ *
+ * @param mgr Pointer to the buffer pool's bookkeeping.
+ * @param from First frame to set up.
+ * @param to Frame past the last one.
+ * @param pageSize Size of the frames' page buffers.
+ */
+static void initFrames(BufferPoolMgr *mgr, int from, int to, int pageSize)
+{
+	PageFrame *page = mgr->frames;
+	int i;
+
+	for(i = from; i < to; i++)
+	{
+		// Set fields (variables) of each page to default values
+		page[i].data = mgr->arena + (size_t)i * pageSize; // The frame's slot in the arena
+		page[i].pageNum = -1;          // Page number not assigned
+		page[i].isDirtyBit = 0;        // Not modified initially
+		page[i].fixCount = 0;          // Not fixed initially
+		page[i].lruCnt = 0;            // Least Recently Used count
+		page[i].lfuCnt = 0;            // Least Frequently Used count
+		page[i].hashNext = NO_FRAME;   // Not in the page table
+		page[i].list = NO_LIST;        // Not on a recency list
+		page[i].lruPrev = NO_FRAME;
+		page[i].lruNext = NO_FRAME;
+		page[i].loading = 0;
+		page[i].loadRc = RC_OK;
+		page[i].prefetched = 0;
+		page[i].writing = 0;
+		page[i].writeRc = RC_OK;
+		page[i].retired = false;
+		pthread_rwlock_init(&page[i].latch, NULL);
+	}
+}
+
+
+/**
+ * @brief Sets up a pool of numPages frames of pageSize bytes, for a page file or as the shared pool.
+ *
+ * See initBufferPool. The shared pool is set up with no file; initPoolView adds its files.
+ *
+ * @param bm Pointer to the buffer pool structure to be initialized.
+ * @param pageFileName Name of the pool's page file, or NULL for the shared pool.
+ * @param pageSize Bytes per frame.
+ * @param numPages Number of page frames in the buffer pool.
+ * @param strategy Page replacement strategy.
+ * @param stratData Parameters of the strategy, as for initBufferPool.
+ *
+ * @return RC_OK on success, or RC_ERROR if memory runs out.
+ */
+static RC initPool(BM_BufferPool *const bm, const char *const pageFileName, int pageSize,
+		const int numPages, ReplacementStrategy strategy, void *stratData)
+{
+	// Assign page file name, number of pages, and page replacement strategy to the buffer pool
+	bm->pageFile = (char *)pageFileName;
+	bm->numPages = numPages;
+	bm->strategy = strategy;
+	bm->pageSize = pageSize;
+	bm->fileSlot = pageFileName != NULL ? 0 : NO_FILE;
+
+	// Allocate the pool's own bookkeeping; nothing here is shared with other pools
+	BufferPoolMgr *mgr = malloc(sizeof(BufferPoolMgr));
+
+	// Reserve room for the frames and for all page buffers as one page-aligned slab, for as many
+	// frames as resizeBufferPool may grow the pool to, and commit the numPages frames in use.
+	// Frames are reused in place and never move, so pinning never allocates, handles stay valid
+	// across resizes and the buffers are suitable for direct I/O
+	int capacity = poolCapacity(numPages);
+	PageFrame *page = reserveMemory(sizeof(PageFrame) * (size_t)capacity);
+	void *arena = reserveMemory((size_t)capacity * pageSize);
+	void *partitions = NULL;
+	if(page == NULL || mgr == NULL || arena == NULL
+	   || !commitMemory(page, 0, sizeof(PageFrame) * (size_t)numPages)
+	   || !commitMemory(arena, 0, (size_t)numPages * pageSize))
+	{
+		if(page != NULL)
+			munmap(page, sizeof(PageFrame) * (size_t)capacity);
+		if(arena != NULL)
+			munmap(arena, (size_t)capacity * pageSize);
+		free(mgr);
+		return RC_ERROR;
+	}
+	if(posix_memalign(&partitions, sizeof(PageTablePartition), sizeof(PageTablePartition) * PAGE_TABLE_PARTITIONS) != 0)
+	{
+		munmap(arena, (size_t)capacity * pageSize);
+		munmap(page, sizeof(PageFrame) * (size_t)capacity);
+		free(mgr);
+		return RC_ERROR;
+	}
+	mgr->arena = (char *)arena;
+	mgr->capacity = capacity;
+	mgr->partitions = (PageTablePartition *)partitions;
+
+	// A pool of its own caches its page file in slot 0; the shared pool gets its files from initPoolView
+	memset(mgr->files, 0, sizeof(mgr->files));
+	mgr->shared = pageFileName == NULL;
+
+	// LRU-K keeps reference histories next to the frames, ARC and 2Q keep ghost lists. ARC
+	// starts with no preference between T1 and T2; 2Q uses the sizes suggested by its authors,
+	// a quarter of the pool for A1in and ghosts for half the pool in A1out
+	mgr->lruk = NULL;
+	mgr->ghosts = NULL;
+	mgr->mrc = mrcCreate();
+	mgr->adaptTarget = (strategy == RS_2Q) ? (numPages / 4 > 0 ? numPages / 4 : 1) : 0;
+	mgr->ghostLimit = numPages / 2 > 0 ? numPages / 2 : 1;
+	if(mgr->mrc == NULL
+	   || (!mgr->shared && (mgr->files[0] = calloc(1, sizeof(PoolFile))) == NULL)
+	   || (strategy == RS_LRU_K && (mgr->lruk = lrukCreate(numPages, (const BM_LRUKParams *)stratData)) == NULL)
+	   || (strategy == RS_ARC && (mgr->ghosts = ghostCreate(numPages + 1)) == NULL)
+	   || (strategy == RS_2Q && (mgr->ghosts = ghostCreate(mgr->ghostLimit + 1)) == NULL))
+	{
+		mrcDestroy(mgr->mrc);
+		free(mgr->files[0]);
+		free(partitions);
+		munmap(arena, (size_t)capacity * pageSize);
+		munmap(page, sizeof(PageFrame) * (size_t)capacity);
+		free(mgr);
+		return RC_ERROR;
+	}
+	
+	if(!mgr->shared)
+		pthread_mutex_init(&mgr->files[0]->lock, NULL);
+
+	// Set the total number of pages in memory or the buffer pool
+	mgr->bufferSize = mgr->targetSize = numPages;	
+	
+	int i;
+
+	// Initialize all pages in the buffer pool
+	mgr->frames = page;
+	initFrames(mgr, 0, numPages, pageSize);
+
+	// Size the page table to the next power of two >= numPages so chains stay about one frame
+	// long, with at least a bucket per partition
+	mgr->numUsedFrames = 0;
+	if(mgr->files[0] != NULL)
+		mgr->files[0]->name = (char *)pageFileName; // The page file is opened on first use
+	mgr->pageTableBits = PAGE_TABLE_PARTITION_BITS;
+	while ((1 << mgr->pageTableBits) < numPages)
+		mgr->pageTableBits++;
+	mgr->pageTable = malloc(sizeof(int) * (1 << mgr->pageTableBits));
+	if(mgr->pageTable == NULL)
+	{
+		for(i = 0; i < numPages; i++)
+			pthread_rwlock_destroy(&page[i].latch);
+		if(!mgr->shared)
+			pthread_mutex_destroy(&mgr->files[0]->lock);
+		lrukDestroy(mgr->lruk);
+		ghostDestroy(mgr->ghosts);
+		mrcDestroy(mgr->mrc);
+		free(mgr->files[0]);
+		free(partitions);
+		munmap(arena, (size_t)capacity * pageSize);
+		munmap(page, sizeof(PageFrame) * (size_t)capacity);
+		free(mgr);
+		return RC_ERROR;
+	}
+	for(i = 0; i < (1 << mgr->pageTableBits); i++)
+		mgr->pageTable[i] = NO_FRAME;
+	for(i = 0; i < PAGE_TABLE_PARTITIONS; i++)
+	{
+		pthread_mutex_init(&mgr->partitions[i].latch, NULL);
+		mgr->partitions[i].hits = 0;
+	}
+
+	// Set the buffer pool's management data to point to the frames and the page table
+	bm->mgmtData = mgr;
+
+	// Initialize counters and pointers used by replacement algorithms
+	mgr->writeCount = mgr->clockPointer = mgr->lfuPointer = 0;
+	for(i = 0; i < 2; i++)
+	{
+		mgr->lists[i].head = mgr->lists[i].tail = NO_FRAME;
+		mgr->lists[i].size = 0;
+	}
+	mgr->pendingGhost = NO_FRAME;
+	mgr->rearIndex = -1; // No page has been read yet
+
+	// No cleaner until one is started
+	pthread_mutex_init(&mgr->lock, NULL);
+	mgr->numDirty = 0;
+	mgr->victimWrites = 0;
+	pthread_cond_init(&mgr->victimWritten, NULL);
+	mgr->cleaner = NULL;
+	mgr->cleanerLowWatermark = 0;
+	memset(&mgr->cleanerStats, 0, sizeof(BM_CleanerStats));
+	mgr->mapped = false;
+	mgr->mappedPins = 0;
+	pthread_mutex_init(&mgr->ioLock, NULL);
+	pthread_cond_init(&mgr->ioDone, NULL);
+
+	// No pins and no I/O yet
+	mgr->misses = mgr->dirtyEvictions = mgr->cleanEvictions = 0;
+	mgr->pinWaits = mgr->readCount = 0;
+	memset(&mgr->pinHitLatency, 0, sizeof(LatencyHist));
+	memset(&mgr->pinMissLatency, 0, sizeof(LatencyHist));
+	memset(&mgr->readLatency, 0, sizeof(LatencyHist));
+	memset(&mgr->writeLatency, 0, sizeof(LatencyHist));
+
+	// Trace the pool's pins if the environment asks for it
+	mgr->trace = NULL;
+	traceFromEnvironment(bm);
+
+	return RC_OK;
+		
+}
+
+
+/** 
+ * @brief Initializes a buffer pool with numPages page frames.
+ *
+ * This function initializes a buffer pool with a specified number of page frames.
+ * It assigns the given page file name, number of pages, and page replacement strategy to the buffer pool.
+ * Each page frame is initialized with default values.
+ *
+ * Frames are as large as the pages of the page file, which initBufferPool reads from the file's
+ * header into bm->pageSize; a pool set up before its page file exists has PAGE_SIZE frames.
+ *
+ * @param bm Pointer to the buffer pool structure to be initialized.
+ * @param pageFileName Name of the page file whose pages will be cached in memory.
+ * @param numPages Number of page frames in the buffer pool.
+ * @param strategy Page replacement strategy (FIFO, LRU, LFU, CLOCK) to be used by the buffer pool.
+ * @param stratData Pointer to parameters needed for the page replacement strategy: a BM_LRUKParams for RS_LRU_K
+ *                  (NULL selects the defaults), ignored by the other strategies.
+ *
+ * @return RC_OK on success, RC_INVALID_PAGE_SIZE if the page file's header is not valid, or
+ *         another error code on failure.
+ */
+extern RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
+		  const int numPages, ReplacementStrategy strategy, 
+		  void *stratData)
+{
+	// Size the frames to the file's pages
+	int pageSize;
+	RC rc = readPageSize((char *)pageFileName, &pageSize);
+	if(rc == RC_FILE_NOT_FOUND)
+		pageSize = PAGE_SIZE;
+	else if(rc != RC_OK)
+		return rc;
+	return initPool(bm, pageFileName, pageSize, numPages, strategy, stratData);
+}
+
+
+/** 
+ * @brief Shuts down the buffer pool, releasing all resources and freeing memory.
+ *
+ * This function closes the buffer pool, removing all pages from memory and releasing all associated resources.
+ * It ensures that all dirty pages (modified pages) are written back to disk before shutting down.
+ * If any pages are still pinned (being used by clients), it returns an error.
+ * Unlike the other calls, it must not run concurrently with anything else on the pool.
+ * Shutting down a view of the shared pool only takes its file out of the pool (see initPoolView).
+ *
+ * @param bm Pointer to the buffer pool structure to be shut down.
+ *
+ * @return RC_OK on success, an error code (RC_PINNED_PAGES_IN_BUFFER) if there are still pinned pages,
+ *         the error of writing back a dirty page, with the pool left up, or the error of closing
+ *         the page file, once the pool is shut down all the same.
+ */
+extern RC shutdownBufferPool(BM_BufferPool *const bm)
+{
+	// Get pointer to the array of page frames in the buffer pool
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PageFrame *pageFrame = mgr->frames;
+	RC rc = RC_OK, closeRc;
+	int i;
+
+	// The shared pool stays up for the other views
+	if(mgr->shared && bm->fileSlot != NO_FILE)
+		return closePoolView(bm);
+
+	// Stop the background cleaner first; its in-flight writes hold pins
+	stopPoolCleaner(bm);
+
+	// Write all dirty pages back to disk before shutting down; should one fail, the pool stays
+	// up with the page still dirty, so the caller can retry
+	rc = forceFlushPool(bm);
+	if(rc != RC_OK)
+		return rc;
+
+	// Prefetch reads in flight hold pins too
+	for(i = 0; i < POOL_MAX_FILES; i++)
+	{
+		if(mgr->files[i] != NULL)
+			stopPoolIO(mgr, mgr->files[i]);
+	}
+
+	// Finish the pool's trace, if it has one, also if pages are still pinned: the caller is done
+	// with the pool
+	stopPoolTrace(bm);
+
+	// A mapped pool's pins are not held in frames
+	if(mgr->mapped && mgr->mappedPins != 0)
+		return RC_PINNED_PAGES_IN_BUFFER;
+
+	// Check if there are any pinned pages in the buffer pool; frames retired by a shrink are held
+	// by the pool itself
+	for(i = 0; i < mgr->bufferSize; i++)
+	{
+		// If fixCount != 0, it means the page is still pinned by some client
+		if(pageFrame[i].fixCount != 0 && !pageFrame[i].retired)
+		{
+			return RC_PINNED_PAGES_IN_BUFFER;
+		}
+	}
+
+	// Close the pool's page file if it was ever opened; closing writes what a compressed file
+	// keeps in memory, so its failure is the pool's
+	for(i = 0; i < POOL_MAX_FILES; i++)
+	{
+		if(mgr->files[i] == NULL)
+			continue;
+		if(mgr->files[i]->fileHandle.mgmtInfo != NULL
+			&& (closeRc = closePageFile(&mgr->files[i]->fileHandle)) != RC_OK && rc == RC_OK)
+			rc = closeRc;
+		pthread_mutex_destroy(&mgr->files[i]->lock);
+		free(mgr->files[i]);
+	}
+
+	// Free memory occupied by the page frames, their buffers and the page table and set mgmtData to NULL
+	for(i = 0; i < mgr->bufferSize; i++)
+		pthread_rwlock_destroy(&pageFrame[i].latch);
+	for(i = 0; i < PAGE_TABLE_PARTITIONS; i++)
+		pthread_mutex_destroy(&mgr->partitions[i].latch);
+	free(mgr->partitions);
+	free(mgr->pageTable);
+	lrukDestroy(mgr->lruk);
+	ghostDestroy(mgr->ghosts);
+	mrcDestroy(mgr->mrc);
+	pthread_mutex_destroy(&mgr->lock);
+	pthread_mutex_destroy(&mgr->ioLock);
+	pthread_cond_destroy(&mgr->ioDone);
+	pthread_cond_destroy(&mgr->victimWritten);
+	munmap(mgr->arena, (size_t)mgr->capacity * bm->pageSize);
+	munmap(pageFrame, sizeof(PageFrame) * (size_t)mgr->capacity);
+	free(mgr);
+	bm->mgmtData = NULL;
+
+	return rc;
+}
+
+
+/**
+ * @brief Orders frames by the page they hold, for qsort.
+ */
+static int compareFramePages(const void *a, const void *b)
+{
+	PoolKey pa = (*(PageFrame *const *)a)->pageNum;
+	PoolKey pb = (*(PageFrame *const *)b)->pageNum;
+
+	return (pa > pb) - (pa < pb);
+}
+
+
+/**
+ * @brief Tells whether a frame holds the page after another frame's page, in the same file.
+ */
+static bool followsPage(BufferPoolMgr *mgr, PageFrame *prev, PageFrame *next)
+{
+	return next->pageNum == prev->pageNum + 1 && keyFile(mgr, next->pageNum) == keyFile(mgr, prev->pageNum);
+}
+
+
+/**
+ * @brief Writes all dirty pages (pages with fixCount = 0 and isDirtyBit = 1) to disk.
+ *
+ * This function forces the buffer pool to write all dirty pages (modified pages) back to the page file on disk.
+ * The dirty, unpinned frames are collected and pinned in one pass under the pool lock and sorted
+ * by page number. Those whose content latch is free are split into runs of adjacent pages: each
+ * run of two or more pages is written with one vectored write (writeBlocks), and the single pages
+ * go as one batch through the I/O queue of their file, so they are in flight meanwhile. Any
+ * single page the queue has no room for, and then the frames others have latched, are written
+ * one at a time. Each page is marked not dirty before its write, and the writeCount incremented
+ * after it. A page whose write fails is marked dirty again, and the flush goes on with the others.
+ * Through a view of the shared pool, only the pages of the view's file are written.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ *
+ * @return RC_OK on success, the error of the first write that failed, or RC_ERROR if memory
+ *         for the batch cannot be allocated.
+ */
+extern RC forceFlushPool(BM_BufferPool *const bm)
+{
+	// Get pointer to the array of page frames in the buffer pool
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PageFrame *pageFrame = mgr->frames;
+	SM_IORequest **requests;
+	SM_PageHandle *runPages;
+	PageFrame **batch;
+	PoolFile *file;
+	int i, j, k, n = 0, numLatched = 0, numAsync = 0, numSubmitted;
+	int numFrames = mgr->bufferSize;
+	long long start;
+	RC runRc, rc = RC_OK;
+
+	// Frames added by a resize meanwhile are left to the next flush
+	batch = malloc(sizeof(PageFrame *) * numFrames);
+	requests = malloc(sizeof(SM_IORequest *) * numFrames);
+	runPages = malloc(sizeof(SM_PageHandle) * numFrames);
+	if(batch == NULL || requests == NULL || runPages == NULL)
+	{
+		free(batch);
+		free(requests);
+		free(runPages);
+		return RC_ERROR;
+	}
+
+	// Pin every dirty, unpinned frame so it keeps its page while the pool lock is released. The
+	// page's file is open, since the page was read through it
+	pthread_mutex_lock(&mgr->lock);
+	for(i = 0; i < numFrames && i < mgr->bufferSize; i++)
+	{
+		if(pageFrame[i].fixCount == 0 && pageFrame[i].isDirtyBit == 1 && inView(bm, pageFrame[i].pageNum))
+		{
+			file = mgr->files[keyFile(mgr, pageFrame[i].pageNum)];
+			if(file->io == NULL)
+				startPoolIO(mgr, file);
+			pageFrame[i].fixCount++;
+			batch[n++] = &pageFrame[i];
+		}
+	}
+	pthread_mutex_unlock(&mgr->lock);
+
+	// Latch the frames nobody is modifying and move them to the front, still sorted; the rest are
+	// written at the end. The page is marked not dirty before it is written, so a change made
+	// after the write is not lost
+	qsort(batch, n, sizeof(PageFrame *), compareFramePages);
+	for(i = 0; i < n; i++)
+	{
+		PageFrame *frame = batch[i];
+
+		if(pthread_rwlock_tryrdlock(&frame->latch) != 0)
+			continue;
+		if(atomic_exchange(&frame->isDirtyBit, 0) == 1)
+			mgr->numDirty--;
+		batch[i] = batch[numLatched];
+		batch[numLatched++] = frame;
+	}
+
+	// Queue the pages that have no latched neighbour
+	for(i = 0; i < numLatched; i = j)
+	{
+		for(j = i + 1; j < numLatched && followsPage(mgr, batch[j - 1], batch[j]); j++)
+			;
+		if(j - i > 1 || mgr->files[keyFile(mgr, batch[i]->pageNum)]->io == NULL)
+			continue;
+		batch[i]->writing = 1;
+		batch[i]->io.pageNum = keyPage(mgr, batch[i]->pageNum);
+		batch[i]->io.memPage = batch[i]->data;
+		batch[i]->io.isWrite = 1;
+		batch[i]->io.userData = batch[i];
+		requests[numAsync++] = &batch[i]->io;
+	}
+
+	// Submit them file by file, and write what a queue has no room for right away
+	for(i = 0; i < numAsync; i = j)
+	{
+		int slot = keyFile(mgr, ((PageFrame *)requests[i]->userData)->pageNum);
+
+		for(j = i + 1; j < numAsync && keyFile(mgr, ((PageFrame *)requests[j]->userData)->pageNum) == slot; j++)
+			;
+		numSubmitted = submitPoolIO(mgr, mgr->files[slot]->io, &requests[i], j - i);
+		for(k = i + numSubmitted; k < j; k++)
+		{
+			PageFrame *frame = (PageFrame *)requests[k]->userData;
+
+			runRc = poolWriteBlock(mgr, frame->pageNum, frame->data);
+			if(runRc != RC_OK && atomic_exchange(&frame->isDirtyBit, 1) == 0)
+				mgr->numDirty++;
+			pthread_mutex_lock(&mgr->ioLock);
+			frame->writeRc = runRc;
+			frame->writing = 0;
+			pthread_mutex_unlock(&mgr->ioLock);
+		}
+	}
+
+	// Write each run of adjacent pages with one vectored write while the queued writes proceed
+	for(i = 0; i < numLatched; i = j)
+	{
+		for(j = i + 1; j < numLatched && followsPage(mgr, batch[j - 1], batch[j]); j++)
+			;
+		file = mgr->files[keyFile(mgr, batch[i]->pageNum)];
+		if(j - i == 1 && file->io != NULL)
+			continue;
+		for(k = i; k < j; k++)
+			runPages[k - i] = batch[k]->data;
+		start = nowNanos();
+		runRc = writeBlocks(keyPage(mgr, batch[i]->pageNum), j - i, &file->fileHandle, runPages);
+		histRecord(&mgr->writeLatency, nowNanos() - start);
+		if(runRc != RC_OK)
+		{
+			// Keep the pages dirty so a later flush or eviction tries again
+			for(k = i; k < j; k++)
+			{
+				if(atomic_exchange(&batch[k]->isDirtyBit, 1) == 0)
+					mgr->numDirty++;
+			}
+			if(rc == RC_OK)
+				rc = runRc;
+		}
+		for(k = i; k < j; k++)
+		{
+			pthread_rwlock_unlock(&batch[k]->latch);
+			batch[k]->fixCount--;
+			// Increment the writeCount which records the number of writes done by the buffer manager
+			if(runRc == RC_OK)
+				mgr->writeCount++;
+		}
+	}
+
+	// Wait for the queued writes; a failed one has marked its page dirty again
+	for(i = 0; i < numAsync; i++)
+	{
+		PageFrame *frame = (PageFrame *)requests[i]->userData;
+
+		pthread_mutex_lock(&mgr->ioLock);
+		while(frame->writing)
+			pthread_cond_wait(&mgr->ioDone, &mgr->ioLock);
+		runRc = frame->writeRc;
+		pthread_mutex_unlock(&mgr->ioLock);
+		if(runRc == RC_OK)
+			mgr->writeCount++;
+		else if(rc == RC_OK)
+			rc = runRc;
+		pthread_rwlock_unlock(&frame->latch);
+		frame->fixCount--;
+	}
+
+	// Wait for those who have the remaining frames latched to finish modifying them, one at a time
+	for(i = numLatched; i < n; i++)
+	{
+		pthread_rwlock_rdlock(&batch[i]->latch);
+		if(atomic_exchange(&batch[i]->isDirtyBit, 0) == 1)
+			mgr->numDirty--;
+		// Write the block of data to the page file on disk
+		runRc = poolWriteBlock(mgr, batch[i]->pageNum, batch[i]->data);
+		if(runRc != RC_OK && atomic_exchange(&batch[i]->isDirtyBit, 1) == 0)
+			mgr->numDirty++;
+		pthread_rwlock_unlock(&batch[i]->latch);
+		batch[i]->fixCount--;
+		if(runRc == RC_OK)
+			mgr->writeCount++;
+		else if(rc == RC_OK)
+			rc = runRc;
+	}
+
+	free(batch);
+	free(requests);
+	free(runPages);
+	return rc;
+}
+
+
+/**
+ * @brief Marks a page as dirty, indicating that its data has been modified by the client.
+ *
+ * This function sets the isDirtyBit flag to 1 for the specified page in the buffer pool, indicating that the page's data has been modified.
+ * It iterates through all pages in the buffer pool to find the page with the specified page number and marks it as dirty.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param page Pointer to the page handle structure containing information about the page to be marked as dirty.
+ *
+ * @return RC_OK if the page is successfully marked as dirty, RC_ERROR if the page is not found in the buffer pool.
+ */
+extern RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolKey key = pageKey(bm, page->pageNum);
+	pthread_mutex_t *latch = partitionLatch(mgr, key);
+	pthread_mutex_lock(latch);
+
+	// Find the frame holding the page through the page table
+	int i = pageTableLookup(mgr, key);
+
+	// Return error if the page is not found in the buffer pool
+	if(i == NO_FRAME)
+	{
+		pthread_mutex_unlock(latch);
+		return RC_ERROR;
+	}
+
+	// Set isDirtyBit = 1 for the page to be marked dirty
+	if(atomic_exchange(&mgr->frames[i].isDirtyBit, 1) == 0)
+		mgr->numDirty++;
+	pthread_mutex_unlock(latch);
+
+	// Only take the pool lock to wake the cleaner when clean frames are actually running low
+	if(mgr->bufferSize - mgr->numDirty < mgr->cleanerLowWatermark)
+	{
+		pthread_mutex_lock(&mgr->lock);
+		wakeCleaner(mgr);
+		pthread_mutex_unlock(&mgr->lock);
+	}
+	return RC_OK;
+}
+
+
+/**
+ * @brief Unpins a page from memory, indicating that the client has completed work on the page.
+ *
+ * This function decreases the fixCount for the specified page in the buffer pool, indicating that the client has completed its work with the page.
+ * It iterates through all pages in the buffer pool to find the page with the specified page number and decreases its fixCount.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param page Pointer to the page handle structure containing information about the page to be unpinned.
+ *
+ * @return RC_OK once the page is successfully unpinned.
+ */
+extern RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const pg)
+{	
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+	// A mapped pool only counts its pins
+	if(mgr->mapped)
+	{
+		int pins = mgr->mappedPins;
+		while(pins > 0 && !atomic_compare_exchange_weak(&mgr->mappedPins, &pins, pins - 1))
+			;
+		return RC_OK;
+	}
+
+	// Find the frame holding the page through the page table and decrease its fixCount
+	PoolKey key = pageKey(bm, pg->pageNum);
+	pthread_mutex_t *latch = partitionLatch(mgr, key);
+	pthread_mutex_lock(latch);
+	int i = pageTableLookup(mgr, key);
+	if(i != NO_FRAME && mgr->frames[i].fixCount > 0)
+		mgr->frames[i].fixCount--;
+	pthread_mutex_unlock(latch);
+
+	return RC_OK;
+}
+
+
+/**
+ * @brief Writes the contents of the modified pages back to the page file on disk.
+ *
+ * This function iterates through all pages in the buffer pool to find the page with the specified page number.
+ * If the page is found and marked dirty (indicating modification), it writes the page's data back to the disk using the storage manager functions.
+ * After writing, it marks the page as not dirty and increments the writeCount to record the write operation.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param page Pointer to the page handle structure containing information about the page to be written back to disk.
+ *
+ * @return RC_OK once the page has been successfully written back to disk (or is not in the pool),
+ *         or the error of the write, the page staying dirty.
+ */
+extern RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const pg)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PageFrame *pageFrame = mgr->frames;
+	RC rc = RC_OK;
+
+	// Find the frame holding the page to be written to disk, pinning it for the write; its file
+	// is open, since the page was read through it
+	PoolKey key = pageKey(bm, pg->pageNum);
+	int i = pinIfResident(mgr, key, false);
+	if(i != NO_FRAME)
+	{
+		// A page whose read failed is no longer in the pool, and there is nothing to write
+		waitForLoad(mgr, &pageFrame[i]);
+		if(pageFrame[i].loadRc != RC_OK)
+		{
+			pageFrame[i].fixCount--;
+			return RC_OK;
+		}
+
+		// Mark the page as not dirty before writing it, so a change made after the write is not lost.
+		// The caller may hold the page's content latch itself, so it is not taken here
+		if(atomic_exchange(&pageFrame[i].isDirtyBit, 0) == 1)
+			mgr->numDirty--;
+
+		// Write the page's data to the disk; should that fail, the page is dirty again
+		rc = poolWriteBlock(mgr, key, pageFrame[i].data);
+		if (rc != RC_OK && atomic_exchange(&pageFrame[i].isDirtyBit, 1) == 0)
+			mgr->numDirty++;
+		pageFrame[i].fixCount--;
+		
+		// Increment the writeCount which records the number of writes done by the buffer manager
+		if (rc == RC_OK)
+			mgr->writeCount++;
+	}
+	return rc;
+}
+
+
+/**
+ * @brief Hands out a page of the pool's file for new data, reusing the lowest free page if there is one.
+ *
+ * See allocatePage. The page reads as zeros; pin it to fill it in.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param pageNum Set to the page handed out.
+ *
+ * @return RC_OK on success, RC_WRITE_FAILED for a mapped pool, or the error returned by the storage manager.
+ */
+extern RC allocatePoolPage(BM_BufferPool *const bm, PageNumber *pageNum)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	SM_FileHandle *fh;
+	RC rc;
+
+	if(mgr->mapped)
+		return RC_WRITE_FAILED;
+
+	// Growing the file is serialized with the misses growing it
+	rc = poolFile(bm, bm->fileSlot, &fh);
+	if(rc == RC_OK)
+	{
+		pthread_mutex_lock(&mgr->files[bm->fileSlot]->lock);
+		rc = allocatePage(fh, pageNum);
+		pthread_mutex_unlock(&mgr->files[bm->fileSlot]->lock);
+	}
+	return rc;
+}
+
+
+/**
+ * @brief Frees a page of the pool's file (see freePage), dropping any change the pool holds for it.
+ *
+ * A frame holding the page stays in the pool, with its page zeroed and no longer dirty, so the
+ * pool never writes the old contents back over the freed page. The page must not be pinned,
+ * not even by a flush in progress.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param pageNum The page to free.
+ *
+ * @return RC_OK on success, RC_PINNED_PAGES_IN_BUFFER if the page is pinned, RC_WRITE_FAILED for
+ *         a mapped pool, or the error returned by freePage.
+ */
+extern RC freePoolPage(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	SM_FileHandle *fh;
+	pthread_mutex_t *latch;
+	RC rc;
+	int i;
+
+	if(mgr->mapped)
+		return RC_WRITE_FAILED;
+
+	// Holding the pool lock keeps the frame from being reused, and the partition latch keeps it from being pinned
+	pthread_mutex_lock(&mgr->lock);
+	rc = poolFile(bm, bm->fileSlot, &fh);
+	if(rc != RC_OK)
+	{
+		pthread_mutex_unlock(&mgr->lock);
+		return rc;
+	}
+	latch = partitionLatch(mgr, pageKey(bm, pageNum));
+	pthread_mutex_lock(latch);
+	i = pageTableLookup(mgr, pageKey(bm, pageNum));
+	if(i != NO_FRAME && mgr->frames[i].fixCount > 0)
+	{
+		pthread_mutex_unlock(latch);
+		pthread_mutex_unlock(&mgr->lock);
+		return RC_PINNED_PAGES_IN_BUFFER;
+	}
+	if(i != NO_FRAME)
+	{
+		if(atomic_exchange(&mgr->frames[i].isDirtyBit, 0) == 1)
+			mgr->numDirty--;
+		memset(mgr->frames[i].data, 0, bm->pageSize);
+	}
+	pthread_mutex_unlock(latch);
+
+	pthread_mutex_lock(&mgr->files[bm->fileSlot]->lock);
+	rc = freePage(fh, pageNum);
+	pthread_mutex_unlock(&mgr->files[bm->fileSlot]->lock);
+	pthread_mutex_unlock(&mgr->lock);
+	return rc;
+}
+
+
+/**
+ * @brief Tells whether a page of the pool's file is free (see freePage), so that scans can skip it.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param pageNum The page.
+ * @return true if the page is free, false if it is in use or not in the file.
+ */
+extern bool isPoolPageFree(BM_BufferPool *const bm, const PageNumber pageNum)
+{
+	SM_FileHandle *fh;
+
+	// The storage manager guards its free page map itself, so this takes no pool lock
+	return poolFile(bm, bm->fileSlot, &fh) == RC_OK && isPageFree(fh, pageNum) != 0;
+}
+
+
+/**
+ * @brief Returns how many pages of the pool's file are free (see getNumFreePages).
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return The number of free pages, 0 if the file cannot be opened.
+ */
+extern int getNumFreePoolPages(BM_BufferPool *const bm)
+{
+	SM_FileHandle *fh;
+
+	return poolFile(bm, bm->fileSlot, &fh) == RC_OK ? getNumFreePages(fh) : 0;
+}
+
+
+/**
+ * @brief Returns how many pages the pool's file holds, free ones included.
+ *
+ * The file grows as pages past its end are pinned, so this is where a scan of the file ends.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return The number of pages, 0 if the file cannot be opened.
+ */
+extern int getNumPoolFilePages(BM_BufferPool *const bm)
+{
+	SM_FileHandle *fh;
+
+	if(poolFile(bm, bm->fileSlot, &fh) != RC_OK)
+		return 0;
+	return __atomic_load_n(&fh->totalNumPages, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Takes the frame a scan ring loaded a page into one lap ago, if it can be reused.
+ *
+ * The slot's frame is reused only if it still holds the page the ring put there and nobody has
+ * it pinned; otherwise the slot is treated as empty and the frame is left to the pool.
+ *
+ * @param bm Pointer to the buffer pool structure the scan pins through.
+ * @param ring The scan's ring.
+ * @return Index of the frame to reuse, or NO_FRAME if the pool has to supply one.
+ */
+static int ringVictim(BM_BufferPool *const bm, BM_ScanRing *const ring)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    int frameIdx = ring->frames[ring->next];
+
+    if (frameIdx == NO_FRAME || frameIdx >= mgr->bufferSize
+        || mgr->frames[frameIdx].pageNum != pageKey(bm, ring->pages[ring->next]) || mgr->frames[frameIdx].fixCount != 0)
+        return NO_FRAME;
+    return frameIdx;
+}
+
+
+/**
+ * @brief Tells whether a hit has to update replacement state that only the pool lock protects.
+ *
+ * FIFO, CLOCK and LFU record a hit with atomic updates of the frame, so their hits never wait
+ * for a miss. The list and history based strategies reorder shared structures on every pin.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return true if recordHit must be called with the pool lock held.
+ */
+static bool hitTakesLock(BM_BufferPool *const bm)
+{
+	return bm->strategy == RS_LRU || bm->strategy == RS_ARC || bm->strategy == RS_2Q
+		|| bm->strategy == RS_LRU_K;
+}
+
+
+/**
+ * @brief Updates the replacement state for a pin of a page that was already in the pool.
+ *
+ * The first pin of a prefetched page is its first reference, so it is recorded the way a miss
+ * would have recorded it: it does not promote the page in ARC, 2Q or LRU-K, nor count twice in LFU.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param i Frame holding the page, pinned by the caller.
+ */
+static void recordHit(BM_BufferPool *const bm, int i)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PageFrame *pgFrame = mgr->frames;
+
+	if (pgFrame[i].prefetched && atomic_exchange(&pgFrame[i].prefetched, 0) == 1)
+	{
+		if (bm->strategy == RS_LRU)
+			listTouch(mgr, 0, i);
+		else if (bm->strategy == RS_ARC && pgFrame[i].list == ARC_T1)
+			listTouch(mgr, ARC_T1, i); // Newest in T1, so re-pins of it still count once
+		else if (bm->strategy == RS_CLOCK)
+			pgFrame[i].lruCnt = 1;
+		else if (bm->strategy == RS_LRU_K)
+			lrukFirstPin(mgr->lruk, i);
+	}
+	// Update page's reference count based on replacement strategy
+	else if (bm->strategy == RS_LRU)
+		listTouch(mgr, 0, i); // Move the frame to the most recently used end
+	else if (bm->strategy == RS_ARC && !(pgFrame[i].list == ARC_T1 && mgr->lists[ARC_T1].head == i))
+		listTouch(mgr, ARC_T2, i); // Referenced again, so it moves to (or within) T2; back-to-back
+		                           // pins of the newest page in T1, like one per record, count once
+	else if (bm->strategy == RS_2Q && pgFrame[i].list == TWOQ_AM)
+		listTouch(mgr, TWOQ_AM, i); // Hits in A1in are deliberately not recorded
+	else if (bm->strategy == RS_CLOCK)
+		pgFrame[i].lruCnt = 1; // lruCnt = 1 to indicate that this was the last page frame examined (added to the buffer pool)
+	else if (bm->strategy == RS_LFU)
+		pgFrame[i].lfuCnt++; // Incrementing lfuCnt to add one more to the count of number of times the page is used (referenced)
+	else if (bm->strategy == RS_LRU_K)
+		lrukReference(mgr->lruk, i);
+
+	mgr->clockPointer++;
+}
+
+
+/**
+ * @brief Asks the pool's replacement strategy for the frame whose page should leave the pool next.
+ *
+ * Called with the pool lock held.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return Index of an unpinned frame, or NO_FRAME if every frame is pinned.
+ */
+static int strategyVictim(BM_BufferPool *const bm)
+{
+	switch(bm->strategy)
+	{			
+		case RS_FIFO:
+			return FIFO(bm);
+		
+		case RS_LRU:
+			return LRU(bm);
+		
+		case RS_CLOCK: 
+			return CLOCK(bm);
+		
+		case RS_LFU: 
+			return LFU(bm);
+		
+		case RS_LRU_K:
+			return LRU_K(bm);
+
+		case RS_ARC:
+			return ARC(bm);
+
+		case RS_2Q:
+			return TWO_Q(bm);
+		
+		default:
+			printf("\nAlgorithm is Not Implemented\n");
+			return NO_FRAME;
+	}
+}
+
+
+/**
+ * @brief Picks a victim frame for a page that is not in the pool and takes it over.
+ *
+ * Called with the pool lock held. The frame comes from the scan ring if one is given and its
+ * frame can be reused, else from the empty frames, else from the replacement strategy. If a
+ * hit pins the victim before it can be taken over, another one is picked.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param ring Scan ring to recycle frames from, or NULL to take frames from the whole pool.
+ * @param pageNum Page number of the page to be brought in.
+ * @param cleanOnly Give up rather than take a dirty victim, which would have to be written first.
+ * @param dirty Unless NULL, a dirty victim is not claimed: it is pinned in place by pinVictim and
+ *        this is set, and the miss's bookkeeping is undone, so that the caller can write the
+ *        page back with the pool lock released and then call takeVictim again.
+ *
+ * @return Index of the claimed (or, for a dirty victim, pinned) frame, pinned once on behalf of
+ *         the caller, or NO_FRAME if every frame is pinned (or, with cleanOnly, the victim is dirty).
+ */
+static int takeVictim(BM_BufferPool *const bm, BM_ScanRing *const ring, const PoolKey pageNum, bool cleanOnly,
+		bool *dirty)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	int adaptTarget = mgr->adaptTarget;
+	int i;
+
+	mgr->rearIndex++;
+	if (dirty != NULL)
+		*dirty = false;
+
+	if (mgr->ghosts != NULL)
+		adaptiveMiss(bm, pageNum);
+
+	// Pick a victim; if a hit pins it before we can take it over, pick again
+	for (;;)
+	{
+		if (ring != NULL && (i = ringVictim(bm, ring)) != NO_FRAME)
+		{
+			// A ring scan recycles its own frames and leaves the rest of the pool alone
+		}
+		else if (mgr->numUsedFrames < mgr->bufferSize)
+		{
+			// Frames are filled in order, so the next empty frame is the first one past the used ones
+			i = mgr->numUsedFrames++;
+		}
+		else
+		{
+			// The buffer is full and we must replace an existing page using page replacement strategy
+			i = strategyVictim(bm);
+		}
+
+		// Every frame is pinned, so there is nowhere to put the page, or the victim would need a write
+		if (i == NO_FRAME || (cleanOnly && mgr->frames[i].isDirtyBit))
+		{
+			mgr->rearIndex--;
+			mgr->pendingGhost = NO_FRAME;
+			return NO_FRAME;
+		}
+
+		// A dirty victim is written back before it is taken, with the pool lock released
+		if (dirty != NULL && mgr->frames[i].isDirtyBit)
+		{
+			if (!pinVictim(mgr, i))
+				continue;
+			mgr->rearIndex--;
+			mgr->pendingGhost = NO_FRAME;
+			mgr->adaptTarget = adaptTarget;
+			*dirty = true;
+			return i;
+		}
+		if (claimFrame(mgr, i))
+			return i;
+	}
+}
+
+
+/**
+ * @brief Hands a frame claimed by takeVictim over to a new page and publishes it as loading.
+ *
+ * Called with the pool lock held. A victim that turned dirty since the caller looked at it is
+ * written back before its page can be read in again by anyone. The new page is then published
+ * in the page table with the frame marked as loading; the caller reads it in after releasing
+ * the pool lock and calls finishLoad, and pinners finding the page meanwhile wait in waitForLoad.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param ring Scan ring the frame is recorded in, or NULL.
+ * @param i The claimed frame.
+ * @param pageNum Page number of the page being brought in, as the pool keys it.
+ * @param writtenBack Whether the caller wrote the victim's page back just before (see writeBackVictim).
+ *
+ * @return RC_OK, or the error of writing back the dirty victim; the victim then keeps its page,
+ *         still dirty, and the caller gives up on the miss as takeVictim does when it finds no frame.
+ */
+static RC installPage(BM_BufferPool *const bm, BM_ScanRing *const ring, int i, const PoolKey pageNum,
+		bool writtenBack)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PageFrame *pgFrame = mgr->frames;
+	pthread_mutex_t *latch;
+	RC rc;
+
+	// If the page in memory has been modified (isDirtyBit = 1), write the page to disk; a frame
+	// whose write failed is not reused, or the change would be lost
+	rc = writeBackVictim(mgr, i, writtenBack);
+	if (rc != RC_OK)
+	{
+		keepVictim(mgr, i);
+		return rc;
+	}
+
+	wakeCleaner(mgr);
+
+	// Initialize the frame for the new page and hand the old page's bookkeeping over to it
+	if (bm->strategy == RS_LRU_K)
+		lrukLoad(mgr->lruk, i, pgFrame[i].pageNum, pageNum);
+	else if (mgr->ghosts != NULL)
+		adaptiveLoad(bm, i, pgFrame[i].pageNum);
+	pgFrame[i].pageNum = pageNum;
+	pgFrame[i].lfuCnt = 0;
+	pgFrame[i].prefetched = 0;
+
+	// Update page's reference count based on replacement strategy
+	if (bm->strategy == RS_LRU)
+		listTouch(mgr, 0, i);
+	else if (bm->strategy == RS_CLOCK)
+		pgFrame[i].lruCnt = 1;
+
+	// Publish the page; pinners finding it before the read completes wait for it
+	pgFrame[i].loading = 1;
+	pgFrame[i].loadRc = RC_OK;
+	latch = partitionLatch(mgr, pageNum);
+	pthread_mutex_lock(latch);
+	pageTableInsert(mgr, i);
+	pthread_mutex_unlock(latch);
+
+	// Remember the frame so the scan can reuse it once the ring comes round again
+	if (ring != NULL)
+	{
+		ring->frames[ring->next] = i;
+		ring->pages[ring->next] = keyPage(mgr, pageNum);
+		ring->next = (ring->next + 1) % ring->numFrames;
+	}
+	return RC_OK;
+}
+
+
+/**
+ * @brief Evicts the page of a frame claimed by claimFrame without bringing another page in.
+ *
+ * Called with the pool lock held. A dirty page is written back first, as in installPage, and
+ * the page leaves the replacement bookkeeping the way an evicted page does, becoming a ghost or
+ * a retained history. The frame is left empty and still pinned on behalf of the caller.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param i The claimed frame.
+ * @return RC_OK, or the error of writing back the page; the frame then keeps its page, still
+ *         dirty and no longer pinned.
+ */
+static RC evictFramePage(BM_BufferPool *const bm, int i)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PageFrame *frame = &mgr->frames[i];
+	RC rc;
+
+	if (frame->pageNum == NO_PAGE)
+	{
+		listUnlink(mgr, i);
+		return RC_OK;
+	}
+	rc = writeBackVictim(mgr, i, false);
+	if (rc != RC_OK)
+	{
+		keepVictim(mgr, i);
+		return rc;
+	}
+
+	if (bm->strategy == RS_LRU_K)
+	{
+		lrukRetain(mgr->lruk, i, frame->pageNum);
+		memset(&mgr->lruk->hist[(size_t)i * mgr->lruk->k], 0, sizeof(int) * mgr->lruk->k);
+		mgr->lruk->last[i] = 0;
+	}
+	else if (mgr->ghosts != NULL)
+		adaptiveEvict(bm, i);
+	listUnlink(mgr, i);
+	frame->pageNum = NO_PAGE;
+	frame->lruCnt = 0;
+	frame->lfuCnt = 0;
+	frame->prefetched = 0;
+	return RC_OK;
+}
+
+
+/**
+ * @brief Hands an empty frame, pinned by the caller or retired, back to the pool for the next miss.
+ *
+ * Called with the pool lock held. List-based strategies find the frame at the end their next
+ * victim comes from; the others pick an unpinned empty frame as soon as they reach it.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param i The empty frame.
+ */
+static void reviveFrame(BM_BufferPool *const bm, int i)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+	if (bm->strategy == RS_LRU)
+		listAppend(mgr, 0, i);
+	else if (bm->strategy == RS_ARC)
+		listAppend(mgr, ARC_T1, i);
+	else if (bm->strategy == RS_2Q)
+		listAppend(mgr, TWOQ_A1IN, i);
+	mgr->frames[i].retired = false;
+	mgr->frames[i].fixCount = 0;
+}
+
+
+/**
+ * @brief Empties one of the frames a shrinking resizeBufferPool is retiring.
+ *
+ * Called with the pool lock held while the pool holds more frames than its target size. An
+ * empty frame is retired as it is. Otherwise a page has to leave: the empty frames below the
+ * target size are filled first, then the page that leaves is the one the replacement strategy
+ * would evict next, wherever it is. If it
+ * was in a frame being retired, that frame is retired. Otherwise the page of an unpinned frame
+ * being retired moves into the victim's frame, keeping its place in the replacement order, so
+ * the pages that survive the shrink are the hot ones wherever they were. The move copies the
+ * page under its partition latch, so pins of it wait for the copy and then find it in its new
+ * frame. A retired frame stays pinned by the pool until dropRetiredFrames drops it.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return true if a frame was retired, false if none could be: every frame being retired or
+ *         every frame to move a page to is pinned.
+ */
+static bool retireFrame(BM_BufferPool *const bm)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PageFrame *frames = mgr->frames;
+	LRUKState *lruk = mgr->lruk;
+	pthread_mutex_t *latch;
+	int t, v;
+
+	// A frame being retired whose page can move
+	for (t = mgr->bufferSize - 1; t >= mgr->targetSize; t--)
+	{
+		if (!frames[t].retired && frames[t].fixCount == 0)
+			break;
+	}
+	if (t < mgr->targetSize)
+		return false;
+	if (frames[t].pageNum == NO_PAGE)
+	{
+		// An empty frame has no page to keep; it is retired as it is
+		listUnlink(mgr, t);
+		frames[t].fixCount = 1;
+		frames[t].retired = true;
+		return true;
+	}
+
+	// Take an empty frame as takeVictim would, else evict the strategy's victim; if a hit pins it
+	// before we can take it over, pick again
+	mgr->rearIndex++;
+	do
+	{
+		if (mgr->numUsedFrames < mgr->bufferSize)
+			v = mgr->numUsedFrames++;
+		else if ((v = strategyVictim(bm)) == NO_FRAME)
+		{
+			mgr->rearIndex--;
+			return false;
+		}
+	} while (!claimFrame(mgr, v));
+	if (evictFramePage(bm, v) != RC_OK)
+	{
+		mgr->rearIndex--;
+		return false;
+	}
+	if (v >= mgr->targetSize)
+	{
+		frames[v].retired = true;
+		return true;
+	}
+
+	// Move the retiring frame's page into the victim's frame, unless it was pinned meanwhile
+	latch = partitionLatch(mgr, frames[t].pageNum);
+	pthread_mutex_lock(latch);
+	if (frames[t].fixCount != 0)
+	{
+		pthread_mutex_unlock(latch);
+		reviveFrame(bm, v);
+		return false;
+	}
+	memcpy(frames[v].data, frames[t].data, bm->pageSize);
+	frames[v].isDirtyBit = atomic_exchange(&frames[t].isDirtyBit, 0);
+	frames[v].lruCnt = frames[t].lruCnt;
+	frames[v].lfuCnt = frames[t].lfuCnt;
+	frames[v].prefetched = frames[t].prefetched;
+	pageTableRemove(mgr, t);
+	frames[v].pageNum = frames[t].pageNum;
+	pageTableInsert(mgr, v);
+	frames[v].fixCount = 0;
+	frames[t].pageNum = NO_PAGE;
+	frames[t].retired = true;
+	frames[t].fixCount = 1;
+	pthread_mutex_unlock(latch);
+
+	listReplace(mgr, t, v);
+	if (lruk != NULL)
+	{
+		memcpy(&lruk->hist[(size_t)v * lruk->k], &lruk->hist[(size_t)t * lruk->k], sizeof(int) * lruk->k);
+		lruk->last[v] = lruk->last[t];
+	}
+	return true;
+}
+
+
+/**
+ * @brief Drops the frames past the pool's target size from the top down, while they are retired or were never used.
+ *
+ * Called with the pool lock held. Only the top frames go, so the pool's frames remain
+ * [0, bufferSize); their memory is given back to the system.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ */
+static void dropRetiredFrames(BM_BufferPool *const bm)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	int numFrames = mgr->bufferSize;
+	int i;
+
+	while (numFrames > mgr->targetSize
+	       && (mgr->frames[numFrames - 1].retired || numFrames - 1 >= mgr->numUsedFrames))
+		numFrames--;
+	if (numFrames == mgr->bufferSize)
+		return;
+
+	for (i = numFrames; i < mgr->bufferSize; i++)
+		pthread_rwlock_destroy(&mgr->frames[i].latch);
+	releaseMemory(mgr->frames, sizeof(PageFrame) * (size_t)numFrames, sizeof(PageFrame) * (size_t)mgr->bufferSize);
+	releaseMemory(mgr->arena, (size_t)numFrames * bm->pageSize, (size_t)mgr->bufferSize * bm->pageSize);
+	mgr->bufferSize = numFrames;
+	if (mgr->numUsedFrames > numFrames)
+		mgr->numUsedFrames = numFrames;
+}
+
+
+/**
+ * @brief Brings a page that is not in the pool into a frame, pinning it.
+ *
+ * Called with the pool lock held, which it releases. The victim is chosen and taken over under
+ * the lock, and the page read from disk after the lock is released, so other pins, hits and
+ * misses alike, go on while the read is in flight. A dirty victim is written back with the lock
+ * released too, before it is taken over; as another miss may bring the page in meanwhile, the
+ * page is looked up again before the next victim is picked. A miss finding every frame pinned
+ * while such write-backs are in flight waits for them rather than fail. Growing the file for a
+ * page past its end is left until the lock is released as well.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param ring Scan ring to recycle frames from, or NULL to take frames from the whole pool.
+ * @param pageNum Page number of the page to be pinned, as the pool keys it.
+ * @param frameIdx Set to the frame now holding the page.
+ * @param miss Set if the page was read in, false if another miss brought it in meanwhile and
+ *        the pin turned into a hit.
+ *
+ * @return RC_OK on success, RC_BUFFER_POOL_FULL if every frame is pinned, or the error returned
+ *         by the storage manager, also for the write-back of a dirty victim. If the file cannot
+ *         grow or the read fails, the page is not left in the pool (see failLoad).
+ */
+static RC loadPage(BM_BufferPool *const bm, BM_ScanRing *const ring, const PoolKey pageNum, int *frameIdx,
+		bool *miss)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolFile *file = mgr->files[keyFile(mgr, pageNum)];
+	int i, writtenBack = NO_FRAME;
+	bool dirty, written;
+
+	// The page has to be read from disk
+	SM_FileHandle *fh;
+	RC rc = poolFile(bm, keyFile(mgr, pageNum), &fh);
+	if (rc != RC_OK)
+	{
+		pthread_mutex_unlock(&mgr->lock);
+		return rc;
+	}
+
+	// While the pool shrinks, each miss retires a frame, as pins move on from those still pinned
+	if (mgr->bufferSize > mgr->targetSize && retireFrame(bm))
+		dropRetiredFrames(bm);
+
+	for (;;)
+	{
+		i = takeVictim(bm, ring, pageNum, false, &dirty);
+		if (i == NO_FRAME && mgr->victimWrites == 0)
+		{
+			pthread_mutex_unlock(&mgr->lock);
+			return RC_BUFFER_POOL_FULL;
+		}
+		if (i != NO_FRAME && !dirty)
+			break;
+
+		if (i == NO_FRAME)
+		{
+			// The frames other misses are writing back are about to be free again
+			pthread_cond_wait(&mgr->victimWritten, &mgr->lock);
+		}
+		else
+		{
+			// Write the victim back the way the cleaner does, and pick again; it is clean now
+			// unless it was pinned meanwhile
+			mgr->victimWrites++;
+			pthread_mutex_unlock(&mgr->lock);
+			rc = writePinnedVictim(mgr, i, &written);
+			pthread_mutex_lock(&mgr->lock);
+			mgr->frames[i].fixCount--;
+			mgr->victimWrites--;
+			pthread_cond_broadcast(&mgr->victimWritten);
+			if (rc != RC_OK)
+			{
+				pthread_mutex_unlock(&mgr->lock);
+				return rc;
+			}
+			if (written)
+			{
+				// With a cleaner running this should be rare, so count it; writeCount records
+				// the number of writes done by the buffer manager
+				mgr->cleanerStats.syncWrites++;
+				mgr->writeCount++;
+				writtenBack = i;
+			}
+		}
+
+		*frameIdx = pinIfResident(mgr, pageNum, true);
+		if (*frameIdx != NO_FRAME)
+		{
+			recordHit(bm, *frameIdx);
+			pthread_mutex_unlock(&mgr->lock);
+			*miss = false;
+			return RC_OK;
+		}
+	}
+	rc = installPage(bm, ring, i, pageNum, i == writtenBack);
+	if (rc != RC_OK)
+	{
+		mgr->rearIndex--;
+		mgr->pendingGhost = NO_FRAME;
+		pthread_mutex_unlock(&mgr->lock);
+		return rc;
+	}
+	mgr->misses++;
+	pthread_mutex_unlock(&mgr->lock);
+
+	// Grow the file if the page is past its end, then read the page from disk straight into the
+	// frame's buffer; a page that cannot be read leaves the pool again
+	pthread_mutex_lock(&file->lock);
+	rc = ensureCapacity(keyPage(mgr, pageNum) + 1, fh);
+	pthread_mutex_unlock(&file->lock);
+	if (rc == RC_OK)
+		rc = poolReadBlock(mgr, pageNum, mgr->frames[i].data);
+	if (rc != RC_OK)
+	{
+		failLoad(mgr, i, rc);
+		return rc;
+	}
+	finishLoad(mgr, &mgr->frames[i]);
+
+	*frameIdx = i;
+	*miss = true;
+	return RC_OK;
+}
+
+
+/**
+ * @brief Pins a page, bringing it in through a scan ring if one is given.
+ *
+ * Shared by pinPage and pinPageScan; see pinPage. A hit pins the frame under the partition
+ * latch of its page and, for strategies whose hits reorder shared state, takes the pool lock to
+ * record it. A miss takes the pool lock, looks again in case another miss brought the page in
+ * meanwhile, and otherwise loads it with loadPage.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param ring Scan ring to recycle frames from, or NULL to take frames from the whole pool.
+ * @param page Pointer to the page handle structure that will store information about the pinned page.
+ * @param pageNum Page number of the page to be pinned.
+ *
+ * @return RC_OK if the page is successfully pinned in the buffer pool, or an appropriate error code otherwise.
+ */
+static RC pinPageWith(BM_BufferPool *const bm, BM_ScanRing *const ring, BM_PageHandle *const page,
+		const PageNumber pageNum)
+{
+	static __thread unsigned int hitSample;
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolKey key = pageKey(bm, pageNum);
+	bool timed, miss = false;
+	long long start;
+	unsigned int hash;
+	int i;
+
+	// A mapped pool hands out the page in place; the kernel reads it in on first access
+	if (mgr->mapped)
+	{
+		char *data = getMappedPage(&mgr->files[0]->fileHandle, pageNum);
+		if (data == NULL)
+			return RC_READ_NON_EXISTING_PAGE;
+		mgr->mappedPins++;
+		if (mgr->trace != NULL)
+			traceRecord(mgr->trace, 0, pageNum, true);
+		page->pageNum = pageNum;
+		page->data = data;
+		page->latch = NULL;
+		return RC_OK;
+	}
+
+	// Only a view's own, non-negative pages have a key in the shared pool
+	if (key == NO_PAGE && mgr->shared)
+		return RC_READ_NON_EXISTING_PAGE;
+
+	// Time one hit in BM_HIT_SAMPLE_RATE, and every miss from when it is found to be one
+	timed = (++hitSample & (BM_HIT_SAMPLE_RATE - 1)) == 0;
+	start = timed ? nowNanos() : 0;
+
+	i = pinIfResident(mgr, key, true);
+	if (i != NO_FRAME && !hitTakesLock(bm))
+		recordHit(bm, i);
+	else
+	{
+		if (i == NO_FRAME && !timed)
+			start = nowNanos();
+		pthread_mutex_lock(&mgr->lock);
+		if (i == NO_FRAME)
+			i = pinIfResident(mgr, key, true);
+		if (i == NO_FRAME)
+		{
+			RC rc = loadPage(bm, ring, key, &i, &miss);
+			if (rc != RC_OK)
+				return rc;
+		}
+		else
+		{
+			recordHit(bm, i);
+			pthread_mutex_unlock(&mgr->lock);
+		}
+	}
+	if (waitForLoad(mgr, &mgr->frames[i]))
+		atomic_fetch_add_explicit(&mgr->pinWaits, 1, memory_order_relaxed);
+
+	// The read this pin waited for failed and took the page out of the pool again
+	if (mgr->frames[i].loadRc != RC_OK)
+	{
+		RC rc = mgr->frames[i].loadRc;
+
+		mgr->frames[i].fixCount--;
+		return rc;
+	}
+	if (miss)
+		histRecord(&mgr->pinMissLatency, nowNanos() - start);
+	else if (timed)
+		histRecord(&mgr->pinHitLatency, nowNanos() - start);
+	if (mgr->trace != NULL)
+		traceRecord(mgr->trace, keyFile(mgr, key), keyPage(mgr, key), !miss);
+
+	// Sample the pin for the pool's miss ratio curve
+	hash = mrcHash(key);
+	if (hash < atomic_load_explicit(&mgr->mrc->threshold, memory_order_relaxed))
+		mrcRecord(mgr->mrc, key, hash);
+
+	page->pageNum = pageNum;
+	page->data = mgr->frames[i].data;
+	page->latch = &mgr->frames[i].latch;
+	return RC_OK;
+}
+
+
+/**
+ * @brief Pins a page with the specified page number in the buffer pool.
+ *
+ * This function adds the page with the given page number to the buffer pool. If the buffer pool is full, it uses the specified page replacement strategy
+ * to replace an existing page in memory with the new page being pinned. The function also handles cases where the buffer pool is empty or where the page
+ * is already present in memory.
+ *
+ * Any number of threads may pin, unpin and mark pages of the same pool at once. The handle also
+ * receives the frame's content latch, which threads sharing a page take through latchPage.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param page Pointer to the page handle structure that will store information about the pinned page.
+ * @param pageNum Page number of the page to be pinned.
+ *
+ * @return RC_OK if the page is successfully pinned in the buffer pool, or an appropriate error code otherwise.
+ */
+extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+{
+	return pinPageWith(bm, NULL, page, pageNum);
+}
+
+
+/**
+ * @brief Latches the content of a pinned page, shared for reading or exclusive for writing.
+ *
+ * Every frame has a reader-writer latch, so threads sharing a pool can read a page together
+ * while a writer has it to itself. Pins only keep a page in its frame; threads that modify a
+ * page another thread may read hold the exclusive latch while doing so and call markDirty
+ * before releasing it. The background cleaner and forceFlushPool write a page under the shared
+ * latch, so they never write it half modified. The latch is not re-entrant, and must be
+ * released before the page is unpinned.
+ *
+ * Pages of a mapped pool are never written, so they need no latch: shared latches are granted
+ * at once and exclusive ones refused.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param page Handle filled in by pinPage or pinPageScan.
+ * @param mode BM_LATCH_SHARED or BM_LATCH_EXCLUSIVE.
+ *
+ * @return RC_OK once the latch is held, RC_WRITE_FAILED for an exclusive latch on a mapped pool,
+ *         or RC_ERROR if the handle has no latch.
+ */
+extern RC latchPage(BM_BufferPool *const bm, BM_PageHandle *const page, const BM_LatchMode mode)
+{
+	pthread_rwlock_t *latch = (pthread_rwlock_t *)page->latch;
+
+	if (latch == NULL && ((BufferPoolMgr *)bm->mgmtData)->mapped)
+		return mode == BM_LATCH_SHARED ? RC_OK : RC_WRITE_FAILED;
+	if (latch == NULL)
+		return RC_ERROR;
+	if (mode == BM_LATCH_EXCLUSIVE)
+		pthread_rwlock_wrlock(latch);
+	else
+		pthread_rwlock_rdlock(latch);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Releases a content latch taken with latchPage.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param page The latched page's handle.
+ *
+ * @return RC_OK, or RC_ERROR if the handle has no latch.
+ */
+extern RC unlatchPage(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+	pthread_rwlock_t *latch = (pthread_rwlock_t *)page->latch;
+
+	if (latch == NULL)
+		return ((BufferPoolMgr *)bm->mgmtData)->mapped ? RC_OK : RC_ERROR;
+	pthread_rwlock_unlock(latch);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Sets up a ring of frames for a sequential scan over the buffer pool.
+ *
+ * Pages a scan reads through pinPageScan are loaded into at most numFrames frames, which are
+ * recycled round-robin once the ring is full, much like PostgreSQL's bulk-read strategy. A
+ * large scan then replaces only the pages it brought in itself instead of the pool's working
+ * set. The ring is capped at a quarter of the pool so a scan can never take it over.
+ *
+ * @param bm Pointer to the buffer pool the scan reads from.
+ * @param ring Pointer to the ring to initialize.
+ * @param numFrames Requested number of frames in the ring, e.g. SCAN_RING_FRAMES.
+ *
+ * @return RC_OK on success, or RC_ERROR if memory for the ring cannot be allocated.
+ */
+extern RC initScanRing(BM_BufferPool *const bm, BM_ScanRing *const ring, const int numFrames)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	int poolFrames = mgr->targetSize;
+	int i;
+
+	ring->numFrames = numFrames < poolFrames / 4 ? numFrames : poolFrames / 4;
+	if (ring->numFrames < 1)
+		ring->numFrames = 1;
+	ring->next = 0;
+	ring->frames = malloc(sizeof(int) * ring->numFrames);
+	ring->pages = malloc(sizeof(PageNumber) * ring->numFrames);
+	if (ring->frames == NULL || ring->pages == NULL)
+	{
+		free(ring->frames);
+		free(ring->pages);
+		return RC_ERROR;
+	}
+
+	// No slot holds a frame yet
+	for (i = 0; i < ring->numFrames; i++)
+	{
+		ring->frames[i] = NO_FRAME;
+		ring->pages[i] = NO_PAGE;
+	}
+	return RC_OK;
+}
+
+
+/**
+ * @brief Pins a page on behalf of a sequential scan.
+ *
+ * Behaves like pinPage, except that on a miss the page goes into the frame the ring loaded one
+ * lap ago, as long as that frame is unpinned and still holds the scan's page. Pages that are
+ * already in the pool are pinned where they are.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param ring The scan's ring, set up by initScanRing.
+ * @param page Pointer to the page handle structure that will store information about the pinned page.
+ * @param pageNum Page number of the page to be pinned.
+ *
+ * @return RC_OK if the page is successfully pinned in the buffer pool, or an appropriate error code otherwise.
+ */
+extern RC pinPageScan(BM_BufferPool *const bm, BM_ScanRing *const ring, BM_PageHandle *const page,
+		const PageNumber pageNum)
+{
+	return pinPageWith(bm, ring, page, pageNum);
+}
+
+
+/**
+ * @brief Releases a scan ring. Its frames stay in the pool with their pages.
+ *
+ * @param ring The ring to release.
+ *
+ * @return RC_OK.
+ */
+extern RC freeScanRing(BM_ScanRing *const ring)
+{
+	free(ring->frames);
+	free(ring->pages);
+	ring->frames = NULL;
+	ring->pages = NULL;
+	ring->numFrames = 0;
+	return RC_OK;
+}
+
+
+/**
+ * @brief Starts reading pages into the pool ahead of the pins that will need them.
+ *
+ * Shared by prefetchPages and readahead. Each page that is not in the pool yet gets a frame the
+ * way a miss would, through the ring if one is given, and the reads are submitted to the pool's
+ * I/O queue as one batch. The frame is pinned only until its read completes, so a prefetched
+ * page is not pinned by anyone once it is in, and a pin arriving while it is in flight waits
+ * for that read alone. Prefetching stops early rather than wait: at the end of the file, or when the next
+ * victim is pinned or would have to be written back first.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param ring Scan ring to recycle frames from, or NULL to take frames from the whole pool.
+ * @param firstPage First page to read.
+ * @param numPages Number of consecutive pages to read.
+ *
+ * @return RC_OK, also if some pages were not prefetched, RC_ERROR for a negative page or count or
+ *         if the I/O queue cannot be set up, or the error returned by the storage manager.
+ */
+static RC prefetchWith(BM_BufferPool *const bm, BM_ScanRing *const ring, const PageNumber firstPage,
+		const int numPages)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	SM_IORequest **requests;
+	SM_FileHandle *fh;
+	PoolIO *io;
+	PageNumber pageNum;
+	PoolKey key;
+	pthread_mutex_t *latch;
+	bool resident;
+	int i, n = 0, numSubmitted, maxRequests, numFilePages;
+	RC rc;
+
+	if (firstPage < 0 || numPages < 0)
+		return RC_ERROR;
+	if (numPages == 0)
+		return RC_OK;
+
+	// A mapped pool has no frames to read into; have the kernel read the pages into the page cache
+	if (mgr->mapped)
+		return adviseAccess(&mgr->files[0]->fileHandle, firstPage, numPages, SM_ADVICE_WILLNEED);
+
+	maxRequests = numPages < mgr->bufferSize ? numPages : mgr->bufferSize;
+	requests = malloc(sizeof(SM_IORequest *) * maxRequests);
+	if (requests == NULL)
+		return RC_ERROR;
+
+	pthread_mutex_lock(&mgr->lock);
+	rc = poolFile(bm, bm->fileSlot, &fh);
+	if (rc == RC_OK && mgr->files[bm->fileSlot]->io == NULL)
+		rc = startPoolIO(mgr, mgr->files[bm->fileSlot]);
+	if (rc != RC_OK)
+	{
+		pthread_mutex_unlock(&mgr->lock);
+		free(requests);
+		return rc;
+	}
+	io = mgr->files[bm->fileSlot]->io;
+
+	// Prefetching never grows the file; pages past its end have nothing to read. Misses grow it
+	// without the pool lock
+	numFilePages = __atomic_load_n(&fh->totalNumPages, __ATOMIC_ACQUIRE);
+	for (pageNum = firstPage; pageNum - firstPage < numPages && pageNum < numFilePages && n < maxRequests; pageNum++)
+	{
+		key = pageKey(bm, pageNum);
+		if (key == NO_PAGE)
+			break;
+		latch = partitionLatch(mgr, key);
+		pthread_mutex_lock(latch);
+		resident = pageTableLookup(mgr, key) != NO_FRAME;
+		pthread_mutex_unlock(latch);
+		if (resident)
+			continue;
+
+		i = takeVictim(bm, ring, key, true, NULL);
+		if (i == NO_FRAME)
+			break;
+		if (installPage(bm, ring, i, key, false) != RC_OK)
+		{
+			mgr->rearIndex--;
+			mgr->pendingGhost = NO_FRAME;
+			break;
+		}
+		mgr->frames[i].prefetched = 1;
+		mgr->frames[i].io.pageNum = pageNum;
+		mgr->frames[i].io.memPage = mgr->frames[i].data;
+		mgr->frames[i].io.isWrite = 0;
+		mgr->frames[i].io.userData = &mgr->frames[i];
+		requests[n++] = &mgr->frames[i].io;
+	}
+	pthread_mutex_unlock(&mgr->lock);
+
+	// Hand the reads over as one batch; read whatever the queue has no room for right here
+	numSubmitted = n > 0 ? submitPoolIO(mgr, io, requests, n) : 0;
+	atomic_fetch_add_explicit(&mgr->readCount, numSubmitted, memory_order_relaxed);
+	for (i = numSubmitted; i < n; i++)
+	{
+		PageFrame *frame = (PageFrame *)requests[i]->userData;
+
+		rc = poolReadBlock(mgr, frame->pageNum, frame->data);
+		if (rc != RC_OK)
+		{
+			failLoad(mgr, (int)(frame - mgr->frames), rc);
+			continue;
+		}
+		finishLoad(mgr, frame);
+		frame->fixCount--;
+	}
+	free(requests);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Starts reading pages into the pool without pinning them, so later pins find them there.
+ *
+ * The reads go through the pool's I/O queue (io_uring, or threads where it is not available),
+ * set up on first use, and complete in the background. Pages already in the
+ * pool or past the end of the file are skipped, and prefetching stops early rather than take a
+ * pinned or dirty frame. A prefetched page counts as read (getNumReadIO), but not as referenced
+ * until it is first pinned. A mapped pool asks the kernel to read the pages ahead instead.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param firstPage First page to read.
+ * @param numPages Number of consecutive pages to read.
+ *
+ * @return RC_OK, also if some pages were not prefetched, or an error code if prefetching cannot start.
+ */
+extern RC prefetchPages(BM_BufferPool *const bm, const PageNumber firstPage, const int numPages)
+{
+	return prefetchWith(bm, NULL, firstPage, numPages);
+}
+
+
+/**
+ * @brief Sets up the readahead state of a new sequential reader.
+ *
+ * @param ra The state to initialize.
+ */
+extern void initReadahead(BM_Readahead *const ra)
+{
+	ra->lastPage = NO_PAGE;
+	ra->nextFetch = 0;
+	ra->window = 0;
+}
+
+
+/**
+ * @brief Tells the pool which page a reader is about to pin, prefetching ahead of sequential reads.
+ *
+ * Called before each pin. Repeated calls for the same page are ignored. Once the reader moves on
+ * to the next page, the pages after it are prefetched, READAHEAD_MIN_PAGES at first and twice
+ * as many each time the reader has consumed half of the last batch, up to READAHEAD_MAX_PAGES,
+ * a quarter of the pool or half of the scan ring. Any other jump ends the sequential run and
+ * drops the window, so random readers pay nothing. A mapped pool has no frames to fill, so only
+ * READAHEAD_MAX_PAGES limits its window.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param ra The reader's readahead state, set up by initReadahead.
+ * @param ring The reader's scan ring, or NULL if it pins with pinPage.
+ * @param pageNum Page the reader is about to pin.
+ *
+ * @return RC_OK, or the error of the prefetch.
+ */
+extern RC readahead(BM_BufferPool *const bm, BM_Readahead *const ra, BM_ScanRing *const ring,
+		const PageNumber pageNum)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	int maxWindow = ring != NULL ? ring->numFrames / 2 : mgr->targetSize / 4;
+	bool sequential = ra->lastPage != NO_PAGE && pageNum == ra->lastPage + 1;
+	RC rc;
+
+	if (pageNum == ra->lastPage)
+		return RC_OK;
+	ra->lastPage = pageNum;
+
+	if (!sequential)
+	{
+		ra->window = 0;
+		ra->nextFetch = pageNum + 1;
+		return RC_OK;
+	}
+	if (ra->nextFetch <= pageNum)
+		ra->nextFetch = pageNum + 1;
+
+	// Prefetch the next batch once the reader is halfway through the previous one
+	if (ra->window > 0 && ra->nextFetch - (pageNum + 1) > ra->window / 2)
+		return RC_OK;
+	if (maxWindow > READAHEAD_MAX_PAGES || ((BufferPoolMgr *)bm->mgmtData)->mapped)
+		maxWindow = READAHEAD_MAX_PAGES;
+	if (maxWindow < 1)
+		maxWindow = 1;
+	ra->window = ra->window == 0 ? READAHEAD_MIN_PAGES : ra->window * 2;
+	if (ra->window > maxWindow)
+		ra->window = maxWindow;
+
+	rc = prefetchWith(bm, ring, ra->nextFetch, ra->window);
+	ra->nextFetch += ra->window;
+	return rc;
+}
+
+
+/**
+ * @brief Collects dirty, unpinned frames in the order the replacement strategy will reach them.
+ *
+ * List-based strategies are walked from the end their victims come from; the others are swept
+ * circularly from where their hand or search resumes. Writing these frames first means the
+ * next victims are already clean when pinPage gets to them.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param batch Receives the frame indices.
+ * @param max Most frames to collect.
+ * @return Number of frames collected.
+ */
+static int cleanerCandidates(BM_BufferPool *const bm, int *batch, int max)
+{
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    PageFrame *frames = mgr->frames;
+    int n = 0, i, l, start, step;
+
+    if (bm->strategy == RS_LRU || bm->strategy == RS_ARC || bm->strategy == RS_2Q)
+    {
+        int first = 0;
+
+        if (bm->strategy == RS_ARC)
+            first = mgr->lists[ARC_T1].size > mgr->adaptTarget ? ARC_T1 : ARC_T2;
+        else if (bm->strategy == RS_2Q)
+            first = mgr->lists[TWOQ_A1IN].size > mgr->adaptTarget ? TWOQ_A1IN : TWOQ_AM;
+
+        for (l = 0; l < 2 && n < max; l++)
+            for (i = mgr->lists[l == 0 ? first : 1 - first].tail; i != NO_FRAME && n < max; i = frames[i].lruPrev)
+                if (frames[i].fixCount == 0 && frames[i].isDirtyBit == 1)
+                    batch[n++] = i;
+        return n;
+    }
+
+    if (bm->strategy == RS_CLOCK)
+        start = mgr->clockPointer;
+    else if (bm->strategy == RS_FIFO)
+        start = mgr->rearIndex + 1;
+    else if (bm->strategy == RS_LFU)
+        start = mgr->lfuPointer;
+    else
+        start = 0;
+
+    for (step = 0; step < mgr->bufferSize && n < max; step++)
+    {
+        i = (start + step) % mgr->bufferSize;
+        if (frames[i].fixCount == 0 && frames[i].isDirtyBit == 1)
+            batch[n++] = i;
+    }
+    return n;
+}
+
+
+/**
+ * @brief Body of a pool's background cleaner thread.
+ *
+ * Sleeps until pinPage reports fewer clean frames than the low watermark, then writes dirty
+ * frames ahead of the replacement strategy until the high watermark is reached. Each batch is
+ * pinned and copied under the pool lock and written with the lock released, so clients keep
+ * pinning pages while the writes are in flight; the pins keep the frames from being reused
+ * before their pages are on disk. Frames are copied under a shared content latch, so a page
+ * is never written half modified, and frames whose latch is held exclusively are skipped.
+ * A page whose write fails is marked dirty again and the round ends, so a failing disk is
+ * retried on the next wake-up rather than in a busy loop.
+ *
+ * @param arg The buffer pool.
+ * @return NULL.
+ */
+static void *cleanerMain(void *arg)
+{
+    BM_BufferPool *bm = (BM_BufferPool *)arg;
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    PoolCleaner *c = mgr->cleaner;
+    int batch[CLEANER_BATCH];
+    PoolKey pages[CLEANER_BATCH];
+    RC results[CLEANER_BATCH];
+    int n, m, k, failed;
+
+    pthread_mutex_lock(&mgr->lock);
+    while (!c->stop)
+    {
+        if (mgr->bufferSize - mgr->numDirty < c->lowWatermark)
+        {
+            mgr->cleanerStats.rounds++;
+            while (!c->stop && mgr->bufferSize - mgr->numDirty < c->highWatermark)
+            {
+                int wanted = c->highWatermark - (mgr->bufferSize - mgr->numDirty);
+
+                // Stop when every remaining dirty frame is pinned
+                n = cleanerCandidates(bm, batch, wanted < CLEANER_BATCH ? wanted : CLEANER_BATCH);
+                if (n == 0)
+                    break;
+
+                // A frame someone pinned and latched since is being modified; leave it for later
+                for (k = 0, m = 0; k < n; k++)
+                {
+                    PageFrame *frame = &mgr->frames[batch[k]];
+
+                    if (pthread_rwlock_tryrdlock(&frame->latch) != 0)
+                        continue;
+                    frame->fixCount++;
+                    memcpy(c->buffers + (size_t)m * bm->pageSize, frame->data, bm->pageSize);
+                    if (atomic_exchange(&frame->isDirtyBit, 0) == 1)
+                        mgr->numDirty--;
+                    pthread_rwlock_unlock(&frame->latch);
+                    pages[m] = frame->pageNum;
+                    batch[m++] = batch[k];
+                }
+                if (m == 0)
+                    break;
+
+                c->writing = true;
+                pthread_mutex_unlock(&mgr->lock);
+                for (k = 0; k < m; k++)
+                    results[k] = poolWriteBlock(mgr, pages[k], c->buffers + (size_t)k * bm->pageSize);
+                pthread_mutex_lock(&mgr->lock);
+
+                // A page whose write failed is dirty again and waits for the next round
+                for (k = 0, failed = 0; k < m; k++)
+                {
+                    PageFrame *frame = &mgr->frames[batch[k]];
+
+                    if (results[k] != RC_OK)
+                    {
+                        if (atomic_exchange(&frame->isDirtyBit, 1) == 0)
+                            mgr->numDirty++;
+                        failed++;
+                    }
+                    frame->fixCount--;
+                }
+                c->writing = false;
+                mgr->writeCount += m - failed;
+                mgr->cleanerStats.pagesWritten += m - failed;
+                if (failed > 0)
+                    break;
+            }
+        }
+        if (!c->stop)
+            pthread_cond_wait(&c->wake, &mgr->lock);
+    }
+    pthread_mutex_unlock(&mgr->lock);
+    return NULL;
+}
+
+
+/**
+ * @brief Starts a background thread that writes dirty pages before they are evicted.
+ *
+ * Whenever fewer than lowWatermark frames are clean, the cleaner writes back dirty, unpinned
+ * frames in the order the replacement strategy will evict them until highWatermark frames are
+ * clean, so that a miss almost never has to wait for a write-back. The pool is locked for
+ * every call while a cleaner runs. shutdownBufferPool stops the cleaner. Started through a view,
+ * the cleaner serves the whole shared pool and outlives the view; shutdownSharedBufferPool stops it.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param lowWatermark Number of clean frames below which the cleaner starts writing.
+ * @param highWatermark Number of clean frames at which it stops again.
+ *
+ * @return RC_OK on success, or RC_ERROR if the watermarks are not 0 <= low <= high <= numPages,
+ *         a cleaner is already running, or the thread cannot be started.
+ */
+extern RC startPoolCleaner(BM_BufferPool *const bm, const int lowWatermark, const int highWatermark)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolCleaner *c;
+	void *buffers = NULL;
+
+	if (lowWatermark < 0 || lowWatermark > highWatermark || highWatermark > mgr->bufferSize)
+		return RC_ERROR;
+
+	c = calloc(1, sizeof(PoolCleaner));
+	if (c == NULL || posix_memalign(&buffers, PAGE_SIZE, (size_t)CLEANER_BATCH * bm->pageSize) != 0)
+	{
+		free(c);
+		return RC_ERROR;
+	}
+	c->buffers = (char *)buffers;
+	c->lowWatermark = lowWatermark;
+	c->highWatermark = highWatermark;
+	c->stop = false;
+	pthread_cond_init(&c->wake, NULL);
+
+	pthread_mutex_lock(&mgr->lock);
+	if (mgr->cleaner != NULL)
+	{
+		pthread_mutex_unlock(&mgr->lock);
+		pthread_cond_destroy(&c->wake);
+		free(c->buffers);
+		free(c);
+		return RC_ERROR;
+	}
+	mgr->cleaner = c;
+	if (pthread_create(&c->thread, NULL, cleanerMain, mgr->shared ? &sharedPool : bm) != 0)
+	{
+		mgr->cleaner = NULL;
+		pthread_mutex_unlock(&mgr->lock);
+		pthread_cond_destroy(&c->wake);
+		free(c->buffers);
+		free(c);
+		return RC_ERROR;
+	}
+	mgr->cleanerLowWatermark = lowWatermark;
+
+	// Clean frames may already be short
+	pthread_cond_signal(&c->wake);
+	pthread_mutex_unlock(&mgr->lock);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Stops the pool's background cleaner, waiting for its writes in flight.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ *
+ * @return RC_OK, also if no cleaner was running.
+ */
+extern RC stopPoolCleaner(BM_BufferPool *const bm)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolCleaner *c;
+
+	pthread_mutex_lock(&mgr->lock);
+	c = mgr->cleaner;
+	if (c == NULL || c->stop)
+	{
+		pthread_mutex_unlock(&mgr->lock);
+		return RC_OK;
+	}
+	mgr->cleanerLowWatermark = 0;
+	c->stop = true;
+	pthread_cond_signal(&c->wake);
+	pthread_mutex_unlock(&mgr->lock);
+	pthread_join(c->thread, NULL);
+
+	pthread_mutex_lock(&mgr->lock);
+	mgr->cleaner = NULL;
+	pthread_mutex_unlock(&mgr->lock);
+
+	pthread_cond_destroy(&c->wake);
+	free(c->buffers);
+	free(c);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Retrieves the counters of the pool's background cleaner.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param stats Filled with the counters since initBufferPool and the pool's current state.
+ *
+ * @return RC_OK.
+ */
+extern RC getCleanerStats(BM_BufferPool *const bm, BM_CleanerStats *const stats)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+	pthread_mutex_lock(&mgr->lock);
+	*stats = mgr->cleanerStats;
+	stats->cleanFrames = mgr->bufferSize - mgr->numDirty;
+	stats->running = mgr->cleaner != NULL;
+	pthread_mutex_unlock(&mgr->lock);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Retrieves the compression counters of the pool's page file (see createCompressedPageFile).
+ *
+ * The counters cover the page I/O since the pool opened its page file, i.e. since its first
+ * pin; before that, and for files that are not compressed, they are all 0. Through a view of the
+ * shared pool, they are those of the view's file.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param stats Filled with the counters.
+ *
+ * @return RC_OK.
+ */
+extern RC getCompressionStats(BM_BufferPool *const bm, BM_CompressionStats *const stats)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolFile *poolFile = mgr->files[bm->fileSlot];
+	SM_CompressionStats file;
+
+	memset(&file, 0, sizeof(file));
+	pthread_mutex_lock(&poolFile->lock);
+	if (poolFile->fileHandle.mgmtInfo != NULL)
+		getPageFileCompressionStats(&poolFile->fileHandle, &file);
+	pthread_mutex_unlock(&poolFile->lock);
+
+	stats->compressed = file.compressed != 0;
+	stats->pagesRead = file.pagesRead;
+	stats->bytesRead = file.bytesRead;
+	stats->pagesWritten = file.pagesWritten;
+	stats->bytesWritten = file.bytesWritten;
+	stats->decompressNanos = file.decompressNanos;
+	stats->compressNanos = file.compressNanos;
+	stats->fileBytes = file.slotBytes;
+	stats->freeBytes = file.freeBytes;
+	return RC_OK;
+}
+
+
+/**
+ * @brief Estimates the pool's LRU miss ratio curve from the reuse distances of its pins.
+ *
+ * Every pinPage of a frame pool feeds an online estimator in the style of SHARDS: pages are
+ * sampled by a hash of their number, and the reuse distance of each sampled pin, scaled by the
+ * sampling rate, is counted in a histogram. One page in MRC_INITIAL_RATE_DIVISOR is sampled
+ * until MRC_MAX_SAMPLES are tracked, after which the rate drops to keep them at that, so large
+ * working sets are measured within a fixed budget of memory and time; pins of unsampled pages
+ * only cost a hash, and a sampled pin is dropped rather than wait while another thread records
+ * one. Working sets of a few dozen pages are sampled too sparsely for more than a
+ * rough estimate. The curve is that of an LRU pool, whatever the pool's own strategy, and
+ * covers all pins since initBufferPool.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param curve Filled with the curve at pool sizes doubling from 1 frame to past the largest
+ *              distance counted.
+ *
+ * @return RC_OK, or RC_ERROR for a mapped pool.
+ */
+extern RC getPoolMissRatioCurve(BM_BufferPool *const bm, BM_MissRatioCurve *const curve)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	MRCEstimator *e = mgr->mrc;
+	long long frames;
+
+	if (mgr->mapped)
+		return RC_ERROR;
+
+	pthread_mutex_lock(&e->lock);
+	curve->references = e->sampled;
+	curve->samplingRate = (double)e->threshold / MRC_HASH_RANGE;
+	curve->numPoints = 0;
+	for (frames = 1; curve->numPoints < BM_MRC_POINTS; frames *= 2)
+	{
+		curve->frames[curve->numPoints] = (int)frames;
+		curve->missRatios[curve->numPoints++] = mrcMissRatio(e, frames);
+		if (frames >= MRC_BUCKETS * e->bucketWidth || frames > (1 << 29))
+			break;
+	}
+	pthread_mutex_unlock(&e->lock);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Estimates the fraction of the pool's pins an LRU pool of numFrames frames would have missed.
+ *
+ * See getPoolMissRatioCurve.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param numFrames Pool size to estimate for.
+ * @param missRatio Set to the estimate, 0 before any pin.
+ *
+ * @return RC_OK, or RC_ERROR for a mapped pool or fewer than one frame.
+ */
+extern RC getPoolMissRatio(BM_BufferPool *const bm, const int numFrames, double *const missRatio)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+
+	if (mgr->mapped || numFrames < 1)
+		return RC_ERROR;
+	pthread_mutex_lock(&mgr->mrc->lock);
+	*missRatio = mrcMissRatio(mgr->mrc, numFrames);
+	pthread_mutex_unlock(&mgr->mrc->lock);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Splits a budget of frames over pools so that together they miss the fewest pins.
+ *
+ * Each pool gets one frame, and the rest go a step at a time to the pool whose estimated
+ * misses (its miss ratio curve times its pins so far) drop the most, steps being a 256th of the
+ * budget or one frame. Curves that flatten before dropping, as a scan larger than the pool
+ * does, are looked at 1, 2, 4, ... steps ahead up to the frames left, and a pool is credited
+ * with its best gain per frame, so one that needs many frames before it hits still gets them. The result is meant for resizing or recreating the pools; nothing is changed.
+ *
+ * @param pools The pools, none of them mapped.
+ * @param numPools Number of pools.
+ * @param totalFrames Frames to split, at least one per pool.
+ * @param frames Set to the frames of each pool.
+ *
+ * @return RC_OK, or RC_ERROR if the budget is too small or a pool is mapped.
+ */
+extern RC splitPoolFrames(BM_BufferPool **const pools, const int numPools, const int totalFrames, int *const frames)
+{
+	long long *pins;
+	int step = totalFrames / 256 > 0 ? totalFrames / 256 : 1;
+	int left = totalFrames - numPools;
+	int p, k;
+
+	if (numPools < 1 || left < 0)
+		return RC_ERROR;
+	pins = malloc(sizeof(long long) * numPools);
+	if (pins == NULL)
+		return RC_ERROR;
+	for (p = 0; p < numPools; p++)
+	{
+		BufferPoolMgr *mgr = (BufferPoolMgr *)pools[p]->mgmtData;
+		BM_PoolMetrics m;
+
+		if (mgr->mapped)
+		{
+			free(pins);
+			return RC_ERROR;
+		}
+		getPoolMetrics(pools[p], &m);
+		pins[p] = m.hits + m.misses;
+		frames[p] = 1;
+	}
+
+	while (left > 0)
+	{
+		double bestGain = 0;
+		int best = 0, bestFrames = step < left ? step : left;
+
+		for (p = 0; p < numPools; p++)
+		{
+			double now = 0, later = 0;
+
+			getPoolMissRatio(pools[p], frames[p], &now);
+			for (k = 1; k * step <= left; k *= 2)
+			{
+				getPoolMissRatio(pools[p], frames[p] + k * step, &later);
+				if ((now - later) * pins[p] / k > bestGain)
+				{
+					bestGain = (now - later) * pins[p] / k;
+					best = p;
+					bestFrames = k * step;
+				}
+			}
+		}
+
+		// Once no pool gains, the rest is spread evenly
+		if (bestGain <= 0)
+		{
+			for (p = 0; left > 0; p = (p + 1) % numPools, left--)
+				frames[p]++;
+			break;
+		}
+		frames[best] += bestFrames;
+		left -= bestFrames;
+	}
+	free(pins);
+	return RC_OK;
+}
+
+
+/**
+ * @brief Adds empty frames to a pool, with the pool lock held.
+ *
+ * The frames come from the pool's reservation, so no frame moves; the page table, the LRU-K
+ * histories and the ghost lists grow along with them.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param numFrames Number of frames the pool has from now on, more than it has.
+ * @return true on success, false if memory runs out; the pool keeps its frames then.
+ */
+static bool growPool(BM_BufferPool *const bm, int numFrames)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	int oldFrames = mgr->bufferSize;
+	int bits = mgr->pageTableBits;
+	int ghostCapacity;
+	GhostDir *ghosts;
+
+	if (!commitMemory(mgr->frames, sizeof(PageFrame) * (size_t)oldFrames, sizeof(PageFrame) * (size_t)numFrames)
+	   || !commitMemory(mgr->arena, (size_t)oldFrames * bm->pageSize, (size_t)numFrames * bm->pageSize))
+		return false;
+	if (mgr->lruk != NULL && !lrukGrow(mgr->lruk, oldFrames, numFrames))
+		return false;
+	if (mgr->ghosts != NULL)
+	{
+		ghostCapacity = bm->strategy == RS_ARC ? numFrames + 1 : (numFrames / 2 > 0 ? numFrames / 2 : 1) + 1;
+		ghosts = ghostGrow(mgr->ghosts, ghostCapacity);
+		if (ghosts == NULL)
+			return false;
+		mgr->ghosts = ghosts;
+	}
+	while ((1 << bits) < numFrames)
+		bits++;
+	if (bits > mgr->pageTableBits && !pageTableResize(mgr, bits))
+		return false;
+
+	initFrames(mgr, oldFrames, numFrames, bm->pageSize);
+	mgr->bufferSize = numFrames;
+	return true;
+}
+
+
+/**
+ * @brief Changes the number of frames of a pool while it is in use.
+ *
+ * Growing takes effect at once: the new frames are empty and filled by the next misses.
+ * Shrinking makes numPages the pool's size at once, and then retires the frames past it: each
+ * step evicts the page the replacement strategy would evict next and, unless that page was in
+ * one of those frames, moves the page of one of them into the victim's frame, so the pool keeps
+ * its hot pages wherever they were. Frames are retired RESIZE_BATCH at a time, releasing the
+ * pool lock in between so pins go on; frames still pinned are retired by later misses, one per
+ * miss, once they are unpinned, and getNumFrames tells how many the pool still holds. Retired
+ * frames give their memory back.
+ *
+ * Frames never move, so handles of pinned pages stay valid. 2Q's queue sizes and ARC's target
+ * follow the new size; scan rings and a running cleaner's watermarks keep theirs.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param numPages Number of frames the pool should have, from 1 up to the frames its
+ *        reservation holds: eight times its initial size, or BM_POOL_MAX_FRAMES_ENV frames if
+ *        that was set when the pool was set up.
+ *
+ * @return RC_OK, also while pinned frames are still to be retired, RC_BUFFER_POOL_FULL for a
+ *         size past the reservation, or RC_ERROR for a mapped pool, a size below 1, or if
+ *         memory runs out.
+ */
+extern RC resizeBufferPool(BM_BufferPool *const bm, const int numPages)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	int i, n, end;
+	bool more;
+
+	if (mgr->mapped || numPages < 1)
+		return RC_ERROR;
+	if (numPages > mgr->capacity)
+		return RC_BUFFER_POOL_FULL;
+
+	pthread_mutex_lock(&mgr->lock);
+	if (numPages > mgr->bufferSize && !growPool(bm, numPages))
+	{
+		pthread_mutex_unlock(&mgr->lock);
+		return RC_ERROR;
+	}
+
+	// Frames an earlier shrink retired below the new size are empty frames again
+	end = numPages < mgr->bufferSize ? numPages : mgr->bufferSize;
+	for (i = mgr->targetSize; i < end; i++)
+	{
+		if (mgr->frames[i].retired)
+			reviveFrame(bm, i);
+	}
+	mgr->targetSize = numPages;
+	bm->numPages = numPages;
+	if (bm->strategy == RS_2Q)
+	{
+		mgr->adaptTarget = numPages / 4 > 0 ? numPages / 4 : 1;
+		mgr->ghostLimit = numPages / 2 > 0 ? numPages / 2 : 1;
+		while (mgr->ghosts->lists[TWOQ_A1OUT].size > mgr->ghostLimit)
+			ghostRemove(mgr->ghosts, mgr->ghosts->lists[TWOQ_A1OUT].tail);
+	}
+	else if (bm->strategy == RS_ARC && mgr->adaptTarget > numPages)
+		mgr->adaptTarget = numPages;
+
+	// Frames that never held a page go at once
+	dropRetiredFrames(bm);
+	pthread_mutex_unlock(&mgr->lock);
+
+	do
+	{
+		pthread_mutex_lock(&mgr->lock);
+		for (n = 0; n < RESIZE_BATCH && mgr->bufferSize > mgr->targetSize && retireFrame(bm); n++)
+			;
+		dropRetiredFrames(bm);
+		more = n == RESIZE_BATCH;
+		pthread_mutex_unlock(&mgr->lock);
+	} while (more);
+	return RC_OK;
 }
 
 
 /**
- * @brief Implementation of the LFU (Least Frequently Used) replacement algorithm.
+ * @brief Sets up the process-wide buffer pool that views of page files share (see initPoolView).
  *
- * This function replaces a page frame in the buffer pool with a new page using the LFU algorithm.
- * Pages are replaced based on the least frequently used criterion.
+ * With a pool per table and per index, memory is split up front, and the frames of an idle
+ * file sit unused while a hot one misses. The shared pool holds the pages of every file opened
+ * on it under one replacement strategy, so frames go to whichever file is in use. Its frames
+ * hold PAGE_SIZE pages. Calling this is optional: the first initPoolView sets the pool up with
+ * BM_SHARED_POOL_FRAMES frames and RS_ARC if it does not exist yet.
  *
- * @param bufferPool Pointer to the buffer pool structure.
- * @param newPage Pointer to the new page to be added to the buffer pool.
+ * @param numPages Number of frames of the shared pool.
+ * @param strategy Page replacement strategy, as for initBufferPool.
+ * @param stratData Parameters of the strategy, as for initBufferPool.
+ *
+ * @return RC_OK on success, or RC_ERROR if the shared pool exists already or memory runs out.
  */
-extern void LFU(BM_BufferPool *const bufferPool, PageFrame *newPage)
+extern RC initSharedBufferPool(const int numPages, ReplacementStrategy strategy, void *stratData)
 {
+	RC rc = RC_ERROR;
 
-    // Retrieve the array of page frames from the buffer pool's management data
-    PageFrame *pageFrames = (PageFrame *) bufferPool->mgmtData;
-    
-    int index, leastFreqIndex, leastFreqCount;
-    leastFreqIndex = LFU_POINTER;	
-    
-    // Iterate through all the page frames in the buffer pool to find the least frequently used page frame
-    for(index = 0; index < BUFFER_SIZE; index++)
-    {
-        if(pageFrames[leastFreqIndex].fixCount == 0)
-        {
-            leastFreqIndex = (leastFreqIndex + index) % BUFFER_SIZE;
-            leastFreqCount = pageFrames[leastFreqIndex].lruCnt;
-            break;
-        }
-    }
-
-    index = (leastFreqIndex + 1) % BUFFER_SIZE;
-
-    // Find the page frame having the minimum lruCnt (i.e., it is used the least frequent)
-    for(int i = 0; i < BUFFER_SIZE; i++)
-    {
-        if(pageFrames[index].lruCnt < leastFreqCount)
-        {
-            leastFreqIndex = index;
-            leastFreqCount = pageFrames[index].lruCnt;
-        }
-        index = (index + 1) % BUFFER_SIZE;
-    }
-        
-    // If the page in memory has been modified (isDirtyBit = 1), write the page to disk	
-    if(pageFrames[leastFreqIndex].isDirtyBit == 1)
-    {
-        SM_FileHandle fileHandle;
-        openPageFile(bufferPool->pageFile, &fileHandle);
-        writeBlock(pageFrames[leastFreqIndex].pageNum, &fileHandle, pageFrames[leastFreqIndex].data);
-        
-        // Increase the WRITE_COUNT which records the number of writes done by the buffer manager.
-        WRITE_COUNT++;
-    }
-    
-    // Set the content of the page frame to the new page's content		
-    pageFrames[leastFreqIndex].data = newPage->data;
-    pageFrames[leastFreqIndex].pageNum = newPage->pageNum;
-    pageFrames[leastFreqIndex].isDirtyBit = newPage->isDirtyBit;
-    pageFrames[leastFreqIndex].fixCount = newPage->fixCount;
-    LFU_POINTER = leastFreqIndex + 1;
+	pthread_mutex_lock(&sharedPoolLock);
+	if (sharedPool.mgmtData == NULL)
+		rc = initPool(&sharedPool, NULL, PAGE_SIZE, numPages, strategy, stratData);
+	pthread_mutex_unlock(&sharedPoolLock);
+	return rc;
 }
 
 
 /**
- * @brief Implementation of the LRU (Least Recently Used) replacement algorithm.
+ * @brief Shuts the shared pool down once no view of it is open.
  *
- * This function replaces a page frame in the buffer pool with a new page using the LRU algorithm.
- * Pages are replaced based on the least recently used criterion.
+ * Stops the pool's cleaner and trace, if any, and releases its memory; the views wrote their
+ * pages when they were closed. The record and index managers call this when they shut down,
+ * so the pool goes away once neither has a file open on it.
  *
- * @param bm Pointer to the buffer pool structure.
- * @param page Pointer to the new page to be added to the buffer pool.
+ * @return RC_OK, also if there is no shared pool, or RC_ERROR if views of it are still open.
  */
-extern void LRU(BM_BufferPool *const bm, PageFrame *page)
-{	
-    // Retrieve the array of page frames from the buffer pool's management data
-    PageFrame *pageFrames = (PageFrame *) bm->mgmtData;
-    int leastLRUIndex = 0;
-    
-    // Find the least recently used page frame
-    for(int i = 0; i < BUFFER_SIZE; i++)
-    {
-        // Find the first page frame with fixCount = 0, indicating it's not pinned
-        if(pageFrames[i].fixCount == 0)
-        {
-            leastLRUIndex = i;
-            break;
-        }
-    }	
-
-    // Iterate through the remaining page frames to find the least recently used page frame
-    for(int i = leastLRUIndex + 1; i < BUFFER_SIZE; i++)
-    {
-        if(pageFrames[i].lruCnt < pageFrames[leastLRUIndex].lruCnt)
-        {
-            leastLRUIndex = i;
-        }
-    }
+extern RC shutdownSharedBufferPool(void)
+{
+	BufferPoolMgr *mgr;
+	RC rc = RC_OK;
+	int slot;
 
-    // If the page in memory has been modified (isDirtyBit = 1), write the page to disk
-    if(pageFrames[leastLRUIndex].isDirtyBit == 1)
-    {
-        SM_FileHandle fh;
-        openPageFile(bm->pageFile, &fh);
-        writeBlock(pageFrames[leastLRUIndex].pageNum, &fh, pageFrames[leastLRUIndex].data);
-        
-        // Increase the WRITE_COUNT which records the number of writes done by the buffer manager.
-        WRITE_COUNT++;
-    }
-    
-    // Set the content of the least recently used page frame to the new page's content
-    pageFrames[leastLRUIndex].data = page->data;
-    pageFrames[leastLRUIndex].pageNum = page->pageNum;
-    pageFrames[leastLRUIndex].isDirtyBit = page->isDirtyBit;
-    pageFrames[leastLRUIndex].fixCount = page->fixCount;
-    pageFrames[leastLRUIndex].lruCnt = page->lruCnt;
+	pthread_mutex_lock(&sharedPoolLock);
+	mgr = (BufferPoolMgr *)sharedPool.mgmtData;
+	if (mgr != NULL)
+	{
+		for (slot = 0; slot < POOL_MAX_FILES && mgr->files[slot] == NULL; slot++)
+			;
+		rc = slot < POOL_MAX_FILES ? RC_ERROR : shutdownBufferPool(&sharedPool);
+	}
+	pthread_mutex_unlock(&sharedPoolLock);
+	return rc;
 }
 
 
-
-
-/** 
- * @brief Initializes a buffer pool with numPages page frames.
+/**
+ * @brief Opens a view of a page file on the process-wide shared pool.
  *
- * This function initializes a buffer pool with a specified number of page frames.
- * It assigns the given page file name, number of pages, and page replacement strategy to the buffer pool.
- * Each page frame is initialized with default values.
+ * The view is used like a pool of its own: pinPage, unpinPage, markDirty, forcePage,
+ * forceFlushPool, scan rings, prefetching and the free page calls take page numbers of the
+ * file and only see its pages, and shutdownBufferPool closes the view. Underneath, the shared
+ * pool keys its frames by (file, page), so the files opened on it compete for one set of
+ * frames and memory flows to whichever is hot. Calls about the pool as a whole, such as
+ * getNumFrames, getPoolMetrics, resizeBufferPool or startPoolCleaner, act on the shared pool.
  *
- * @param bm Pointer to the buffer pool structure to be initialized.
- * @param pageFileName Name of the page file whose pages will be cached in memory.
- * @param numPages Number of page frames in the buffer pool.
- * @param strategy Page replacement strategy (FIFO, LRU, LFU, CLOCK) to be used by the buffer pool.
- * @param stratData Pointer to parameters needed for the page replacement strategy (not used in this implementation).
+ * A view pins any page of its file, as a pool of its own would. Up to 128 views are open at a time. Views opened separately on
+ * the same file cache it separately, as two pools of their own would, so a file is opened once.
+ * Closing the view writes the file's dirty pages and empties their frames for the other files;
+ * it fails with RC_PINNED_PAGES_IN_BUFFER, leaving the view open, while pages of the file are
+ * pinned.
  *
- * @return RC_OK on success, or an error code on failure.
+ * @param bm Pointer to the buffer pool structure to set up as a view.
+ * @param pageFileName Name of the page file, kept by the view as initBufferPool keeps it.
+ *
+ * @return RC_OK on success, RC_PAGE_SIZE_MISMATCH if the file's pages are not the size of the
+ *         shared pool's frames, RC_ERROR if every view slot is taken or the shared pool cannot
+ *         be set up, or the error of reading the file's header.
  */
-extern RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
-		  const int numPages, ReplacementStrategy strategy, 
-		  void *stratData)
+extern RC initPoolView(BM_BufferPool *const bm, const char *const pageFileName)
 {
-	// Assign page file name, number of pages, and page replacement strategy to the buffer pool
-	bm->pageFile = (char *)pageFileName;
-	bm->numPages = numPages;
-	bm->strategy = strategy;
+	BufferPoolMgr *mgr;
+	PoolFile *file;
+	int pageSize, slot;
+	RC rc;
 
-	// Allocate memory space = number of pages x space required for one page
-	PageFrame *page = malloc(sizeof(PageFrame) * numPages);
-	
-	// Set the total number of pages in memory or the buffer pool
-	BUFFER_SIZE = numPages;	
-	
-	int i;
+	// A file not created yet will have the default page size, which openPageFile checks later
+	rc = readPageSize((char *)pageFileName, &pageSize);
+	if (rc == RC_FILE_NOT_FOUND)
+		pageSize = PAGE_SIZE;
+	else if (rc != RC_OK)
+		return rc;
 
-	// Initialize all pages in the buffer pool
-	for(i = 0; i < BUFFER_SIZE; i++)
+	pthread_mutex_lock(&sharedPoolLock);
+	if (sharedPool.mgmtData == NULL
+	    && (rc = initPool(&sharedPool, NULL, PAGE_SIZE, BM_SHARED_POOL_FRAMES, RS_ARC, NULL)) != RC_OK)
 	{
-		// Set fields (variables) of each page to default values
-		page[i].data = NULL;           // No data initially
-		page[i].pageNum = -1;          // Page number not assigned
-		page[i].isDirtyBit = 0;        // Not modified initially
-		page[i].fixCount = 0;          // Not fixed initially
-		page[i].lruCnt = 0;            // Least Recently Used count
-		page[i].lfuCnt = 0;            // Least Frequently Used count
+		pthread_mutex_unlock(&sharedPoolLock);
+		return rc;
+	}
+	mgr = (BufferPoolMgr *)sharedPool.mgmtData;
+	if (pageSize != sharedPool.pageSize)
+	{
+		pthread_mutex_unlock(&sharedPoolLock);
+		return RC_PAGE_SIZE_MISMATCH;
 	}
 
-	// Set the buffer pool's management data to point to the allocated memory for page frames
-	bm->mgmtData = page;
-
-	// Initialize counters and pointers used by replacement algorithms
-	WRITE_COUNT = CLOCK_POINTER = LFU_POINTER = 0;
+	// Give the file the first free slot; it is opened on first use
+	file = calloc(1, sizeof(PoolFile));
+	pthread_mutex_lock(&mgr->lock);
+	for (slot = 0; slot < POOL_MAX_FILES && mgr->files[slot] != NULL; slot++)
+		;
+	if (file != NULL && slot < POOL_MAX_FILES)
+	{
+		file->name = (char *)pageFileName;
+		pthread_mutex_init(&file->lock, NULL);
+		mgr->files[slot] = file;
+	}
+	pthread_mutex_unlock(&mgr->lock);
+	if (file == NULL || slot == POOL_MAX_FILES)
+	{
+		pthread_mutex_unlock(&sharedPoolLock);
+		free(file);
+		return RC_ERROR;
+	}
 
+	bm->pageFile = (char *)pageFileName;
+	bm->numPages = mgr->targetSize;
+	bm->pageSize = sharedPool.pageSize;
+	bm->strategy = sharedPool.strategy;
+	bm->mgmtData = mgr;
+	bm->fileSlot = slot;
+	pthread_mutex_unlock(&sharedPoolLock);
 	return RC_OK;
-		
 }
 
 
-/** 
- * @brief Shuts down the buffer pool, releasing all resources and freeing memory.
- *
- * This function closes the buffer pool, removing all pages from memory and releasing all associated resources.
- * It ensures that all dirty pages (modified pages) are written back to disk before shutting down.
- * If any pages are still pinned (being used by clients), it returns an error.
+/**
+ * @brief Closes a view of the shared pool: writes its file's dirty pages, empties their frames and frees the file's slot.
  *
- * @param bm Pointer to the buffer pool structure to be shut down.
+ * Called by shutdownBufferPool. Pins the cleaner and other misses hold on the file's frames while
+ * writing them are waited for; pins of the view's users make it fail, with the view still open.
  *
- * @return RC_OK on success, or an error code (RC_PINNED_PAGES_IN_BUFFER) if there are still pinned pages.
+ * @param bm The view.
+ * @return RC_OK, RC_PINNED_PAGES_IN_BUFFER if pages of the file are still pinned, or the error of
+ *         writing back a page, with the view still open, or the error of closing the file, with
+ *         the view closed all the same.
  */
-extern RC shutdownBufferPool(BM_BufferPool *const bm)
+static RC closePoolView(BM_BufferPool *const bm)
 {
-	// Get pointer to the array of page frames in the buffer pool
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolFile *file = mgr->files[bm->fileSlot];
+	bool pinned;
+	RC rc;
+	int i;
 
-	// Write all dirty pages back to disk before shutting down
-	forceFlushPool(bm);
+	pthread_mutex_lock(&sharedPoolLock);
 
-	int i;
+	// Write the file's dirty pages; prefetch reads in flight hold pins too
+	rc = forceFlushPool(bm);
+	if (rc != RC_OK)
+	{
+		pthread_mutex_unlock(&sharedPoolLock);
+		return rc;
+	}
+	stopPoolIO(mgr, file);
 
-	// Check if there are any pinned pages in the buffer pool
-	for(i = 0; i < BUFFER_SIZE; i++)
+	pthread_mutex_lock(&mgr->lock);
+	for (;;)
 	{
-		// If fixCount != 0, it means the page is still pinned by some client
-		if(pageFrame[i].fixCount != 0)
+		pinned = false;
+		for (i = 0; i < mgr->bufferSize && !pinned; i++)
+			pinned = inView(bm, mgr->frames[i].pageNum) && mgr->frames[i].fixCount != 0;
+		if (!pinned || ((mgr->cleaner == NULL || !mgr->cleaner->writing) && mgr->victimWrites == 0))
+			break;
+
+		// The pins may be the cleaner's, which it drops once its batch is written, or those of
+		// misses writing the file's pages back as victims
+		if (mgr->victimWrites > 0)
+			pthread_cond_wait(&mgr->victimWritten, &mgr->lock);
+		else
 		{
-			return RC_PINNED_PAGES_IN_BUFFER;
+			pthread_mutex_unlock(&mgr->lock);
+			sched_yield();
+			pthread_mutex_lock(&mgr->lock);
+		}
+	}
+	if (pinned)
+	{
+		pthread_mutex_unlock(&mgr->lock);
+		pthread_mutex_unlock(&sharedPoolLock);
+		return RC_PINNED_PAGES_IN_BUFFER;
+	}
+
+	// Nobody can pin the file's pages any more; hand their frames to the other files
+	for (i = 0; i < mgr->bufferSize; i++)
+	{
+		if (inView(bm, mgr->frames[i].pageNum) && claimFrame(mgr, i))
+		{
+			rc = evictFramePage(bm, i);
+			if (rc != RC_OK)
+			{
+				pthread_mutex_unlock(&mgr->lock);
+				pthread_mutex_unlock(&sharedPoolLock);
+				return rc;
+			}
+			reviveFrame(bm, i);
 		}
 	}
+	mgr->files[bm->fileSlot] = NULL;
+	pthread_mutex_unlock(&mgr->lock);
+	pthread_mutex_unlock(&sharedPoolLock);
 
-	// Free memory occupied by the page frames and set mgmtData to NULL
-	free(pageFrame);
+	rc = file->fileHandle.mgmtInfo != NULL ? closePageFile(&file->fileHandle) : RC_OK;
+	pthread_mutex_destroy(&file->lock);
+	free(file);
 	bm->mgmtData = NULL;
-
-	return RC_OK;
+	return rc;
 }
 
-
 /**
- * @brief Writes all dirty pages (pages with fixCount = 0 and isDirtyBit = 1) to disk.
+ * @brief Starts recording every pinPage of the pool into a trace file.
  *
- * This function forces the buffer pool to write all dirty pages (modified pages) back to the page file on disk.
- * It iterates through all page frames in the buffer pool, checks if a page is dirty and unpinned, and writes it to disk.
- * After writing, it marks the page as not dirty and increments the WRITE_COUNT.
+ * Each pin is logged with its page number, whether it was a hit, and the time since the trace
+ * started, in a compact binary file that readPoolTrace reads back and trace_sim replays against
+ * every replacement strategy and pool size. Records are buffered and written
+ * TRACE_BUFFER_RECORDS at a time; each costs a clock reading and the trace's lock. A mapped
+ * pool's pins are recorded as hits. Start and stop a trace while no other thread uses the pool;
+ * shutdownBufferPool stops it, even when it fails because pages are still pinned. Setting BM_TRACE_DIR_ENV traces every pool from initBufferPool on.
+ * Through a view, the trace records the pins of every view of the shared pool, each page with
+ * the slot of its file; shutdownSharedBufferPool stops it.
  *
  * @param bm Pointer to the buffer pool structure.
+ * @param traceFileName File to write the trace to, replaced if it exists.
  *
- * @return RC_OK on success.
+ * @return RC_OK, RC_ERROR if the pool is already traced, or RC_WRITE_FAILED if the file cannot be written.
  */
-extern RC forceFlushPool(BM_BufferPool *const bm)
+extern RC startPoolTrace(BM_BufferPool *const bm, const char *const traceFileName)
 {
-	// Get pointer to the array of page frames in the buffer pool
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
-	int i;
-	// Iterate through all page frames in the buffer pool
-	for(i = 0; i < BUFFER_SIZE; i++)
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolTrace *trace;
+	char header[TRACE_HEADER_BYTES];
+	int frames = mgr->bufferSize;
+
+	if (mgr->trace != NULL)
+		return RC_ERROR;
+	trace = malloc(sizeof(PoolTrace));
+	if (trace == NULL)
+		return RC_ERROR;
+	trace->fd = open(traceFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (trace->fd < 0)
 	{
-		// Check if the page is dirty and unpinned
-		if(pageFrame[i].fixCount == 0 && pageFrame[i].isDirtyBit == 1)
-		{
-			SM_FileHandle filehandle;
-			// Open the page file on disk
-			openPageFile(bm->pageFile, &filehandle);
-			// Write the block of data to the page file on disk
-			writeBlock(pageFrame[i].pageNum, &filehandle, pageFrame[i].data);
-			// Mark the page as not dirty
-			pageFrame[i].isDirtyBit = 0;
-			// Increment the WRITE_COUNT which records the number of writes done by the buffer manager
-			WRITE_COUNT++;
-		}
-	}	
+		free(trace);
+		return RC_WRITE_FAILED;
+	}
+
+	memcpy(header, TRACE_MAGIC, 8);
+	memcpy(header + 8, &bm->pageSize, sizeof(int));
+	memcpy(header + 12, &frames, sizeof(int));
+	if (write(trace->fd, header, TRACE_HEADER_BYTES) != TRACE_HEADER_BYTES)
+	{
+		close(trace->fd);
+		free(trace);
+		return RC_WRITE_FAILED;
+	}
+
+	pthread_mutex_init(&trace->lock, NULL);
+	trace->numBuffered = 0;
+	trace->failed = false;
+	trace->start = nowNanos();
+	mgr->trace = trace;
 	return RC_OK;
 }
 
 
 /**
- * @brief Marks a page as dirty, indicating that its data has been modified by the client.
- *
- * This function sets the isDirtyBit flag to 1 for the specified page in the buffer pool, indicating that the page's data has been modified.
- * It iterates through all pages in the buffer pool to find the page with the specified page number and marks it as dirty.
+ * @brief Stops the pool's trace, writing out the pins still buffered.
  *
  * @param bm Pointer to the buffer pool structure.
- * @param page Pointer to the page handle structure containing information about the page to be marked as dirty.
  *
- * @return RC_OK if the page is successfully marked as dirty, RC_ERROR if the page is not found in the buffer pool.
+ * @return RC_OK, also if the pool is not traced, or RC_WRITE_FAILED if part of the trace could
+ *         not be written; the file then ends with the records written before.
  */
-extern RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
+extern RC stopPoolTrace(BM_BufferPool *const bm)
 {
-	// Get pointer to the array of page frames in the buffer pool
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
-	int i;
-	// Iterate through all pages in the buffer pool
-	for(i = 0; i < BUFFER_SIZE; i++)
-	{
-		// If the current page is the page to be marked dirty, set isDirtyBit = 1 for that page
-		if(pageFrame[i].pageNum == page->pageNum)
-		{
-			pageFrame[i].isDirtyBit = 1;
-			return RC_OK;		
-		}			
-	}		
-	// Return error if the page is not found in the buffer pool
-	return RC_ERROR;
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolTrace *trace = mgr->trace;
+	bool failed;
+
+	if (trace == NULL)
+		return RC_OK;
+	mgr->trace = NULL;
+
+	traceFlush(trace);
+	failed = trace->failed;
+	if (close(trace->fd) != 0)
+		failed = true;
+	pthread_mutex_destroy(&trace->lock);
+	free(trace);
+	return failed ? RC_WRITE_FAILED : RC_OK;
 }
 
 
 /**
- * @brief Unpins a page from memory, indicating that the client has completed work on the page.
+ * @brief Reads a trace written by startPoolTrace.
  *
- * This function decreases the fixCount for the specified page in the buffer pool, indicating that the client has completed its work with the page.
- * It iterates through all pages in the buffer pool to find the page with the specified page number and decreases its fixCount.
+ * A record cut short, as when the traced process died, is dropped.
  *
- * @param bm Pointer to the buffer pool structure.
- * @param page Pointer to the page handle structure containing information about the page to be unpinned.
+ * @param traceFileName The trace file.
+ * @param trace Filled with the trace; release it with freePoolTrace.
  *
- * @return RC_OK once the page is successfully unpinned.
+ * @return RC_OK, RC_FILE_NOT_FOUND if the file cannot be opened, or RC_ERROR if it is not a
+ *         trace or cannot be read.
  */
-extern RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const pg)
-{	
-	// Get pointer to the array of page frames in the buffer pool
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
-	int i;
-	// Iterate through all pages in the buffer pool
-	for(i = 0; i < BUFFER_SIZE; i++)
+extern RC readPoolTrace(const char *const traceFileName, BM_Trace *const trace)
+{
+	FILE *file = fopen(traceFileName, "rb");
+	char header[TRACE_HEADER_BYTES], record[TRACE_RECORD_BYTES];
+	long long stamp, capacity = 1024;
+
+	if (file == NULL)
+		return RC_FILE_NOT_FOUND;
+	if (fread(header, 1, TRACE_HEADER_BYTES, file) != TRACE_HEADER_BYTES || memcmp(header, TRACE_MAGIC, 8) != 0)
+	{
+		fclose(file);
+		return RC_ERROR;
+	}
+	memcpy(&trace->pageSize, header + 8, sizeof(int));
+	memcpy(&trace->numFrames, header + 12, sizeof(int));
+	trace->numRecords = 0;
+	trace->records = malloc(sizeof(BM_TraceRecord) * capacity);
+
+	while (trace->records != NULL && fread(record, 1, TRACE_RECORD_BYTES, file) == TRACE_RECORD_BYTES)
 	{
-		// If the current page is the page to be unpinned, decrease its fixCount and exit loop
-		if(pageFrame[i].pageNum == pg->pageNum)
+		BM_TraceRecord *r;
+
+		if (trace->numRecords == capacity)
 		{
-			pageFrame[i].fixCount--;
-			break;		
-		}		
+			BM_TraceRecord *grown = realloc(trace->records, sizeof(BM_TraceRecord) * capacity * 2);
+			if (grown == NULL)
+			{
+				free(trace->records);
+				trace->records = NULL;
+				break;
+			}
+			trace->records = grown;
+			capacity *= 2;
+		}
+		r = &trace->records[trace->numRecords++];
+		memcpy(&r->fileSlot, record, sizeof(int));
+		memcpy(&r->pageNum, record + sizeof(int), sizeof(int));
+		memcpy(&stamp, record + 2 * sizeof(int), sizeof(long long));
+		r->nanos = stamp >> 1;
+		r->hit = (stamp & 1) != 0;
+	}
+	if (trace->records == NULL || ferror(file))
+	{
+		fclose(file);
+		freePoolTrace(trace);
+		return RC_ERROR;
 	}
+	fclose(file);
 	return RC_OK;
 }
 
 
 /**
- * @brief Writes the contents of the modified pages back to the page file on disk.
+ * @brief Releases a trace read by readPoolTrace.
  *
- * This function iterates through all pages in the buffer pool to find the page with the specified page number.
- * If the page is found and marked dirty (indicating modification), it writes the page's data back to the disk using the storage manager functions.
- * After writing, it marks the page as not dirty and increments the WRITE_COUNT to record the write operation.
+ * @param trace The trace.
+ */
+extern void freePoolTrace(BM_Trace *const trace)
+{
+	free(trace->records);
+	trace->records = NULL;
+	trace->numRecords = 0;
+}
+
+
+/**
+ * @brief Takes a snapshot of the pool's counters and latency histograms.
+ *
+ * Counters only grow, so rates come from the difference of two snapshots. Hits are summed over
+ * the page table partitions, each under its latch, and the histograms are read without locks,
+ * so a snapshot taken while others pin may be a few operations off between fields. The pinPage
+ * histograms cover frame pools only; the pins of a mapped pool are not counted.
  *
  * @param bm Pointer to the buffer pool structure.
- * @param page Pointer to the page handle structure containing information about the page to be written back to disk.
+ * @param metrics Filled with the snapshot.
  *
- * @return RC_OK once the page has been successfully written back to disk.
+ * @return RC_OK.
  */
-extern RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const pg)
+extern RC getPoolMetrics(BM_BufferPool *const bm, BM_PoolMetrics *const metrics)
 {
-	// Get pointer to the array of page frames in the buffer pool
-	PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
-	
-	int i;
-	// Iterate through all pages in the buffer pool
-	for(i = 0; i < BUFFER_SIZE; i++)
-	{
-		// If the current page matches the page to be written to disk
-		if(pageFrame[i].pageNum == pg->pageNum)
-		{		
-			// Open the page file on disk
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			
-			// Write the page's data to the disk
-			writeBlock(pageFrame[i].pageNum, &fh, pageFrame[i].data);
-		
-			// Mark the page as not dirty because the modified page has been written to disk
-			pageFrame[i].isDirtyBit = 0;
-			
-			// Increment the WRITE_COUNT which records the number of writes done by the buffer manager
-			WRITE_COUNT++;
-		}
-	}	
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	int p;
+
+	metrics->hits = 0;
+	for (p = 0; p < PAGE_TABLE_PARTITIONS; p++)
+	{
+		pthread_mutex_lock(&mgr->partitions[p].latch);
+		metrics->hits += mgr->partitions[p].hits;
+		pthread_mutex_unlock(&mgr->partitions[p].latch);
+	}
+
+	pthread_mutex_lock(&mgr->lock);
+	metrics->misses = mgr->misses;
+	metrics->dirtyEvictions = mgr->dirtyEvictions;
+	metrics->cleanEvictions = mgr->cleanEvictions;
+	metrics->writes = mgr->writeCount;
+	pthread_mutex_unlock(&mgr->lock);
+
+	metrics->pinWaits = atomic_load_explicit(&mgr->pinWaits, memory_order_relaxed);
+	metrics->reads = atomic_load_explicit(&mgr->readCount, memory_order_relaxed);
+	histSnapshot(&mgr->pinHitLatency, &metrics->pinHit);
+	histSnapshot(&mgr->pinMissLatency, &metrics->pinMiss);
+	histSnapshot(&mgr->readLatency, &metrics->read);
+	histSnapshot(&mgr->writeLatency, &metrics->write);
 	return RC_OK;
 }
 
 
 /**
- * @brief Pins a page with the specified page number in the buffer pool.
+ * @brief Chooses whether the pool's page reads and writes bypass the OS page cache.
  *
- * This function adds the page with the given page number to the buffer pool. If the buffer pool is full, it uses the specified page replacement strategy
- * to replace an existing page in memory with the new page being pinned. The function also handles cases where the buffer pool is empty or where the page
- * is already present in memory.
+ * A page the pool caches in a frame is otherwise cached a second time by the kernel, so direct
+ * I/O leaves that memory to the pool; in exchange, a page the pool evicts has to come from the
+ * device again. Takes effect at once if the page file is already open, else when it is opened.
+ * Where the file system does not allow direct I/O, the pool keeps using the page cache. Through a
+ * view of the shared pool, the choice is made for the view's file.
  *
  * @param bm Pointer to the buffer pool structure.
- * @param page Pointer to the page handle structure that will store information about the pinned page.
- * @param pageNum Page number of the page to be pinned.
+ * @param direct true to bypass the page cache, false to go through it (the default).
  *
- * @return RC_OK if the page is successfully pinned in the buffer pool, or an appropriate error code otherwise.
+ * @return RC_OK, or the error returned by setPageFileMode.
  */
-extern RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page, const PageNumber pageNum)
+extern RC setPoolDirectIO(BM_BufferPool *const bm, const bool direct)
 {
-	// Get pointer to the array of page frames in the buffer pool
-	PageFrame *pgFrame = (PageFrame *)bm->mgmtData;
-	
-	// Checking if buffer pool is empty and this is the first page to be pinned
-	if (pgFrame[0].pageNum == -1)
-	{
-		// Reading page from disk and initializing page frame's content in the buffer pool
-		SM_FileHandle fh;
-		openPageFile(bm->pageFile, &fh);
-		pgFrame[0].data = (SM_PageHandle)malloc(PAGE_SIZE);
-		ensureCapacity(pageNum, &fh);
-		readBlock(pageNum, &fh, pgFrame[0].data);
-		pgFrame[0].pageNum = pageNum;
-		pgFrame[0].fixCount++;
-		REAR_INDEX = HIT = 0;
-		pgFrame[0].lruCnt = HIT;
-		pgFrame[0].lfuCnt = 0;
-		page->pageNum = pageNum;
-		page->data = pgFrame[0].data;
-		return RC_OK;
-	}
-	else
-	{
-		int i;
-		bool isBufferFull = true;
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolFile *file = mgr->files[bm->fileSlot];
+	RC rc = RC_OK;
 
-		for (i = 0; i < BUFFER_SIZE; i++)
-		{
-			if (pgFrame[i].pageNum != -1)
-			{
-				// Checking if page is in memory
-				if (pgFrame[i].pageNum == pageNum)
-				{
-					// Increasing fixCount i.e. now there is one more client accessing this page
-					pgFrame[i].fixCount++;
-					isBufferFull = false;
-					HIT++; // Incrementing HIT (HIT is used by LRU algorithm to determine the least recently used page)
-
-					// Update page's reference count based on replacement strategy
-					if (bm->strategy == RS_LRU)
-						pgFrame[i].lruCnt = HIT;
-					else if (bm->strategy == RS_CLOCK)
-						pgFrame[i].lruCnt = 1; // lruCnt = 1 to indicate that this was the last page frame examined (added to the buffer pool)
-					else if (bm->strategy == RS_LFU)
-						pgFrame[i].lfuCnt++; // Incrementing lfuCnt to add one more to the count of number of times the page is used (referenced)
-
-					page->pageNum = pageNum;
-					page->data = pgFrame[i].data;
-
-					CLOCK_POINTER++;
-					break;
-				}
-			}
-			else
-			{
-				SM_FileHandle fh;
-				openPageFile(bm->pageFile, &fh);
-				pgFrame[i].data = (SM_PageHandle)malloc(PAGE_SIZE);
-				readBlock(pageNum, &fh, pgFrame[i].data);
-				pgFrame[i].pageNum = pageNum;
-				pgFrame[i].fixCount = 1;
-				pgFrame[i].lfuCnt = 0;
-				REAR_INDEX++;
-				HIT++; // Incrementing HIT (HIT is used by LRU algorithm to determine the least recently used page)
-
-				// Update page's reference count based on replacement strategy
-				if (bm->strategy == RS_LRU)
-					pgFrame[i].lruCnt = HIT;
-				else if (bm->strategy == RS_CLOCK)
-					pgFrame[i].lruCnt = 1;
-
-				page->pageNum = pageNum;
-				page->data = pgFrame[i].data;
-
-				isBufferFull = false;
-				break;
-			}
-		}
+	pthread_mutex_lock(&file->lock);
+	file->directIO = direct;
+	if (file->fileHandle.mgmtInfo != NULL)
+		rc = setPageFileMode(&file->fileHandle, direct ? SM_FILE_DIRECT : SM_FILE_BUFFERED);
+	pthread_mutex_unlock(&file->lock);
+	return rc;
+}
 
-		// If isBufferFull = true, then it means that the buffer is full and we must replace an existing page using page replacement strategy
-		if (isBufferFull == true)
-		{
-			// Create a new page to store data read from the file.
-			PageFrame *new_Page = (PageFrame *)malloc(sizeof(PageFrame));
-
-			// Reading page from disk and initializing page frame's content in the buffer pool
-			SM_FileHandle fh;
-			openPageFile(bm->pageFile, &fh);
-			new_Page->data = (SM_PageHandle)malloc(PAGE_SIZE);
-			readBlock(pageNum, &fh, new_Page->data);
-			new_Page->pageNum = pageNum;
-			new_Page->isDirtyBit = 0;
-			new_Page->fixCount = 1;
-			new_Page->lfuCnt = 0;
-			REAR_INDEX++;
-			HIT++;
-
-			// Update page's reference count based on replacement strategy
-			if (bm->strategy == RS_LRU)
-				new_Page->lruCnt = HIT;
-			else if (bm->strategy == RS_CLOCK)
-				new_Page->lruCnt = 1;
-
-			page->pageNum = pageNum;
-			page->data = new_Page->data;
-		
 
-			// Call appropriate algorithm's function depending on the page replacement strategy selected (passed through parameters)
-			switch(bm->strategy)
-			{			
-				case RS_FIFO:
-					FIFO(bm, new_Page);
-					break;
-				
-				case RS_LRU:
-					LRU(bm, new_Page);
-					break;
-				
-				case RS_CLOCK: 
-					CLOCK(bm, new_Page);
-					break;
-  				
-				case RS_LFU: 
-					LFU(bm, new_Page);
-					break;
-  				
-				case RS_LRU_K:
-					printf("\n LRU-k algorithm is not implemented");
-					break;
-				
-				default:
-					printf("\nAlgorithm is Not Implemented\n");
-					break;
-			}
-						
-		}		
-		return RC_OK;
-	}	
+/**
+ * @brief Tells whether the pool's page I/O bypasses the OS page cache (see setPoolDirectIO).
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @return Whether direct I/O is in use, or, before the page file is opened, requested.
+ */
+extern bool getPoolDirectIO(BM_BufferPool *const bm)
+{
+	BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+	PoolFile *file = mgr->files[bm->fileSlot];
+	bool direct;
+
+	pthread_mutex_lock(&file->lock);
+	direct = file->fileHandle.mgmtInfo != NULL ? getPageFileMode(&file->fileHandle) == SM_FILE_DIRECT : file->directIO;
+	pthread_mutex_unlock(&file->lock);
+	return direct;
 }
 
 
+/**
+ * @brief Creates a read-only pool whose pins point straight into the memory-mapped page file.
+ *
+ * Pinning a page of a mapped pool copies nothing and reads nothing: the handle's data points
+ * into the kernel's page cache, which reads a page in on first access, and the pool does no
+ * replacement of its own. This suits read-mostly tables larger than any pool would be. The
+ * pages must not be written; markDirty fails, exclusive latches are refused, and pins past the
+ * end of the file as it was when the pool was created fail with RC_READ_NON_EXISTING_PAGE.
+ * The pool is shut down with shutdownBufferPool like any other.
+ *
+ * @param bm Pointer to the buffer pool structure.
+ * @param pageFileName Name of the existing page file to map.
+ * @param hint How the pages are going to be read, passed on to the kernel's readahead.
+ *
+ * @return RC_OK on success, RC_ERROR if the pool cannot be allocated, or the error returned by
+ *         openPageFileMode.
+ */
+extern RC initMappedBufferPool(BM_BufferPool *const bm, const char *const pageFileName, const BM_AccessHint hint)
+{
+	static const SM_AccessAdvice advice[] = { SM_ADVICE_NORMAL, SM_ADVICE_SEQUENTIAL, SM_ADVICE_RANDOM };
+	BufferPoolMgr *mgr;
+	SM_FileHandle *fh;
+	RC rc;
 
+	// The single frame is never used; it only keeps the rest of the pool code valid
+	rc = initBufferPool(bm, pageFileName, 1, RS_FIFO, NULL);
+	if (rc != RC_OK)
+		return rc;
+	mgr = (BufferPoolMgr *)bm->mgmtData;
+	fh = &mgr->files[0]->fileHandle;
 
+	rc = openPageFileMode(bm->pageFile, fh, SM_FILE_MAPPED);
+	if (rc == RC_OK && fh->pageSize != bm->pageSize)
+	{
+		closePageFile(fh);
+		rc = RC_PAGE_SIZE_MISMATCH;
+	}
+	if (rc != RC_OK)
+	{
+		shutdownBufferPool(bm);
+		return rc;
+	}
+	mgr->mapped = true;
+	adviseAccess(fh, 0, 0, advice[hint]);
+	return RC_OK;
+}
 
 
 /**
  * @brief Retrieves an array of boolean values indicating whether each page in the buffer pool is dirty.
  *
  * This function allocates memory for an array of booleans and populates it with the dirty status (isDirtyBit) of each page.
+ * Through a view of the shared pool, frames holding pages of other files are shown as clean.
  *
  * @param bm Pointer to the buffer pool structure.
  * @return An array of boolean values representing the dirty status of each page.
  */
 extern bool *getDirtyFlags(BM_BufferPool *const bm)
 {
-    // Allocate memory for the array of boolean values
-    bool *dirtyFlags = malloc(sizeof(bool) * BUFFER_SIZE);
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    bool *dirtyFlags;
     // Retrieve the page frames from the buffer pool's management data
-    PageFrame *pageFrame = (PageFrame *)bm->mgmtData;
+    PageFrame *pageFrame = mgr->frames;
     
     int i;
+    pthread_mutex_lock(&mgr->lock);
+    // Allocate memory for the array of boolean values
+    dirtyFlags = malloc(sizeof(bool) * mgr->bufferSize);
     // Iterate through all the pages in the buffer pool
-    for (i = 0; i < BUFFER_SIZE; i++)
+    for (i = 0; i < mgr->bufferSize; i++)
     {
         // Set the value of dirtyFlags based on the isDirtyBit of each page
-        dirtyFlags[i] = (pageFrame[i].isDirtyBit == 1) ? true : false;
+        dirtyFlags[i] = (pageFrame[i].isDirtyBit == 1 && inView(bm, pageFrame[i].pageNum)) ? true : false;
     }   
+    pthread_mutex_unlock(&mgr->lock);
     return dirtyFlags;
 }
 
@@ -744,30 +5551,30 @@ extern bool *getDirtyFlags(BM_BufferPool *const bm)
  * @brief Retrieves an array of integers representing the fix count of each page in the buffer pool.
  *
  * This function allocates memory for an array of integers and populates it with the fix count of each page.
+ * Through a view of the shared pool, frames holding pages of other files are shown as unpinned.
  *
  * @param bm Pointer to the buffer pool structure.
  * @return An array of integers representing the fix count of each page.
  */
 extern int *getFixCounts(BM_BufferPool *const bm)
 {
-    // Allocate memory for the array of integers
-    int *fixCounts = malloc(sizeof(int) * BUFFER_SIZE);
+    BufferPoolMgr *mgr = (BufferPoolMgr *)bm->mgmtData;
+    int *fixCounts;
     // Retrieve the page frames from the buffer pool's management data
-    PageFrame *pgFrame = (PageFrame *)bm->mgmtData;
+    PageFrame *pgFrame = mgr->frames;
     
     int i = 0;
+    pthread_mutex_lock(&mgr->lock);
+    // Allocate memory for the array of integers
+    fixCounts = malloc(sizeof(int) * mgr->bufferSize);
     // Iterate through all the pages in the buffer pool
-    while (i < BUFFER_SIZE)
+    while (i < mgr->bufferSize)
     {
         // Set the value of fixCounts based on the fixCount of each page
-        fixCounts[i] = (pgFrame[i].fixCount != -1) ? pgFrame[i].fixCount : 0;
+        fixCounts[i] = (pgFrame[i].fixCount != -1 && !pgFrame[i].retired
+                        && (!mgr->shared || inView(bm, pgFrame[i].pageNum))) ? pgFrame[i].fixCount : 0;
         i++;
     }   
+    pthread_mutex_unlock(&mgr->lock);
     return fixCounts;
 }
-
-
-
-
-
-
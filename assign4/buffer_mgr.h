@@ -13,7 +13,9 @@ typedef enum ReplacementStrategy {
 	RS_LRU = 1,
 	RS_CLOCK = 2,
 	RS_LFU = 3,
-	RS_LRU_K = 4
+	RS_LRU_K = 4,
+	RS_ARC = 5,
+	RS_2Q = 6
 } ReplacementStrategy;
 
 // Data Types and Structures
@@ -23,16 +25,150 @@ typedef int PageNumber;
 typedef struct BM_BufferPool {
 	char *pageFile;
 	int numPages;
+	int pageSize; // Bytes per page and frame, read from the page file by initBufferPool
 	ReplacementStrategy strategy;
 	void *mgmtData; // use this one to store the bookkeeping info your buffer
 	// manager needs for a buffer pool
+	int fileSlot; // Slot of the page file in the shared pool for a view (see initPoolView), 0 otherwise
 } BM_BufferPool;
 
+// Frames of the shared pool when initPoolView creates it (see initSharedBufferPool)
+#define BM_SHARED_POOL_FRAMES 1024
+
+// Parameters for RS_LRU_K, passed to initBufferPool as stratData (NULL selects the defaults)
+typedef struct BM_LRUKParams {
+	int k;                // Number of past references compared (default 2)
+	int correlatedPeriod; // Pins of a page within this many pins of its last one count as the
+	                      // same reference, e.g. one pin per record on a page (default 4)
+	int historySize;      // Number of evicted pages whose history is retained (default numPages)
+} BM_LRUKParams;
+
 typedef struct BM_PageHandle {
 	PageNumber pageNum;
 	char *data;
+	void *latch; // Content latch of the frame holding the page, set by pinPage (see latchPage)
 } BM_PageHandle;
 
+// Modes of a page's content latch
+typedef enum BM_LatchMode {
+	BM_LATCH_SHARED = 0,   // Readers of the page
+	BM_LATCH_EXCLUSIVE = 1 // A writer of the page
+} BM_LatchMode;
+
+// A small ring of frames recycled by a sequential scan (see initScanRing)
+typedef struct BM_ScanRing {
+	int numFrames;     // Number of slots in the ring
+	int next;          // Slot the next page read by the scan goes into
+	int *frames;       // Frame each slot last loaded a page into (-1 if none)
+	PageNumber *pages; // Page the slot loaded into that frame
+} BM_ScanRing;
+
+// Ring size used by table scans: 32 pages, as in PostgreSQL's bulk-read strategy
+#define SCAN_RING_FRAMES 32
+
+// Readahead state of one sequential reader, e.g. a table scan (see readahead)
+typedef struct BM_Readahead {
+	PageNumber lastPage;  // Page the reader pinned last (NO_PAGE before its first)
+	PageNumber nextFetch; // First page past those already prefetched
+	int window;           // Pages prefetched at a time, grown while reads stay sequential (0 if none)
+} BM_Readahead;
+
+// Readahead window bounds; the window is also capped at a quarter of the pool or half a scan ring
+#define READAHEAD_MIN_PAGES 4
+#define READAHEAD_MAX_PAGES 64
+
+// Counters of a pool's background cleaner (see startPoolCleaner)
+typedef struct BM_CleanerStats {
+	int rounds;       // Times the cleaner found fewer clean frames than the low watermark
+	int pagesWritten; // Dirty pages written back by the cleaner
+	int syncWrites;   // Dirty victims pinPage had to write back itself
+	int cleanFrames;  // Frames that are clean right now
+	bool running;     // Whether a cleaner is running
+} BM_CleanerStats;
+
+// Compression counters of a pool's page file (see getCompressionStats)
+typedef struct BM_CompressionStats {
+	bool compressed;           // Whether the page file stores its pages compressed; all else is 0 if not
+	long long pagesRead;       // Pages the pool read and had decompressed
+	long long bytesRead;       // Bytes read from disk for them, against pagesRead * pageSize uncompressed
+	long long pagesWritten;    // Pages the pool wrote and had compressed
+	long long bytesWritten;    // Bytes written to disk for them
+	long long decompressNanos; // Time spent decompressing pages
+	long long compressNanos;   // Time spent compressing pages
+	long long fileBytes;       // Bytes the file's pages take on disk now, free space included
+	long long freeBytes;       // Bytes of free space among them
+} BM_CompressionStats;
+
+// Buckets of a latency histogram: bucket b counts latencies of [2^b, 2^(b+1)) ns, bucket 0 also those under 1 ns
+#define BM_HIST_BUCKETS 32
+
+// pinPage times one hit in this many per thread (see BM_PoolMetrics)
+#define BM_HIT_SAMPLE_RATE 64
+
+// Log-scaled latency histogram of one operation (see BM_PoolMetrics)
+typedef struct BM_LatencyHist {
+	long long count;                    // Latencies recorded
+	long long sumNanos;                 // Their sum
+	long long buckets[BM_HIST_BUCKETS]; // Latencies recorded per power of two of nanoseconds
+} BM_LatencyHist;
+
+// Snapshot of a pool's counters and latencies since initBufferPool (see getPoolMetrics)
+typedef struct BM_PoolMetrics {
+	long long hits;           // Pins that found their page in a frame, also if still being read in
+	long long misses;         // Pins that had to read their page into a frame
+	long long dirtyEvictions; // Pages evicted that had to be written back first
+	long long cleanEvictions; // Pages evicted without a write
+	long long pinWaits;       // Pins that waited for a read started by another miss or a prefetch
+	long long reads;          // Pages read from the page file, prefetched ones included
+	long long writes;         // Pages written to the page file
+	BM_LatencyHist pinHit;    // pinPage latency of hits, one in BM_HIT_SAMPLE_RATE timed
+	BM_LatencyHist pinMiss;   // pinPage latency of misses
+	BM_LatencyHist read;      // Latency of the pool's synchronous page reads
+	BM_LatencyHist write;     // Latency of its synchronous writes, a vectored run counting once
+} BM_PoolMetrics;
+
+// Points of a pool's miss ratio curve (see getPoolMissRatioCurve)
+#define BM_MRC_POINTS 32
+
+// Estimated miss ratio of a pool's pins for LRU pools of other sizes (see getPoolMissRatioCurve)
+typedef struct BM_MissRatioCurve {
+	long long references;             // Sampled pins the estimate rests on
+	double samplingRate;              // Fraction of pages sampled now
+	int numPoints;
+	int frames[BM_MRC_POINTS];        // Pool sizes, doubling from 1 frame
+	double missRatios[BM_MRC_POINTS]; // Estimated fraction of pins missed with that many frames
+} BM_MissRatioCurve;
+
+// One pinPage of a pool's access trace (see startPoolTrace)
+typedef struct BM_TraceRecord {
+	long long nanos;    // Time of the pin since the trace started
+	int fileSlot;       // Slot of the page's file in a shared pool, 0 for other pools
+	PageNumber pageNum; // Page pinned
+	bool hit;           // Whether the page was found in a frame
+} BM_TraceRecord;
+
+// An access trace read back by readPoolTrace
+typedef struct BM_Trace {
+	int pageSize;            // Page size of the traced pool
+	int numFrames;           // Its number of frames
+	long long numRecords;
+	BM_TraceRecord *records; // The pins in the order they were recorded
+} BM_Trace;
+
+// If set, every pool traces its pins into a file in this directory (see startPoolTrace)
+#define BM_TRACE_DIR_ENV "BM_TRACE_DIR"
+
+// If set, the most frames resizeBufferPool may grow a pool set up from then on to; by default a
+// pool may grow to eight times its initial size
+#define BM_POOL_MAX_FRAMES_ENV "BM_POOL_MAX_FRAMES"
+
+// Expected access to a mapped pool's pages (see initMappedBufferPool)
+typedef enum BM_AccessHint {
+	BM_ACCESS_NORMAL = 0,     // No particular order
+	BM_ACCESS_SEQUENTIAL = 1, // Mostly in page order, e.g. table scans
+	BM_ACCESS_RANDOM = 2      // No order, e.g. index lookups
+} BM_AccessHint;
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -47,6 +183,11 @@ RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
 
+// Buffer Manager Interface Shared Pool
+RC initSharedBufferPool(const int numPages, ReplacementStrategy strategy, void *stratData);
+RC shutdownSharedBufferPool(void);
+RC initPoolView(BM_BufferPool *const bm, const char *const pageFileName);
+
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -54,11 +195,62 @@ RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
 
+// Buffer Manager Interface Free Pages
+RC allocatePoolPage (BM_BufferPool *const bm, PageNumber *pageNum);
+RC freePoolPage (BM_BufferPool *const bm, const PageNumber pageNum);
+bool isPoolPageFree (BM_BufferPool *const bm, const PageNumber pageNum);
+int getNumFreePoolPages (BM_BufferPool *const bm);
+int getNumPoolFilePages (BM_BufferPool *const bm);
+
+// Buffer Manager Interface Content Latches
+RC latchPage (BM_BufferPool *const bm, BM_PageHandle *const page, const BM_LatchMode mode);
+RC unlatchPage (BM_BufferPool *const bm, BM_PageHandle *const page);
+
+// Buffer Manager Interface Scan Rings
+RC initScanRing (BM_BufferPool *const bm, BM_ScanRing *const ring, const int numFrames);
+RC pinPageScan (BM_BufferPool *const bm, BM_ScanRing *const ring, BM_PageHandle *const page,
+		const PageNumber pageNum);
+RC freeScanRing (BM_ScanRing *const ring);
+
+// Buffer Manager Interface Prefetching
+RC prefetchPages (BM_BufferPool *const bm, const PageNumber firstPage, const int numPages);
+void initReadahead (BM_Readahead *const ra);
+RC readahead (BM_BufferPool *const bm, BM_Readahead *const ra, BM_ScanRing *const ring,
+		const PageNumber pageNum);
+
+// Buffer Manager Interface Background Cleaner
+RC startPoolCleaner (BM_BufferPool *const bm, const int lowWatermark, const int highWatermark);
+RC stopPoolCleaner (BM_BufferPool *const bm);
+
+// Buffer Manager Interface Direct I/O
+RC setPoolDirectIO (BM_BufferPool *const bm, const bool direct);
+bool getPoolDirectIO (BM_BufferPool *const bm);
+
+// Buffer Manager Interface Mapped Pools
+RC initMappedBufferPool (BM_BufferPool *const bm, const char *const pageFileName,
+		const BM_AccessHint hint);
+
+// Buffer Manager Interface Access Traces
+RC startPoolTrace (BM_BufferPool *const bm, const char *const traceFileName);
+RC stopPoolTrace (BM_BufferPool *const bm);
+RC readPoolTrace (const char *const traceFileName, BM_Trace *const trace);
+void freePoolTrace (BM_Trace *const trace);
+
+// Buffer Manager Interface Pool Sizing
+RC getPoolMissRatioCurve (BM_BufferPool *const bm, BM_MissRatioCurve *const curve);
+RC getPoolMissRatio (BM_BufferPool *const bm, const int numFrames, double *const missRatio);
+RC splitPoolFrames (BM_BufferPool **const pools, const int numPools, const int totalFrames, int *const frames);
+RC resizeBufferPool (BM_BufferPool *const bm, const int numPages);
+
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
 bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumFrames (BM_BufferPool *const bm);
+RC getCleanerStats (BM_BufferPool *const bm, BM_CleanerStats *const stats);
+RC getCompressionStats (BM_BufferPool *const bm, BM_CompressionStats *const stats);
+RC getPoolMetrics (BM_BufferPool *const bm, BM_PoolMetrics *const metrics);
 
 #endif
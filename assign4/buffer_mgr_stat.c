@@ -51,6 +51,143 @@ sprintPoolContent (BM_BufferPool *const bm)
 }
 
 
+void
+printCleanerStats (BM_BufferPool *const bm)
+{
+	char *message = sprintCleanerStats(bm);
+
+	printf("%s\n", message);
+	free(message);
+}
+
+char *
+sprintCleanerStats (BM_BufferPool *const bm)
+{
+	BM_CleanerStats stats;
+	char *message;
+
+	message = (char *) malloc(256);
+	getCleanerStats(bm, &stats);
+	sprintf(message, "{cleaner %s}: %i rounds, %i pages written, %i synchronous writes, %i/%i frames clean",
+			(stats.running ? "running" : "stopped"), stats.rounds, stats.pagesWritten, stats.syncWrites,
+			stats.cleanFrames, bm->numPages);
+
+	return message;
+}
+
+void
+printCompressionStats (BM_BufferPool *const bm)
+{
+	char *message = sprintCompressionStats(bm);
+
+	printf("%s\n", message);
+	free(message);
+}
+
+char *
+sprintCompressionStats (BM_BufferPool *const bm)
+{
+	BM_CompressionStats stats;
+	char *message;
+
+	message = (char *) malloc(256);
+	getCompressionStats(bm, &stats);
+	if (!stats.compressed)
+	{
+		sprintf(message, "{compression off}");
+		return message;
+	}
+	sprintf(message, "{compression on}: %lld pages read from %lld bytes (%.2fx), %.0f ns each to decompress; %lld pages written to %lld bytes (%.2fx); file %lld bytes, %lld free",
+			stats.pagesRead, stats.bytesRead,
+			stats.bytesRead > 0 ? (double) stats.pagesRead * bm->pageSize / stats.bytesRead : 0.0,
+			stats.pagesRead > 0 ? (double) stats.decompressNanos / stats.pagesRead : 0.0,
+			stats.pagesWritten, stats.bytesWritten,
+			stats.bytesWritten > 0 ? (double) stats.pagesWritten * bm->pageSize / stats.bytesWritten : 0.0,
+			stats.fileBytes, stats.freeBytes);
+
+	return message;
+}
+
+long long
+latencyPercentile (const BM_LatencyHist *const hist, double fraction)
+{
+	long long rank, seen = 0;
+	int b;
+
+	if (hist->count == 0)
+		return 0;
+	rank = (long long) (fraction * hist->count);
+	if (rank >= hist->count)
+		rank = hist->count - 1;
+	for (b = 0; b < BM_HIST_BUCKETS - 1; b++)
+	{
+		seen += hist->buckets[b];
+		if (seen > rank)
+			break;
+	}
+	return 1LL << (b + 1);
+}
+
+void
+printPoolMetrics (BM_BufferPool *const bm)
+{
+	char *message = sprintPoolMetrics(bm);
+
+	printf("%s\n", message);
+	free(message);
+}
+
+char *
+sprintPoolMetrics (BM_BufferPool *const bm)
+{
+	BM_PoolMetrics m;
+	char *message;
+
+	message = (char *) malloc(512);
+	getPoolMetrics(bm, &m);
+	sprintf(message, "{metrics}: %lld hits, %lld misses (%.1f%% hits), %lld dirty and %lld clean evictions, %lld pin waits; %lld reads, %lld writes; p50/p99 ns: pin hit %lld/%lld, pin miss %lld/%lld, read %lld/%lld, write %lld/%lld",
+			m.hits, m.misses,
+			m.hits + m.misses > 0 ? 100.0 * m.hits / (m.hits + m.misses) : 0.0,
+			m.dirtyEvictions, m.cleanEvictions, m.pinWaits, m.reads, m.writes,
+			latencyPercentile(&m.pinHit, 0.5), latencyPercentile(&m.pinHit, 0.99),
+			latencyPercentile(&m.pinMiss, 0.5), latencyPercentile(&m.pinMiss, 0.99),
+			latencyPercentile(&m.read, 0.5), latencyPercentile(&m.read, 0.99),
+			latencyPercentile(&m.write, 0.5), latencyPercentile(&m.write, 0.99));
+
+	return message;
+}
+
+void
+printMissRatioCurve (BM_BufferPool *const bm)
+{
+	char *message = sprintMissRatioCurve(bm);
+
+	printf("%s\n", message);
+	free(message);
+}
+
+char *
+sprintMissRatioCurve (BM_BufferPool *const bm)
+{
+	BM_MissRatioCurve curve;
+	char *message;
+	int pos = 0, i;
+
+	message = (char *) malloc(64 + BM_MRC_POINTS * 24);
+	if (getPoolMissRatioCurve(bm, &curve) != RC_OK)
+	{
+		sprintf(message, "{no miss ratio curve}");
+		return message;
+	}
+	pos += sprintf(message + pos, "{miss ratio curve, %lld pins sampled at %.4f}:", curve.references, curve.samplingRate);
+	for (i = 0; i < curve.numPoints; i++)
+		pos += sprintf(message + pos, " %d:%.1f%%", curve.frames[i], 100 * curve.missRatios[i]);
+
+	return message;
+}
+
+
+
 void
 printPageContent (BM_PageHandle *const page)
 {
@@ -98,6 +235,12 @@ printStrat (BM_BufferPool *const bm)
 	case RS_LRU_K:
 		printf("LRU-K");
 		break;
+	case RS_ARC:
+		printf("ARC");
+		break;
+	case RS_2Q:
+		printf("2Q");
+		break;
 	default:
 		printf("%i", bm->strategy);
 		break;
@@ -8,5 +8,16 @@ void printPoolContent (BM_BufferPool *const bm);
 void printPageContent (BM_PageHandle *const page);
 char *sprintPoolContent (BM_BufferPool *const bm);
 char *sprintPageContent (BM_PageHandle *const page);
+void printCleanerStats (BM_BufferPool *const bm);
+char *sprintCleanerStats (BM_BufferPool *const bm);
+void printCompressionStats (BM_BufferPool *const bm);
+char *sprintCompressionStats (BM_BufferPool *const bm);
+void printPoolMetrics (BM_BufferPool *const bm);
+char *sprintPoolMetrics (BM_BufferPool *const bm);
+void printMissRatioCurve (BM_BufferPool *const bm);
+char *sprintMissRatioCurve (BM_BufferPool *const bm);
+
+// Upper bound, in ns, of the histogram bucket holding the given fraction of its latencies (0 if empty)
+long long latencyPercentile (const BM_LatencyHist *const hist, double fraction);
 
 #endif
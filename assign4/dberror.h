@@ -4,7 +4,9 @@
 #include "stdio.h"
 
 /* module wide constants */
-#define PAGE_SIZE 4096
+#define PAGE_SIZE 4096 // Page size of page files created without one (see createPageFileWithPageSize)
+#define MIN_PAGE_SIZE 4096
+#define MAX_PAGE_SIZE 65536
 
 /* return code definitions */
 typedef int RC;
@@ -14,8 +16,12 @@ typedef int RC;
 #define RC_FILE_HANDLE_NOT_INIT 2
 #define RC_WRITE_FAILED 3
 #define RC_READ_NON_EXISTING_PAGE 4
+#define RC_INVALID_PAGE_SIZE 5 // Not a power of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE
+#define RC_PAGE_ALREADY_FREE 6 // The page was freed before (see freePage)
 #define RC_ERROR 400 // Added a new definiton for ERROR
 #define RC_PINNED_PAGES_IN_BUFFER 500 // Added a new definition for Buffer Manager
+#define RC_BUFFER_POOL_FULL 501 // Every frame is pinned, so no page can be brought in
+#define RC_PAGE_SIZE_MISMATCH 502 // The page file's pages are not the size of the pool's frames
 
 #define RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE 200
 #define RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN 201
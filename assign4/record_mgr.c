@@ -27,6 +27,12 @@ typedef struct RecordDataManager
 	int firstFreePage;
 	// Count of the number of records scanned
 	int scannedRecordCount;
+	// Frames recycled by a ring scan (NULL for scans through the shared pool)
+	BM_ScanRing *scanRing;
+	// Readahead state of a scan, which reads the table's pages in order
+	BM_Readahead readahead;
+	// Whether the table was opened with openTableReadOnly, whose pages cannot be modified
+	bool readOnly;
 } RecordDataManager;
 
 
@@ -90,6 +96,8 @@ RC attrOffset(Schema *schema, int attrNum, int *output)
  */
 extern RC shutdownRecordManager()
 {
+    // Release the shared buffer pool once no table or index has it open
+    shutdownSharedBufferPool();
     recordMgr = NULL;
     free(recordMgr);
     return RC_OK;
@@ -97,40 +105,56 @@ extern RC shutdownRecordManager()
 
 
 /**
- * @brief Opens the table with the specified name.
+ * @brief Sets up the buffer pool a table's records are read and written through.
  *
- * This function opens the table with the given name and retrieves its metadata.
+ * The table is opened on the shared buffer pool, whose frames go to whichever table or index is
+ * in use. A table with pages of another size, or one opened once every view slot is taken, gets
+ * a pool of its own using the ARC page replacement policy, which balances recency and frequency
+ * by itself so scans and repeated lookups can share the pool.
  *
- * @param rel Pointer to the table data structure to be populated.
- * @param name The name of the table to be opened.
+ * @return RC_OK, or the error of setting up a pool of its own.
+ */
+static RC openTablePool(RecordDataManager *dataMgr, char *tableName)
+{
+	dataMgr->readOnly = false;
+	if (initPoolView(&dataMgr->bufferPool, tableName) == RC_OK)
+		return RC_OK;
+	return initBufferPool(&dataMgr->bufferPool, tableName, MAX_NUM_OF_PAG, RS_ARC, NULL);
+}
+
+
+/**
+ * @brief Reads a table's metadata from its header page through the given data manager.
  *
- * @return
- *   - RC_OK: Successful table opening.
- *   - Other error codes indicating failure during table opening.
+ * Shared by openTable, which opens the table created last, and openTableReadOnly, whose data
+ * manager belongs to the table alone.
  */
-extern RC openTable(RM_TableData *tableData, char *tableName)
+static RC readTableHeader(RM_TableData *tableData, char *tableName, RecordDataManager *dataMgr)
 {
 	SM_PageHandle pageHandle;    
 	
 	int attributeCount, k;
+	RC rc;
 	
 	// Set table's metadata to the custom data manager metadata structure
-	tableData->mgmtData = recordMgr;
+	tableData->mgmtData = dataMgr;
 	// Set the table's name
 	tableData->name = tableName;
     
 	// Pin a page i.e., put a page in the buffer pool using the buffer manager
-	pinPage(&recordMgr->bufferPool, &recordMgr->filePageHandle, 0);
+	rc = pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, 0);
+	if (rc != RC_OK)
+		return rc;
 	
-	// Set the initial pointer (0th location) to the record manager's page data
-	pageHandle = (char*) recordMgr->filePageHandle.data;
+	// Set the initial pointer (0th location) to the data manager's page data
+	pageHandle = (char*) dataMgr->filePageHandle.data;
 	
 	// Retrieve total number of tuples from the page file
-	recordMgr->totalTuples= *(int*)pageHandle;
+	dataMgr->totalTuples= *(int*)pageHandle;
 	pageHandle += sizeof(int);
 
 	// Get free page from the page file
-	recordMgr->firstFreePage= *(int*) pageHandle;
+	dataMgr->firstFreePage= *(int*) pageHandle;
     pageHandle += sizeof(int);
 	
 	// Get the number of attributes from the page file
@@ -141,6 +165,11 @@ extern RC openTable(RM_TableData *tableData, char *tableName)
 
 	// Allocate memory space for 'schema'
 	schema = (Schema*) malloc(sizeof(Schema));
+
+	// Get the key size, which createTable writes ahead of the attributes; the key attributes are not stored
+	schema->keySize = *(int*)pageHandle;
+	schema->keyAttrs = NULL;
+	pageHandle += sizeof(int);
     
 	// Set schema's parameters
 	schema->numAttr = attributeCount;
@@ -171,19 +200,94 @@ extern RC openTable(RM_TableData *tableData, char *tableName)
 	tableData->schema = schema;	
 
 	// Unpin the page i.e., remove it from the buffer pool using the buffer manager
-	unpinPage(&recordMgr->bufferPool, &recordMgr->filePageHandle);
+	unpinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle);
 
 	// Write the page back to disk using the buffer manager
-	forcePage(&recordMgr->bufferPool, &recordMgr->filePageHandle);
+	forcePage(&dataMgr->bufferPool, &dataMgr->filePageHandle);
 
 	return RC_OK;
 }
+
+
+/**
+ * @brief Opens the table with the specified name.
+ *
+ * This function opens the table with the given name and retrieves its metadata.
+ *
+ * @param rel Pointer to the table data structure to be populated.
+ * @param name The name of the table to be opened.
+ *
+ * @return
+ *   - RC_OK: Successful table opening.
+ *   - Other error codes indicating failure during table opening.
+ */
+extern RC openTable(RM_TableData *tableData, char *tableName)
+{
+	RC rc;
+
+	// A table closed since it was created, or created before the record manager was last shut
+	// down, gets its buffer pool back
+	if (recordMgr == NULL && (recordMgr = (RecordDataManager*) calloc(1, sizeof(RecordDataManager))) == NULL)
+		return RC_ERROR;
+	if (recordMgr->bufferPool.mgmtData == NULL && (rc = openTablePool(recordMgr, tableName)) != RC_OK)
+		return rc;
+
+	return readTableHeader(tableData, tableName, recordMgr);
+}
+
+
+/**
+ * @brief Opens an existing table for reading only, through a pool mapping its page file.
+ *
+ * Pinned pages point straight into the mapped file, so records are read without the page
+ * being copied into a buffer pool first, and opening the table reads nothing up front. This
+ * suits large static reference tables. Inserts, updates and deletes on the table fail with
+ * RC_WRITE_FAILED; closeTable releases the mapping. The table gets a data manager of its own,
+ * so openTable still opens the table created last.
+ *
+ * @param rel Pointer to the table data structure to be populated.
+ * @param name The name of the table to be opened.
+ *
+ * @return
+ *   - RC_OK: Successful table opening.
+ *   - RC_FILE_NOT_FOUND: The table does not exist or cannot be mapped.
+ *   - Other error codes indicating failure during table opening.
+ */
+extern RC openTableReadOnly(RM_TableData *tableData, char *tableName)
+{
+	RecordDataManager *dataMgr;
+	RC rc;
+
+	// Allocate memory space for the data manager custom data structure
+	dataMgr = (RecordDataManager*) malloc(sizeof(RecordDataManager));
+	if (dataMgr == NULL)
+		return RC_ERROR;
+
+	// Map the table; records are looked up by RID as often as they are scanned
+	rc = initMappedBufferPool(&dataMgr->bufferPool, tableName, BM_ACCESS_NORMAL);
+	if (rc != RC_OK)
+	{
+		free(dataMgr);
+		return rc;
+	}
+	dataMgr->readOnly = true;
+
+	// Read the table's metadata from the mapped header page; the table created last stays the one
+	// openTable opens
+	rc = readTableHeader(tableData, tableName, dataMgr);
+	if (rc != RC_OK)
+	{
+		shutdownBufferPool(&dataMgr->bufferPool);
+		free(dataMgr);
+	}
+	return rc;
+}
   
   
-// This function finds and returns the index of a free slot within a page.
-int findFreePageIndex(char *pageData, int recordSize)
+// This function finds and returns the index of a free slot within a page of pageSize bytes.
+int findFreePageIndex(char *pageData, int recordSize, int pageSize)
 {
-	int index, totalSlots = PAGE_SIZE / recordSize; 
+	int index, totalSlots = pageSize / recordSize; 
 
 	for (index = 0; index < totalSlots; index++)
 		if (pageData[index * recordSize] != '+')
@@ -192,6 +296,18 @@ int findFreePageIndex(char *pageData, int recordSize)
 }
 
 
+// This function finds and returns the index of a slot holding a record within a page of pageSize bytes.
+int findUsedSlot(char *pageData, int recordSize, int pageSize)
+{
+	int index, totalSlots = pageSize / recordSize;
+
+	for (index = 0; index < totalSlots; index++)
+		if (pageData[index * recordSize] == '+')
+			return index;
+	return -1;
+}
+
+
 /**
  * @brief Initializes the Data Manager.
  *
@@ -224,15 +340,24 @@ extern RC initRecordManager(void *mgmtData)
  *
  * @return
  *   - RC_OK: Successful table closing.
- *   - Other error codes indicating failure during table closing.
+ *   - RC_PINNED_PAGES_IN_BUFFER: A scan or another user still has pages of the table pinned; the table stays open.
+ *   - Other error codes indicating failure during table closing, such as writing its pages.
  */
 extern RC closeTable(RM_TableData *tableData)
 {
 	// Retrieve the table's metadata
 	RecordDataManager *dataMgr = tableData->mgmtData;
+	RC rc;
 	
-	// Shut down the buffer pool	
-	shutdownBufferPool(&dataMgr->bufferPool);
+	// Shut down the buffer pool, which writes the table's pages and closes its file; while pages
+	// are still pinned or cannot be written, the table stays open
+	rc = shutdownBufferPool(&dataMgr->bufferPool);
+	if (rc != RC_OK)
+		return rc;
+
+	// A table opened read only has a data manager of its own, made for this open
+	if (dataMgr->readOnly)
+		free(dataMgr);
 	
 	// Clear the pointer to the metadata
 	//tableData->mgmtData = NULL; // Commented out to prevent memory leaks
@@ -241,27 +366,19 @@ extern RC closeTable(RM_TableData *tableData)
 }
 
 /**
- * @brief Creates a table with the specified name and schema.
- *
- * This function creates a table with the given name and schema.
- *
- * @param name The name of the table.
- * @param schema Pointer to the schema of the table.
+ * @brief Writes a new table's page file, holding the header page, and sets up its buffer pool.
  *
- * @return
- *   - RC_OK: Successful table creation.
- *   - Other error codes indicating failure during table creation.
+ * Shared by createTableWithPageSize, createCompressedTable and createSegmentedTable; a segmented
+ * table has a layout, the others none.
  */
-extern RC createTable(char *tableName, Schema *schema)
+static RC createTableFile(char *tableName, Schema *schema, int pageSize, bool compressed, const SM_SegmentLayout *layout)
 {
-	// Allocate memory space for the data manager custom data structure
-	recordMgr = (RecordDataManager*) malloc(sizeof(RecordDataManager));
-
-	// Initialize the Buffer Pool using LRU page replacement policy
-	initBufferPool(&recordMgr->bufferPool, tableName, MAX_NUM_OF_PAG, RS_LFU, NULL);
-
-	char data[PAGE_SIZE];
+	// The header page is built in a buffer large enough for any page size
+	char *data = (char*) calloc(MAX_PAGE_SIZE, 1);
 	char *pageData = data;
+
+	if (data == NULL)
+		return RC_ERROR;
 	 
 	int output, k;
 
@@ -298,19 +415,112 @@ extern RC createTable(char *tableName, Schema *schema)
 
 	SM_FileHandle fileHandle;
 		
-	if((output = createPageFile(tableName)) != RC_OK)
-		return output;
-		
-	if((output = openPageFile(tableName, &fileHandle)) != RC_OK)
-		return output;
-		
-	if((output = writeBlock(0, &fileHandle, data)) != RC_OK)
-		return output;
+	if (layout != NULL)
+		output = createSegmentedPageFile(tableName, pageSize, layout);
+	else
+		output = compressed ? createCompressedPageFile(tableName, pageSize) : createPageFileWithPageSize(tableName, pageSize);
 		
-	if((output = closePageFile(&fileHandle)) != RC_OK)
+	if(output == RC_OK && (output = openPageFile(tableName, &fileHandle)) == RC_OK)
+	{
+		output = writeBlock(0, &fileHandle, data);
+		if(closePageFile(&fileHandle) != RC_OK && output == RC_OK)
+			output = RC_WRITE_FAILED;
+	}
+	free(data);
+	if(output != RC_OK)
 		return output;
 
-	return RC_OK;
+	// Allocate memory space for the data manager custom data structure
+	recordMgr = (RecordDataManager*) malloc(sizeof(RecordDataManager));
+	if (recordMgr == NULL)
+		return RC_ERROR;
+
+	return openTablePool(recordMgr, tableName);
+}
+
+
+/**
+ * @brief Creates a table with the specified name and schema.
+ *
+ * This function creates a table with the given name and schema.
+ *
+ * @param name The name of the table.
+ * @param schema Pointer to the schema of the table.
+ *
+ * @return
+ *   - RC_OK: Successful table creation.
+ *   - Other error codes indicating failure during table creation.
+ */
+extern RC createTable(char *tableName, Schema *schema)
+{
+	return createTableWithPageSize(tableName, schema, PAGE_SIZE);
+}
+
+
+/**
+ * @brief Creates a table like createTable, stored in pages of the given size.
+ *
+ * Each page holds pageSize / getRecordSize(schema) records, so bigger pages mean fewer pages
+ * to read for a scan, while 4 KB pages keep point lookups and updates cheap.
+ *
+ * @param name The name of the table.
+ * @param schema Pointer to the schema of the table.
+ * @param pageSize Bytes per page, a power of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE.
+ *
+ * @return
+ *   - RC_OK: Successful table creation.
+ *   - RC_INVALID_PAGE_SIZE: The page size is not supported.
+ *   - Other error codes indicating failure during table creation.
+ */
+extern RC createTableWithPageSize(char *tableName, Schema *schema, int pageSize)
+{
+	return createTableFile(tableName, schema, pageSize, false, NULL);
+}
+
+
+/**
+ * @brief Creates a table like createTable whose pages are stored compressed.
+ *
+ * Records with DT_STRING fields are padded with zeros to their full length, so record pages
+ * compress well: a scan reads fewer bytes from disk and the table takes less disk space, at the
+ * cost of decompressing each page read (see createCompressedPageFile and getCompressionStats).
+ * The table is used like any other, except that openTableReadOnly cannot map it.
+ *
+ * @param name The name of the table.
+ * @param schema Pointer to the schema of the table.
+ *
+ * @return
+ *   - RC_OK: Successful table creation.
+ *   - Other error codes indicating failure during table creation.
+ */
+extern RC createCompressedTable(char *tableName, Schema *schema)
+{
+	return createTableFile(tableName, schema, PAGE_SIZE, true, NULL);
+}
+
+
+/**
+ * @brief Creates a table like createTable whose pages are spread over segment files.
+ *
+ * The table is no longer bound by the largest file the file system allows, and with segments
+ * in several directories, e.g. on different disks, a scan's reads go to all of them (see
+ * createSegmentedPageFile). The table is used like any other, except that openTableReadOnly
+ * cannot map it; deleteTable removes its segments too.
+ *
+ * @param name The name of the table.
+ * @param schema Pointer to the schema of the table.
+ * @param layout Pages per segment and the directories the segments go to.
+ *
+ * @return
+ *   - RC_OK: Successful table creation.
+ *   - RC_ERROR: The layout is invalid.
+ *   - Other error codes indicating failure during table creation.
+ */
+extern RC createSegmentedTable(char *tableName, Schema *schema, const SM_SegmentLayout *layout)
+{
+	if (layout == NULL)
+		return RC_ERROR;
+	return createTableFile(tableName, schema, PAGE_SIZE, false, layout);
 }
 
 
@@ -345,17 +555,23 @@ extern int getNumTuples(RM_TableData *tableData)
  *
  * @return
  *   - RC_OK: Successful record insertion.
+ *   - RC_WRITE_FAILED: The table was opened read only.
  *   - Other error codes indicating failure during record insertion.
  */
 extern RC insertRecord(RM_TableData *tableData, Record *record)
 {
 	// Retrieve metadata stored in the table
 	RecordDataManager *dataMgr = tableData->mgmtData;	
+
+	// The pages of a read-only table are mapped read only
+	if (dataMgr->readOnly)
+		return RC_WRITE_FAILED;
 	
 	// Set the Record ID for this record
 	RID *recordID = &record->id; 
 	
 	char *data, *slotPointer;
+	RC rc;
 	
 	// Get the size in bytes needed to store one record for the given schema
 	int recordSize = getRecordSize(tableData->schema);
@@ -363,31 +579,46 @@ extern RC insertRecord(RM_TableData *tableData, Record *record)
 	// Set first free page to the current page
 	recordID->page = dataMgr->firstFreePage;
 
+	// A page deleteRecord gave back is taken back from the file's free pages before it is filled;
+	// the lowest one is handed out, and inserts go on from there
+	if (isPoolPageFree(&dataMgr->bufferPool, recordID->page)
+		&& allocatePoolPage(&dataMgr->bufferPool, &recordID->page) == RC_OK)
+		dataMgr->firstFreePage = recordID->page;
+
 	// Pin the page i.e., inform Buffer Manager that we are using this page
-	pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, recordID->page);
+	rc = pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, recordID->page);
+	if (rc != RC_OK)
+		return rc;
 	
 	// Set the data to initial position of record's data
 	data = dataMgr->filePageHandle.data;
 	
 	// Get a free slot using our custom function
-	recordID->slot = findFreePageIndex(data, recordSize);
+	recordID->slot = findFreePageIndex(data, recordSize, dataMgr->bufferPool.pageSize);
 
 	while(recordID->slot == -1)
 	{
 		// If the pinned page doesn't have a free slot then unpin that page
 		unpinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle);	
 		
-		// Increment page
-		recordID->page++;
+		// Move on to the lowest free page while the file has any, so pages deleteRecord freed
+		// anywhere in the table are filled before it grows; otherwise try the next page
+		if (getNumFreePoolPages(&dataMgr->bufferPool) > 0
+			&& allocatePoolPage(&dataMgr->bufferPool, &recordID->page) == RC_OK)
+			dataMgr->firstFreePage = recordID->page;
+		else
+			recordID->page++;
 		
 		// Bring the new page into the Buffer Pool using Buffer Manager
-		pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, recordID->page);
+		rc = pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, recordID->page);
+		if (rc != RC_OK)
+			return rc;
 		
 		// Set the data to initial position of record's data		
 		data = dataMgr->filePageHandle.data;
 
 		// Again check for a free slot using our custom function
-		recordID->slot = findFreePageIndex(data, recordSize);
+		recordID->slot = findFreePageIndex(data, recordSize, dataMgr->bufferPool.pageSize);
 	}
 	
 	slotPointer = data;
@@ -409,9 +640,6 @@ extern RC insertRecord(RM_TableData *tableData, Record *record)
 	
 	// Increment count of tuples
 	dataMgr->totalTuples++;
-	
-	// Pin back the page	
-	pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, 0);
 
 	return RC_OK;
 }
@@ -447,15 +675,22 @@ extern RC deleteTable(char *table_Name)
  *
  * @return
  *   - RC_OK: Successful record update.
+ *   - RC_WRITE_FAILED: The table was opened read only.
  *   - Other error codes indicating failure during record update.
  */
 extern RC updateRecord(RM_TableData *tableData, Record *record)
 {	
 	// Retrieve metadata stored in the table
 	RecordDataManager *dataMgr = tableData->mgmtData;
+
+	// The pages of a read-only table are mapped read only
+	if (dataMgr->readOnly)
+		return RC_WRITE_FAILED;
 	
 	// Pin the page which has the record to be updated
-	pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, record->id.page);
+	RC rc = pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, record->id.page);
+	if (rc != RC_OK)
+		return rc;
 
 	char *data;
 
@@ -491,21 +726,30 @@ extern RC updateRecord(RM_TableData *tableData, Record *record)
  * @brief Deletes a record with the specified Record ID in the table referenced by the provided table data.
  *
  * This function deletes a record with the given Record ID in the table referenced by the provided table data.
+ * A data page left without records is freed (see freePoolPage): scans skip it, and inserts fill
+ * the file's free pages, lowest first, before the table grows, so tables stop growing under churn.
  *
  * @param tableData Pointer to the table data structure.
  * @param id The Record ID of the record to be deleted.
  *
  * @return
  *   - RC_OK: Successful record deletion.
+ *   - RC_WRITE_FAILED: The table was opened read only.
  *   - Other error codes indicating failure during record deletion.
  */
 extern RC deleteRecord(RM_TableData *tableData, RID id)
 {
 	// Retrieve metadata stored in the table
 	RecordDataManager *dataMgr = tableData->mgmtData;
+
+	// The pages of a read-only table are mapped read only
+	if (dataMgr->readOnly)
+		return RC_WRITE_FAILED;
 	
 	// Pin the page which has the record to be deleted
-	pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, id.page);
+	RC rc = pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, id.page);
+	if (rc != RC_OK)
+		return rc;
 
 	// Update free page because this page 
 	dataMgr->firstFreePage = id.page;
@@ -524,9 +768,16 @@ extern RC deleteRecord(RM_TableData *tableData, RID id)
 	// Mark the page dirty because it has been modified
 	markDirty(&dataMgr->bufferPool, &dataMgr->filePageHandle);
 
+	// A data page left without records goes back to the file's free pages (page 0 holds the schema)
+	bool emptyPage = id.page != 0 && findUsedSlot(dataMgr->filePageHandle.data, recordSize, dataMgr->bufferPool.pageSize) == -1;
+
 	// Unpin the page after the record is deleted since the page is no longer required to be in memory
 	unpinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle);
 
+	// Should someone else have it pinned, the page simply stays allocated
+	if (emptyPage)
+		freePoolPage(&dataMgr->bufferPool, id.page);
+
 	return RC_OK;
 }
 
@@ -548,6 +799,29 @@ extern RC deleteRecord(RM_TableData *tableData, RID id)
  *   - Other error codes indicating failure during scan start.
  */
 extern RC startScan(RM_TableData *tableData, RM_ScanHandle *scanHandle, Expr *condition)
+{
+	return startScanWithAccess(tableData, scanHandle, condition, RM_SCAN_SHARED);
+}
+
+
+/**
+ * @brief Starts a scan like startScan, choosing how the scan uses the buffer pool.
+ *
+ * With RM_SCAN_RING the scan reads table pages through a small ring of frames that it recycles
+ * (see initScanRing), so a large sequential scan does not evict the index and point lookup
+ * pages that other accesses keep in the pool.
+ *
+ * @param tableData Pointer to the table data structure.
+ * @param scanHandle Pointer to the scan handle structure.
+ * @param condition Pointer to the condition expression.
+ * @param access RM_SCAN_SHARED or RM_SCAN_RING.
+ *
+ * @return
+ *   - RC_OK: Successful scan start.
+ *   - RC_SCAN_CONDITION_NOT_FOUND: Scan condition not provided.
+ *   - Other error codes indicating failure during scan start.
+ */
+extern RC startScanWithAccess(RM_TableData *tableData, RM_ScanHandle *scanHandle, Expr *condition, RM_ScanAccess access)
 {
 	// Check if scan condition (test expression) is present
 	if (condition == NULL)
@@ -555,9 +829,6 @@ extern RC startScan(RM_TableData *tableData, RM_ScanHandle *scanHandle, Expr *co
 		return RC_SCAN_CONDITION_NOT_FOUND;
 	}
 
-	// Open the table in memory
-	openTable(tableData, "ScanTable");
-
     RecordDataManager *scanMgr;
 	RecordDataManager *tableMgr;
 
@@ -582,8 +853,22 @@ extern RC startScan(RM_TableData *tableData, RM_ScanHandle *scanHandle, Expr *co
 	// Set our metadata to the table's metadata
     tableMgr = tableData->mgmtData;
 
-	// Set the tuple count
-    tableMgr->totalTuples = ATTR_SIZE;
+	// Pages ahead of the scan are prefetched once it is seen reading them in order
+	initReadahead(&scanMgr->readahead);
+
+	// Set up the scan's ring of frames if it should not go through the shared pool
+	scanMgr->scanRing = NULL;
+	if (access == RM_SCAN_RING)
+	{
+		scanMgr->scanRing = (BM_ScanRing*) malloc(sizeof(BM_ScanRing));
+		if (scanMgr->scanRing == NULL || initScanRing(&tableMgr->bufferPool, scanMgr->scanRing, SCAN_RING_FRAMES) != RC_OK)
+		{
+			free(scanMgr->scanRing);
+			free(scanMgr);
+			scanHandle->mgmtData = NULL;
+			return RC_ERROR;
+		}
+	}
 
 	// Set the scan's table, i.e., the table to be scanned using the specified condition
     scanHandle->rel= tableData;
@@ -625,25 +910,22 @@ extern RC next(RM_ScanHandle *scan, Record *record)
 	Value *output = (Value *) malloc(sizeof(Value));
    
 	char *data;
+	RC pinned;
    	
 	// Get record size of the schema
 	int recordSize = getRecordSize(schema);
 
 	// Calculate total number of slots
-	int totalSlots = PAGE_SIZE / recordSize;
+	int totalSlots = tableMgr->bufferPool.pageSize / recordSize;
 
 	// Get scanned record count
 	int scannedCnt = scanMgr->scannedRecordCount;
 
-	// Get tuples count of the table
-	int totalTuples = tableMgr->totalTuples;
-
-	// Check if the table contains tuples
-	if (totalTuples == 0)
-		return RC_RM_NO_MORE_TUPLES;
+	// Pages past the end of the table's file hold no records
+	int numPages = getNumPoolFilePages(&tableMgr->bufferPool);
 
-	// Iterate through the tuples
-	while (scannedCnt <= totalTuples)
+	// Iterate through the slots of the table's pages
+	while (true)
 	{  
 		// If all the tuples have been scanned
 		if (scannedCnt <= 0)
@@ -665,14 +947,51 @@ extern RC next(RM_ScanHandle *scan, Record *record)
 			}
 		}
 
-		// Pin the page i.e. put the page in buffer pool
-		pinPage(&tableMgr->bufferPool, &scanMgr->filePageHandle, scanMgr->recordIdentifier.page);
+		// Pages freed by deleteRecord hold no records, so they are not read at all
+		while (scanMgr->recordIdentifier.slot == 0 && scanMgr->recordIdentifier.page < numPages
+			&& isPoolPageFree(&tableMgr->bufferPool, scanMgr->recordIdentifier.page))
+			scanMgr->recordIdentifier.page++;
+
+		// Every page of the table has been scanned
+		if (scanMgr->recordIdentifier.page >= numPages)
+			break;
+
+		// Pin the page i.e. put the page in buffer pool, through the scan's ring if it has one
+		readahead(&tableMgr->bufferPool, &scanMgr->readahead, scanMgr->scanRing, scanMgr->recordIdentifier.page);
+		if (scanMgr->scanRing != NULL)
+			pinned = pinPageScan(&tableMgr->bufferPool, scanMgr->scanRing, &scanMgr->filePageHandle, scanMgr->recordIdentifier.page);
+		else
+			pinned = pinPage(&tableMgr->bufferPool, &scanMgr->filePageHandle, scanMgr->recordIdentifier.page);
+
+		// A page that cannot be read fails the scan; stepping back to the slot before it lets a
+		// later call retry the page
+		if (pinned != RC_OK)
+		{
+			if (scanMgr->recordIdentifier.slot > 0)
+				scanMgr->recordIdentifier.slot--;
+			else
+			{
+				scanMgr->recordIdentifier.page--;
+				scanMgr->recordIdentifier.slot = totalSlots - 1;
+			}
+			free(output);
+			return pinned;
+		}
 			
 		// Retrieve the data of the page			
 		data = scanMgr->filePageHandle.data;
 
 		// Calculate the data location from record's slot and record size
 		data += (scanMgr->recordIdentifier.slot * recordSize);
+
+		// Slots not marked '+' hold no record and are passed over
+		if (*data != '+')
+		{
+			unpinPage(&tableMgr->bufferPool, &scanMgr->filePageHandle);
+			scanMgr->scannedRecordCount++;
+			scannedCnt++;
+			continue;
+		}
 		
 		// Set the record's slot and page to scan manager's slot and page
 		record->id.page = scanMgr->recordIdentifier.page;
@@ -686,6 +1005,10 @@ extern RC next(RM_ScanHandle *scan, Record *record)
 		
 		memcpy(++dataPtr, data + 1, recordSize - 1);
 
+		// Unpin the page as soon as the record has been copied out, so a scan never holds
+		// more than one pin and scanned pages stay evictable
+		unpinPage(&tableMgr->bufferPool, &scanMgr->filePageHandle);
+
 		// Increment scan count because one record has been scanned
 		scanMgr->scannedRecordCount++;
 		scannedCnt++;
@@ -696,16 +1019,11 @@ extern RC next(RM_ScanHandle *scan, Record *record)
 		// 'v.boolV' is TRUE if the record satisfies the condition
 		if (output->v.boolV == TRUE)
 		{
-			// Unpin the page i.e. remove it from the buffer pool
-			unpinPage(&tableMgr->bufferPool, &scanMgr->filePageHandle);
 			// Return SUCCESS			
 			return RC_OK;
 		}
 	}
 	
-	// Unpin the page i.e. remove it from the buffer pool
-	unpinPage(&tableMgr->bufferPool, &scanMgr->filePageHandle);
-	
 	// Reset the Scan Manager's values
 	scanMgr->recordIdentifier.page = 1;
 	scanMgr->recordIdentifier.slot = 0;
@@ -737,7 +1055,9 @@ extern RC getRecord(RM_TableData *tableData, RID id, Record *record)
 	RecordDataManager *dataMgr = tableData->mgmtData;
 	
 	// Pin the page which has the record to be retrieved
-	pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, id.page);
+	RC rc = pinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle, id.page);
+	if (rc != RC_OK)
+		return rc;
 
 	// Get the size of the record
 	int recordSize = getRecordSize(tableData->schema);
@@ -746,7 +1066,9 @@ extern RC getRecord(RM_TableData *tableData, RID id, Record *record)
 	
 	if(*dataPtr != '+')
 	{
-		// Return error if no matching record for Record ID 'id' is found in the table
+		// Return error if no matching record for Record ID 'id' is found in the table, once the
+		// page is unpinned again
+		unpinPage(&dataMgr->bufferPool, &dataMgr->filePageHandle);
 		return RC_RM_NO_TUPLE_WITH_GIVEN_RID;
 	}
 	else
@@ -781,23 +1103,26 @@ extern RC getRecord(RM_TableData *tableData, RID id, Record *record)
 extern RC closeScan(RM_ScanHandle *scan)
 {
 	RecordDataManager *scanMgr = scan->mgmtData;
-	RecordDataManager *recordMgr = scan->rel->mgmtData;
 
-	// Check if scan was incomplete
+	// Check if scan was incomplete (next() does not hold a pin between calls, so there is nothing to unpin)
 	if (scanMgr->scannedRecordCount > 0)
 	{
-		// Unpin the page i.e. remove it from the buffer pool
-		unpinPage(&recordMgr->bufferPool, &scanMgr->filePageHandle);
-		
 		// Reset the Scan Manager's values
 		scanMgr->scannedRecordCount = 0;
 		scanMgr->recordIdentifier.page = 1;
 		scanMgr->recordIdentifier.slot = 0;
 	}
 	
+	// Release the scan's ring; its frames stay in the buffer pool
+	if (scanMgr->scanRing != NULL)
+	{
+		freeScanRing(scanMgr->scanRing);
+		free(scanMgr->scanRing);
+	}
+
 	// De-allocate all the memory space allocated to the scan's metadata (our custom structure)
+    free(scan->mgmtData);
     scan->mgmtData = NULL;
-    free(scan->mgmtData);  
 	
 	return RC_OK;
 }
@@ -4,6 +4,7 @@
 #include "dberror.h"
 #include "expr.h"
 #include "tables.h"
+#include "storage_mgr.h"
 
 // Bookkeeping for scans
 typedef struct RM_ScanHandle
@@ -12,11 +13,22 @@ typedef struct RM_ScanHandle
 	void *mgmtData;
 } RM_ScanHandle;
 
+// How a scan brings table pages into the buffer pool
+typedef enum RM_ScanAccess
+{
+	RM_SCAN_SHARED = 0, // Through the shared pool like any other page access
+	RM_SCAN_RING = 1    // Through a ring of SCAN_RING_FRAMES frames, leaving the pool's other pages alone
+} RM_ScanAccess;
+
 // table and manager
 extern RC initRecordManager (void *mgmtData);
 extern RC shutdownRecordManager ();
 extern RC createTable (char *name, Schema *schema);
+extern RC createTableWithPageSize (char *name, Schema *schema, int pageSize);
+extern RC createCompressedTable (char *name, Schema *schema);
+extern RC createSegmentedTable (char *name, Schema *schema, const SM_SegmentLayout *layout);
 extern RC openTable (RM_TableData *rel, char *name);
+extern RC openTableReadOnly (RM_TableData *rel, char *name);
 extern RC closeTable (RM_TableData *rel);
 extern RC deleteTable (char *name);
 extern int getNumTuples (RM_TableData *rel);
@@ -29,6 +41,7 @@ extern RC getRecord (RM_TableData *rel, RID id, Record *record);
 
 // scans
 extern RC startScan (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC startScanWithAccess (RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, RM_ScanAccess access);
 extern RC next (RM_ScanHandle *scan, Record *record);
 extern RC closeScan (RM_ScanHandle *scan);
 
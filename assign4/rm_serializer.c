@@ -18,7 +18,7 @@ typedef struct VarString {
 			var = (VarString *) malloc(sizeof(VarString));	\
 			var->size = 0;					\
 			var->bufsize = 100;					\
-			var->buf = calloc(100,0);				\
+			var->buf = calloc(100,1);				\
 		} while (0)
 
 #define FREE_VARSTRING(var)			\
@@ -89,20 +89,30 @@ serializeTableContent(RM_TableData *rel)
 	int i;
 	VarString *result;
 	RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
-	Record *r = (Record *) malloc(sizeof(Record));
+	Record *r;
+	Value *all;
+	Expr *everyRecord;
 	MAKE_VARSTRING(result);
 
 	for(i = 0; i < rel->schema->numAttr; i++)
 		APPEND(result, "%s%s", (i != 0) ? ", " : "", rel->schema->attrNames[i]);
 
-	startScan(rel, sc, NULL);
-
-	while(next(sc, r) != RC_RM_NO_MORE_TUPLES)
+	// dump every record through a scan ring so the dump does not flush the buffer pool
+	createRecord(&r, rel->schema);
+	MAKE_VALUE(all, DT_BOOL, TRUE);
+	MAKE_CONS(everyRecord, all);
+	if (startScanWithAccess(rel, sc, everyRecord, RM_SCAN_RING) == RC_OK)
 	{
-		APPEND_STRING(result,serializeRecord(r, rel->schema));
-		APPEND_STRING(result,"\n");
+		while(next(sc, r) != RC_RM_NO_MORE_TUPLES)
+		{
+			APPEND_STRING(result,serializeRecord(r, rel->schema));
+			APPEND_STRING(result,"\n");
+		}
+		closeScan(sc);
 	}
-	closeScan(sc);
+	freeExpr(everyRecord);
+	freeRecord(r);
+	free(sc);
 
 	RETURN_STRING(result);
 }
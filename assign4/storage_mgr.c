@@ -1,9 +1,1890 @@
 
+// O_DIRECT is a GNU extension of fcntl.h
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "storage_mgr.h"
 #include "dberror.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+// io_uring is driven through its raw system calls, so no liburing is needed
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SM_HAVE_IO_URING 1
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#endif
+
+
+// Buffers handed to direct I/O are aligned to 4 KB, which covers the logical block size of
+// common devices (512 bytes or 4 KB); page offsets are multiples of it for every page size
+#define DIRECT_IO_ALIGN MIN_PAGE_SIZE
+
+// Page files start with a header block holding FILE_MAGIC and the page size, followed by the
+// pages. The block is 4 KB so that pages stay aligned for direct I/O. Files without the magic
+// were written before pages had a configurable size; they have no header and 4 KB pages.
+#define FILE_HEADER_SIZE MIN_PAGE_SIZE
+#define FILE_MAGIC "RDBMSPF1"
+#define FILE_MAGIC_LENGTH 8
+
+// Flags in the header of a page file
+#define FILE_FLAG_COMPRESSED 1 // Pages are stored compressed (see createCompressedPageFile)
+#define FILE_FLAG_SEGMENTED 2  // Pages are spread over segment files (see createSegmentedPageFile)
+
+// The header block lists the file's free pages after the header, as runs of pages (see freePage)
+#define FREE_RUNS_MAX ((FILE_HEADER_SIZE - (int)sizeof(SM_FileHeader)) / (int)sizeof(SM_PageRun))
+
+// Free pages are punched out of the file in aligned chunks of this many bytes, or one page if larger
+#define PUNCH_CHUNK_BYTES 65536
+
+// A segmented file has a second header block, the space block, holding its SM_SpaceHeader
+// followed by the directories of its segments, each ending in a zero byte
+#define SPACE_DIRS_BYTES (FILE_HEADER_SIZE - (int)sizeof(SM_SpaceHeader))
+
+// A compressed file stores each page in a slot of whole units of this many bytes after the
+// header block, and the slot table after the last slot
+#define SLOT_UNIT 512
+
+// Shortest match the page codec encodes, and bits of its match finder's hash
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+
+// Most pages moved by one preadv/pwritev call; longer runs take several (IOV_MAX is 1024 on Linux)
+#define VECTOR_MAX_PAGES 256
+
+// The file grows in extents of a quarter of its size, within these bounds (256 KB to 64 MB of 4 KB pages)
+#define EXTENT_MIN_PAGES 64
+#define EXTENT_MAX_PAGES 16384
+
+// Header block of a page file; the rest of the block is zero
+typedef struct SM_FileHeader
+{
+    char magic[FILE_MAGIC_LENGTH];
+    int32_t pageSize;
+    int32_t flags;     // FILE_FLAG_ values; 0 in files written before there were any
+    int32_t numPages;  // Compressed files: pages in the file when it was last closed
+    int32_t numFreeRuns; // Runs of free pages listed after the header; 0 in files written before there were any
+    int64_t mapOffset; // Compressed files: where the slot table starts
+} SM_FileHeader;
+
+// A run of free pages, as listed in the header block
+typedef struct SM_PageRun
+{
+    int32_t first;
+    int32_t count;
+} SM_PageRun;
+
+// Start of the space block of a segmented file
+typedef struct SM_SpaceHeader
+{
+    int32_t segmentPages; // Pages per segment file
+    int32_t numDirs;      // Directories listed after the header; 0 if the segments are next to the file
+} SM_SpaceHeader;
+
+// A segment file of a segmented page file
+typedef struct SM_Segment
+{
+    int fd;                 // -1 while the file is not open
+    int refs;               // Transfers using fd right now; it is not closed while there are any
+    unsigned long lastUse;  // Tick of the last transfer, to close the one used longest ago
+} SM_Segment;
+
+// Bookkeeping of an open segmented page file. Segment 0 is the page file itself, holding the
+// first segmentPages pages after its two header blocks; segment n > 0 is a file of its own
+// named after the page file with ".n" appended, holding pages n * segmentPages on
+typedef struct SM_Tablespace
+{
+    pthread_mutex_t lock;   // Guards everything below but the layout
+    char *fileName;
+    int segmentPages;
+    int numDirs;
+    char **dirs;            // Where segments 1, 2, ... go, in turn (see segmentPath)
+    SM_Segment *segs;       // segCapacity entries, the first numSegments of which exist on disk
+    int segCapacity;
+    int numSegments;
+    int openFds;            // Segment files open besides the page file
+    unsigned long clock;
+    long long opens;
+} SM_Tablespace;
+
+// Where a page of a compressed file is stored; the slot table is an array of these
+typedef struct SM_PageSlot
+{
+    uint32_t unit;   // First unit of the slot, counted from the end of the header block
+    uint32_t length; // Bytes stored: 0 for a page never written, pageSize for one stored as is
+} SM_PageSlot;
+
+// A run of free units in a compressed file
+typedef struct SM_FreeExtent
+{
+    uint32_t unit;
+    uint32_t count;
+} SM_FreeExtent;
+
+// Bookkeeping of an open compressed page file
+typedef struct SM_CompressedFile
+{
+    pthread_mutex_t lock;   // Guards the slots, the free extents and dataEnd
+    SM_PageSlot *slots;     // Slot of each page, slotCapacity entries (at least totalNumPages)
+    int slotCapacity;
+    SM_FreeExtent *free;    // Free runs of units below dataEnd, in unit order, none adjacent
+    int numFree;
+    int freeCapacity;
+    uint32_t dataEnd;       // Units up to here hold slots or are free
+    SM_CompressionStats stats; // Counters, updated atomically without the lock
+} SM_CompressedFile;
+
+// Bookkeeping kept in fHandle->mgmtInfo for an open page file
+typedef struct SM_FileMgmt
+{
+    int fd;     // Descriptor used for all positional (pread/pwrite) page I/O, but that of later segments
+    int direct; // 1 while fd bypasses the page cache (see setPageFileMode), loaded atomically
+    int pageSize;       // Bytes per page, from the file's header
+    off_t dataOffset;   // Where page 0 starts: FILE_HEADER_SIZE, or 0 for a file without header
+    int allocatedPages; // Pages the file has disk space reserved for, at least totalNumPages (see reserveExtent)
+    int mapped;         // 1 if opened with SM_FILE_MAPPED: read only, with every page in map
+    char *map;          // The file's pages mapped into memory, NULL if not mapped or empty
+    size_t mapLength;   // Bytes mapped
+    SM_CompressedFile *comp; // Slots of a compressed file's pages, NULL if not compressed
+    SM_Tablespace *space;    // Segments of a segmented file, NULL if every page is in this file
+    pthread_mutex_t freeLock; // Guards the free-page map below
+    uint64_t *freeBits; // Bit p is set if page p is free (see freePage); freeCapacity bits
+    int freeCapacity;
+    int numFreePages;
+    int freeChanged;    // 1 once the map differs from the one listed in the header block
+    int noPunch;        // 1 once the file system refused to punch a hole
+} SM_FileMgmt;
+
+
+/**
+ * @brief Returns the bookkeeping of an open page file.
+ */
+static inline SM_FileMgmt *fileMgmt(SM_FileHandle *fileHandle)
+{
+    return (SM_FileMgmt *)fileHandle->mgmtInfo;
+}
+
+
+/**
+ * @brief Returns the descriptor of an open page file.
+ */
+static inline int fileDescriptor(SM_FileHandle *fileHandle)
+{
+    return fileMgmt(fileHandle)->fd;
+}
+
+
+/**
+ * @brief Returns whether the file's page I/O currently bypasses the page cache.
+ */
+static inline int isDirect(SM_FileMgmt *file)
+{
+    return __atomic_load_n(&file->direct, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Turns page-cache bypass on or off for a descriptor.
+ *
+ * Linux takes O_DIRECT through fcntl and refuses it with EINVAL on file systems that cannot do
+ * direct I/O; macOS has F_NOCACHE instead, which needs no alignment.
+ *
+ * @return 0 on success, -1 if the system or the file system does not allow it.
+ */
+static int setDirectFlag(int fd, int on)
+{
+#if defined(O_DIRECT)
+    int flags = fcntl(fd, F_GETFL);
+
+    if (flags < 0)
+        return -1;
+    return fcntl(fd, F_SETFL, on ? flags | O_DIRECT : flags & ~O_DIRECT) < 0 ? -1 : 0;
+#elif defined(F_NOCACHE)
+    return fcntl(fd, F_NOCACHE, on) < 0 ? -1 : 0;
+#else
+    return on ? -1 : 0;
+#endif
+}
+
+
+/**
+ * @brief Falls back to buffered I/O after the file system turned a direct read or write down.
+ *
+ * The open segment files of a segmented file are switched back as well.
+ *
+ * @return 0 if the file is buffered now, so the transfer can be retried.
+ */
+static int dropDirect(SM_FileMgmt *file)
+{
+    SM_Tablespace *s = file->space;
+    int rc = setDirectFlag(file->fd, 0), i;
+
+    if (s != NULL)
+    {
+        pthread_mutex_lock(&s->lock);
+        for (i = 1; i < s->numSegments; i++)
+        {
+            if (s->segs[i].fd >= 0 && setDirectFlag(s->segs[i].fd, 0) != 0)
+                rc = -1;
+        }
+        pthread_mutex_unlock(&s->lock);
+    }
+    if (rc != 0)
+        return -1;
+    __atomic_store_n(&file->direct, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+
+
+/**
+ * @brief Returns the number of pages the handle knows of.
+ *
+ * A buffer pool grows its file under a lock of its own while other threads read and write pages
+ * through the same handle, so the count is loaded and stored atomically.
+ */
+static inline int knownPages(SM_FileHandle *fileHandle)
+{
+    return __atomic_load_n(&fileHandle->totalNumPages, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Records a new page count for the handle (see knownPages).
+ */
+static inline void setKnownPages(SM_FileHandle *fileHandle, int numPages)
+{
+    __atomic_store_n(&fileHandle->totalNumPages, numPages, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Returns the byte offset of a page in the file.
+ */
+static inline off_t pageOffset(SM_FileMgmt *file, int pageNum)
+{
+    return file->dataOffset + (off_t)pageNum * file->pageSize;
+}
+
+
+/**
+ * @brief Returns the number of whole pages a file of the given size holds.
+ */
+static inline int pagesInFile(SM_FileMgmt *file, off_t fileSize)
+{
+    return fileSize > file->dataOffset ? (int)((fileSize - file->dataOffset) / file->pageSize) : 0;
+}
+
+
+/**
+ * @brief Tells whether a page size is supported: a power of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE.
+ */
+static inline int validPageSize(int pageSize)
+{
+    return pageSize >= MIN_PAGE_SIZE && pageSize <= MAX_PAGE_SIZE && (pageSize & (pageSize - 1)) == 0;
+}
+
+
+/**
+ * @brief Fills in a header for a file of the given page size and flags.
+ */
+static void initHeader(SM_FileHeader *header, int pageSize, int flags)
+{
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, FILE_MAGIC, FILE_MAGIC_LENGTH);
+    header->pageSize = pageSize;
+    header->flags = flags;
+}
+
+
+/**
+ * @brief Reads an open file's header and where the pages start.
+ *
+ * @return RC_OK, with the header of a file without one (PAGE_SIZE pages, no flags) if it has
+ *         none, or RC_INVALID_PAGE_SIZE if the header holds a page size that is not supported.
+ */
+static RC readHeader(int fd, SM_FileHeader *header, off_t *dataOffset)
+{
+    if (pread(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header)
+        || memcmp(header->magic, FILE_MAGIC, FILE_MAGIC_LENGTH) != 0)
+    {
+        memset(header, 0, sizeof(*header));
+        header->pageSize = PAGE_SIZE;
+        *dataOffset = 0;
+        return RC_OK;
+    }
+    if (!validPageSize(header->pageSize))
+        return RC_INVALID_PAGE_SIZE;
+    *dataOffset = (header->flags & FILE_FLAG_SEGMENTED) ? 2 * FILE_HEADER_SIZE : FILE_HEADER_SIZE;
+    return RC_OK;
+}
+
+
+static int transferPage(SM_FileMgmt *file, int fd, off_t offset, char *buf, int isWrite);
+static int transferBytes(int fd, off_t offset, char *buf, size_t length, int isWrite);
+static int writeHeaderBlock(SM_FileMgmt *file, SM_FileHeader *header);
+
+
+/**
+ * @brief Transfers a page through a page-aligned copy of an unaligned buffer, for direct I/O.
+ */
+static int bouncePage(SM_FileMgmt *file, int fd, off_t offset, char *buf, int isWrite)
+{
+    void *bounce;
+    int rc;
+
+    if (posix_memalign(&bounce, DIRECT_IO_ALIGN, file->pageSize) != 0)
+        return -1;
+    if (isWrite)
+        memcpy(bounce, buf, file->pageSize);
+    rc = transferPage(file, fd, offset, (char *)bounce, isWrite);
+    if (rc == 0 && !isWrite)
+        memcpy(buf, bounce, file->pageSize);
+    free(bounce);
+    return rc;
+}
+
+
+/**
+ * @brief Reads or writes exactly one page at the given byte offset of fd without touching the descriptor's file offset.
+ *
+ * Retries on short transfers and EINTR. With direct I/O, an unaligned buffer goes through an
+ * aligned copy, and should the file system turn the transfer down after all, the file falls
+ * back to buffered I/O and the transfer is retried.
+ *
+ * @return 0 on success, -1 if the page cannot be transferred completely.
+ */
+static int transferPage(SM_FileMgmt *file, int fd, off_t offset, char *buf, int isWrite)
+{
+    size_t done = 0, size = (size_t)file->pageSize;
+
+    if (isDirect(file) && (uintptr_t)buf % DIRECT_IO_ALIGN != 0)
+        return bouncePage(file, fd, offset, buf, isWrite);
+
+    while (done < size)
+    {
+        ssize_t n = isWrite ? pwrite(fd, buf + done, size - done, offset + done)
+                            : pread(fd, buf + done, size - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EINVAL && isDirect(file) && dropDirect(file) == 0)
+            continue;
+        if (n == 0 && !isWrite)
+        {
+            // Past the end of the file: the page was added but never written (see ensureCapacity)
+            memset(buf + done, 0, size - done);
+            return 0;
+        }
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Reads or writes consecutive pages of fd from or to separate buffers with as few system calls as possible.
+ *
+ * Up to VECTOR_MAX_PAGES pages go in one preadv/pwritev. Short transfers and EINTR are retried
+ * like in transferPage, and so is a direct transfer the file system turns down, once buffered.
+ * With direct I/O, a stretch holding an unaligned buffer is moved page by page through
+ * transferPage instead.
+ *
+ * @return 0 on success, -1 if the pages cannot be transferred completely.
+ */
+static int transferPages(SM_FileMgmt *file, int fd, off_t offset, char **pages, int numPages, int isWrite)
+{
+    struct iovec iov[VECTOR_MAX_PAGES];
+    int first, i;
+
+    for (first = 0; first < numPages; first += VECTOR_MAX_PAGES)
+    {
+        int count = numPages - first < VECTOR_MAX_PAGES ? numPages - first : VECTOR_MAX_PAGES;
+        off_t at = offset + (off_t)first * file->pageSize;
+        size_t left = (size_t)count * file->pageSize;
+        int unaligned = 0, next = 0;
+
+        for (i = 0; i < count; i++)
+        {
+            iov[i].iov_base = pages[first + i];
+            iov[i].iov_len = file->pageSize;
+            unaligned |= (uintptr_t)pages[first + i] % DIRECT_IO_ALIGN != 0;
+        }
+        if (unaligned && isDirect(file))
+        {
+            for (i = 0; i < count; i++)
+            {
+                if (transferPage(file, fd, at + (off_t)i * file->pageSize, pages[first + i], isWrite) != 0)
+                    return -1;
+            }
+            continue;
+        }
+
+        while (left > 0)
+        {
+            ssize_t n = isWrite ? pwritev(fd, iov + next, count - next, at)
+                                : preadv(fd, iov + next, count - next, at);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno == EINVAL && isDirect(file) && dropDirect(file) == 0)
+                continue;
+            if (n == 0 && !isWrite)
+            {
+                // Past the end of the file: pages added but never written read as zeros
+                for (; next < count; next++)
+                    memset(iov[next].iov_base, 0, iov[next].iov_len);
+                break;
+            }
+            if (n <= 0)
+                return -1;
+            left -= n;
+            at += n;
+
+            // Skip the buffers done with and trim a partly done one
+            while (next < count && (size_t)n >= iov[next].iov_len)
+                n -= iov[next++].iov_len;
+            if (n > 0)
+            {
+                iov[next].iov_base = (char *)iov[next].iov_base + n;
+                iov[next].iov_len -= n;
+            }
+        }
+    }
+    return 0;
+}
+
+
+/************************************************************
+ *                    segments                              *
+ ************************************************************/
+
+/**
+ * @brief Returns the name of segment file seg > 0 of a segmented file, in memory the caller frees, or NULL if out of memory.
+ *
+ * Segments go next to the page file, as "<fileName>.<seg>", or if the layout lists directories,
+ * to each in turn, as "<dir>/<base name of fileName>.<seg>".
+ */
+static char *segmentPath(SM_Tablespace *s, int seg)
+{
+    const char *base = strrchr(s->fileName, '/');
+    const char *dir = s->numDirs > 0 ? s->dirs[(seg - 1) % s->numDirs] : NULL;
+    size_t length;
+    char *path;
+
+    base = base != NULL ? base + 1 : s->fileName;
+    length = (dir != NULL ? strlen(dir) + 1 + strlen(base) : strlen(s->fileName)) + 16;
+    path = (char *)malloc(length);
+    if (path == NULL)
+        return NULL;
+    if (dir != NULL)
+        snprintf(path, length, "%s/%s.%d", dir, base, seg);
+    else
+        snprintf(path, length, "%s.%d", s->fileName, seg);
+    return path;
+}
+
+
+/**
+ * @brief Closes the segment files still open and frees the bookkeeping of a segmented file.
+ */
+static void freeSpace(SM_Tablespace *s)
+{
+    int i;
+
+    for (i = 1; i < s->segCapacity; i++)
+    {
+        if (s->segs[i].fd >= 0)
+            close(s->segs[i].fd);
+    }
+    for (i = 0; i < s->numDirs; i++)
+        free(s->dirs[i]);
+    free(s->dirs);
+    free(s->segs);
+    free(s->fileName);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+
+/**
+ * @brief Makes room for at least numSegments segments in the segment table. Called with the lock held unless the file is being opened.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int growSegments(SM_Tablespace *s, int numSegments)
+{
+    int capacity = s->segCapacity > 0 ? s->segCapacity : 8, i;
+    SM_Segment *segs;
+
+    if (numSegments <= s->segCapacity)
+        return 0;
+    while (capacity < numSegments)
+        capacity *= 2;
+    segs = (SM_Segment *)realloc(s->segs, sizeof(SM_Segment) * capacity);
+    if (segs == NULL)
+        return -1;
+    for (i = s->segCapacity; i < capacity; i++)
+    {
+        segs[i].fd = -1;
+        segs[i].refs = 0;
+        segs[i].lastUse = 0;
+    }
+    s->segs = segs;
+    s->segCapacity = capacity;
+    return 0;
+}
+
+
+/**
+ * @brief Reads the space block of an open segmented file and sets up its bookkeeping, with only the page file itself as segment.
+ *
+ * @return The bookkeeping, or NULL if the block is damaged or out of memory.
+ */
+static SM_Tablespace *readSpace(int fd, const char *fName)
+{
+    SM_Tablespace *s;
+    SM_SpaceHeader *header;
+    char *block = (char *)malloc(FILE_HEADER_SIZE), *dir;
+    int i;
+
+    s = (SM_Tablespace *)calloc(1, sizeof(SM_Tablespace));
+    if (block == NULL || s == NULL || transferBytes(fd, FILE_HEADER_SIZE, block, FILE_HEADER_SIZE, 0) != 0)
+    {
+        free(block);
+        free(s);
+        return NULL;
+    }
+    header = (SM_SpaceHeader *)block;
+    pthread_mutex_init(&s->lock, NULL);
+    s->segmentPages = header->segmentPages;
+    s->numSegments = 1;
+    s->fileName = strdup(fName);
+    if (header->segmentPages < 1 || header->numDirs < 0 || header->numDirs > SPACE_DIRS_BYTES
+        || s->fileName == NULL || growSegments(s, 1) != 0
+        || (s->dirs = (char **)calloc(header->numDirs + 1, sizeof(char *))) == NULL)
+    {
+        free(block);
+        freeSpace(s);
+        return NULL;
+    }
+
+    // The directories follow the header, each ending in a zero byte within the block
+    dir = block + sizeof(SM_SpaceHeader);
+    for (i = 0; i < header->numDirs; i++)
+    {
+        size_t length = strnlen(dir, block + FILE_HEADER_SIZE - dir);
+
+        if (dir + length == block + FILE_HEADER_SIZE || (s->dirs[i] = strdup(dir)) == NULL)
+        {
+            free(block);
+            freeSpace(s);
+            return NULL;
+        }
+        s->numDirs++;
+        dir += length + 1;
+    }
+    free(block);
+    return s;
+}
+
+
+/**
+ * @brief Sets up the segments of a segmented file being opened and counts its pages.
+ *
+ * Segments are created in order (see acquireSegment), so the pages are those of every segment
+ * file up to the last one there is, the last one holding as many as its size tells.
+ *
+ * @param numPages The pages of the page file itself on entry, the pages of all segments on return.
+ *
+ * @return RC_OK, or RC_ERROR if the space block is damaged or out of memory.
+ */
+static RC loadSpace(SM_FileMgmt *file, const char *fName, int *numPages)
+{
+    SM_Tablespace *s = readSpace(file->fd, fName);
+    struct stat segStat;
+    off_t lastSize = 0;
+    char *path;
+
+    if (s == NULL)
+        return RC_ERROR;
+    for (;;)
+    {
+        if ((path = segmentPath(s, s->numSegments)) == NULL)
+        {
+            freeSpace(s);
+            return RC_ERROR;
+        }
+        if (stat(path, &segStat) != 0)
+        {
+            free(path);
+            break;
+        }
+        free(path);
+        lastSize = segStat.st_size;
+        s->numSegments++;
+    }
+    if (growSegments(s, s->numSegments) != 0)
+    {
+        freeSpace(s);
+        return RC_ERROR;
+    }
+    if (s->numSegments > 1)
+        *numPages = (s->numSegments - 1) * s->segmentPages + (int)(lastSize / file->pageSize);
+    file->space = s;
+    return RC_OK;
+}
+
+
+/**
+ * @brief Opens segment file seg > 0 of a segmented file, creating it if need be. Called with the lock held.
+ *
+ * Once SEGMENT_FDS_MAX segment files are open, the one used longest ago and not in use right
+ * now is closed first; should every one be in use, one more is opened all the same. A file
+ * read around the page cache has the segment opened that way too.
+ *
+ * @return 0 on success, -1 if the segment file cannot be opened.
+ */
+static int openSegment(SM_FileMgmt *file, int seg)
+{
+    SM_Tablespace *s = file->space;
+    char *path;
+    int fd, i;
+
+    if (s->openFds >= SEGMENT_FDS_MAX)
+    {
+        int victim = -1;
+
+        for (i = 1; i < s->numSegments; i++)
+        {
+            if (s->segs[i].fd >= 0 && s->segs[i].refs == 0
+                && (victim < 0 || s->segs[i].lastUse < s->segs[victim].lastUse))
+                victim = i;
+        }
+        if (victim > 0)
+        {
+            close(s->segs[victim].fd);
+            s->segs[victim].fd = -1;
+            s->openFds--;
+        }
+    }
+
+    if ((path = segmentPath(s, seg)) == NULL)
+        return -1;
+    fd = open(path, O_RDWR | O_CREAT, 0666);
+    free(path);
+    if (fd < 0)
+        return -1;
+    if (isDirect(file))
+        setDirectFlag(fd, 1);
+    s->segs[seg].fd = fd;
+    s->openFds++;
+    s->opens++;
+    return 0;
+}
+
+
+/**
+ * @brief Returns the descriptor of the segment holding a page, opening the segment file if it is not open.
+ *
+ * Segment files missing before it are created first, empty, so that the segments on disk always
+ * run from the first to the last without a gap. Every call is paired with one to releaseSegment,
+ * and until then the descriptor stays open.
+ *
+ * @return The descriptor, or -1 if the segment file cannot be opened.
+ */
+static int acquireSegment(SM_FileMgmt *file, int seg)
+{
+    SM_Tablespace *s = file->space;
+    int fd = -1;
+
+    if (seg == 0)
+        return file->fd;
+
+    pthread_mutex_lock(&s->lock);
+    if (growSegments(s, seg + 1) == 0)
+    {
+        while (s->numSegments < seg)
+        {
+            char *path = segmentPath(s, s->numSegments);
+            int created = path != NULL ? open(path, O_RDWR | O_CREAT, 0666) : -1;
+
+            free(path);
+            if (created < 0)
+                break;
+            close(created);
+            s->numSegments++;
+        }
+        if (s->numSegments >= seg && (s->segs[seg].fd >= 0 || openSegment(file, seg) == 0))
+        {
+            if (s->numSegments == seg)
+                s->numSegments++;
+            fd = s->segs[seg].fd;
+            s->segs[seg].refs++;
+            s->segs[seg].lastUse = ++s->clock;
+        }
+    }
+    pthread_mutex_unlock(&s->lock);
+    return fd;
+}
+
+
+/**
+ * @brief Lets go of a segment's descriptor taken with acquireSegment.
+ */
+static void releaseSegment(SM_FileMgmt *file, int seg)
+{
+    SM_Tablespace *s = file->space;
+
+    if (seg == 0)
+        return;
+    pthread_mutex_lock(&s->lock);
+    s->segs[seg].refs--;
+    pthread_mutex_unlock(&s->lock);
+}
+
+
+// Consecutive pages of the same segment, as found by openSpan
+typedef struct SM_PageSpan
+{
+    int segment;
+    int fd;       // Descriptor of the segment's file
+    off_t offset; // Byte offset of the first page in it
+    int numPages; // Pages of the run that are in the segment
+} SM_PageSpan;
+
+
+/**
+ * @brief Finds where a run of pages starts: the segment, its descriptor and the byte offset in it.
+ *
+ * The span covers the pages of the run up to the end of the segment; a file that is not
+ * segmented has the whole run in one span. Every successful call is paired with one to closeSpan.
+ *
+ * @return 0 on success, -1 if the segment file cannot be opened.
+ */
+static int openSpan(SM_FileMgmt *file, int firstPage, int numPages, SM_PageSpan *span)
+{
+    SM_Tablespace *s = file->space;
+    int within;
+
+    if (s == NULL)
+    {
+        span->segment = 0;
+        span->fd = file->fd;
+        span->offset = pageOffset(file, firstPage);
+        span->numPages = numPages;
+        return 0;
+    }
+    span->segment = firstPage / s->segmentPages;
+    within = firstPage % s->segmentPages;
+    span->numPages = numPages < s->segmentPages - within ? numPages : s->segmentPages - within;
+    span->offset = (span->segment == 0 ? file->dataOffset : 0) + (off_t)within * file->pageSize;
+    span->fd = acquireSegment(file, span->segment);
+    return span->fd < 0 ? -1 : 0;
+}
+
+
+/**
+ * @brief Lets go of the segment of a span found by openSpan.
+ */
+static void closeSpan(SM_FileMgmt *file, SM_PageSpan *span)
+{
+    if (file->space != NULL)
+        releaseSegment(file, span->segment);
+}
+
+
+/**
+ * @brief Reads or writes consecutive pages, segment by segment, with transferPages (or transferPage for a single page).
+ *
+ * @return 0 on success, -1 if the pages cannot be transferred completely.
+ */
+static int transferRun(SM_FileMgmt *file, int firstPage, char **pages, int numPages, int isWrite)
+{
+    SM_PageSpan span;
+    int rc;
+
+    while (numPages > 0)
+    {
+        if (openSpan(file, firstPage, numPages, &span) != 0)
+            return -1;
+        rc = span.numPages == 1 ? transferPage(file, span.fd, span.offset, pages[0], isWrite)
+                                : transferPages(file, span.fd, span.offset, pages, span.numPages, isWrite);
+        closeSpan(file, &span);
+        if (rc != 0)
+            return -1;
+        firstPage += span.numPages;
+        pages += span.numPages;
+        numPages -= span.numPages;
+    }
+    return 0;
+}
+
+
+#ifdef FALLOC_FL_KEEP_SIZE
+/**
+ * @brief Calls fallocate with the given mode on the bytes of a run of pages, segment by segment.
+ *
+ * @return 0 on success, -1 with errno set if a segment cannot be opened or fallocate fails.
+ */
+static int allocateRun(SM_FileMgmt *file, int mode, int firstPage, int numPages)
+{
+    SM_PageSpan span;
+    int rc;
+
+    while (numPages > 0)
+    {
+        if (openSpan(file, firstPage, numPages, &span) != 0)
+            return -1;
+        while ((rc = fallocate(span.fd, mode, span.offset, (off_t)span.numPages * file->pageSize)) != 0 && errno == EINTR)
+            ;
+        closeSpan(file, &span);
+        if (rc != 0)
+            return -1;
+        firstPage += span.numPages;
+        numPages -= span.numPages;
+    }
+    return 0;
+}
+#endif
+
+
+/**
+ * @brief Sizes the segment files of a segmented file being closed to hold numPages pages, removing segments past them.
+ *
+ * Like a file that is not segmented (see closePageFile), a segment is extended to hold pages
+ * added but never written, and cut down only where free pages at the end were trimmed off.
+ * Segments are handled from the last on, so the segments left on disk never have a gap.
+ *
+ * @return 0 on success, -1 if a segment cannot be sized or removed.
+ */
+static int closeSegments(SM_FileMgmt *file, int numPages, int totalNumPages)
+{
+    SM_Tablespace *s = file->space;
+    int needed = numPages > 0 ? (numPages - 1) / s->segmentPages + 1 : 1;
+    int seg, rc = 0;
+
+    for (seg = s->numSegments - 1; seg >= 0; seg--)
+    {
+        long long first = (long long)seg * s->segmentPages;
+        long long pages = numPages - first < s->segmentPages ? numPages - first : s->segmentPages;
+        long long known = totalNumPages - first < s->segmentPages ? totalNumPages - first : s->segmentPages;
+        off_t base = seg == 0 ? file->dataOffset : 0;
+        off_t want = base + (off_t)(pages > 0 ? pages : 0) * file->pageSize;
+        int fd = seg == 0 ? file->fd : s->segs[seg].fd;
+        char *path = seg == 0 ? NULL : segmentPath(s, seg);
+        struct stat segStat;
+
+        if (seg > 0 && path == NULL)
+        {
+            rc = -1;
+            continue;
+        }
+        if (seg >= needed)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+                s->segs[seg].fd = -1;
+                s->openFds--;
+            }
+            if (unlink(path) != 0 && errno != ENOENT)
+                rc = -1;
+            else
+                s->numSegments = seg;
+        }
+        else if ((fd >= 0 ? fstat(fd, &segStat) : stat(path, &segStat)) != 0)
+            rc = -1;
+        else if ((segStat.st_size < want
+                  || (numPages < totalNumPages && segStat.st_size > want && segStat.st_size <= base + (off_t)known * file->pageSize))
+                 && (fd >= 0 ? ftruncate(fd, want) : truncate(path, want)) != 0)
+            rc = -1;
+        free(path);
+    }
+    return rc;
+}
+
+
+/**
+ * @brief Removes the segment files of a segmented page file but the page file itself.
+ */
+static void removeSegments(char *fName)
+{
+    SM_FileHeader header;
+    SM_Tablespace *s;
+    off_t dataOffset;
+    int fd = open(fName, O_RDONLY), seg;
+
+    if (fd < 0)
+        return;
+    s = readHeader(fd, &header, &dataOffset) == RC_OK && (header.flags & FILE_FLAG_SEGMENTED) ? readSpace(fd, fName) : NULL;
+    close(fd);
+    if (s == NULL)
+        return;
+    for (seg = 1;; seg++)
+    {
+        char *path = segmentPath(s, seg);
+        int removed = path != NULL && unlink(path) == 0;
+
+        free(path);
+        if (!removed)
+            break;
+    }
+    freeSpace(s);
+}
+
+
+/************************************************************
+ *                    page compression                      *
+ ************************************************************/
+
+/**
+ * @brief Returns the byte offset of a unit of a compressed file.
+ */
+static inline off_t slotOffset(uint32_t unit)
+{
+    return FILE_HEADER_SIZE + (off_t)unit * SLOT_UNIT;
+}
+
+
+/**
+ * @brief Returns the number of units a slot of the given length takes.
+ */
+static inline uint32_t unitsFor(uint32_t length)
+{
+    return (length + SLOT_UNIT - 1) / SLOT_UNIT;
+}
+
+
+/**
+ * @brief Returns a monotonic clock reading in nanoseconds, for the compression counters.
+ */
+static inline long long nowNanos(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Adds to one of a compressed file's counters.
+ */
+static inline void addCounter(long long *counter, long long n)
+{
+    __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief Reads or writes a run of bytes at the given offset, retrying on short transfers and EINTR.
+ *
+ * @return 0 on success, -1 if the bytes cannot be transferred completely.
+ */
+static int transferBytes(int fd, off_t offset, char *buf, size_t length, int isWrite)
+{
+    size_t done = 0;
+
+    while (done < length)
+    {
+        ssize_t n = isWrite ? pwrite(fd, buf + done, length - done, offset + done)
+                            : pread(fd, buf + done, length - done, offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        done += n;
+    }
+    return 0;
+}
+
+
+static inline uint32_t lzRead32(const unsigned char *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+static inline int lzHash(uint32_t v)
+{
+    return (int)((v * 2654435761u) >> (32 - LZ_HASH_BITS));
+}
+
+
+/**
+ * @brief Returns how many bytes from p on equal those from ref on, up to end.
+ */
+static size_t lzMatchLength(const unsigned char *p, const unsigned char *ref, const unsigned char *end)
+{
+    const unsigned char *start = p;
+
+    while (p + sizeof(uint64_t) <= end)
+    {
+        uint64_t a, b;
+
+        memcpy(&a, p, sizeof(a));
+        memcpy(&b, ref, sizeof(b));
+        if (a != b)
+        {
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return (size_t)(p - start) + (size_t)(__builtin_ctzll(a ^ b) / 8);
+#else
+            break;
+#endif
+        }
+        p += sizeof(a);
+        ref += sizeof(b);
+    }
+    while (p < end && *p == *ref)
+    {
+        p++;
+        ref++;
+    }
+    return (size_t)(p - start);
+}
+
+
+/**
+ * @brief Appends the extension bytes of a literal or match length: 255 while more follows.
+ */
+static unsigned char *lzPutLength(unsigned char *op, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+
+/**
+ * @brief Appends one sequence: literals, then a match at the given distance back (none if offset is 0).
+ *
+ * @return Where the output continues, or NULL if the sequence does not fit before end.
+ */
+static unsigned char *lzSequence(unsigned char *op, unsigned char *end, const unsigned char *literals,
+                                 size_t numLiterals, size_t offset, size_t matchLength)
+{
+    unsigned char *token;
+
+    if ((size_t)(end - op) < 5 + numLiterals + numLiterals / 255 + matchLength / 255)
+        return NULL;
+    token = op++;
+    *token = (unsigned char)((numLiterals < 15 ? numLiterals : 15) << 4);
+    if (numLiterals >= 15)
+        op = lzPutLength(op, numLiterals - 15);
+    memcpy(op, literals, numLiterals);
+    op += numLiterals;
+    if (offset == 0)
+        return op;
+
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    matchLength -= LZ_MIN_MATCH;
+    *token |= (unsigned char)(matchLength < 15 ? matchLength : 15);
+    if (matchLength >= 15)
+        op = lzPutLength(op, matchLength - 15);
+    return op;
+}
+
+
+/**
+ * @brief Compresses a page with a greedy LZ77 coder in the LZ4 block format.
+ *
+ * Each sequence is a token (literal count and match length, 4 bits each, 15 meaning more
+ * follows in bytes of 255), the literals, and a match as a 16-bit distance back; the last
+ * sequence has literals only. Matches are found through a hash table of the last position each
+ * 4-byte string was seen at, so a page costs a few nanoseconds per byte; runs of one byte, such
+ * as the zero padding of DT_STRING fields, become a single match.
+ *
+ * @return Bytes written to dst, or -1 if the result would not fit in capacity bytes.
+ */
+static int lzCompress(const unsigned char *src, int srcLength, unsigned char *dst, int capacity)
+{
+    uint16_t table[1 << LZ_HASH_BITS];
+    const unsigned char *ip = src, *anchor = src, *end = src + srcLength;
+    unsigned char *op = dst, *opEnd = dst + capacity;
+
+    memset(table, 0, sizeof(table));
+    while (ip + LZ_MIN_MATCH <= end)
+    {
+        uint32_t seq = lzRead32(ip);
+        int h = lzHash(seq);
+        const unsigned char *ref = src + table[h];
+        size_t length;
+
+        table[h] = (uint16_t)(ip - src);
+        if (ref >= ip || lzRead32(ref) != seq)
+        {
+            ip++;
+            continue;
+        }
+
+        length = LZ_MIN_MATCH + lzMatchLength(ip + LZ_MIN_MATCH, ref + LZ_MIN_MATCH, end);
+        op = lzSequence(op, opEnd, anchor, (size_t)(ip - anchor), (size_t)(ip - ref), length);
+        if (op == NULL)
+            return -1;
+        ip += length;
+        anchor = ip;
+    }
+
+    op = lzSequence(op, opEnd, anchor, (size_t)(end - anchor), 0, 0);
+    return op == NULL ? -1 : (int)(op - dst);
+}
+
+
+/**
+ * @brief Reads the extension bytes of a literal or match length (see lzPutLength).
+ *
+ * @return 0 on success, -1 if the input ends first.
+ */
+static int lzGetLength(const unsigned char **ip, const unsigned char *end, size_t *length)
+{
+    unsigned char b;
+
+    do
+    {
+        if (*ip >= end)
+            return -1;
+        b = *(*ip)++;
+        *length += b;
+    } while (b == 255);
+    return 0;
+}
+
+
+/**
+ * @brief Decompresses a page compressed by lzCompress.
+ *
+ * Every length and distance is checked against both buffers, so a damaged slot makes the
+ * result wrong but never reads or writes outside them.
+ *
+ * @return Bytes written to dst, or -1 if src is not a valid compressed page of at most dstLength bytes.
+ */
+static int lzDecompress(const unsigned char *src, int srcLength, unsigned char *dst, int dstLength)
+{
+    const unsigned char *ip = src, *end = src + srcLength;
+    unsigned char *op = dst, *opEnd = dst + dstLength;
+
+    for (;;)
+    {
+        const unsigned char *ref;
+        size_t length, offset;
+        int token;
+
+        if (ip >= end)
+            return -1;
+        token = *ip++;
+        length = (size_t)(token >> 4);
+        if (length == 15 && lzGetLength(&ip, end, &length) != 0)
+            return -1;
+        if ((size_t)(end - ip) < length || (size_t)(opEnd - op) < length)
+            return -1;
+        memcpy(op, ip, length);
+        op += length;
+        ip += length;
+        if (ip == end)
+            break;
+
+        if (end - ip < 2)
+            return -1;
+        offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        length = (size_t)(token & 15);
+        if (length == 15 && lzGetLength(&ip, end, &length) != 0)
+            return -1;
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(opEnd - op) < length)
+            return -1;
+
+        // A match closer than its length repeats itself; copy it in growing chunks
+        ref = op - offset;
+        while (length > 0)
+        {
+            size_t n = length < (size_t)(op - ref) ? length : (size_t)(op - ref);
+
+            memcpy(op, ref, n);
+            op += n;
+            length -= n;
+        }
+    }
+    return (int)(op - dst);
+}
+
+
+/**
+ * @brief Returns a run of units to a compressed file's free extents. Called with the file's lock held.
+ *
+ * The run is merged with free neighbours, and a free run at the end of the slots shrinks them.
+ * Should the extent array not grow, the units are lost until the file is opened again.
+ */
+static void freeUnits(SM_CompressedFile *c, uint32_t unit, uint32_t count)
+{
+    int lo = 0, hi = c->numFree, prev, next;
+
+    if (count == 0)
+        return;
+
+    // First extent after the run
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+
+        if (c->free[mid].unit < unit)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    prev = lo > 0 && c->free[lo - 1].unit + c->free[lo - 1].count == unit;
+    next = lo < c->numFree && unit + count == c->free[lo].unit;
+
+    if (prev && next)
+    {
+        c->free[lo - 1].count += count + c->free[lo].count;
+        memmove(&c->free[lo], &c->free[lo + 1], (size_t)(c->numFree - lo - 1) * sizeof(SM_FreeExtent));
+        c->numFree--;
+    }
+    else if (prev)
+        c->free[lo - 1].count += count;
+    else if (next)
+    {
+        c->free[lo].unit = unit;
+        c->free[lo].count += count;
+    }
+    else
+    {
+        if (c->numFree == c->freeCapacity)
+        {
+            int capacity = c->freeCapacity > 0 ? 2 * c->freeCapacity : 64;
+            SM_FreeExtent *grown = (SM_FreeExtent *)realloc(c->free, (size_t)capacity * sizeof(SM_FreeExtent));
+
+            if (grown == NULL)
+                return;
+            c->free = grown;
+            c->freeCapacity = capacity;
+        }
+        memmove(&c->free[lo + 1], &c->free[lo], (size_t)(c->numFree - lo) * sizeof(SM_FreeExtent));
+        c->free[lo].unit = unit;
+        c->free[lo].count = count;
+        c->numFree++;
+    }
+
+    if (c->numFree > 0 && c->free[c->numFree - 1].unit + c->free[c->numFree - 1].count == c->dataEnd)
+        c->dataEnd = c->free[--c->numFree].unit;
+}
+
+
+/**
+ * @brief Finds room for a slot of count units, in the first free run large enough or else past the last slot.
+ * Called with the file's lock held.
+ *
+ * @return 0 on success, -1 if the file has no more units.
+ */
+static int allocUnits(SM_CompressedFile *c, uint32_t count, uint32_t *unit)
+{
+    int i;
+
+    for (i = 0; i < c->numFree; i++)
+    {
+        if (c->free[i].count >= count)
+        {
+            *unit = c->free[i].unit;
+            c->free[i].unit += count;
+            c->free[i].count -= count;
+            if (c->free[i].count == 0)
+            {
+                memmove(&c->free[i], &c->free[i + 1], (size_t)(c->numFree - i - 1) * sizeof(SM_FreeExtent));
+                c->numFree--;
+            }
+            return 0;
+        }
+    }
+    if (c->dataEnd > UINT32_MAX - count)
+        return -1;
+    *unit = c->dataEnd;
+    c->dataEnd += count;
+    return 0;
+}
+
+
+/**
+ * @brief Makes a compressed file's slot table hold at least numPages pages, the new ones never written.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int growSlots(SM_CompressedFile *c, int numPages)
+{
+    int rc = 0;
+
+    pthread_mutex_lock(&c->lock);
+    if (numPages > c->slotCapacity)
+    {
+        int capacity = numPages > 2 * c->slotCapacity ? numPages : 2 * c->slotCapacity;
+        SM_PageSlot *grown = (SM_PageSlot *)realloc(c->slots, (size_t)capacity * sizeof(SM_PageSlot));
+
+        if (grown == NULL)
+            rc = -1;
+        else
+        {
+            memset(grown + c->slotCapacity, 0, (size_t)(capacity - c->slotCapacity) * sizeof(SM_PageSlot));
+            c->slots = grown;
+            c->slotCapacity = capacity;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+    return rc;
+}
+
+
+static int compareExtents(const void *a, const void *b)
+{
+    uint32_t x = ((const SM_FreeExtent *)a)->unit, y = ((const SM_FreeExtent *)b)->unit;
+
+    return x < y ? -1 : x > y;
+}
+
+
+/**
+ * @brief Releases a compressed file's bookkeeping.
+ */
+static void freeCompressedFile(SM_CompressedFile *c)
+{
+    pthread_mutex_destroy(&c->lock);
+    free(c->slots);
+    free(c->free);
+    free(c);
+}
+
+
+/**
+ * @brief Reads a compressed file's slot table and finds the free units between the slots.
+ *
+ * @return RC_OK, or RC_ERROR if the table is damaged or cannot be read.
+ */
+static RC loadSlots(SM_FileMgmt *file, const SM_FileHeader *header)
+{
+    SM_CompressedFile *c;
+    SM_FreeExtent *used;
+    int i, numUsed = 0, damaged;
+
+    if (header->numPages < 0 || header->mapOffset < FILE_HEADER_SIZE
+        || (header->mapOffset - FILE_HEADER_SIZE) % SLOT_UNIT != 0)
+        return RC_ERROR;
+
+    c = (SM_CompressedFile *)calloc(1, sizeof(SM_CompressedFile));
+    if (c == NULL)
+        return RC_ERROR;
+    pthread_mutex_init(&c->lock, NULL);
+    c->slotCapacity = header->numPages > 0 ? header->numPages : 1;
+    c->slots = (SM_PageSlot *)calloc((size_t)c->slotCapacity, sizeof(SM_PageSlot));
+    used = (SM_FreeExtent *)malloc((size_t)c->slotCapacity * sizeof(SM_FreeExtent));
+    if (c->slots == NULL || used == NULL
+        || transferBytes(file->fd, (off_t)header->mapOffset, (char *)c->slots,
+                         (size_t)header->numPages * sizeof(SM_PageSlot), 0) != 0)
+    {
+        free(used);
+        freeCompressedFile(c);
+        return RC_ERROR;
+    }
+
+    for (i = 0; i < header->numPages && c->slots[i].length <= (uint32_t)file->pageSize; i++)
+    {
+        if (c->slots[i].length > 0)
+        {
+            used[numUsed].unit = c->slots[i].unit;
+            used[numUsed++].count = unitsFor(c->slots[i].length);
+        }
+    }
+    damaged = i < header->numPages;
+
+    // Every unit below the last slot that no slot covers is free
+    qsort(used, (size_t)numUsed, sizeof(SM_FreeExtent), compareExtents);
+    for (i = 0; !damaged && i < numUsed; i++)
+    {
+        damaged = used[i].unit < c->dataEnd || used[i].unit > UINT32_MAX - used[i].count;
+        if (!damaged)
+        {
+            freeUnits(c, c->dataEnd, used[i].unit - c->dataEnd);
+            c->dataEnd = used[i].unit + used[i].count;
+        }
+    }
+    free(used);
+    if (damaged)
+    {
+        // A slot is longer than a page, or slots overlap
+        freeCompressedFile(c);
+        return RC_ERROR;
+    }
+    file->comp = c;
+    return RC_OK;
+}
+
+
+/**
+ * @brief Writes a compressed file's slot table after its last slot and points the header at it.
+ *
+ * The header block is written with the file's free pages listed in it (see writeHeaderBlock).
+ *
+ * @return 0 on success, -1 if the file cannot be written.
+ */
+static int saveSlots(SM_FileMgmt *file, int numPages)
+{
+    SM_CompressedFile *c = file->comp;
+    SM_FileHeader header;
+    off_t mapOffset = slotOffset(c->dataEnd);
+    size_t length = (size_t)numPages * sizeof(SM_PageSlot);
+
+    initHeader(&header, file->pageSize, FILE_FLAG_COMPRESSED);
+    header.numPages = numPages;
+    header.mapOffset = mapOffset;
+    if (transferBytes(file->fd, mapOffset, (char *)c->slots, length, 1) != 0
+        || writeHeaderBlock(file, &header) != 0
+        || ftruncate(file->fd, mapOffset + (off_t)length) != 0)
+        return -1;
+    return 0;
+}
+
+
+/**
+ * @brief Reads a page of a compressed file from its slot and decompresses it.
+ *
+ * @return RC_OK on success, RC_READ_NON_EXISTING_PAGE if the slot cannot be read or is damaged.
+ */
+static RC readCompressedPage(SM_FileMgmt *file, int pageNum, char *buf)
+{
+    SM_CompressedFile *c = file->comp;
+    SM_PageSlot slot;
+    unsigned char *packed;
+    long long start;
+    int length;
+
+    pthread_mutex_lock(&c->lock);
+    slot = c->slots[pageNum];
+    pthread_mutex_unlock(&c->lock);
+
+    addCounter(&c->stats.pagesRead, 1);
+    addCounter(&c->stats.bytesRead, slot.length);
+    if (slot.length == 0)
+    {
+        // Never written
+        memset(buf, 0, file->pageSize);
+        return RC_OK;
+    }
+    if (slot.length == (uint32_t)file->pageSize)
+        return transferBytes(file->fd, slotOffset(slot.unit), buf, slot.length, 0) == 0 ? RC_OK : RC_READ_NON_EXISTING_PAGE;
+
+    packed = (unsigned char *)malloc(slot.length);
+    if (packed == NULL || transferBytes(file->fd, slotOffset(slot.unit), (char *)packed, slot.length, 0) != 0)
+    {
+        free(packed);
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    start = nowNanos();
+    length = lzDecompress(packed, (int)slot.length, (unsigned char *)buf, file->pageSize);
+    addCounter(&c->stats.decompressNanos, nowNanos() - start);
+    free(packed);
+    return length == file->pageSize ? RC_OK : RC_READ_NON_EXISTING_PAGE;
+}
+
+
+/**
+ * @brief Compresses a page of a compressed file and writes it to a new slot.
+ *
+ * A page that would not save a unit is stored as is. The page always moves to a new slot, which
+ * only replaces the old one in the slot table once written, so the old slot is never overwritten
+ * while it is still the page's; it is freed afterwards.
+ *
+ * @return RC_OK on success, RC_WRITE_FAILED if the page cannot be written.
+ */
+static RC writeCompressedPage(SM_FileMgmt *file, int pageNum, const char *buf)
+{
+    SM_CompressedFile *c = file->comp;
+    SM_PageSlot old;
+    unsigned char *packed = (unsigned char *)malloc(file->pageSize);
+    const char *data = (const char *)packed;
+    long long start;
+    uint32_t unit, units;
+    int length, allocated, written;
+
+    if (packed == NULL)
+        return RC_WRITE_FAILED;
+    start = nowNanos();
+    length = lzCompress((const unsigned char *)buf, file->pageSize, packed, file->pageSize - SLOT_UNIT);
+    addCounter(&c->stats.compressNanos, nowNanos() - start);
+    if (length < 0)
+    {
+        length = file->pageSize;
+        data = buf;
+    }
+
+    units = unitsFor((uint32_t)length);
+    pthread_mutex_lock(&c->lock);
+    allocated = allocUnits(c, units, &unit) == 0;
+    pthread_mutex_unlock(&c->lock);
+    written = allocated && transferBytes(file->fd, slotOffset(unit), (char *)data, (size_t)length, 1) == 0;
+
+    pthread_mutex_lock(&c->lock);
+    if (written)
+    {
+        old = c->slots[pageNum];
+        c->slots[pageNum].unit = unit;
+        c->slots[pageNum].length = (uint32_t)length;
+        if (old.length > 0)
+            freeUnits(c, old.unit, unitsFor(old.length));
+    }
+    else if (allocated)
+        freeUnits(c, unit, units);
+    pthread_mutex_unlock(&c->lock);
+    free(packed);
+
+    if (!written)
+        return RC_WRITE_FAILED;
+    addCounter(&c->stats.pagesWritten, 1);
+    addCounter(&c->stats.bytesWritten, length);
+    return RC_OK;
+}
+
+
+/**
+ * @brief Reads exactly one page, from its offset in its segment (see transferRun) or, if the file is compressed, from its slot.
+ *
+ * @return RC_OK on success, RC_READ_NON_EXISTING_PAGE if the page cannot be read completely.
+ */
+static RC preadPage(SM_FileMgmt *file, int pageNum, char *buf)
+{
+    if (file->comp != NULL)
+        return readCompressedPage(file, pageNum, buf);
+    return transferRun(file, pageNum, &buf, 1, 0) == 0 ? RC_OK : RC_READ_NON_EXISTING_PAGE;
+}
+
+
+/**
+ * @brief Writes exactly one page, at its offset in its segment (see transferRun) or, if the file is compressed, to a slot.
+ *
+ * @return RC_OK on success, RC_WRITE_FAILED if the page cannot be written completely.
+ */
+static RC pwritePage(SM_FileMgmt *file, int pageNum, const char *buf)
+{
+    char *page = (char *)buf;
+
+    if (file->comp != NULL)
+        return writeCompressedPage(file, pageNum, buf);
+    return transferRun(file, pageNum, &page, 1, 1) == 0 ? RC_OK : RC_WRITE_FAILED;
+}
+
+
+/************************************************************
+ *                    free pages                            *
+ ************************************************************/
+
+/**
+ * @brief Tells whether a page is in the file's free-page map. Called with freeLock held.
+ */
+static inline int pageIsFree(SM_FileMgmt *file, int pageNum)
+{
+    return pageNum < file->freeCapacity && ((file->freeBits[pageNum / 64] >> (pageNum % 64)) & 1);
+}
+
+
+/**
+ * @brief Adds a page to the free-page map or takes it out. Called with freeLock held.
+ */
+static inline void setPageFree(SM_FileMgmt *file, int pageNum, int isFree)
+{
+    if (isFree)
+    {
+        file->freeBits[pageNum / 64] |= (uint64_t)1 << (pageNum % 64);
+        file->numFreePages++;
+    }
+    else
+    {
+        file->freeBits[pageNum / 64] &= ~((uint64_t)1 << (pageNum % 64));
+        file->numFreePages--;
+    }
+    file->freeChanged = 1;
+}
+
+
+/**
+ * @brief Makes the free-page map cover at least numPages pages, the new ones in use. Called with freeLock held.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int growFreeBits(SM_FileMgmt *file, int numPages)
+{
+    int words = (numPages + 63) / 64, oldWords = file->freeCapacity / 64;
+    uint64_t *grown;
+
+    if (numPages <= file->freeCapacity)
+        return 0;
+    if (words < 2 * oldWords)
+        words = 2 * oldWords;
+    grown = (uint64_t *)realloc(file->freeBits, (size_t)words * sizeof(uint64_t));
+    if (grown == NULL)
+        return -1;
+    memset(grown + oldWords, 0, (size_t)(words - oldWords) * sizeof(uint64_t));
+    file->freeBits = grown;
+    file->freeCapacity = words * 64;
+    return 0;
+}
+
+
+/**
+ * @brief Sets up an empty free-page map for a file being opened.
+ */
+static void initFreeMap(SM_FileMgmt *file)
+{
+    pthread_mutex_init(&file->freeLock, NULL);
+    file->freeBits = NULL;
+    file->freeCapacity = 0;
+    file->numFreePages = 0;
+    file->freeChanged = 0;
+    file->noPunch = 0;
+}
+
+
+/**
+ * @brief Releases a file's free-page map.
+ */
+static void freeFreeMap(SM_FileMgmt *file)
+{
+    pthread_mutex_destroy(&file->freeLock);
+    free(file->freeBits);
+    file->freeBits = NULL;
+}
+
+
+/**
+ * @brief Reads the runs of free pages listed in the header block into the free-page map.
+ *
+ * @return RC_OK, or RC_ERROR if the list is damaged or cannot be read.
+ */
+static RC loadFreeMap(SM_FileMgmt *file, const SM_FileHeader *header, int numPages)
+{
+    SM_PageRun runs[FREE_RUNS_MAX];
+    int i, p;
+
+    if (header->numFreeRuns == 0)
+        return RC_OK;
+    if (header->numFreeRuns < 0 || header->numFreeRuns > FREE_RUNS_MAX || file->dataOffset == 0
+        || transferBytes(file->fd, sizeof(SM_FileHeader), (char *)runs,
+                         (size_t)header->numFreeRuns * sizeof(SM_PageRun), 0) != 0)
+        return RC_ERROR;
+
+    for (i = 0; i < header->numFreeRuns; i++)
+    {
+        // A run outside the file, or overlapping another
+        if (runs[i].first < 0 || runs[i].count <= 0 || runs[i].first > numPages - runs[i].count
+            || growFreeBits(file, runs[i].first + runs[i].count) != 0)
+            return RC_ERROR;
+        for (p = runs[i].first; p < runs[i].first + runs[i].count; p++)
+        {
+            if (pageIsFree(file, p))
+                return RC_ERROR;
+            setPageFree(file, p, 1);
+        }
+    }
+    file->freeChanged = 0;
+    return RC_OK;
+}
+
+
+/**
+ * @brief Writes the header block: the header, followed by the runs of free pages.
+ *
+ * The block is aligned, so it can be written to a file open for direct I/O. At most
+ * FREE_RUNS_MAX runs fit; pages of runs beyond them stay zero, but are not listed as free
+ * when the file is opened again.
+ *
+ * @return 0 on success, -1 if the block cannot be written.
+ */
+static int writeHeaderBlock(SM_FileMgmt *file, SM_FileHeader *header)
+{
+    SM_PageRun *runs;
+    char *block;
+    int p, n = 0, rc;
+
+    if (posix_memalign((void **)&block, DIRECT_IO_ALIGN, FILE_HEADER_SIZE) != 0)
+        return -1;
+    memset(block, 0, FILE_HEADER_SIZE);
+    runs = (SM_PageRun *)(block + sizeof(SM_FileHeader));
+
+    pthread_mutex_lock(&file->freeLock);
+    for (p = 0; p < file->freeCapacity; p++)
+    {
+        if (!pageIsFree(file, p))
+            continue;
+        if (n > 0 && runs[n - 1].first + runs[n - 1].count == p)
+            runs[n - 1].count++;
+        else if (n < FREE_RUNS_MAX)
+        {
+            runs[n].first = p;
+            runs[n++].count = 1;
+        }
+    }
+    pthread_mutex_unlock(&file->freeLock);
+
+    header->numFreeRuns = n;
+    memcpy(block, header, sizeof(*header));
+    rc = transferBytes(file->fd, 0, block, FILE_HEADER_SIZE, 1);
+    free(block);
+    return rc;
+}
+
+
+/**
+ * @brief Drops the free pages at the end of the file from the free-page map, keeping at least one page.
+ *
+ * @return The number of pages left.
+ */
+static int trimFreePages(SM_FileMgmt *file, int numPages)
+{
+    pthread_mutex_lock(&file->freeLock);
+    while (numPages > 1 && pageIsFree(file, numPages - 1))
+        setPageFree(file, --numPages, 0);
+    pthread_mutex_unlock(&file->freeLock);
+    return numPages;
+}
+
+
+/**
+ * @brief Gives the disk space of a run of pages back to the file system, leaving a hole that reads as zeros.
+ *
+ * @return 0 on success, -1 if the file system cannot punch holes.
+ */
+static int punchPages(SM_FileMgmt *file, int firstPage, int numPages)
+{
+#if defined(FALLOC_FL_PUNCH_HOLE) && defined(FALLOC_FL_KEEP_SIZE)
+    return allocateRun(file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, firstPage, numPages);
+#else
+    return -1;
+#endif
+}
+
+
+/**
+ * @brief Empties a page that is being freed, so that it reads as zeros. Called with freeLock held.
+ *
+ * A compressed page's slot is freed. Otherwise, once every page of the page's aligned
+ * PUNCH_CHUNK_BYTES chunk is free, the chunk is punched out of the file; until then, or where
+ * holes cannot be punched, the page is overwritten with zeros.
+ *
+ * @return RC_OK, or RC_WRITE_FAILED if the page cannot be written.
+ */
+static RC clearPage(SM_FileMgmt *file, int numPages, int pageNum)
+{
+    SM_CompressedFile *c = file->comp;
+    int chunk = file->pageSize < PUNCH_CHUNK_BYTES ? PUNCH_CHUNK_BYTES / file->pageSize : 1;
+    int first = pageNum / chunk * chunk, p;
+    char *zeros;
+    RC rc;
+
+    if (c != NULL)
+    {
+        SM_PageSlot old;
+
+        pthread_mutex_lock(&c->lock);
+        old = c->slots[pageNum];
+        c->slots[pageNum].unit = 0;
+        c->slots[pageNum].length = 0;
+        if (old.length > 0)
+            freeUnits(c, old.unit, unitsFor(old.length));
+        pthread_mutex_unlock(&c->lock);
+        return RC_OK;
+    }
+
+    for (p = first; p < first + chunk && (p == pageNum || pageIsFree(file, p)); p++)
+        ;
+    if (p == first + chunk && first + chunk <= numPages && !file->noPunch)
+    {
+        if (punchPages(file, first, chunk) == 0)
+            return RC_OK;
+        file->noPunch = 1;
+    }
+
+    zeros = (char *)calloc(1, file->pageSize);
+    if (zeros == NULL)
+        return RC_WRITE_FAILED;
+    rc = pwritePage(file, pageNum, zeros);
+    free(zeros);
+    return rc;
+}
+
+
+/**
+ * @brief Makes sure the file has disk space reserved for at least numPages pages.
+ *
+ * Space is reserved in extents growing with the file, a quarter of its size between
+ * EXTENT_MIN_PAGES and EXTENT_MAX_PAGES, so a file grown page by page is reserved for only now and
+ * then and stays contiguous on disk. The reservation leaves the file size alone (it is beyond
+ * the end of the file), so the size still tells how many pages were written. Where the file
+ * system cannot reserve space, or on systems without fallocate, nothing is reserved and the
+ * pages take disk space when written.
+ *
+ * @return 0 on success, -1 if the disk is full.
+ */
+static int reserveExtent(SM_FileMgmt *file, int numPages)
+{
+    long long extent, target;
+
+    if (numPages <= file->allocatedPages)
+        return 0;
+
+    extent = file->allocatedPages / 4;
+    if (extent < EXTENT_MIN_PAGES)
+        extent = EXTENT_MIN_PAGES;
+    if (extent > EXTENT_MAX_PAGES)
+        extent = EXTENT_MAX_PAGES;
+    target = (long long)file->allocatedPages + extent;
+    if (target < numPages)
+        target = numPages;
+    if (target > INT32_MAX)
+        target = INT32_MAX;
+
+    // A segmented file is not reserved past the segment of its last page, since every segment
+    // file on disk counts as holding pages (see loadSpace)
+    if (file->space != NULL)
+    {
+        long long segmentEnd = ((long long)numPages + file->space->segmentPages - 1) / file->space->segmentPages
+                               * file->space->segmentPages;
+        if (target > segmentEnd)
+            target = segmentEnd;
+    }
+
+#ifdef FALLOC_FL_KEEP_SIZE
+    for (;;)
+    {
+        if (allocateRun(file, FALLOC_FL_KEEP_SIZE, file->allocatedPages, (int)target - file->allocatedPages) == 0)
+            break;
+        if (errno == ENOSPC && target > numPages)
+        {
+            // No room for a whole extent; settle for the pages asked for
+            target = numPages;
+            continue;
+        }
+        if (errno == ENOSPC || errno == EFBIG)
+            return -1;
+        break; // Reserving is not supported here
+    }
+#endif
+    file->allocatedPages = (int)target;
+    return 0;
+}
 
 
 void initStorageManager(void) {
@@ -11,37 +1892,203 @@ void initStorageManager(void) {
 }
 
 
-// Create a new page file fileName. The initial file size should be one page.
-//  This method should fill this single page with ’\0’ bytes.
-// Create a new page file with the specified file name (fName)
-RC createPageFile(char *fName) {
+/**
+ * @brief Creates a page file with the given page size and header flags, holding one empty page.
+ *
+ * A plain file gets the empty page written after the header block, and a segmented one after
+ * the space block listing its layout; a compressed one gets a slot table saying page 0 was
+ * never written, which reads as zeros just the same.
+ */
+static RC createFile(char *fName, int pageSize, int flags, const SM_SegmentLayout *layout) {
+    if (!validPageSize(pageSize))
+        return RC_INVALID_PAGE_SIZE;
+
+    // The space block of a segmented file: its segment size, then its directories
+    char space[FILE_HEADER_SIZE];
+    if (flags & FILE_FLAG_SEGMENTED) {
+        SM_SpaceHeader spaceHeader;
+        size_t used = sizeof(spaceHeader);
+        int i;
+
+        memset(space, 0, sizeof(space));
+        spaceHeader.segmentPages = layout->segmentPages > 0 ? layout->segmentPages : SEGMENT_DEFAULT_BYTES / pageSize;
+        spaceHeader.numDirs = layout->numDirs;
+        if (layout->segmentPages < 0 || layout->numDirs < 0 || (layout->numDirs > 0 && layout->dirs == NULL))
+            return RC_ERROR;
+        for (i = 0; i < layout->numDirs; i++) {
+            size_t length = layout->dirs[i] != NULL ? strlen(layout->dirs[i]) + 1 : 0;
+            if (length <= 1 || used + length > sizeof(space))
+                return RC_ERROR;
+            memcpy(space + used, layout->dirs[i], length);
+            used += length;
+        }
+        memcpy(space, &spaceHeader, sizeof(spaceHeader));
+    }
+
+    // Segments of a segmented file this one replaces would otherwise be taken for its pages
+    removeSegments(fName);
+
     FILE *newFile = fopen(fName, "w+"); // Open the file in binary write mode
 
     if (newFile == NULL)
         return RC_WRITE_FAILED; // Return an error code if the file cannot be opened
 
-    // Allocate memory for a single page filled with '\0' bytes
-    SM_PageHandle newEmptyPage = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
+    // Allocate memory for the header block followed by a single page filled with '\0' bytes,
+    // or by the empty slot of that page
+    size_t length = FILE_HEADER_SIZE + ((flags & FILE_FLAG_COMPRESSED) ? sizeof(SM_PageSlot) : (size_t)pageSize);
+    if (flags & FILE_FLAG_SEGMENTED)
+        length += FILE_HEADER_SIZE;
+    SM_PageHandle newEmptyPage = (SM_PageHandle)calloc(length, sizeof(char));
 
     if (newEmptyPage == NULL) {
         fclose(newFile); // Close the file if memory allocation fails
         return RC_WRITE_FAILED;
     }
+    SM_FileHeader header;
+    initHeader(&header, pageSize, flags);
+    if (flags & FILE_FLAG_COMPRESSED) {
+        header.numPages = 1;
+        header.mapOffset = FILE_HEADER_SIZE;
+    }
+    memcpy(newEmptyPage, &header, sizeof(header));
+    if (flags & FILE_FLAG_SEGMENTED)
+        memcpy(newEmptyPage + FILE_HEADER_SIZE, space, FILE_HEADER_SIZE);
 
-    // Write the empty page to the file
-    if (fwrite(newEmptyPage, sizeof(char), PAGE_SIZE, newFile) < PAGE_SIZE) {
+    // Write the header and the empty page to the file
+    if (fwrite(newEmptyPage, sizeof(char), length, newFile) < length) {
         free(newEmptyPage); // Free allocated memory
         fclose(newFile);    // Close the file if the write operation fails
         return RC_WRITE_FAILED;
     }
 
     // Update metadata in the file handle
-    fclose(newFile); 
+    if (fclose(newFile) != 0) {
+        free(newEmptyPage);
+        return RC_WRITE_FAILED;
+    }
     free(newEmptyPage);
     return RC_OK;
 }
 
 
+// Create a new page file fileName. The initial file size should be one page.
+//  This method should fill this single page with ’\0’ bytes.
+// Create a new page file with the specified file name (fName)
+RC createPageFile(char *fName) {
+    return createPageFileWithPageSize(fName, PAGE_SIZE);
+}
+
+
+/**
+ * @brief Creates a page file like createPageFile, with pages of the given size.
+ *
+ * The page size is kept in a header block at the start of the file, so openPageFile and
+ * readPageSize find it again. Bigger pages suit scans and B+ trees with a large fanout;
+ * 4 KB pages suit point lookups and updates.
+ *
+ * @param fName Name of the page file.
+ * @param pageSize Bytes per page, a power of two from MIN_PAGE_SIZE (4 KB) to MAX_PAGE_SIZE (64 KB).
+ *
+ * @return
+ *   - RC_OK: The file holds one empty page.
+ *   - RC_INVALID_PAGE_SIZE: The page size is not supported.
+ *   - RC_WRITE_FAILED: The file cannot be created or written.
+ */
+RC createPageFileWithPageSize(char *fName, int pageSize) {
+    return createFile(fName, pageSize, 0, NULL);
+}
+
+
+/**
+ * @brief Creates a page file like createPageFileWithPageSize whose pages are stored compressed.
+ *
+ * Reads and writes through readBlock and writeBlock are unchanged; underneath, each page is
+ * compressed with a built-in LZ77 codec and stored in a slot of whole SLOT_UNIT (512 byte)
+ * units, and a slot table kept in the file tells where each page is. Pages full of zero
+ * padding or repeated values, as record pages with DT_STRING fields are, shrink several times,
+ * so scans read fewer bytes and the file takes less disk; in exchange, every page read costs
+ * a decompression and every write a compression (see getPageFileCompressionStats).
+ *
+ * The slot table is written when the file is closed, so only one handle at a time may have a
+ * compressed file open, and an open compressed file can be neither mapped nor read around the
+ * page cache.
+ *
+ * @param fName Name of the page file.
+ * @param pageSize Bytes per page, a power of two from MIN_PAGE_SIZE (4 KB) to MAX_PAGE_SIZE (64 KB).
+ *
+ * @return
+ *   - RC_OK: The file holds one empty page.
+ *   - RC_INVALID_PAGE_SIZE: The page size is not supported.
+ *   - RC_WRITE_FAILED: The file cannot be created or written.
+ */
+RC createCompressedPageFile(char *fName, int pageSize) {
+    return createFile(fName, pageSize, FILE_FLAG_COMPRESSED, NULL);
+}
+
+
+/**
+ * @brief Creates a page file like createPageFileWithPageSize whose pages are spread over segment files, a tablespace.
+ *
+ * Page p is in segment p / segmentPages. The first segment is the page file itself; segment
+ * n > 0 is a file of its own, "<fName>.<n>" next to the page file or, if the layout lists
+ * directories, "<dir>/<base name of fName>.<n>" in each of them in turn, so that segments can
+ * be put on different mounts and their I/O spread over them. Relative directories are taken
+ * from the working directory of whoever opens the file. Segment files are created as the file
+ * grows into them and opened only when one of their pages is read or written; at most
+ * SEGMENT_FDS_MAX (16) are kept open at once, the one used longest ago being closed to make
+ * room (see getPageFileSegmentStats). No single file then grows past segmentPages pages, so the
+ * file system's largest file no longer limits how large the file can grow. destroyPageFile
+ * removes the segments along with the page file.
+ *
+ * Reads and writes through readBlock and writeBlock are unchanged. A segmented file can be read
+ * around the page cache, but not mapped, and asynchronous I/O on it always uses threads.
+ *
+ * @param fName Name of the page file.
+ * @param pageSize Bytes per page, a power of two from MIN_PAGE_SIZE (4 KB) to MAX_PAGE_SIZE (64 KB).
+ * @param layout Pages per segment (0 for SEGMENT_DEFAULT_BYTES, 1 GB, worth) and the directories
+ *        the segments go to; the directories must exist, and together fit in the 4 KB space block.
+ *
+ * @return
+ *   - RC_OK: The file holds one empty page.
+ *   - RC_INVALID_PAGE_SIZE: The page size is not supported.
+ *   - RC_WRITE_FAILED: The file cannot be created or written.
+ *   - RC_ERROR: The layout is invalid, or its directories do not fit.
+ */
+RC createSegmentedPageFile(char *fName, int pageSize, const SM_SegmentLayout *layout) {
+    if (layout == NULL)
+        return RC_ERROR;
+    return createFile(fName, pageSize, FILE_FLAG_SEGMENTED, layout);
+}
+
+
+
+/**
+ * @brief Reads the page size of a page file without opening it for page I/O.
+ *
+ * @param fName Name of the page file.
+ * @param pageSize Set to the file's bytes per page.
+ *
+ * @return
+ *   - RC_OK: pageSize is set; PAGE_SIZE for a file written without header.
+ *   - RC_FILE_NOT_FOUND: The file does not exist or cannot be read.
+ *   - RC_INVALID_PAGE_SIZE: The header holds a page size that is not supported.
+ */
+RC readPageSize(char *fName, int *pageSize) {
+    SM_FileHeader header;
+    off_t dataOffset;
+    RC rc;
+    int fd = open(fName, O_RDONLY);
+
+    if (fd < 0)
+        return RC_FILE_NOT_FOUND;
+    rc = readHeader(fd, &header, &dataOffset);
+    close(fd);
+    if (rc == RC_OK)
+        *pageSize = header.pageSize;
+    return rc;
+}
+
+
 
 // Open the file with the given fileName in binary read/write mode
 // – Opens an existing page file. Should return RC FILE NOT FOUND if the file does not exist.
@@ -50,27 +2097,334 @@ RC createPageFile(char *fName) {
 // about the opened file. For instance, you would have to read the total number of pages that are stored
 // in the file from disk.
 RC openPageFile(char *fName, SM_FileHandle *fileHandle) {
-    FILE *file = fopen(fName, "rb+");
+    return openPageFileMode(fName, fileHandle, SM_FILE_BUFFERED);
+}
+
+
+/**
+ * @brief Opens an existing page file like openPageFile, choosing whether its pages go through the OS page cache.
+ *
+ * With SM_FILE_DIRECT, page reads and writes bypass the page cache (O_DIRECT), so a page cached
+ * in a buffer pool frame is not cached a second time by the kernel. Direct I/O needs buffers
+ * aligned to DIRECT_IO_ALIGN; buffer pool frames are, and other buffers are copied through an
+ * aligned one. Where the file system does not allow direct I/O, the file is opened buffered
+ * instead; getPageFileMode tells which mode is in use.
+ *
+ * With SM_FILE_MAPPED, the file is opened read only and mapped into memory, so getMappedPage
+ * can hand out pointers straight into the file's pages without copying them. Writing to the
+ * file or growing it through the handle then fails, and pages others append later are not seen.
+ *
+ * A compressed file (see createCompressedPageFile) is always buffered, and cannot be mapped;
+ * neither can a segmented one (see createSegmentedPageFile), whose segment files are opened
+ * as their pages are first read or written.
+ *
+ * @param fName Name of the page file.
+ * @param fileHandle The handle to initialize.
+ * @param mode SM_FILE_BUFFERED, SM_FILE_DIRECT or SM_FILE_MAPPED.
+ *
+ * @return
+ *   - RC_OK: The file is open; fileHandle->pageSize tells its page size.
+ *   - RC_FILE_NOT_FOUND: The file does not exist, or cannot be opened or mapped.
+ *   - RC_INVALID_PAGE_SIZE: The file's header holds a page size that is not supported.
+ *   - RC_ERROR: The file is compressed or segmented and SM_FILE_MAPPED was asked for, or its slot
+ *     table or space block is damaged.
+ */
+RC openPageFileMode(char *fName, SM_FileHandle *fileHandle, SM_FileMode mode) {
+    int fd = open(fName, mode == SM_FILE_MAPPED ? O_RDONLY : O_RDWR);
+
+    if (fd < 0) {
+        // Return FILE NOT FOUND if the specified file doesn't exist
+        return RC_FILE_NOT_FOUND; 
+    }
+
+    // Calculate the total number of pages in the file from its size
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        close(fd);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    SM_FileMgmt *file = (SM_FileMgmt *)malloc(sizeof(SM_FileMgmt));
+    if (file == NULL) {
+        close(fd);
+        return RC_FILE_NOT_FOUND;
+    }
+    SM_FileHeader header;
+    RC rc = readHeader(fd, &header, &file->dataOffset);
+    file->fd = fd;
+    file->pageSize = header.pageSize;
+    file->comp = NULL;
+    file->space = NULL;
+    file->direct = 0;
+    initFreeMap(file);
+    if (rc == RC_OK && (header.flags & FILE_FLAG_COMPRESSED))
+        rc = mode == SM_FILE_MAPPED ? RC_ERROR : loadSlots(file, &header);
+    int numPages = file->comp != NULL ? (int)header.numPages : pagesInFile(file, fileStat.st_size);
+    if (rc == RC_OK && (header.flags & FILE_FLAG_SEGMENTED))
+        rc = mode == SM_FILE_MAPPED ? RC_ERROR : loadSpace(file, fName, &numPages);
+    if (rc == RC_OK)
+        rc = loadFreeMap(file, &header, numPages);
+    if (rc != RC_OK) {
+        if (file->comp != NULL)
+            freeCompressedFile(file->comp);
+        if (file->space != NULL)
+            freeSpace(file->space);
+        freeFreeMap(file);
+        free(file);
+        close(fd);
+        return rc;
+    }
+
+    fileHandle->pageSize = file->pageSize;
+    fileHandle->totalNumPages = numPages;
+
+    file->allocatedPages = fileHandle->totalNumPages;
+    file->mapped = 0;
+    file->map = NULL;
+    file->mapLength = 0;
+
+    // Initialize other fields of fileHandle
+    fileHandle->fileName = fName;
+    fileHandle->curPagePos = 0;
+    fileHandle->mgmtInfo = file;
+    if (mode != SM_FILE_MAPPED)
+        return setPageFileMode(fileHandle, mode);
+
+    // Map the whole file; it can neither grow nor be written through this handle
+    file->mapped = 1;
+    file->mapLength = fileHandle->totalNumPages > 0 ? (size_t)pageOffset(file, fileHandle->totalNumPages) : 0;
+    if (file->mapLength > 0)
+    {
+        void *map = mmap(NULL, file->mapLength, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            close(fd);
+            freeFreeMap(file);
+            free(file);
+            fileHandle->mgmtInfo = NULL;
+            return RC_FILE_NOT_FOUND;
+        }
+        file->map = (char *)map;
+    }
+    return RC_OK;
+}
+
+
+/**
+ * @brief Switches an open page file between buffered and direct page I/O (see openPageFileMode).
+ *
+ * Falls back to buffered I/O where the file system does not allow direct I/O, and for compressed
+ * files, whose slots are not aligned for it. Reads and writes already under way finish in the
+ * mode they started in.
+ *
+ * @param fileHandle The open page file.
+ * @param mode SM_FILE_BUFFERED or SM_FILE_DIRECT.
+ *
+ * @return
+ *   - RC_OK: The file is in the requested mode, or buffered if direct I/O is not allowed.
+ *   - RC_FILE_HANDLE_NOT_INIT: The file handle is not open.
+ *   - RC_ERROR: The file is or would have to be mapped, which only openPageFileMode does.
+ */
+RC setPageFileMode(SM_FileHandle *fileHandle, SM_FileMode mode) {
+    SM_FileMgmt *file;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    file = fileMgmt(fileHandle);
+    if (file->mapped || mode == SM_FILE_MAPPED)
+        return RC_ERROR;
+
+    if (mode == SM_FILE_DIRECT && file->comp == NULL && setDirectFlag(file->fd, 1) == 0) {
+        __atomic_store_n(&file->direct, 1, __ATOMIC_RELEASE);
+
+        // Segment files opened later are opened for direct I/O as well (see openSegment); one on a
+        // file system without direct I/O simply stays buffered
+        if (file->space != NULL) {
+            int i;
+            pthread_mutex_lock(&file->space->lock);
+            for (i = 1; i < file->space->numSegments; i++) {
+                if (file->space->segs[i].fd >= 0)
+                    setDirectFlag(file->space->segs[i].fd, 1);
+            }
+            pthread_mutex_unlock(&file->space->lock);
+        }
+    }
+    else if (isDirect(file))
+        dropDirect(file);
+    return RC_OK;
+}
+
+
+/**
+ * @brief Returns whether an open page file is mapped, or else whether its pages currently bypass the page cache.
+ *
+ * @return SM_FILE_MAPPED, SM_FILE_DIRECT or SM_FILE_BUFFERED; SM_FILE_BUFFERED for a handle that is not open.
+ */
+SM_FileMode getPageFileMode(SM_FileHandle *fileHandle) {
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return SM_FILE_BUFFERED;
+    if (fileMgmt(fileHandle)->mapped)
+        return SM_FILE_MAPPED;
+    return isDirect(fileMgmt(fileHandle)) ? SM_FILE_DIRECT : SM_FILE_BUFFERED;
+}
+
+
+/**
+ * @brief Returns a page of a file opened with SM_FILE_MAPPED, in place in the mapping.
+ *
+ * The page is read only: writing to it crashes the process. It stays valid until the file is
+ * closed. The first access to a page that is not in the page cache yet reads it in.
+ *
+ * @param fileHandle A file opened with SM_FILE_MAPPED.
+ * @param pageNum The page.
+ *
+ * @return The page's contents, or NULL if the file is not mapped or has no such page.
+ */
+SM_PageHandle getMappedPage(SM_FileHandle *fileHandle, int pageNum) {
+    SM_FileMgmt *file;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return NULL;
+    file = fileMgmt(fileHandle);
+    if (file->map == NULL || pageNum < 0 || pageNum >= fileHandle->totalNumPages)
+        return NULL;
+    return file->map + pageOffset(file, pageNum);
+}
+
+
+/**
+ * @brief Tells the OS how a range of a file's pages is going to be read.
+ *
+ * Mapped files get madvise, others posix_fadvise, so that the kernel reads ahead further for
+ * sequential access, not at all for random access, or starts reading pages that will be needed
+ * soon. The advice is only a hint; systems that do not take it ignore it, and so do compressed
+ * files, whose pages are not stored in page order.
+ *
+ * @param fileHandle The open page file.
+ * @param firstPageNum First page of the range.
+ * @param numPages Number of pages in the range, or 0 for every page from firstPageNum on.
+ * @param advice One of the SM_ADVICE_ values.
+ *
+ * @return RC_OK, RC_FILE_HANDLE_NOT_INIT if the handle is not open, or RC_READ_NON_EXISTING_PAGE
+ *         for a negative page or count.
+ */
+RC adviseAccess(SM_FileHandle *fileHandle, int firstPageNum, int numPages, SM_AccessAdvice advice) {
+    SM_FileMgmt *file;
+    int lastPage;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (firstPageNum < 0 || numPages < 0)
+        return RC_READ_NON_EXISTING_PAGE;
+    file = fileMgmt(fileHandle);
+    if (file->comp != NULL)
+        return RC_OK;
+
+    lastPage = knownPages(fileHandle);
+    if (numPages > 0 && numPages < lastPage - firstPageNum)
+        lastPage = firstPageNum + numPages;
+    if (firstPageNum >= lastPage)
+        return RC_OK;
+
+    if (file->map != NULL)
+    {
+#ifdef MADV_SEQUENTIAL
+        static const int madvice[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED };
+        // madvise wants the start aligned to the system's page, which may be larger than ours
+        size_t sysPage = (size_t)sysconf(_SC_PAGESIZE);
+        size_t start = (size_t)pageOffset(file, firstPageNum) / sysPage * sysPage;
+
+        madvise(file->map + start, (size_t)pageOffset(file, lastPage) - start, madvice[advice]);
+#endif
+    }
+    else
+    {
+#ifdef POSIX_FADV_SEQUENTIAL
+        static const int fadvice[] = { POSIX_FADV_NORMAL, POSIX_FADV_SEQUENTIAL, POSIX_FADV_RANDOM, POSIX_FADV_WILLNEED };
+        SM_PageSpan span;
+
+        // Each segment of a segmented file gets the advice for its part of the range
+        while (firstPageNum < lastPage && openSpan(file, firstPageNum, lastPage - firstPageNum, &span) == 0)
+        {
+            posix_fadvise(span.fd, span.offset, (off_t)span.numPages * file->pageSize, fadvice[advice]);
+            closeSpan(file, &span);
+            firstPageNum += span.numPages;
+        }
+#endif
+    }
+    return RC_OK;
+}
+
+
+
+/**
+ * @brief Retrieves the compression counters of an open page file (see createCompressedPageFile).
+ *
+ * Comparing pagesRead * pageSize with bytesRead tells how much less a scan reads from disk, and
+ * decompressNanos / pagesRead what that costs per page.
+ *
+ * @param fileHandle The open page file.
+ * @param stats Filled with the counters since the file was opened; all 0 if it is not compressed.
+ *
+ * @return RC_OK, or RC_FILE_HANDLE_NOT_INIT if the handle is not open.
+ */
+RC getPageFileCompressionStats(SM_FileHandle *fileHandle, SM_CompressionStats *stats) {
+    SM_CompressedFile *c;
+    int i;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    memset(stats, 0, sizeof(*stats));
+    c = fileMgmt(fileHandle)->comp;
+    if (c == NULL)
+        return RC_OK;
 
-    if (file == NULL) {
-        // Return FILE NOT FOUND if the specified file doesn't exist
-        return RC_FILE_NOT_FOUND; 
-    }
+    stats->compressed = 1;
+    stats->pagesWritten = __atomic_load_n(&c->stats.pagesWritten, __ATOMIC_RELAXED);
+    stats->bytesWritten = __atomic_load_n(&c->stats.bytesWritten, __ATOMIC_RELAXED);
+    stats->pagesRead = __atomic_load_n(&c->stats.pagesRead, __ATOMIC_RELAXED);
+    stats->bytesRead = __atomic_load_n(&c->stats.bytesRead, __ATOMIC_RELAXED);
+    stats->compressNanos = __atomic_load_n(&c->stats.compressNanos, __ATOMIC_RELAXED);
+    stats->decompressNanos = __atomic_load_n(&c->stats.decompressNanos, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&c->lock);
+    stats->slotBytes = (long long)c->dataEnd * SLOT_UNIT;
+    for (i = 0; i < c->numFree; i++)
+        stats->freeBytes += (long long)c->free[i].count * SLOT_UNIT;
+    pthread_mutex_unlock(&c->lock);
+    return RC_OK;
+}
 
-    // Calculate the total number of pages in the file
-    // Move the file position to the end
-    fseek(file, 0, SEEK_END); 
 
-    fileHandle->totalNumPages = ftell(file) / PAGE_SIZE;
-    printf("Debug: total number of pages - %d \n", fileHandle->totalNumPages);
 
-    // Reset the file position to the beginning
-    fseek(file, 0, SEEK_SET);
+/**
+ * @brief Retrieves the segment counters of an open page file (see createSegmentedPageFile).
+ *
+ * segmentOpens against numSegments tells how often segments had to be opened again after their
+ * descriptor was closed to stay within SEGMENT_FDS_MAX.
+ *
+ * @param fileHandle The open page file.
+ * @param stats Filled with the counters since the file was opened; all 0 if it is not segmented.
+ *
+ * @return RC_OK, or RC_FILE_HANDLE_NOT_INIT if the handle is not open.
+ */
+RC getPageFileSegmentStats(SM_FileHandle *fileHandle, SM_SegmentStats *stats) {
+    SM_Tablespace *s;
 
-    // Initialize other fields of fileHandle
-    fileHandle->fileName = fName;
-    fileHandle->curPagePos = 0;
-    fileHandle->mgmtInfo = file;
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    memset(stats, 0, sizeof(*stats));
+    s = fileMgmt(fileHandle)->space;
+    if (s == NULL)
+        return RC_OK;
+
+    pthread_mutex_lock(&s->lock);
+    stats->segmented = 1;
+    stats->segmentPages = s->segmentPages;
+    stats->numSegments = s->numSegments;
+    stats->openSegments = s->openFds + 1;
+    stats->segmentOpens = s->opens;
+    pthread_mutex_unlock(&s->lock);
     return RC_OK;
 }
 
@@ -82,12 +2436,50 @@ RC closePageFile(SM_FileHandle *fileHandle) {
     if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
 
-    
-    FILE *file = (FILE *)fileHandle->mgmtInfo;
-    fclose(file); // Close the file
+    // Free pages at the end of the file are cut off. Pages added but never written are not in the
+    // file yet; extend it to hold them, so that they are there when the file is opened again. A
+    // compressed file keeps them in its slot table, and a segmented file has each segment sized
+    // this way (see closeSegments)
+    SM_FileMgmt *file = fileMgmt(fileHandle);
+    RC rc = RC_OK;
+    struct stat fileStat;
+    int numPages = file->mapped ? fileHandle->totalNumPages : trimFreePages(file, fileHandle->totalNumPages);
+    if (file->comp != NULL) {
+        if (saveSlots(file, numPages) != 0)
+            rc = RC_WRITE_FAILED;
+    }
+    else if (file->space != NULL) {
+        if (closeSegments(file, numPages, fileHandle->totalNumPages) != 0)
+            rc = RC_WRITE_FAILED;
+    }
+    else if (!file->mapped) {
+        if (fstat(file->fd, &fileStat) == 0
+            && (fileStat.st_size < pageOffset(file, numPages)
+                || (numPages < fileHandle->totalNumPages && fileStat.st_size <= pageOffset(file, fileHandle->totalNumPages)))
+            && ftruncate(file->fd, pageOffset(file, numPages)) != 0)
+            rc = RC_WRITE_FAILED;
+    }
+
+    // List the free pages in the header block if they changed
+    if (file->comp == NULL && !file->mapped) {
+        SM_FileHeader header;
+        initHeader(&header, file->pageSize, file->space != NULL ? FILE_FLAG_SEGMENTED : 0);
+        if (file->freeChanged && writeHeaderBlock(file, &header) != 0)
+            rc = RC_WRITE_FAILED;
+    }
+    if (file->comp != NULL)
+        freeCompressedFile(file->comp);
+    if (file->space != NULL)
+        freeSpace(file->space);
+    if (file->map != NULL)
+        munmap(file->map, file->mapLength);
+    freeFreeMap(file);
+
+    close(fileDescriptor(fileHandle)); // Close the file
+    free(fileHandle->mgmtInfo);
     fileHandle->mgmtInfo = NULL; // Set the management info to NULL to indicate it's closed
 
-    return RC_OK;
+    return rc;
 }
 
 
@@ -102,6 +2494,9 @@ extern RC destroyPageFile(char *targetFileName) {
     
     // Close the file stream
     fclose(fileStream);
+
+    // A segmented file's other segments go first
+    removeSegments(targetFileName);
     
     // Delete the given file to make it inaccessible.
     if (remove(targetFileName) != 0)
@@ -116,7 +2511,8 @@ extern RC destroyPageFile(char *targetFileName) {
  * @brief Reads a specified block (page) from the file associated with the given file handle.
  *
  * This function reads the content of the specified page into the provided memory page buffer.
- * The file handle's current page position is updated accordingly.
+ * The read is positional (pread): it neither moves the descriptor's file offset nor the handle's
+ * current page position, so several threads may read pages of the same file concurrently.
  *
  * @param pageNumber Page number to be read.
  * @param fileHandle Pointer to the file handle structure.
@@ -129,30 +2525,75 @@ extern RC destroyPageFile(char *targetFileName) {
 RC readBlock(int pageNumber, SM_FileHandle *fileHandle, SM_PageHandle memPage) {
     
     // Check for a valid file handle, page number, and page buffer
-    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL || pageNumber < 0 || pageNumber >= fileHandle->totalNumPages || memPage == NULL)
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL || pageNumber < 0 || pageNumber >= knownPages(fileHandle) || memPage == NULL)
         return RC_READ_NON_EXISTING_PAGE; // Invalid handle, page number, or page buffer
 
-    // Retrieve the FILE pointer from the management information
-    FILE *file = (FILE *)fileHandle->mgmtInfo;
+    // A mapped file's page is copied out of the mapping, without a system call
+    if (fileMgmt(fileHandle)->map != NULL) {
+        memcpy(memPage, getMappedPage(fileHandle, pageNumber), fileHandle->pageSize);
+        return RC_OK;
+    }
+
+    // Read a page of data into memPage at the page's byte offset
+    return preadPage(fileMgmt(fileHandle), pageNumber, memPage);
+}
+
 
-    // Calculate the file position to read from
-    long position = (long)pageNumber * PAGE_SIZE;
+/**
+ * @brief Reads consecutive pages of the file into separate buffers, with one system call per VECTOR_MAX_PAGES pages.
+ *
+ * Like readBlock, the read is positional and leaves the handle's current page position alone.
+ * Reading a run of pages this way costs one preadv instead of a pread per page; the pages of a
+ * compressed file are read one by one.
+ *
+ * @param firstPageNum First page to read.
+ * @param numPages Number of pages to read.
+ * @param fileHandle Pointer to the file handle structure.
+ * @param memPages One buffer per page, memPages[i] receiving page firstPageNum + i.
+ *
+ * @return
+ *   - RC_OK: Successful read operation.
+ *   - RC_READ_NON_EXISTING_PAGE: Invalid handle, a page outside the file, a missing buffer, or a failed read.
+ */
+RC readBlocks(int firstPageNum, int numPages, SM_FileHandle *fileHandle, SM_PageHandle *memPages) {
+    int i;
 
-    // Seek to the desired file position
-    if (fseek(file, position, SEEK_SET) != 0)
-        return RC_READ_NON_EXISTING_PAGE; // Failed to move to the desired position
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL || memPages == NULL || firstPageNum < 0 || numPages < 0
+        || firstPageNum > knownPages(fileHandle) - numPages)
+        return RC_READ_NON_EXISTING_PAGE;
+    for (i = 0; i < numPages; i++)
+    {
+        if (memPages[i] == NULL)
+            return RC_READ_NON_EXISTING_PAGE;
+    }
 
-    // Read a page of data into memPage
-    size_t bytesRead = fread(memPage, sizeof(char), PAGE_SIZE, file);
+    // A compressed file's pages each have a slot of their own
+    if (fileMgmt(fileHandle)->comp != NULL) {
+        for (i = 0; i < numPages; i++) {
+            RC rc = preadPage(fileMgmt(fileHandle), firstPageNum + i, memPages[i]);
+            if (rc != RC_OK)
+                return rc;
+        }
+        return RC_OK;
+    }
 
-    // Check for a partial or failed read
-    if (bytesRead != PAGE_SIZE)
+    if (transferRun(fileMgmt(fileHandle), firstPageNum, memPages, numPages, 0) != 0)
         return RC_READ_NON_EXISTING_PAGE;
+    return RC_OK;
+}
 
-    // Update the current page position in the file handle
-    fileHandle->curPagePos = pageNumber;
 
-    return RC_OK; // Successful read operation
+/**
+ * @brief Reads a block through readBlock and, on success, makes it the handle's current page.
+ *
+ * Shared by the relative read functions, which are the only callers that move curPagePos.
+ */
+static RC readBlockAndSeek(int pageNumber, SM_FileHandle *fileHandle, SM_PageHandle memPage) {
+    RC rc = readBlock(pageNumber, fileHandle, memPage);
+
+    if (rc == RC_OK)
+        fileHandle->curPagePos = pageNumber;
+    return rc;
 }
 
 /**
@@ -184,7 +2625,7 @@ int getBlockPos(SM_FileHandle *fileHandle) {
 
 RC readFirstBlock(SM_FileHandle *fileHandle, SM_PageHandle memoryPage) {
     // Use readBlock to read the first block (block 0)
-    return readBlock(0, fileHandle, memoryPage);
+    return readBlockAndSeek(0, fileHandle, memoryPage);
 }
 
 
@@ -202,7 +2643,7 @@ RC readFirstBlock(SM_FileHandle *fileHandle, SM_PageHandle memoryPage) {
  *   - RC_READ_NON_EXISTING_PAGE: Invalid handle, page number, or failed read operation.
  */
 RC readPreviousBlock(SM_FileHandle *fileHandle, SM_PageHandle memoryPage) {
-    return readBlock(fileHandle->curPagePos - 1, fileHandle, memoryPage);
+    return readBlockAndSeek(fileHandle->curPagePos - 1, fileHandle, memoryPage);
 }
 
 /**
@@ -219,7 +2660,7 @@ RC readPreviousBlock(SM_FileHandle *fileHandle, SM_PageHandle memoryPage) {
  *   - RC_READ_NON_EXISTING_PAGE: Invalid handle, page number, or failed read operation.
  */
 RC readCurrentBlock(SM_FileHandle *fileHandle, SM_PageHandle memoryPage) {
-    return readBlock(fileHandle->curPagePos, fileHandle, memoryPage);
+    return readBlockAndSeek(fileHandle->curPagePos, fileHandle, memoryPage);
 }
 
 /**
@@ -236,7 +2677,7 @@ RC readCurrentBlock(SM_FileHandle *fileHandle, SM_PageHandle memoryPage) {
  *   - RC_READ_NON_EXISTING_PAGE: Invalid handle, page number, or failed read operation.
  */
 RC readNextBlock(SM_FileHandle* fileHandle, SM_PageHandle memoryPage) {
-    return readBlock(fileHandle->curPagePos+1, fileHandle, memoryPage);
+    return readBlockAndSeek(fileHandle->curPagePos+1, fileHandle, memoryPage);
 }
 
 /**
@@ -253,11 +2694,27 @@ RC readNextBlock(SM_FileHandle* fileHandle, SM_PageHandle memoryPage) {
  *   - RC_READ_NON_EXISTING_PAGE: Invalid handle, page number, or failed read operation.
  */
 RC readLastBlock(SM_FileHandle* fileHandle, SM_PageHandle memoryPage) {
-    return readBlock(fileHandle->totalNumPages - 1, fileHandle, memoryPage);
+    return readBlockAndSeek(fileHandle->totalNumPages - 1, fileHandle, memoryPage);
 }
 
 
- 
+/**
+ * @brief Writes a page to the given block of the file associated with the given file handle.
+ *
+ * The write is positional (pwrite) and unbuffered: it neither moves the descriptor's file offset
+ * nor the handle's current page position, so several threads may write pages of the same file
+ * concurrently.
+ *
+ * @param targetPageNum Page number to be written.
+ * @param fileHandle Pointer to the file handle structure.
+ * @param sourceMemPage Pointer to the memory page holding the data to write.
+ *
+ * @return
+ *   - RC_OK: Successful write operation.
+ *   - RC_FILE_HANDLE_NOT_INIT: File handle not initialized.
+ *   - RC_READ_NON_EXISTING_PAGE: The page is beyond the end of the file.
+ *   - RC_WRITE_FAILED: The page could not be written completely.
+ */
 RC writeBlock(int targetPageNum, SM_FileHandle *fileHandle, SM_PageHandle sourceMemPage) {
     
     if (fileHandle->mgmtInfo == NULL) {
@@ -265,34 +2722,64 @@ RC writeBlock(int targetPageNum, SM_FileHandle *fileHandle, SM_PageHandle source
     }
 
     // Check if the given targetPageNum is within the valid range
-    if (targetPageNum < 0 || targetPageNum >= fileHandle->totalNumPages) {
+    if (targetPageNum < 0 || targetPageNum >= knownPages(fileHandle)) {
         return RC_READ_NON_EXISTING_PAGE;
     }
 
-    // Calculate the byte offset to the desired page
-    long byteOffset = (long)targetPageNum * PAGE_SIZE;
+    // Write the content of sourceMemPage at the page's byte offset
+    return pwritePage(fileMgmt(fileHandle), targetPageNum, sourceMemPage);
+}
 
-    // Move the file pointer to the calculated byte offset
-    if (fseek(fileHandle->mgmtInfo, byteOffset, SEEK_SET) != 0) {
-        return RC_WRITE_FAILED;
-    }
 
-    // Write the content of sourceMemPage to the file
-    size_t bytesWritten = fwrite(sourceMemPage, sizeof(char), PAGE_SIZE, fileHandle->mgmtInfo);
 
-    // Check if the write operation was successful
-    if (bytesWritten != PAGE_SIZE) {
-        return RC_WRITE_FAILED;
+/**
+ * @brief Writes separate buffers to consecutive pages of the file, with one system call per VECTOR_MAX_PAGES pages.
+ *
+ * Like writeBlock, the write is positional and leaves the handle's current page position alone.
+ * Writing back a run of adjacent pages this way costs one pwritev instead of a pwrite per page;
+ * the pages of a compressed file are written one by one.
+ *
+ * @param firstPageNum First page to write.
+ * @param numPages Number of pages to write.
+ * @param fileHandle Pointer to the file handle structure.
+ * @param memPages One buffer per page, memPages[i] holding page firstPageNum + i.
+ *
+ * @return
+ *   - RC_OK: Successful write operation.
+ *   - RC_FILE_HANDLE_NOT_INIT: File handle not initialized.
+ *   - RC_READ_NON_EXISTING_PAGE: A page is beyond the end of the file or a buffer is missing.
+ *   - RC_WRITE_FAILED: The pages could not be written completely.
+ */
+RC writeBlocks(int firstPageNum, int numPages, SM_FileHandle *fileHandle, SM_PageHandle *memPages) {
+    int i;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL) {
+        return RC_FILE_HANDLE_NOT_INIT;
+    }
+    if (memPages == NULL || firstPageNum < 0 || numPages < 0 || firstPageNum > knownPages(fileHandle) - numPages) {
+        return RC_READ_NON_EXISTING_PAGE;
+    }
+    for (i = 0; i < numPages; i++) {
+        if (memPages[i] == NULL)
+            return RC_READ_NON_EXISTING_PAGE;
     }
 
-    // Update the current page position in the file handle
-    fileHandle->curPagePos = targetPageNum;
+    // A compressed file's pages each have a slot of their own
+    if (fileMgmt(fileHandle)->comp != NULL) {
+        for (i = 0; i < numPages; i++) {
+            RC rc = pwritePage(fileMgmt(fileHandle), firstPageNum + i, memPages[i]);
+            if (rc != RC_OK)
+                return rc;
+        }
+        return RC_OK;
+    }
 
+    if (transferRun(fileMgmt(fileHandle), firstPageNum, memPages, numPages, 1) != 0)
+        return RC_WRITE_FAILED;
     return RC_OK;
 }
 
 
-
 /**
  * @brief Writes the content of the current page to the file.
  *
@@ -313,17 +2800,10 @@ RC writeCurrentBlock(SM_FileHandle *fileHandle, SM_PageHandle Page) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
 
-    // Calculate the byte offset to the current page
-    long byteOffset = (long)fileHandle->curPagePos * PAGE_SIZE;
-
-    // Move the file pointer to the calculated byte offset
-    if (fseek(fileHandle->mgmtInfo, byteOffset, SEEK_SET) != 0) {
-        return RC_WRITE_FAILED;
-    }
-
-    // Write one page (block) of data from Page to the file
-    if (fwrite(Page, sizeof(char), PAGE_SIZE, fileHandle->mgmtInfo) != PAGE_SIZE) {
-        return RC_WRITE_FAILED;
+    // Write one page (block) of data from Page to the current page
+    RC rc = writeBlock(fileHandle->curPagePos, fileHandle, Page);
+    if (rc != RC_OK) {
+        return rc;
     }
 
     // Update the current page position
@@ -337,15 +2817,16 @@ RC writeCurrentBlock(SM_FileHandle *fileHandle, SM_PageHandle Page) {
 /**
  * @brief Appends an empty block (page) to the end of the file.
  *
- * This function appends an empty block to the file associated with the given file handle.
- * The file handle's total number of pages and current page position are updated accordingly.
+ * This function appends an empty block to the file associated with the given file handle
+ * through ensureCapacity, so the page costs no write (see there). The file handle's total
+ * number of pages and current page position are updated accordingly.
  *
  * @param fileHandle Pointer to the file handle structure.
  *
  * @return
  *   - RC_OK: Successful operation.
  *   - RC_FILE_HANDLE_NOT_INIT: File handle not initialized or file not open for writing.
- *   - RC_WRITE_FAILED: Failed to allocate memory or encountered an issue during the write operation.
+ *   - RC_WRITE_FAILED: The disk is full.
  */
 RC appendEmptyBlock(SM_FileHandle *fileHandle) {
     // Check if the file is open for writing
@@ -353,33 +2834,14 @@ RC appendEmptyBlock(SM_FileHandle *fileHandle) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
 
-    // Calculate the byte offset to the end of the file
-    long byte_offset = (long)(fileHandle->totalNumPages) * PAGE_SIZE;
-
-    // Move the file pointer to the calculated byte offset
-    if (fseek(fileHandle->mgmtInfo, byte_offset, SEEK_SET) != 0) {
-        return RC_WRITE_FAILED;
-    }
-
-    // Create an empty page filled with '\0' bytes
-    SM_PageHandle empty_block = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-    if (empty_block == NULL) {
-        return RC_WRITE_FAILED;
-    }
-
-    // Write the empty page to the file
-    if (fwrite(empty_block, sizeof(char), PAGE_SIZE, fileHandle->mgmtInfo) != PAGE_SIZE) {
-        free(empty_block);
-        return RC_WRITE_FAILED;
+    RC rc = ensureCapacity(fileHandle->totalNumPages + 1, fileHandle);
+    if (rc != RC_OK) {
+        return rc;
     }
 
-    // Update the total number of pages and current page position
-    fileHandle->totalNumPages++;
+    // Update the current page position
     fileHandle->curPagePos = fileHandle->totalNumPages - 1;
 
-    // Free allocated memory
-    free(empty_block);
-
     return RC_OK;
 }
 
@@ -392,13 +2854,19 @@ RC appendEmptyBlock(SM_FileHandle *fileHandle) {
  * has at least the specified number of pages. If the current capacity is sufficient,
  * no action is taken.
  *
+ * The new pages are not written: the handle's page count grows at once, while the file itself
+ * grows as pages are written, and to the full count when the handle is closed. Until then a
+ * page past the end of the file reads as zeros. Disk space is reserved in extents growing with
+ * the file (see reserveExtent), so adding pages one at a time, as inserts do, costs system
+ * calls only once per extent.
+ *
  * @param requiredPages The target number of pages needed in the file.
  * @param fileHandle Pointer to the file handle structure.
  *
  * @return
  *   - RC_OK: Successful operation.
  *   - RC_FILE_HANDLE_NOT_INIT: File handle not initialized or file not open for writing.
- *   - RC_WRITE_FAILED: Failed to allocate memory or encountered an issue during the write operation.
+ *   - RC_WRITE_FAILED: The disk is full, or the file is mapped (read only).
  */
 RC ensureCapacity(int requiredPages, SM_FileHandle *fileHandle) {
     // Check if the file is open for writing
@@ -406,36 +2874,702 @@ RC ensureCapacity(int requiredPages, SM_FileHandle *fileHandle) {
         return RC_FILE_HANDLE_NOT_INIT;
     }
 
-    // Determine the current number of pages in the file
-    int currentNumOfPages = fileHandle->totalNumPages;
+    if (requiredPages <= knownPages(fileHandle)) {
+        return RC_OK;
+    }
+
+    // A mapped file is read only
+    if (fileMgmt(fileHandle)->mapped) {
+        return RC_WRITE_FAILED;
+    }
 
-    if (requiredPages <= currentNumOfPages) {
+    // A compressed file only needs room in its slot table; its pages take disk space when written
+    if (fileMgmt(fileHandle)->comp != NULL) {
+        if (growSlots(fileMgmt(fileHandle)->comp, requiredPages) != 0) {
+            return RC_WRITE_FAILED;
+        }
+        setKnownPages(fileHandle, requiredPages);
         return RC_OK;
     }
 
-    int addPages = requiredPages - currentNumOfPages;
+    if (requiredPages > fileMgmt(fileHandle)->allocatedPages) {
+        // Another handle on the same file may have grown it since we opened it, so refresh the
+        // page count first (of a file that is not segmented); pages within the reserved extent
+        // need no system call at all
+        struct stat fileStat;
+        if (fileMgmt(fileHandle)->space == NULL && fstat(fileDescriptor(fileHandle), &fileStat) == 0
+            && pagesInFile(fileMgmt(fileHandle), fileStat.st_size) > fileHandle->totalNumPages) {
+            setKnownPages(fileHandle, pagesInFile(fileMgmt(fileHandle), fileStat.st_size));
+            if (requiredPages <= fileHandle->totalNumPages) {
+                return RC_OK;
+            }
+        }
 
-    SM_PageHandle paddingPage = (SM_PageHandle)calloc(PAGE_SIZE, sizeof(char));
-    if (paddingPage == NULL) {
-        return RC_WRITE_FAILED; // Failed to allocate memory for an empty page
+        if (reserveExtent(fileMgmt(fileHandle), requiredPages) != 0) {
+            return RC_WRITE_FAILED;
+        }
     }
 
-    if (fseek(fileHandle->mgmtInfo, 0, SEEK_END) != 0) {
-        free(paddingPage);
+    // Update the total number of pages in the file handle
+    setKnownPages(fileHandle, requiredPages);
+    return RC_OK;
+}
+
+
+/**
+ * @brief Hands out a page for new data: the lowest free page (see freePage), or else a new page at the end of the file.
+ *
+ * Either way the page reads as zeros, unless it was written since it was freed. Like
+ * ensureCapacity, growing the file is not synchronized between threads sharing the handle;
+ * a buffer pool allocates under the lock it grows the file with.
+ *
+ * @param fileHandle The open page file.
+ * @param pageNum Set to the page handed out.
+ *
+ * @return
+ *   - RC_OK: pageNum is set.
+ *   - RC_FILE_HANDLE_NOT_INIT: The file handle is not open.
+ *   - RC_WRITE_FAILED: The file is mapped (read only), or the disk is full.
+ */
+RC allocatePage(SM_FileHandle *fileHandle, int *pageNum) {
+    SM_FileMgmt *file;
+    int i, numPages;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    file = fileMgmt(fileHandle);
+    if (file->mapped)
         return RC_WRITE_FAILED;
+
+    // Reuse the lowest free page, so the file stays dense at the front and free pages collect at its end
+    pthread_mutex_lock(&file->freeLock);
+    for (i = 0; file->numFreePages > 0 && i < file->freeCapacity / 64; i++) {
+        if (file->freeBits[i] != 0) {
+            *pageNum = i * 64 + __builtin_ctzll(file->freeBits[i]);
+            setPageFree(file, *pageNum, 0);
+            pthread_mutex_unlock(&file->freeLock);
+            return RC_OK;
+        }
     }
+    pthread_mutex_unlock(&file->freeLock);
 
-    for (int pageIndex = 0; pageIndex < addPages; pageIndex++) {
-        if (fwrite(paddingPage, sizeof(char), PAGE_SIZE, fileHandle->mgmtInfo) != PAGE_SIZE) {
-            free(paddingPage);
-            return RC_WRITE_FAILED;
+    numPages = knownPages(fileHandle);
+    RC rc = ensureCapacity(numPages + 1, fileHandle);
+    if (rc == RC_OK)
+        *pageNum = numPages;
+    return rc;
+}
+
+
+/**
+ * @brief Frees a page of the file, so that allocatePage hands it out again.
+ *
+ * The page reads as zeros from then on. Its disk space is given back where possible: a
+ * compressed file frees the page's slot, and other files have aligned 64 KB runs of free pages
+ * punched out (FALLOC_FL_PUNCH_HOLE), so long free stretches take no disk space. Free pages at
+ * the end of the file are cut off when the file is closed, and the others are listed in the
+ * file's header block, which holds up to 508 runs of free pages.
+ *
+ * @param fileHandle The open page file.
+ * @param pageNum The page to free.
+ *
+ * @return
+ *   - RC_OK: The page is free.
+ *   - RC_FILE_HANDLE_NOT_INIT: The file handle is not open.
+ *   - RC_READ_NON_EXISTING_PAGE: The page is not in the file.
+ *   - RC_PAGE_ALREADY_FREE: The page is free already.
+ *   - RC_WRITE_FAILED: The file is mapped (read only), or the page cannot be emptied.
+ *   - RC_ERROR: The file was written without header, so it has no room to list free pages.
+ */
+RC freePage(SM_FileHandle *fileHandle, int pageNum) {
+    SM_FileMgmt *file;
+    RC rc;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    file = fileMgmt(fileHandle);
+    if (file->mapped)
+        return RC_WRITE_FAILED;
+    if (file->dataOffset == 0)
+        return RC_ERROR;
+    if (pageNum < 0 || pageNum >= knownPages(fileHandle))
+        return RC_READ_NON_EXISTING_PAGE;
+
+    // The page is emptied under the lock, so it cannot be handed out again before it is
+    pthread_mutex_lock(&file->freeLock);
+    if (pageIsFree(file, pageNum))
+        rc = RC_PAGE_ALREADY_FREE;
+    else if (growFreeBits(file, pageNum + 1) != 0)
+        rc = RC_WRITE_FAILED;
+    else if ((rc = clearPage(file, knownPages(fileHandle), pageNum)) == RC_OK)
+        setPageFree(file, pageNum, 1);
+    pthread_mutex_unlock(&file->freeLock);
+    return rc;
+}
+
+
+/**
+ * @brief Tells whether a page of the file is free (see freePage), so that scans can skip it.
+ *
+ * @return 1 if the page is free, 0 if it is in use, not in the file, or the handle is not open.
+ */
+int isPageFree(SM_FileHandle *fileHandle, int pageNum) {
+    SM_FileMgmt *file;
+    int isFree;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL || pageNum < 0)
+        return 0;
+    file = fileMgmt(fileHandle);
+    pthread_mutex_lock(&file->freeLock);
+    isFree = pageIsFree(file, pageNum);
+    pthread_mutex_unlock(&file->freeLock);
+    return isFree;
+}
+
+
+/**
+ * @brief Returns the number of free pages of the file (see freePage), or 0 if the handle is not open.
+ */
+int getNumFreePages(SM_FileHandle *fileHandle) {
+    SM_FileMgmt *file;
+    int numFree;
+
+    if (fileHandle == NULL || fileHandle->mgmtInfo == NULL)
+        return 0;
+    file = fileMgmt(fileHandle);
+    pthread_mutex_lock(&file->freeLock);
+    numFree = file->numFreePages;
+    pthread_mutex_unlock(&file->freeLock);
+    return numFree;
+}
+
+
+/************************************************************
+ *                 asynchronous page I/O                    *
+ ************************************************************/
+
+// Threads serving an SM_IO_THREADS queue
+#define IO_QUEUE_THREADS 4
+
+// Most requests a queue keeps in flight
+#define IO_QUEUE_MAX_DEPTH 4096
+
+#ifdef SM_HAVE_IO_URING
+// The rings shared with the kernel, mapped by uringSetup
+typedef struct SM_URing
+{
+    int fd;
+    void *sqRing;
+    void *cqRing;
+    size_t sqRingSize;
+    size_t cqRingSize;
+    struct io_uring_sqe *sqes;
+    size_t sqesSize;
+    unsigned *sqTail;
+    unsigned *sqMask;
+    unsigned *sqArray;
+    unsigned *cqHead;
+    unsigned *cqTail;
+    unsigned *cqMask;
+    struct io_uring_cqe *cqes;
+} SM_URing;
+#endif
+
+// Bookkeeping kept in queue->mgmtInfo
+typedef struct SM_IOQueueMgmt
+{
+    SM_FileHandle *fileHandle;
+    int fd;
+    pthread_mutex_t lock;   // Guards everything below but the rings
+    pthread_cond_t done;    // Signalled when a request lands on the completed ring
+    int inFlight;           // Requests submitted and not yet returned by completeIO
+
+    // Completed requests not yet returned, a ring of depth entries; with SM_IO_URING only
+    // requests that had to be done synchronously go here, the rest stay on the kernel's ring
+    SM_IORequest **completed;
+    int completedHead;
+    int numCompleted;
+
+    // SM_IO_THREADS: requests waiting for a thread, a ring of depth entries
+    SM_IORequest **waiting;
+    int waitingHead;
+    int numWaiting;
+    pthread_cond_t work;    // Signalled when requests are queued, and to stop
+    pthread_t threads[IO_QUEUE_THREADS];
+    int numThreads;
+    int stop;
+
+#ifdef SM_HAVE_IO_URING
+    // SM_IO_URING: submissions go through the ring under lock, reaping under completeLock
+    pthread_mutex_t completeLock;
+    SM_URing ring;
+#endif
+} SM_IOQueueMgmt;
+
+
+/**
+ * @brief Carries out a request with a blocking positional read or write.
+ */
+static void runRequest(SM_IOQueueMgmt *m, SM_IORequest *req)
+{
+    SM_FileMgmt *file = fileMgmt(m->fileHandle);
+
+    req->rc = req->isWrite ? pwritePage(file, req->pageNum, req->memPage) : preadPage(file, req->pageNum, req->memPage);
+}
+
+
+/**
+ * @brief Puts a completed request on the completed ring and wakes completeIO. Called with m->lock held.
+ */
+static void pushCompleted(SM_IOQueueMgmt *m, int depth, SM_IORequest *req)
+{
+    m->completed[(m->completedHead + m->numCompleted) % depth] = req;
+    m->numCompleted++;
+    pthread_cond_broadcast(&m->done);
+}
+
+
+/**
+ * @brief Body of an SM_IO_THREADS thread: carries out queued requests until the queue shuts down.
+ */
+static void *ioThreadMain(void *arg)
+{
+    SM_IOQueue *queue = (SM_IOQueue *)arg;
+    SM_IOQueueMgmt *m = (SM_IOQueueMgmt *)queue->mgmtInfo;
+    SM_IORequest *req;
+
+    pthread_mutex_lock(&m->lock);
+    for (;;)
+    {
+        while (m->numWaiting == 0 && !m->stop)
+            pthread_cond_wait(&m->work, &m->lock);
+        if (m->numWaiting == 0)
+            break;
+
+        req = m->waiting[m->waitingHead];
+        m->waitingHead = (m->waitingHead + 1) % queue->depth;
+        m->numWaiting--;
+        pthread_mutex_unlock(&m->lock);
+
+        runRequest(m, req);
+
+        pthread_mutex_lock(&m->lock);
+        pushCompleted(m, queue->depth, req);
+    }
+    pthread_mutex_unlock(&m->lock);
+    return NULL;
+}
+
+
+#ifdef SM_HAVE_IO_URING
+/**
+ * @brief Sets up an io_uring of at least the given number of entries and maps its rings.
+ *
+ * @return 0 on success, -1 if the kernel does not offer io_uring or the rings cannot be mapped.
+ */
+static int uringSetup(SM_URing *r, unsigned entries)
+{
+    struct io_uring_params p;
+    char *sq, *cq;
+
+    memset(&p, 0, sizeof(p));
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0)
+        return -1;
+
+    r->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        // Both rings live in one mapping
+        if (r->cqRingSize > r->sqRingSize)
+            r->sqRingSize = r->cqRingSize;
+        r->cqRingSize = 0;
+    }
+
+    r->sqRing = mmap(NULL, r->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cqRing = r->cqRingSize == 0 ? r->sqRing
+        : mmap(NULL, r->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqRing == MAP_FAILED || r->cqRing == MAP_FAILED || r->sqes == MAP_FAILED)
+    {
+        if (r->sqes != MAP_FAILED)
+            munmap(r->sqes, r->sqesSize);
+        if (r->cqRingSize != 0 && r->cqRing != MAP_FAILED)
+            munmap(r->cqRing, r->cqRingSize);
+        if (r->sqRing != MAP_FAILED)
+            munmap(r->sqRing, r->sqRingSize);
+        close(r->fd);
+        return -1;
+    }
+
+    sq = (char *)r->sqRing;
+    cq = (char *)r->cqRing;
+    r->sqTail = (unsigned *)(sq + p.sq_off.tail);
+    r->sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sqArray = (unsigned *)(sq + p.sq_off.array);
+    r->cqHead = (unsigned *)(cq + p.cq_off.head);
+    r->cqTail = (unsigned *)(cq + p.cq_off.tail);
+    r->cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+
+/**
+ * @brief Unmaps an io_uring's rings and closes it.
+ */
+static void uringTeardown(SM_URing *r)
+{
+    munmap(r->sqes, r->sqesSize);
+    if (r->cqRingSize != 0)
+        munmap(r->cqRing, r->cqRingSize);
+    munmap(r->sqRing, r->sqRingSize);
+    close(r->fd);
+}
+
+
+/**
+ * @brief Queues requests on the submission ring and hands them to the kernel with one system call.
+ *
+ * Called with m->lock held, which completeIO takes before returning any request, so the
+ * submission is ordered before the completion for the threads involved, not only through the
+ * kernel. The caller has reserved room for the requests (see submitIO), so the ring never
+ * overflows. Should the kernel refuse them outright, they are taken back off the ring and done
+ * synchronously.
+ */
+static void uringSubmit(SM_IOQueue *queue, SM_IORequest **requests, int numRequests)
+{
+    SM_IOQueueMgmt *m = (SM_IOQueueMgmt *)queue->mgmtInfo;
+    SM_URing *r = &m->ring;
+    unsigned tail;
+    int i, left;
+
+    tail = *r->sqTail;
+    for (i = 0; i < numRequests; i++)
+    {
+        unsigned idx = tail & *r->sqMask;
+        struct io_uring_sqe *sqe = &r->sqes[idx];
+
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = requests[i]->isWrite ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd = m->fd;
+        sqe->addr = (uint64_t)(uintptr_t)requests[i]->memPage;
+        sqe->len = m->fileHandle->pageSize;
+        sqe->off = (uint64_t)pageOffset(fileMgmt(m->fileHandle), requests[i]->pageNum);
+        sqe->user_data = (uint64_t)(uintptr_t)requests[i];
+        r->sqArray[idx] = idx;
+        tail++;
+    }
+    __atomic_store_n(r->sqTail, tail, __ATOMIC_RELEASE);
+
+    left = numRequests;
+    while (left > 0)
+    {
+        int n = (int)syscall(__NR_io_uring_enter, r->fd, left, 0, 0, NULL, 0);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY))
+            continue;
+        if (n <= 0)
+            break;
+        left -= n;
+    }
+    if (left > 0)
+        __atomic_store_n(r->sqTail, tail - left, __ATOMIC_RELEASE);
+
+    for (i = numRequests - left; i < numRequests; i++)
+    {
+        runRequest(m, requests[i]);
+        pushCompleted(m, queue->depth, requests[i]);
+    }
+}
+
+
+/**
+ * @brief Takes completions off the kernel's completion ring, waiting for one if wait is set and none is there.
+ *
+ * A read or write the kernel did only in part, or does not support, is finished synchronously,
+ * e.g. a read of a page that was added to the file but never written. Its submitter may have
+ * released m->lock after completeIO last took it, so m->lock is taken again first to order the
+ * submission before the redo.
+ *
+ * @return Number of requests stored in completed.
+ */
+static int uringReap(SM_IOQueue *queue, SM_IORequest **completed, int maxRequests, int wait)
+{
+    SM_IOQueueMgmt *m = (SM_IOQueueMgmt *)queue->mgmtInfo;
+    SM_URing *r = &m->ring;
+    unsigned head;
+    int got = 0;
+
+    pthread_mutex_lock(&m->completeLock);
+    head = *r->cqHead;
+    if (wait && head == __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE))
+    {
+        while (syscall(__NR_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno == EINTR)
+            ;
+    }
+    while (got < maxRequests && head != __atomic_load_n(r->cqTail, __ATOMIC_ACQUIRE))
+    {
+        struct io_uring_cqe *cqe = &r->cqes[head & *r->cqMask];
+        SM_IORequest *req = (SM_IORequest *)(uintptr_t)cqe->user_data;
+
+        if (cqe->res == m->fileHandle->pageSize)
+            req->rc = RC_OK;
+        else if (cqe->res >= 0 || cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP || cqe->res == -EAGAIN)
+        {
+            pthread_mutex_lock(&m->lock);
+            pthread_mutex_unlock(&m->lock);
+            runRequest(m, req);
         }
-        currentNumOfPages++; 
+        else
+            req->rc = req->isWrite ? RC_WRITE_FAILED : RC_READ_NON_EXISTING_PAGE;
+        completed[got++] = req;
+        head++;
     }
+    __atomic_store_n(r->cqHead, head, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&m->completeLock);
+    return got;
+}
+#endif
 
-    // Update the total number of pages in the file handle
-    fileHandle->totalNumPages = currentNumOfPages;
 
-    free(paddingPage);
+/**
+ * @brief Sets up a queue for asynchronous reads and writes of an open page file's pages.
+ *
+ * Requests are submitted in batches with submitIO and come back through completeIO, in whatever
+ * order they complete, so many page reads and writes can be outstanding at once. With
+ * SM_IO_URING a batch costs one system call and completions are taken straight off the
+ * kernel's ring; SM_IO_THREADS gets the same semantics from a few threads doing blocking pread
+ * and pwrite, for systems without io_uring, for compressed files, whose pages the kernel
+ * cannot decompress, and for segmented files, whose pages are not all in one file. One thread
+ * may submit while another completes.
+ *
+ * @param queue The queue to set up.
+ * @param fHandle The open page file. It must stay open until the queue is shut down.
+ * @param depth Most requests in flight, i.e. submitted and not yet returned by completeIO.
+ * @param backend SM_IO_URING, SM_IO_THREADS, or SM_IO_AUTO for io_uring if available.
+ *
+ * @return
+ *   - RC_OK: The queue is ready; queue->backend tells which backend it uses.
+ *   - RC_FILE_HANDLE_NOT_INIT: The file handle is not open.
+ *   - RC_ERROR: Bad depth, io_uring was asked for but is not available (or the file is
+ *     compressed or segmented), or out of memory or threads.
+ */
+RC initIOQueue(SM_IOQueue *queue, SM_FileHandle *fHandle, int depth, SM_IOBackend backend) {
+    SM_IOQueueMgmt *m;
+
+    if (fHandle == NULL || fHandle->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    if (queue == NULL || depth < 1 || depth > IO_QUEUE_MAX_DEPTH)
+        return RC_ERROR;
+
+    m = (SM_IOQueueMgmt *)calloc(1, sizeof(SM_IOQueueMgmt));
+    if (m == NULL)
+        return RC_ERROR;
+    m->completed = (SM_IORequest **)malloc(sizeof(SM_IORequest *) * depth);
+    m->waiting = (SM_IORequest **)malloc(sizeof(SM_IORequest *) * depth);
+    if (m->completed == NULL || m->waiting == NULL)
+    {
+        free(m->completed);
+        free(m->waiting);
+        free(m);
+        return RC_ERROR;
+    }
+    m->fileHandle = fHandle;
+    m->fd = fileDescriptor(fHandle);
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_cond_init(&m->done, NULL);
+    pthread_cond_init(&m->work, NULL);
+
+    queue->depth = depth;
+    queue->mgmtInfo = m;
+    queue->backend = SM_IO_THREADS;
+
+#ifdef SM_HAVE_IO_URING
+    if (backend != SM_IO_THREADS && fileMgmt(fHandle)->comp == NULL && fileMgmt(fHandle)->space == NULL && uringSetup(&m->ring, (unsigned)depth) == 0)
+    {
+        pthread_mutex_init(&m->completeLock, NULL);
+        queue->backend = SM_IO_URING;
+        return RC_OK;
+    }
+#endif
+
+    if (backend != SM_IO_URING)
+    {
+        for (m->numThreads = 0; m->numThreads < IO_QUEUE_THREADS; m->numThreads++)
+        {
+            if (pthread_create(&m->threads[m->numThreads], NULL, ioThreadMain, queue) != 0)
+                break;
+        }
+        if (m->numThreads > 0)
+            return RC_OK;
+    }
+
+    pthread_cond_destroy(&m->work);
+    pthread_cond_destroy(&m->done);
+    pthread_mutex_destroy(&m->lock);
+    free(m->completed);
+    free(m->waiting);
+    free(m);
+    queue->mgmtInfo = NULL;
+    return RC_ERROR;
+}
+
+
+/**
+ * @brief Submits a batch of page reads and writes to a queue without waiting for them.
+ *
+ * Every request's page must already exist in the file. A submitted request, its buffer and the
+ * page contents being written belong to the queue until completeIO returns the request. Like
+ * io_uring_submit, this never waits: if the queue has less room than the batch needs, only the
+ * first requests are submitted, and the caller completes some before submitting the rest, or
+ * does them itself.
+ *
+ * @param queue The queue, set up by initIOQueue.
+ * @param requests The requests to submit.
+ * @param numRequests Number of requests.
+ *
+ * @return Number of requests submitted, from the start of the batch, or -1 if the queue is not set
+ *         up or a request is for a page outside the file or has no buffer; then nothing is submitted.
+ */
+int submitIO(SM_IOQueue *queue, SM_IORequest **requests, int numRequests) {
+    SM_IOQueueMgmt *m;
+    int i, batch;
+
+    if (queue == NULL || queue->mgmtInfo == NULL)
+        return -1;
+    m = (SM_IOQueueMgmt *)queue->mgmtInfo;
+
+    for (i = 0; i < numRequests; i++)
+    {
+        if (requests[i] == NULL || requests[i]->memPage == NULL || requests[i]->pageNum < 0
+            || requests[i]->pageNum >= knownPages(m->fileHandle))
+            return -1;
+    }
+
+    // Reserve room for as much of the batch as fits
+    pthread_mutex_lock(&m->lock);
+    batch = queue->depth - m->inFlight;
+    if (batch > numRequests)
+        batch = numRequests;
+    m->inFlight += batch;
+
+    if (queue->backend == SM_IO_THREADS)
+    {
+        for (i = 0; i < batch; i++)
+            m->waiting[(m->waitingHead + m->numWaiting + i) % queue->depth] = requests[i];
+        m->numWaiting += batch;
+        pthread_cond_broadcast(&m->work);
+    }
+#ifdef SM_HAVE_IO_URING
+    else if (batch > 0)
+        uringSubmit(queue, requests, batch);
+#endif
+    pthread_mutex_unlock(&m->lock);
+    return batch;
+}
+
+
+/**
+ * @brief Returns completed requests, waiting until at least minRequests have completed.
+ *
+ * Each returned request has its rc set. A caller asking for more completions than it knows to
+ * be submitted waits for other threads' submissions; minRequests 0 just polls.
+ *
+ * @param queue The queue, set up by initIOQueue.
+ * @param completed Receives the completed requests.
+ * @param maxRequests Most requests to return.
+ * @param minRequests Fewest requests to return (capped at maxRequests).
+ *
+ * @return Number of requests stored in completed, or -1 if the queue is not set up.
+ */
+int completeIO(SM_IOQueue *queue, SM_IORequest **completed, int maxRequests, int minRequests) {
+    SM_IOQueueMgmt *m;
+    int got = 0;
+
+    if (queue == NULL || queue->mgmtInfo == NULL)
+        return -1;
+    m = (SM_IOQueueMgmt *)queue->mgmtInfo;
+    if (minRequests > maxRequests)
+        minRequests = maxRequests;
+
+    for (;;)
+    {
+        // Requests completed by the threads or done synchronously
+        pthread_mutex_lock(&m->lock);
+        if (queue->backend == SM_IO_THREADS)
+        {
+            while (got + m->numCompleted < minRequests)
+                pthread_cond_wait(&m->done, &m->lock);
+        }
+        while (got < maxRequests && m->numCompleted > 0)
+        {
+            completed[got++] = m->completed[m->completedHead];
+            m->completedHead = (m->completedHead + 1) % queue->depth;
+            m->numCompleted--;
+        }
+        pthread_mutex_unlock(&m->lock);
+
+#ifdef SM_HAVE_IO_URING
+        if (queue->backend == SM_IO_URING)
+            got += uringReap(queue, completed + got, maxRequests - got, got < minRequests);
+#endif
+        if (got >= minRequests)
+            break;
+    }
+
+    pthread_mutex_lock(&m->lock);
+    m->inFlight -= got;
+    pthread_mutex_unlock(&m->lock);
+    return got;
+}
+
+
+/**
+ * @brief Waits for the requests still in flight on a queue, dropping their completions, and releases it.
+ *
+ * No other thread may use the queue any more.
+ *
+ * @param queue The queue, set up by initIOQueue.
+ *
+ * @return RC_OK, or RC_FILE_HANDLE_NOT_INIT if the queue is not set up.
+ */
+RC shutdownIOQueue(SM_IOQueue *queue) {
+    SM_IOQueueMgmt *m;
+    SM_IORequest *drained[16];
+    int t;
+
+    if (queue == NULL || queue->mgmtInfo == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+    m = (SM_IOQueueMgmt *)queue->mgmtInfo;
+
+    while (m->inFlight > 0)
+        completeIO(queue, drained, 16, m->inFlight < 16 ? m->inFlight : 16);
+
+    if (queue->backend == SM_IO_THREADS)
+    {
+        pthread_mutex_lock(&m->lock);
+        m->stop = 1;
+        pthread_cond_broadcast(&m->work);
+        pthread_mutex_unlock(&m->lock);
+        for (t = 0; t < m->numThreads; t++)
+            pthread_join(m->threads[t], NULL);
+    }
+#ifdef SM_HAVE_IO_URING
+    else
+    {
+        uringTeardown(&m->ring);
+        pthread_mutex_destroy(&m->completeLock);
+    }
+#endif
+
+    pthread_cond_destroy(&m->work);
+    pthread_cond_destroy(&m->done);
+    pthread_mutex_destroy(&m->lock);
+    free(m->completed);
+    free(m->waiting);
+    free(m);
+    queue->mgmtInfo = NULL;
     return RC_OK;
-}
\ No newline at end of file
+}
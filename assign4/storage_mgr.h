@@ -10,23 +10,109 @@ typedef struct SM_FileHandle {
 	char *fileName;
 	int totalNumPages;
 	int curPagePos;
+	int pageSize; // Bytes per page, kept in the file's header (see createPageFileWithPageSize)
 	void *mgmtInfo;
 } SM_FileHandle;
 
 typedef char* SM_PageHandle;
 
+// How an open page file's pages reach the disk (see openPageFileMode)
+typedef enum SM_FileMode {
+	SM_FILE_BUFFERED = 0, // Through the OS page cache
+	SM_FILE_DIRECT = 1,   // Around the page cache (O_DIRECT), where the file system allows it
+	SM_FILE_MAPPED = 2    // Read only, mapped into memory (see getMappedPage)
+} SM_FileMode;
+
+// Expected access to a page file's pages, passed on to the OS (see adviseAccess)
+typedef enum SM_AccessAdvice {
+	SM_ADVICE_NORMAL = 0,     // No particular order
+	SM_ADVICE_SEQUENTIAL = 1, // In page order: read ahead aggressively
+	SM_ADVICE_RANDOM = 2,     // No order: do not read ahead
+	SM_ADVICE_WILLNEED = 3    // The pages will be read soon: start reading them now
+} SM_AccessAdvice;
+
+// Counters of an open page file's page compression (see getPageFileCompressionStats)
+typedef struct SM_CompressionStats {
+	int compressed;            // 1 if the file stores its pages compressed; all counters are 0 if not
+	long long pagesWritten;    // Pages compressed and written since the file was opened
+	long long bytesWritten;    // Bytes those pages took on disk
+	long long pagesRead;       // Pages read and decompressed since the file was opened
+	long long bytesRead;       // Bytes read from disk for them
+	long long compressNanos;   // Time spent compressing pages
+	long long decompressNanos; // Time spent decompressing pages
+	long long slotBytes;       // Bytes of the file holding pages now, free slots included
+	long long freeBytes;       // Bytes of free slots among them
+} SM_CompressionStats;
+
+// Layout of a segmented page file, a tablespace whose pages are spread over segment files (see createSegmentedPageFile)
+typedef struct SM_SegmentLayout {
+	int segmentPages; // Pages per segment file; 0 for SEGMENT_DEFAULT_BYTES worth
+	int numDirs;      // Directories the segments after the first go to, in turn; 0 to keep them next to the file
+	char **dirs;
+} SM_SegmentLayout;
+
+// Segment files of 1 GB, as in PostgreSQL
+#define SEGMENT_DEFAULT_BYTES (1 << 30)
+
+// Most segment files of one page file kept open besides the page file itself
+#define SEGMENT_FDS_MAX 16
+
+// Segment counters of an open page file (see getPageFileSegmentStats)
+typedef struct SM_SegmentStats {
+	int segmented;          // 1 if the file is segmented; all else is 0 if not
+	int segmentPages;       // Pages per segment file
+	int numSegments;        // Segment files on disk, the page file itself included
+	int openSegments;       // Segment files with a descriptor open now, the page file itself included
+	long long segmentOpens; // Times a segment file was opened since the file was, reopens after eviction included
+} SM_SegmentStats;
+
+// Backends of an asynchronous I/O queue
+typedef enum SM_IOBackend {
+	SM_IO_AUTO = 0,    // io_uring where the kernel offers it, else SM_IO_THREADS
+	SM_IO_URING = 1,   // Linux io_uring
+	SM_IO_THREADS = 2  // A pool of threads doing positional reads and writes
+} SM_IOBackend;
+
+// One page read or write submitted to an I/O queue
+typedef struct SM_IORequest {
+	int pageNum;
+	SM_PageHandle memPage; // Buffer the page is read into or written from
+	int isWrite;           // 1 to write memPage to the page, 0 to read the page into memPage
+	RC rc;                 // Result, set when the request completes
+	void *userData;        // Left alone by the storage manager
+} SM_IORequest;
+
+// Queue of asynchronous page I/O on one open page file (see initIOQueue)
+typedef struct SM_IOQueue {
+	SM_IOBackend backend; // Backend in use
+	int depth;            // Most requests in flight at once
+	void *mgmtInfo;
+} SM_IOQueue;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createPageFileWithPageSize (char *fileName, int pageSize);
+extern RC createCompressedPageFile (char *fileName, int pageSize);
+extern RC createSegmentedPageFile (char *fileName, int pageSize, const SM_SegmentLayout *layout);
+extern RC readPageSize (char *fileName, int *pageSize);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
+extern RC openPageFileMode (char *fileName, SM_FileHandle *fHandle, SM_FileMode mode);
+extern RC setPageFileMode (SM_FileHandle *fHandle, SM_FileMode mode);
+extern SM_FileMode getPageFileMode (SM_FileHandle *fHandle);
+extern SM_PageHandle getMappedPage (SM_FileHandle *fHandle, int pageNum);
+extern RC adviseAccess (SM_FileHandle *fHandle, int firstPageNum, int numPages, SM_AccessAdvice advice);
+extern RC getPageFileCompressionStats (SM_FileHandle *fHandle, SM_CompressionStats *stats);
+extern RC getPageFileSegmentStats (SM_FileHandle *fHandle, SM_SegmentStats *stats);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
 /* reading blocks from disc */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC readBlocks (int firstPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern int getBlockPos (SM_FileHandle *fHandle);
 extern RC readFirstBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC readPreviousBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
@@ -36,8 +122,21 @@ extern RC readLastBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 
 /* writing blocks to a page file */
 extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
+extern RC writeBlocks (int firstPageNum, int numPages, SM_FileHandle *fHandle, SM_PageHandle *memPages);
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
 
+/* free pages */
+extern RC allocatePage (SM_FileHandle *fHandle, int *pageNum);
+extern RC freePage (SM_FileHandle *fHandle, int pageNum);
+extern int isPageFree (SM_FileHandle *fHandle, int pageNum);
+extern int getNumFreePages (SM_FileHandle *fHandle);
+
+/* asynchronous page I/O */
+extern RC initIOQueue (SM_IOQueue *queue, SM_FileHandle *fHandle, int depth, SM_IOBackend backend);
+extern int submitIO (SM_IOQueue *queue, SM_IORequest **requests, int numRequests);
+extern int completeIO (SM_IOQueue *queue, SM_IORequest **completed, int maxRequests, int minRequests);
+extern RC shutdownIOQueue (SM_IOQueue *queue);
+
 #endif
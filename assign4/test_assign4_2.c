@@ -0,0 +1,2053 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "buffer_mgr_stat.h"
+#include "test_helper.h"
+
+// check whether the content of a buffer pool matches the expected content
+// (given in the format produced by sprintPoolContent)
+#define ASSERT_EQUALS_POOL(expected,bm,message)			        \
+  do {									\
+    char *real;								\
+    char *_exp = (char *) (expected);                                   \
+    real = sprintPoolContent(bm);					\
+    if (strcmp((_exp),real) != 0)					\
+      {									\
+	printf("[%s-%s-L%i-%s] FAILED: expected <%s> but was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+	free(real);							\
+	exit(1);							\
+      }									\
+    printf("[%s-%s-L%i-%s] OK: expected <%s> and was <%s>: %s\n",TEST_INFO, _exp, real, message); \
+    free(real);								\
+  } while(0)
+
+// test methods
+static void testCreatingAndReadingDummyPages (void);
+static void testTwoPoolsCoexist (void);
+static void testFramesReusedInPlace (void);
+static void testLRUSkipsPinnedFrames (void);
+static void testLRUKKeepsRereferencedPages (void);
+static void testARCAnd2QKeepHotPages (void);
+static void testScanRingLeavesPoolAlone (void);
+static void testBackgroundCleaner (void);
+static void testConcurrentPinsKeepUpdates (void);
+static void testPrefetchReadsAhead (void);
+static void testIOQueueBackends (void);
+static void testDirectIO (void);
+static void testVectoredIOAndFlush (void);
+static void testGrowingFileWritesNoPages (void);
+static void testMappedPool (void);
+static void testPageSizes (void);
+static void testCompressedPages (void);
+static void testFreePages (void);
+static void testSegmentedPages (void);
+static void testPoolMetrics (void);
+static void testPoolTrace (void);
+static void testMissRatioCurve (void);
+static void testResizePool (void);
+static void testSharedPool (void);
+static void testSharedPoolFarPages (void);
+static void testWriteFailuresKeepPages (void);
+static void testFailedReadsLeavePool (void);
+
+// helper methods
+static void createDummyPages (BM_BufferPool *bm, char *fileName, int num);
+static void checkDummyPages (BM_BufferPool *bm, char *fileName, int num);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  initStorageManager();
+  testName = "";
+
+  testCreatingAndReadingDummyPages();
+  testTwoPoolsCoexist();
+  testFramesReusedInPlace();
+  testLRUSkipsPinnedFrames();
+  testLRUKKeepsRereferencedPages();
+  testARCAnd2QKeepHotPages();
+  testScanRingLeavesPoolAlone();
+  testBackgroundCleaner();
+  testConcurrentPinsKeepUpdates();
+  testPrefetchReadsAhead();
+  testIOQueueBackends();
+  testDirectIO();
+  testVectoredIOAndFlush();
+  testGrowingFileWritesNoPages();
+  testMappedPool();
+  testPageSizes();
+  testCompressedPages();
+  testFreePages();
+  testSegmentedPages();
+  testPoolMetrics();
+  testPoolTrace();
+  testMissRatioCurve();
+  testResizePool();
+  testSharedPool();
+  testSharedPoolFarPages();
+  testWriteFailuresKeepPages();
+  testFailedReadsLeavePool();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testCreatingAndReadingDummyPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  testName = "Creating and Reading Back Dummy Pages";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+
+  createDummyPages(bm, "testbuffer.bin", 22);
+  checkDummyPages(bm, "testbuffer.bin", 20);
+
+  createDummyPages(bm, "testbuffer.bin", 1000);
+  checkDummyPages(bm, "testbuffer.bin", 1000);
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testTwoPoolsCoexist (void)
+{
+  BM_BufferPool *table = MAKE_POOL();
+  BM_BufferPool *index = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int i;
+  testName = "Two pools with different sizes and strategies";
+
+  TEST_CHECK(createPageFile("testtable.bin"));
+  TEST_CHECK(createPageFile("testindex.bin"));
+
+  TEST_CHECK(initBufferPool(table, "testtable.bin", 3, RS_FIFO, NULL));
+  TEST_CHECK(initBufferPool(index, "testindex.bin", 5, RS_LRU, NULL));
+
+  // interleave accesses so that each pool's replacement state would clobber the other's if shared
+  for (i = 0; i < 6; i++)
+    {
+      TEST_CHECK(pinPage(table, h, i));
+      sprintf(h->data, "%s-%i", "Table", h->pageNum);
+      TEST_CHECK(markDirty(table, h));
+      TEST_CHECK(unpinPage(table, h));
+
+      TEST_CHECK(pinPage(index, h, i % 4));
+      TEST_CHECK(unpinPage(index, h));
+    }
+
+  ASSERT_EQUALS_POOL("[3x0],[4x0],[5x0]", table, "table pool cycled through FIFO on its own");
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[-1 0]", index, "index pool keeps its own frames");
+  ASSERT_EQUALS_INT(3, getNumWriteIO(table), "table pool wrote back its evicted pages");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(index), "index pool has not written anything");
+  ASSERT_EQUALS_INT(4, getNumReadIO(index), "index pool read each of its pages once");
+
+  TEST_CHECK(shutdownBufferPool(index));
+  TEST_CHECK(shutdownBufferPool(table));
+
+  TEST_CHECK(initBufferPool(table, "testtable.bin", 2, RS_CLOCK, NULL));
+  for (i = 0; i < 6; i++)
+    {
+      char expected[32];
+
+      TEST_CHECK(pinPage(table, h, i));
+      sprintf(expected, "%s-%i", "Table", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "table pages survive the other pool");
+      TEST_CHECK(unpinPage(table, h));
+    }
+  TEST_CHECK(shutdownBufferPool(table));
+
+  TEST_CHECK(destroyPageFile("testtable.bin"));
+  TEST_CHECK(destroyPageFile("testindex.bin"));
+
+  free(table);
+  free(index);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testFramesReusedInPlace (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned[3];
+  char *frameData[3];
+  int i, j;
+  testName = "Frames are reused in place and pinned frames are never evicted";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 10);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  // remember which buffer each frame uses
+  for (i = 0; i < 3; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      frameData[i] = h->data;
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  // cycling through more pages than frames must keep using the same three buffers
+  for (i = 3; i < 10; i++)
+    {
+      bool sameBuffer = false;
+
+      TEST_CHECK(pinPage(bm, h, i));
+      for (j = 0; j < 3; j++)
+        sameBuffer = sameBuffer || (h->data == frameData[j]);
+      ASSERT_TRUE(sameBuffer, "page was read into one of the pool's own buffers");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  // with every frame pinned there is no victim
+  for (i = 0; i < 3; i++)
+    {
+      pinned[i] = MAKE_PAGE_HANDLE();
+      TEST_CHECK(pinPage(bm, pinned[i], i));
+    }
+  ASSERT_ERROR(pinPage(bm, h, 7), "pinning with every frame pinned fails");
+  for (i = 0; i < 3; i++)
+    {
+      char expected[32];
+
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, pinned[i]->data, "pinned page was not overwritten");
+      TEST_CHECK(unpinPage(bm, pinned[i]));
+      free(pinned[i]);
+    }
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLRUSkipsPinnedFrames (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *held = MAKE_PAGE_HANDLE();
+  int i;
+  testName = "LRU evicts the least recently pinned unpinned page";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 10);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+
+  // page 0 is the oldest page but stays pinned throughout
+  TEST_CHECK(pinPage(bm, held, 0));
+  for (i = 1; i < 3; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[0 1],[1 0],[2 0]", bm, "pool filled");
+
+  // touching page 1 again makes page 2 the victim
+  TEST_CHECK(pinPage(bm, h, 1));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(pinPage(bm, h, 3));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 1],[1 0],[3 0]", bm, "pinned page skipped, recently used page kept");
+
+  TEST_CHECK(pinPage(bm, h, 4));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 1],[4 0],[3 0]", bm, "least recently used unpinned page replaced");
+
+  // once unpinned, page 0 is still the least recently pinned page
+  TEST_CHECK(unpinPage(bm, held));
+  TEST_CHECK(pinPage(bm, h, 5));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[5 0],[4 0],[3 0]", bm, "released page becomes the victim");
+  ASSERT_EQUALS_INT(6, getNumReadIO(bm), "each page read once");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  free(held);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLRUKKeepsRereferencedPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_LRUKParams params = { 2, 0, 10 };
+  int i;
+  int scan[] = { 1, 2, 3, 4, 5 };
+  testName = "LRU-2 keeps pages referenced twice ahead of a scan";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 10);
+
+  // page 0 is referenced twice, then a scan runs through pages read only once
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &params));
+  for (i = 0; i < 2; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, 0));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  for (i = 0; i < 5; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, scan[i]));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[0 0],[5 0],[4 0]", bm, "scan did not evict the page referenced twice");
+
+  // page 1 comes back with its retained history and now has two references as well
+  TEST_CHECK(pinPage(bm, h, 1));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[5 0],[1 0]", bm, "page 1 replaced the older scan page");
+  TEST_CHECK(pinPage(bm, h, 6));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[6 0],[1 0]", bm, "page with retained history survives the next miss");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // two back-to-back pins of page 0 inside the correlated period count as one reference
+  params.correlatedPeriod = 1;
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU_K, &params));
+  for (i = 0; i < 2; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, 0));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  for (i = 1; i < 4; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[3 0],[1 0],[2 0]", bm, "correlated pins do not make a page hot");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testARCAnd2QKeepHotPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  int i;
+  int arcTrace[] = { 0, 1, 2, 0, 3, 4, 5 };
+  int twoQTrace[] = { 0, 1, 2, 3, 4, 0 };
+  testName = "ARC and 2Q keep re-referenced pages through a scan";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 10);
+
+  // ARC: page 0 is referenced twice and moves to T2, the scan cycles through T1
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_ARC, NULL));
+  for (i = 0; i < 7; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, arcTrace[i]));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[0 0],[5 0],[4 0]", bm, "ARC kept page 0 while scanning");
+
+  // page 3 is still a ghost in B1, so it comes back into T2 and T1 gives up a frame
+  TEST_CHECK(pinPage(bm, h, 3));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[0 0],[5 0],[3 0]", bm, "ARC ghost hit replaced the oldest page of T1");
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "ARC read page 0 once");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // 2Q with 4 frames: A1in holds 1 page, A1out remembers 2
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_2Q, NULL));
+  for (i = 0; i < 6; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, twoQTrace[i]));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[4 0],[0 0],[2 0],[3 0]", bm, "2Q promoted page 0 from A1out to Am");
+  for (i = 5; i < 9; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[7 0],[0 0],[8 0],[6 0]", bm, "2Q scan only cycled through A1in");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testScanRingLeavesPoolAlone (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *held = MAKE_PAGE_HANDLE();
+  BM_ScanRing ring;
+  int i;
+  testName = "Scans through a ring only recycle the ring's frames";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 40);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 8, RS_LRU, NULL));
+
+  // six pages the scan must not disturb
+  for (i = 0; i < 6; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  // the ring is capped at a quarter of the pool, i.e. two frames
+  TEST_CHECK(initScanRing(bm, &ring, SCAN_RING_FRAMES));
+  ASSERT_EQUALS_INT(2, ring.numFrames, "ring capped at a quarter of the pool");
+  for (i = 10; i < 30; i++)
+    {
+      TEST_CHECK(pinPageScan(bm, &ring, h, i));
+      ASSERT_EQUALS_INT(i, h->pageNum, "scan pinned the requested page");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[0 0],[1 0],[2 0],[3 0],[4 0],[5 0],[28 0],[29 0]", bm, "scan cycled through two frames");
+  ASSERT_EQUALS_INT(26, getNumReadIO(bm), "every scan page read once");
+
+  // a ring frame pinned by someone else is left alone and the pool supplies a frame instead
+  TEST_CHECK(pinPage(bm, held, 28));
+  for (i = 30; i < 32; i++)
+    {
+      TEST_CHECK(pinPageScan(bm, &ring, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_POOL("[30 0],[1 0],[2 0],[3 0],[4 0],[5 0],[28 1],[31 0]", bm, "pinned ring frame skipped");
+  TEST_CHECK(unpinPage(bm, held));
+
+  TEST_CHECK(freeScanRing(&ring));
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  free(held);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testBackgroundCleaner (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_CleanerStats stats;
+  int i, waited;
+  testName = "Background cleaner keeps frames clean";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_LRU, NULL));
+
+  ASSERT_ERROR(startPoolCleaner(bm, 6, 4), "low watermark above high watermark");
+  ASSERT_ERROR(startPoolCleaner(bm, 4, 11), "high watermark above pool size");
+  TEST_CHECK(startPoolCleaner(bm, 4, 8));
+  ASSERT_ERROR(startPoolCleaner(bm, 4, 8), "only one cleaner per pool");
+
+  // dirty far more pages than the pool holds
+  for (i = 0; i < 100; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  // whenever clean frames dropped below the low watermark the cleaner was woken, and each time
+  // it cleaned up to the high watermark, so it leaves at least the low watermark clean
+  for (waited = 0; waited < 500; waited++)
+    {
+      TEST_CHECK(getCleanerStats(bm, &stats));
+      if (stats.cleanFrames >= 4)
+        break;
+      usleep(10000);
+    }
+  ASSERT_TRUE(stats.running, "cleaner is running");
+  ASSERT_TRUE(stats.cleanFrames >= 4, "cleaner keeps the low watermark clean");
+  ASSERT_TRUE(stats.rounds > 0 && stats.pagesWritten > 0, "cleaner wrote pages");
+  ASSERT_EQUALS_INT(stats.pagesWritten + stats.syncWrites, getNumWriteIO(bm), "every write counted once");
+
+  TEST_CHECK(stopPoolCleaner(bm));
+  TEST_CHECK(getCleanerStats(bm, &stats));
+  ASSERT_TRUE(!stats.running, "cleaner stopped");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // whoever wrote them, every page made it to disk
+  checkDummyPages(bm, "testbuffer.bin", 100);
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+#define CONCURRENT_THREADS 4
+#define CONCURRENT_PAGES 40
+#define CONCURRENT_UPDATES 2000
+
+typedef struct ConcurrentWorker
+{
+  BM_BufferPool *bm;
+  unsigned int seed;
+  int failures;
+} ConcurrentWorker;
+
+// increment counters kept on random pages, each under the page's exclusive latch
+static void *
+concurrentUpdates (void *arg)
+{
+  ConcurrentWorker *w = (ConcurrentWorker *) arg;
+  BM_PageHandle h;
+  int i, counter;
+
+  for (i = 0; i < CONCURRENT_UPDATES; i++)
+    {
+      if (pinPage(w->bm, &h, rand_r(&w->seed) % CONCURRENT_PAGES) != RC_OK)
+        {
+          w->failures++;
+          continue;
+        }
+      latchPage(w->bm, &h, BM_LATCH_EXCLUSIVE);
+      memcpy(&counter, h.data, sizeof(int));
+      counter++;
+      memcpy(h.data, &counter, sizeof(int));
+      markDirty(w->bm, &h);
+      unlatchPage(w->bm, &h);
+      unpinPage(w->bm, &h);
+    }
+  return NULL;
+}
+
+// threads sharing a small pool never lose an update, whichever strategy evicts their pages
+void
+testConcurrentPinsKeepUpdates (void)
+{
+  ReplacementStrategy strategies[] = { RS_CLOCK, RS_LRU };
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  ConcurrentWorker workers[CONCURRENT_THREADS];
+  pthread_t threads[CONCURRENT_THREADS];
+  int s, t, i, counter, total;
+  testName = "Concurrent pins with content latches keep every update";
+
+  for (s = 0; s < 2; s++)
+    {
+      TEST_CHECK(createPageFile("testbuffer.bin"));
+      TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 10, strategies[s], NULL));
+
+      for (t = 0; t < CONCURRENT_THREADS; t++)
+        {
+          workers[t].bm = bm;
+          workers[t].seed = t + 1;
+          workers[t].failures = 0;
+          ASSERT_TRUE(pthread_create(&threads[t], NULL, concurrentUpdates, &workers[t]) == 0, "worker started");
+        }
+      for (t = 0; t < CONCURRENT_THREADS; t++)
+        {
+          pthread_join(threads[t], NULL);
+          ASSERT_EQUALS_INT(0, workers[t].failures, "every pin succeeded");
+        }
+      TEST_CHECK(shutdownBufferPool(bm));
+
+      // read the counters back through a fresh pool
+      TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 10, RS_FIFO, NULL));
+      for (i = 0, total = 0; i < CONCURRENT_PAGES; i++)
+        {
+          TEST_CHECK(pinPage(bm, h, i));
+          memcpy(&counter, h->data, sizeof(int));
+          total += counter;
+          TEST_CHECK(unpinPage(bm, h));
+        }
+      TEST_CHECK(shutdownBufferPool(bm));
+      ASSERT_EQUALS_INT(CONCURRENT_THREADS * CONCURRENT_UPDATES, total, "no update was lost");
+      TEST_CHECK(destroyPageFile("testbuffer.bin"));
+    }
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPrefetchReadsAhead (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_Readahead ra;
+  char expected[64];
+  int i, reads, misses;
+  testName = "Prefetched pages are read once and pinned without another read";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 40);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 20, RS_LRU, NULL));
+
+  // explicit prefetch: the pins only wait for the reads already started
+  TEST_CHECK(prefetchPages(bm, 0, 5));
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "five pages prefetched");
+  for (i = 0; i < 5; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "prefetched page content");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(5, getNumReadIO(bm), "pins of prefetched pages read nothing");
+
+  // nothing past the end of the file, nothing twice
+  TEST_CHECK(prefetchPages(bm, 38, 10));
+  TEST_CHECK(prefetchPages(bm, 0, 5));
+  ASSERT_EQUALS_INT(7, getNumReadIO(bm), "only pages 38 and 39 prefetched");
+
+  // a sequential reader misses on its first two pages only
+  initReadahead(&ra);
+  misses = 0;
+  for (i = 10; i < 30; i++)
+    {
+      TEST_CHECK(readahead(bm, &ra, NULL, i));
+      reads = getNumReadIO(bm);
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "read ahead page content");
+      TEST_CHECK(unpinPage(bm, h));
+      if (getNumReadIO(bm) != reads)
+        misses++;
+    }
+  ASSERT_EQUALS_INT(2, misses, "sequential pins found their pages prefetched");
+
+  // a random reader gets nothing read ahead
+  reads = getNumReadIO(bm);
+  int randomPages[] = { 8, 5, 9, 6 };
+  for (i = 0; i < 4; i++)
+    {
+      TEST_CHECK(readahead(bm, &ra, NULL, randomPages[i]));
+      TEST_CHECK(pinPage(bm, h, randomPages[i]));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(reads + 4, getNumReadIO(bm), "random pins read only their own pages");
+
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testIOQueueBackends (void)
+{
+  SM_IOQueue queue;
+  SM_FileHandle fh;
+  SM_IORequest req[40], *batch[40], *done[40], bad;
+  char *buf = malloc(40 * PAGE_SIZE);
+  char expected[64];
+  SM_IOBackend backends[] = { SM_IO_AUTO, SM_IO_THREADS };
+  int b, i, n, submitted, completed;
+  testName = "I/O queues write and read batches of pages";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  TEST_CHECK(ensureCapacity(40, &fh));
+
+  for (b = 0; b < 2; b++)
+    {
+      TEST_CHECK(initIOQueue(&queue, &fh, 16, backends[b]));
+      ASSERT_TRUE(backends[b] == SM_IO_AUTO || queue.backend == backends[b], "requested backend in use");
+
+      // a batch larger than the queue: submit what fits, complete, submit the rest
+      for (i = 0; i < 40; i++)
+        {
+          req[i].pageNum = i;
+          req[i].memPage = buf + i * PAGE_SIZE;
+          req[i].isWrite = 1;
+          sprintf(req[i].memPage, "%s-%i-%i", "Page", i, b);
+          batch[i] = &req[i];
+        }
+      submitted = completed = 0;
+      while (completed < 40)
+        {
+          n = submitIO(&queue, batch + submitted, 40 - submitted);
+          ASSERT_TRUE(n >= 0 && n <= 16, "submitted no more than the queue depth");
+          submitted += n;
+          n = completeIO(&queue, done, 40, 1);
+          for (i = 0; i < n; i++)
+            ASSERT_EQUALS_INT(RC_OK, done[i]->rc, "page written");
+          completed += n;
+        }
+      ASSERT_EQUALS_INT(40, submitted, "every write submitted");
+
+      // read the pages back in one batch that fits
+      memset(buf, 0, 40 * PAGE_SIZE);
+      for (i = 0; i < 16; i++)
+        req[i].isWrite = 0;
+      n = submitIO(&queue, batch, 16);
+      ASSERT_EQUALS_INT(16, n, "reads submitted as one batch");
+      n = completeIO(&queue, done, 40, 16);
+      ASSERT_EQUALS_INT(16, n, "reads completed");
+      for (i = 0; i < 16; i++)
+        {
+          sprintf(expected, "%s-%i-%i", "Page", i, b);
+          ASSERT_EQUALS_STRING(expected, req[i].memPage, "page read back");
+        }
+
+      // nothing is submitted from a batch with a page outside the file
+      bad = req[0];
+      bad.pageNum = 40;
+      batch[1] = &bad;
+      n = submitIO(&queue, batch, 2);
+      ASSERT_EQUALS_INT(-1, n, "page outside the file refused");
+      n = completeIO(&queue, done, 40, 0);
+      ASSERT_EQUALS_INT(0, n, "nothing in flight");
+      batch[1] = &req[1];
+
+      TEST_CHECK(shutdownIOQueue(&queue));
+    }
+
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(buf);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testDirectIO (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *buf = malloc(2 * PAGE_SIZE + 1);
+  char *unaligned = buf + 1; // direct I/O has to copy through an aligned buffer
+  char expected[64];
+  int i;
+  testName = "Direct I/O reads and writes pages past the page cache";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(openPageFileMode("testbuffer.bin", &fh, SM_FILE_DIRECT));
+  TEST_CHECK(ensureCapacity(4, &fh));
+
+  for (i = 0; i < 4; i++)
+    {
+      memset(unaligned, 0, PAGE_SIZE);
+      sprintf(unaligned, "%s-%i", "Page", i);
+      TEST_CHECK(writeBlock(i, &fh, unaligned));
+    }
+  for (i = 0; i < 4; i++)
+    {
+      sprintf(expected, "%s-%i", "Page", i);
+      TEST_CHECK(readBlock(i, &fh, unaligned));
+      ASSERT_EQUALS_STRING(expected, unaligned, "page read back with direct I/O");
+    }
+
+  // both modes see the same file
+  TEST_CHECK(setPageFileMode(&fh, SM_FILE_BUFFERED));
+  ASSERT_TRUE(getPageFileMode(&fh) == SM_FILE_BUFFERED, "file buffered again");
+  TEST_CHECK(readBlock(3, &fh, unaligned));
+  ASSERT_EQUALS_STRING("Page-3", unaligned, "page read back buffered");
+  TEST_CHECK(closePageFile(&fh));
+
+  // a pool with direct I/O evicts and writes back through it
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  TEST_CHECK(setPoolDirectIO(bm, true));
+  for (i = 0; i < 10; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i-%s", "Page", i, "direct");
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  for (i = 0; i < 10; i++)
+    {
+      sprintf(expected, "%s-%i-%s", "Page", i, "direct");
+      TEST_CHECK(readBlock(i, &fh, unaligned));
+      ASSERT_EQUALS_STRING(expected, unaligned, "page written back by the direct I/O pool");
+    }
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(buf);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testVectoredIOAndFlush (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  SM_PageHandle pages[300];
+  char expected[64];
+  int i;
+  testName = "Vectored reads and writes, and a flush coalescing adjacent pages";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  TEST_CHECK(ensureCapacity(300, &fh));
+
+  // more pages than one system call takes, each in its own buffer
+  for (i = 0; i < 300; i++)
+    {
+      pages[i] = calloc(1, PAGE_SIZE);
+      sprintf(pages[i], "%s-%i", "Page", i);
+    }
+  TEST_CHECK(writeBlocks(0, 300, &fh, pages));
+  for (i = 0; i < 300; i++)
+    memset(pages[i], 0, PAGE_SIZE);
+  TEST_CHECK(readBlocks(0, 300, &fh, pages));
+  for (i = 0; i < 300; i++)
+    {
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, pages[i], "page read back by the vectored read");
+    }
+  ASSERT_ERROR(readBlocks(290, 11, &fh, pages), "reading past the end of the file");
+  ASSERT_ERROR(writeBlocks(-1, 2, &fh, pages), "writing before the first page");
+
+  // dirty pages 0-4, 6-9 and 20: two runs and a single page
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 16, RS_LRU, NULL));
+  for (i = 0; i < 21; i++)
+    {
+      if (i == 5 || (i > 9 && i < 20))
+        continue;
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i-%s", "Page", i, "flushed");
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(pinPage(bm, h, 5));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(10, getNumWriteIO(bm), "each dirty page written once");
+
+  TEST_CHECK(readBlocks(0, 21, &fh, pages));
+  for (i = 0; i < 21; i++)
+    {
+      if (i == 5 || (i > 9 && i < 20))
+        sprintf(expected, "%s-%i", "Page", i);
+      else
+        sprintf(expected, "%s-%i-%s", "Page", i, "flushed");
+      ASSERT_EQUALS_STRING(expected, pages[i], "page on disk after the flush");
+    }
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  for (i = 0; i < 300; i++)
+    free(pages[i]);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testGrowingFileWritesNoPages (void)
+{
+  SM_FileHandle fh;
+  struct stat created, st;
+  char *page = malloc(PAGE_SIZE);
+  char zeros[PAGE_SIZE];
+  testName = "Growing a file adds pages without writing them";
+
+  memset(zeros, 0, PAGE_SIZE);
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  ASSERT_TRUE(stat("testbuffer.bin", &created) == 0, "created file has a size");
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+
+  TEST_CHECK(ensureCapacity(5000, &fh));
+  ASSERT_EQUALS_INT(5000, fh.totalNumPages, "file has 5000 pages");
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size == created.st_size, "no page written yet");
+  memset(page, 'x', PAGE_SIZE);
+  TEST_CHECK(readBlock(4999, &fh, page));
+  ASSERT_TRUE(memcmp(page, zeros, PAGE_SIZE) == 0, "added page reads as zeros");
+
+  sprintf(page, "%s-%i", "Page", 2500);
+  TEST_CHECK(writeBlock(2500, &fh, page));
+  TEST_CHECK(appendEmptyBlock(&fh));
+  ASSERT_EQUALS_INT(5001, fh.totalNumPages, "appended page counted");
+  ASSERT_EQUALS_INT(5000, getBlockPos(&fh), "appended page is the current page");
+  TEST_CHECK(closePageFile(&fh));
+
+  // closing writes out the size, so the pages are there when the file is opened again
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(5001, fh.totalNumPages, "pages kept after reopening");
+  TEST_CHECK(readBlock(2500, &fh, page));
+  ASSERT_EQUALS_STRING("Page-2500", page, "written page read back");
+  TEST_CHECK(readBlock(5000, &fh, page));
+  ASSERT_TRUE(memcmp(page, zeros, PAGE_SIZE) == 0, "appended page reads as zeros");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(page);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testMappedPool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *h2 = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *page = malloc(PAGE_SIZE);
+  char expected[64];
+  int i;
+  RC rc;
+  testName = "Mapped pool pins pages in place without reading them";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 20);
+
+  // the storage manager maps the file read only
+  TEST_CHECK(openPageFileMode("testbuffer.bin", &fh, SM_FILE_MAPPED));
+  ASSERT_EQUALS_INT(SM_FILE_MAPPED, getPageFileMode(&fh), "file is mapped");
+  TEST_CHECK(readBlock(7, &fh, page));
+  ASSERT_EQUALS_STRING("Page-7", page, "page copied out of the mapping");
+  ASSERT_EQUALS_STRING("Page-7", getMappedPage(&fh, 7), "page read in place");
+  ASSERT_TRUE(getMappedPage(&fh, 20) == NULL, "no page past the end of the file");
+  TEST_CHECK(adviseAccess(&fh, 0, 0, SM_ADVICE_SEQUENTIAL));
+  ASSERT_ERROR(writeBlock(0, &fh, page), "writing to a mapped file");
+  ASSERT_ERROR(appendEmptyBlock(&fh), "growing a mapped file");
+  ASSERT_ERROR(setPageFileMode(&fh, SM_FILE_BUFFERED), "unmapping an open file");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(initMappedBufferPool(bm, "testbuffer.bin", BM_ACCESS_SEQUENTIAL));
+  for (i = 0; i < 20; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(expected, "%s-%i", "Page", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "mapped page has the right content");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(0, getNumReadIO(bm), "pins read nothing into the pool");
+
+  // a page pinned twice is the same memory, and cannot be modified
+  TEST_CHECK(pinPage(bm, h, 3));
+  TEST_CHECK(pinPage(bm, h2, 3));
+  ASSERT_TRUE(h->data == h2->data, "both pins point to the same page");
+  TEST_CHECK(latchPage(bm, h, BM_LATCH_SHARED));
+  TEST_CHECK(unlatchPage(bm, h));
+  ASSERT_ERROR(latchPage(bm, h, BM_LATCH_EXCLUSIVE), "exclusive latch on a mapped page");
+  ASSERT_ERROR(markDirty(bm, h), "marking a mapped page dirty");
+  ASSERT_ERROR(pinPage(bm, h2, 20), "pinning past the end of the file");
+  TEST_CHECK(prefetchPages(bm, 10, 10));
+
+  rc = shutdownBufferPool(bm);
+  ASSERT_EQUALS_INT(RC_PINNED_PAGES_IN_BUFFER, rc, "pool still has pinned pages");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(unpinPage(bm, h2));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(page);
+  free(bm);
+  free(h);
+  free(h2);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPageSizes (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  char *page = calloc(1, 4 * PAGE_SIZE);
+  char expected[64];
+  FILE *legacy;
+  int i, pageSize;
+  RC rc;
+  testName = "Page files keep their own page size";
+
+  // the page size is kept in the file
+  ASSERT_ERROR(createPageFileWithPageSize("testbuffer.bin", 6000), "page size not a power of two");
+  ASSERT_ERROR(createPageFileWithPageSize("testbuffer.bin", 2 * MAX_PAGE_SIZE), "page size too large");
+  TEST_CHECK(createPageFileWithPageSize("testbuffer.bin", 4 * PAGE_SIZE));
+  TEST_CHECK(readPageSize("testbuffer.bin", &pageSize));
+  ASSERT_EQUALS_INT(4 * PAGE_SIZE, pageSize, "page size read from the header");
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(4 * PAGE_SIZE, fh.pageSize, "open file has the page size");
+  ASSERT_EQUALS_INT(1, fh.totalNumPages, "new file has one page");
+  memset(page, 'x', 4 * PAGE_SIZE);
+  TEST_CHECK(appendEmptyBlock(&fh));
+  TEST_CHECK(writeBlock(1, &fh, page));
+  TEST_CHECK(closePageFile(&fh));
+
+  // the pool's frames are as large as the pages
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  ASSERT_EQUALS_INT(4 * PAGE_SIZE, bm->pageSize, "pool takes the file's page size");
+  TEST_CHECK(pinPage(bm, h, 1));
+  ASSERT_TRUE(h->data[4 * PAGE_SIZE - 1] == 'x', "whole page read into the frame");
+  TEST_CHECK(unpinPage(bm, h));
+  for (i = 2; i < 6; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      memset(h->data, 0, 4 * PAGE_SIZE);
+      sprintf(h->data + 4 * PAGE_SIZE - 64, "%s-%i", "Page", i);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(6, fh.totalNumPages, "pool grew the file by whole pages");
+  for (i = 2; i < 6; i++)
+    {
+      sprintf(expected, "%s-%i", "Page", i);
+      TEST_CHECK(readBlock(i, &fh, page));
+      ASSERT_EQUALS_STRING(expected, page + 4 * PAGE_SIZE - 64, "end of the page written back");
+    }
+  TEST_CHECK(closePageFile(&fh));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  // a pool set up before its file has PAGE_SIZE frames and refuses larger pages
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  ASSERT_EQUALS_INT(PAGE_SIZE, bm->pageSize, "pool without a file has the default page size");
+  TEST_CHECK(createPageFileWithPageSize("testbuffer.bin", 2 * PAGE_SIZE));
+  rc = pinPage(bm, h, 0);
+  ASSERT_EQUALS_INT(RC_PAGE_SIZE_MISMATCH, rc, "pages larger than the frames");
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  // a file written before page sizes were kept has no header and 4 KB pages
+  legacy = fopen("testbuffer.bin", "w");
+  memset(page, 0, 2 * PAGE_SIZE);
+  strcpy(page + PAGE_SIZE, "Page-1");
+  ASSERT_TRUE(legacy != NULL && fwrite(page, 1, 2 * PAGE_SIZE, legacy) == 2 * PAGE_SIZE, "headerless file written");
+  fclose(legacy);
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(PAGE_SIZE, fh.pageSize, "headerless file has 4 KB pages");
+  ASSERT_EQUALS_INT(2, fh.totalNumPages, "headerless file has two pages");
+  TEST_CHECK(readBlock(1, &fh, page));
+  ASSERT_EQUALS_STRING("Page-1", page, "page read from the headerless file");
+  TEST_CHECK(closePageFile(&fh));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// compressed page files read back what was written and take less disk than plain ones
+void
+testCompressedPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_CompressionStats stats;
+  SM_FileHandle fh;
+  struct stat st;
+  char *noise = malloc(PAGE_SIZE);
+  char *page = malloc(PAGE_SIZE);
+  char expected[64];
+  int i;
+  RC rc;
+  testName = "Compressed page files";
+
+  srand(18);
+  for (i = 0; i < PAGE_SIZE; i++)
+    noise[i] = (char) rand();
+
+  TEST_CHECK(createCompressedPageFile("testbuffer.bin", PAGE_SIZE));
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(1, fh.totalNumPages, "new file has one page");
+  memset(page, 'x', PAGE_SIZE);
+  TEST_CHECK(readBlock(0, &fh, page));
+  ASSERT_TRUE(page[0] == 0 && page[PAGE_SIZE - 1] == 0, "page never written reads as zeros");
+  TEST_CHECK(closePageFile(&fh));
+
+  // a pool writes zero-padded pages and one that does not compress
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  for (i = 0; i < 21; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      if (i < 20)
+        {
+          memset(h->data, 0, PAGE_SIZE);
+          sprintf(h->data, "%s-%i", "Page", i);
+        }
+      else
+        memcpy(h->data, noise, PAGE_SIZE);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(getCompressionStats(bm, &stats));
+  ASSERT_TRUE(stats.compressed, "pool's file is compressed");
+  TEST_CHECK(shutdownBufferPool(bm));
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size < PAGE_SIZE + 20 * 512 + 2 * PAGE_SIZE,
+              "zero-padded pages take one unit each");
+
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  for (i = 0; i < 21; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      if (i < 20)
+        {
+          sprintf(expected, "%s-%i", "Page", i);
+          ASSERT_EQUALS_STRING(expected, h->data, "compressed page read back");
+        }
+      else
+        ASSERT_TRUE(memcmp(noise, h->data, PAGE_SIZE) == 0, "incompressible page read back");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(getCompressionStats(bm, &stats));
+  ASSERT_TRUE(stats.pagesRead >= 21, "page reads counted");
+  ASSERT_TRUE(stats.bytesRead < stats.pagesRead * PAGE_SIZE / 4, "compressed pages read fewer bytes");
+
+  // a page that no longer fits its slot moves, and its old slot is reused
+  TEST_CHECK(pinPage(bm, h, 3));
+  memcpy(h->data, noise, PAGE_SIZE);
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(21, fh.totalNumPages, "page count kept in the slot table");
+  TEST_CHECK(readBlock(3, &fh, page));
+  ASSERT_TRUE(memcmp(noise, page, PAGE_SIZE) == 0, "moved page read back");
+  TEST_CHECK(readBlock(4, &fh, page));
+  ASSERT_EQUALS_STRING("Page-4", page, "neighbour of the moved page intact");
+  memset(page, 0, PAGE_SIZE);
+  TEST_CHECK(writeBlock(3, &fh, page));
+  TEST_CHECK(closePageFile(&fh));
+  rc = openPageFileMode("testbuffer.bin", &fh, SM_FILE_MAPPED);
+  ASSERT_EQUALS_INT(RC_ERROR, rc, "compressed file cannot be mapped");
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+
+  // plain files report no compression
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  TEST_CHECK(pinPage(bm, h, 0));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(getCompressionStats(bm, &stats));
+  ASSERT_TRUE(!stats.compressed && stats.pagesRead == 0, "plain file not compressed");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(noise);
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// freed pages read as zeros, are handed out again lowest first and shrink the file
+void
+testFreePages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  SM_FileHandle fh;
+  struct stat before, after;
+  char *page = malloc(PAGE_SIZE);
+  PageNumber pageNum;
+  int i;
+  RC rc;
+  testName = "Free pages are reused and give their disk space back";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 40);
+
+  // free an aligned 64 KB chunk, a page in the middle and the last two pages
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_TRUE(stat("testbuffer.bin", &before) == 0, "file size read");
+  for (i = 16; i < 32; i++)
+    TEST_CHECK(freePage(&fh, i));
+  TEST_CHECK(freePage(&fh, 5));
+  TEST_CHECK(freePage(&fh, 38));
+  TEST_CHECK(freePage(&fh, 39));
+  rc = freePage(&fh, 5);
+  ASSERT_EQUALS_INT(RC_PAGE_ALREADY_FREE, rc, "page freed twice");
+  rc = freePage(&fh, 40);
+  ASSERT_EQUALS_INT(RC_READ_NON_EXISTING_PAGE, rc, "page past the end of the file");
+  ASSERT_EQUALS_INT(19, getNumFreePages(&fh), "free pages counted");
+  ASSERT_TRUE(stat("testbuffer.bin", &after) == 0
+              && after.st_blocks <= before.st_blocks - 16 * PAGE_SIZE / 512, "free chunk punched out of the file");
+  TEST_CHECK(readBlock(5, &fh, page));
+  ASSERT_TRUE(page[0] == 0 && page[PAGE_SIZE - 1] == 0, "free page reads as zeros");
+  TEST_CHECK(readBlock(6, &fh, page));
+  ASSERT_EQUALS_STRING("Page-6", page, "neighbour of a free page intact");
+  TEST_CHECK(closePageFile(&fh));
+
+  // free pages at the end are cut off; the others are listed in the header
+  ASSERT_TRUE(stat("testbuffer.bin", &after) == 0 && after.st_size == PAGE_SIZE + 38 * PAGE_SIZE,
+              "free pages at the end cut off");
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(38, fh.totalNumPages, "file shrunk by two pages");
+  ASSERT_EQUALS_INT(17, getNumFreePages(&fh), "free pages kept across close");
+  ASSERT_TRUE(isPageFree(&fh, 5) && !isPageFree(&fh, 6), "free page map read back");
+  TEST_CHECK(allocatePage(&fh, &i));
+  ASSERT_EQUALS_INT(5, i, "lowest free page handed out first");
+  TEST_CHECK(allocatePage(&fh, &i));
+  ASSERT_EQUALS_INT(16, i, "next free page handed out");
+  TEST_CHECK(closePageFile(&fh));
+
+  // a pool drops the change it holds for a freed page and refuses to free a pinned one
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  TEST_CHECK(pinPage(bm, h, 7));
+  strcpy(h->data, "Changed-7");
+  TEST_CHECK(markDirty(bm, h));
+  rc = freePoolPage(bm, 7);
+  ASSERT_EQUALS_INT(RC_PINNED_PAGES_IN_BUFFER, rc, "pinned page not freed");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(freePoolPage(bm, 7));
+  ASSERT_TRUE(isPoolPageFree(bm, 7), "pool page free");
+  TEST_CHECK(forceFlushPool(bm));
+  TEST_CHECK(allocatePoolPage(bm, &pageNum));
+  ASSERT_EQUALS_INT(7, pageNum, "freed pool page handed out again");
+  TEST_CHECK(pinPage(bm, h, 7));
+  ASSERT_TRUE(h->data[0] == 0, "reused page is empty");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(page);
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// pages spread over segment files in two directories, opened lazily and within the descriptor limit
+void
+testSegmentedPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  char *dirs[] = { "testsegs_a", "testsegs_b" };
+  SM_SegmentLayout layout = { 2, 2, dirs };
+  SM_SegmentStats stats;
+  SM_FileHandle fh, mapped;
+  struct stat st;
+  char *pages[40];
+  char expected[16];
+  int i;
+  RC rc;
+  testName = "Segmented page files spread pages over segment files";
+
+  mkdir("testsegs_a", 0777);
+  mkdir("testsegs_b", 0777);
+  TEST_CHECK(createSegmentedPageFile("testbuffer.bin", PAGE_SIZE, &layout));
+  createDummyPages(bm, "testbuffer.bin", 40);
+
+  // two pages per segment: the file itself, then the others in turn in each directory
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0 && st.st_size == 2 * PAGE_SIZE + 2 * PAGE_SIZE,
+              "first segment in the page file");
+  ASSERT_TRUE(stat("testsegs_a/testbuffer.bin.1", &st) == 0 && st.st_size == 2 * PAGE_SIZE, "segment 1 in the first directory");
+  ASSERT_TRUE(stat("testsegs_b/testbuffer.bin.2", &st) == 0 && st.st_size == 2 * PAGE_SIZE, "segment 2 in the second directory");
+  ASSERT_TRUE(stat("testsegs_a/testbuffer.bin.19", &st) == 0, "last segment");
+  ASSERT_TRUE(stat("testsegs_b/testbuffer.bin.20", &st) != 0, "no segment past the last page");
+
+  // segments are opened as their pages are read, keeping at most SEGMENT_FDS_MAX open
+  TEST_CHECK(openPageFile("testbuffer.bin", &fh));
+  ASSERT_EQUALS_INT(40, fh.totalNumPages, "pages of every segment counted");
+  TEST_CHECK(getPageFileSegmentStats(&fh, &stats));
+  ASSERT_TRUE(stats.segmented && stats.segmentPages == 2 && stats.numSegments == 20, "segment layout");
+  ASSERT_EQUALS_INT(1, stats.openSegments, "segments opened lazily");
+  for (i = 0; i < 40; i++)
+    pages[i] = malloc(PAGE_SIZE);
+  TEST_CHECK(readBlocks(0, 40, &fh, pages));
+  for (i = 0; i < 40; i++)
+    {
+      sprintf(expected, "Page-%i", i);
+      ASSERT_EQUALS_STRING(expected, pages[i], "page read across segments");
+    }
+  TEST_CHECK(getPageFileSegmentStats(&fh, &stats));
+  ASSERT_EQUALS_INT(SEGMENT_FDS_MAX + 1, stats.openSegments, "descriptors kept within the limit");
+  ASSERT_EQUALS_INT(19, (int) stats.segmentOpens, "each segment opened once");
+  TEST_CHECK(readBlock(2, &fh, pages[0]));
+  TEST_CHECK(getPageFileSegmentStats(&fh, &stats));
+  ASSERT_EQUALS_INT(20, (int) stats.segmentOpens, "closed segment opened again");
+
+  // free pages at the end take their segments with them
+  for (i = 36; i < 40; i++)
+    TEST_CHECK(freePage(&fh, i));
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_TRUE(stat("testsegs_b/testbuffer.bin.18", &st) != 0 && stat("testsegs_a/testbuffer.bin.17", &st) == 0,
+              "segments past the last page removed");
+  checkDummyPages(bm, "testbuffer.bin", 36);
+  rc = openPageFileMode("testbuffer.bin", &mapped, SM_FILE_MAPPED);
+  ASSERT_EQUALS_INT(RC_ERROR, rc, "segmented file not mapped");
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  ASSERT_TRUE(stat("testsegs_a/testbuffer.bin.1", &st) != 0 && rmdir("testsegs_a") == 0 && rmdir("testsegs_b") == 0,
+              "segments destroyed with the file");
+  for (i = 0; i < 40; i++)
+    free(pages[i]);
+  free(bm);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPoolMetrics (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PoolMetrics m;
+  BM_LatencyHist hist;
+  char *message;
+  long long sum;
+  int i, b;
+  testName = "Pool metrics count hits, misses, evictions and latencies";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 10);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 5, RS_FIFO, NULL));
+
+  TEST_CHECK(getPoolMetrics(bm, &m));
+  ASSERT_TRUE(m.hits == 0 && m.misses == 0 && m.reads == 0 && m.pinMiss.count == 0, "new pool has no metrics");
+
+  // fill the pool, dirty page 0, then pin every page again
+  for (i = 0; i < 5; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      if (i == 0)
+        TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  for (i = 0; i < 5 * BM_HIT_SAMPLE_RATE; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i % 5));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  // five more pages evict the five in the pool, the dirty one with a write
+  for (i = 5; i < 10; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+
+  TEST_CHECK(getPoolMetrics(bm, &m));
+  ASSERT_EQUALS_INT(5 * BM_HIT_SAMPLE_RATE, (int) m.hits, "hits");
+  ASSERT_EQUALS_INT(10, (int) m.misses, "misses");
+  ASSERT_EQUALS_INT(1, (int) m.dirtyEvictions, "dirty evictions");
+  ASSERT_EQUALS_INT(4, (int) m.cleanEvictions, "clean evictions");
+  ASSERT_EQUALS_INT(0, (int) m.pinWaits, "no pin waited for another's read");
+  ASSERT_EQUALS_INT(10, (int) m.reads, "one read per miss");
+  ASSERT_EQUALS_INT(10, getNumReadIO(bm), "getNumReadIO counts the reads");
+  ASSERT_EQUALS_INT(1, (int) m.writes, "one write");
+  ASSERT_EQUALS_INT(getNumWriteIO(bm), (int) m.writes, "getNumWriteIO counts the writes");
+
+  // every miss and I/O is timed, hits one in BM_HIT_SAMPLE_RATE
+  ASSERT_EQUALS_INT(10, (int) m.pinMiss.count, "every miss timed");
+  ASSERT_EQUALS_INT(10, (int) m.read.count, "every read timed");
+  ASSERT_EQUALS_INT(1, (int) m.write.count, "every write timed");
+  ASSERT_EQUALS_INT(5, (int) m.pinHit.count, "one hit in the sample rate timed");
+  for (sum = 0, b = 0; b < BM_HIST_BUCKETS; b++)
+    sum += m.pinMiss.buckets[b];
+  ASSERT_EQUALS_INT(10, (int) sum, "every miss in a bucket");
+  ASSERT_TRUE(latencyPercentile(&m.pinMiss, 0.5) >= latencyPercentile(&m.pinHit, 0.5), "misses take longer than hits");
+
+  message = sprintPoolMetrics(bm);
+  ASSERT_TRUE(strncmp(message, "{metrics}: 320 hits, 10 misses", 30) == 0, "metrics printed");
+  free(message);
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // percentiles are bucket bounds
+  memset(&hist, 0, sizeof(hist));
+  ASSERT_TRUE(latencyPercentile(&hist, 0.5) == 0, "empty histogram");
+  hist.count = 100;
+  hist.buckets[3] = 90;
+  hist.buckets[10] = 10;
+  ASSERT_TRUE(latencyPercentile(&hist, 0.5) == 16, "median below 16 ns");
+  ASSERT_TRUE(latencyPercentile(&hist, 0.99) == 2048, "p99 below 2048 ns");
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testPoolTrace (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_Trace trace;
+  int pages[] = { 0, 1, 2, 0, 3, 1, 4, 4 };
+  bool hits[] = { false, false, false, true, false, false, false, true };
+  bool ordered = true;
+  FILE *f;
+  int i;
+  testName = "Pool traces record every pin and read back";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 5);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  TEST_CHECK(startPoolTrace(bm, "testbuffer.trace"));
+  ASSERT_ERROR(startPoolTrace(bm, "testbuffer.trace"), "one trace per pool");
+
+  // three frames: page 1 is evicted by page 3 and missed again
+  for (i = 0; i < 8; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, pages[i]));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(stopPoolTrace(bm));
+  TEST_CHECK(stopPoolTrace(bm));
+
+  // pins after the trace stopped are not recorded
+  TEST_CHECK(pinPage(bm, h, 0));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(readPoolTrace("testbuffer.trace", &trace));
+  ASSERT_EQUALS_INT(PAGE_SIZE, trace.pageSize, "page size recorded");
+  ASSERT_EQUALS_INT(3, trace.numFrames, "pool size recorded");
+  ASSERT_EQUALS_INT(8, (int) trace.numRecords, "every pin recorded");
+  for (i = 0; i < 8; i++)
+    {
+      ASSERT_EQUALS_INT(pages[i], trace.records[i].pageNum, "page recorded");
+      ASSERT_EQUALS_INT(0, trace.records[i].fileSlot, "a pool of its own records slot 0");
+      ASSERT_TRUE(trace.records[i].hit == hits[i], "hit or miss recorded");
+      if (i > 0 && trace.records[i].nanos < trace.records[i - 1].nanos)
+        ordered = false;
+    }
+  ASSERT_TRUE(ordered, "times only grow");
+  freePoolTrace(&trace);
+
+  // a record cut short is dropped, and other files are not traces
+  truncate("testbuffer.trace", 16 + 16 * 5 + 7);
+  TEST_CHECK(readPoolTrace("testbuffer.trace", &trace));
+  ASSERT_EQUALS_INT(5, (int) trace.numRecords, "partial record dropped");
+  freePoolTrace(&trace);
+  ASSERT_TRUE(readPoolTrace("testbuffer.bin", &trace) == RC_ERROR, "page file is not a trace");
+  ASSERT_TRUE(readPoolTrace("testbuffer.missing", &trace) == RC_FILE_NOT_FOUND, "missing trace");
+
+  // shutdown ends a trace that was not stopped
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_CLOCK, NULL));
+  TEST_CHECK(startPoolTrace(bm, "testbuffer.trace"));
+  TEST_CHECK(pinPage(bm, h, 2));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+  TEST_CHECK(readPoolTrace("testbuffer.trace", &trace));
+  ASSERT_TRUE(trace.numRecords == 1 && trace.records[0].pageNum == 2 && !trace.records[0].hit, "trace written at shutdown");
+  freePoolTrace(&trace);
+
+  f = fopen("testbuffer.trace", "r");
+  ASSERT_TRUE(f != NULL, "trace file exists");
+  fclose(f);
+  unlink("testbuffer.trace");
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testMissRatioCurve (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_BufferPool *scan = MAKE_POOL();
+  BM_BufferPool *spread = MAKE_POOL();
+  BM_BufferPool *pools[2];
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_MissRatioCurve curve;
+  char *message;
+  double below, above;
+  unsigned int seed = 7;
+  int frames[2];
+  int i;
+  testName = "Miss ratio curves estimate LRU misses at other pool sizes";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 400);
+
+  // before any pin nothing is missed
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 16, RS_FIFO, NULL));
+  TEST_CHECK(getPoolMissRatio(bm, 16, &below));
+  ASSERT_TRUE(below == 0, "no pins, no misses");
+  ASSERT_ERROR(getPoolMissRatio(bm, 0, &below), "a pool has at least one frame");
+
+  // five scans of 400 pages: LRU misses every pin below 400 frames and only the first scan above
+  for (i = 0; i < 2000; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i % 400));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(getPoolMissRatio(bm, 200, &below));
+  TEST_CHECK(getPoolMissRatio(bm, 800, &above));
+  ASSERT_TRUE(below > 0.9, "scan misses below its size");
+  ASSERT_TRUE(above > 0.1 && above < 0.3, "scan hits above its size");
+  TEST_CHECK(getPoolMissRatioCurve(bm, &curve));
+  ASSERT_TRUE(curve.numPoints > 9 && curve.frames[0] == 1 && curve.frames[9] == 512, "points double from one frame");
+  ASSERT_TRUE(curve.missRatios[0] > 0.9 && curve.missRatios[9] < 0.3, "curve drops past the scan");
+  ASSERT_TRUE(curve.samplingRate > 0 && curve.samplingRate <= 1, "sampling rate");
+  message = sprintMissRatioCurve(bm);
+  ASSERT_TRUE(strncmp(message, "{miss ratio curve, ", 19) == 0, "curve printed");
+  free(message);
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // a hot scan of 100 pages needs about 100 frames, random pins over 400 pages gain little per frame
+  TEST_CHECK(initBufferPool(scan, "testbuffer.bin", 8, RS_LRU, NULL));
+  TEST_CHECK(initBufferPool(spread, "testbuffer.bin", 8, RS_LRU, NULL));
+  for (i = 0; i < 4000; i++)
+    {
+      TEST_CHECK(pinPage(scan, h, i % 100));
+      TEST_CHECK(unpinPage(scan, h));
+      seed = seed * 1103515245 + 12345;
+      TEST_CHECK(pinPage(spread, h, (seed >> 16) % 400));
+      TEST_CHECK(unpinPage(spread, h));
+    }
+  pools[0] = scan;
+  pools[1] = spread;
+  TEST_CHECK(splitPoolFrames(pools, 2, 200, frames));
+  ASSERT_TRUE(frames[0] + frames[1] == 200, "whole budget split");
+  ASSERT_TRUE(frames[0] >= 80, "scan gets its pages");
+  ASSERT_ERROR(splitPoolFrames(pools, 2, 1, frames), "one frame per pool at least");
+  TEST_CHECK(shutdownBufferPool(scan));
+  TEST_CHECK(shutdownBufferPool(spread));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(scan);
+  free(spread);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testResizePool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+  ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+  int sizes[] = { 5, 12, 2, 16 };
+  char expected[32];
+  unsigned int seed = 11;
+  int i, s, r;
+  testName = "Resizing a pool keeps its hot pages and retires pinned frames later";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 20);
+
+  // growing adds empty frames and keeps the pages
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  for (i = 0; i < 4; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(resizeBufferPool(bm, 8));
+  ASSERT_EQUALS_INT(8, getNumFrames(bm), "pool grown");
+  ASSERT_EQUALS_INT(8, bm->numPages, "size follows");
+  for (i = 0; i < 8; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, (i + 4) % 8));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "pages kept while growing");
+
+  // shrinking evicts the coldest pages and moves hot pages out of the frames that go
+  TEST_CHECK(pinPage(bm, pinned, 7));
+  for (i = 4; i < 7; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      if (i == 5)
+        TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(resizeBufferPool(bm, 4));
+  ASSERT_EQUALS_INT(4, bm->numPages, "new size");
+  ASSERT_EQUALS_INT(8, getNumFrames(bm), "pinned frame on top kept");
+  for (i = 4; i < 7; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(expected, "Page-%i", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "moved page content");
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  ASSERT_EQUALS_INT(8, getNumReadIO(bm), "hot pages kept");
+  TEST_CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "moved page still dirty");
+
+  // once unpinned, the next miss retires the last frame, moving its page if it is hot
+  TEST_CHECK(pinPage(bm, h, 7));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(unpinPage(bm, pinned));
+  TEST_CHECK(pinPage(bm, h, 10));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(4, getNumFrames(bm), "pool shrunk");
+  TEST_CHECK(pinPage(bm, h, 7));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_INT(9, getNumReadIO(bm), "page of the pinned frame kept");
+  ASSERT_ERROR(resizeBufferPool(bm, 0), "a pool has at least one frame");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // a pool grows to eight times its initial size, or to BM_POOL_MAX_FRAMES_ENV frames
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  TEST_CHECK(resizeBufferPool(bm, 32));
+  ASSERT_EQUALS_INT(RC_BUFFER_POOL_FULL, resizeBufferPool(bm, 33), "past the pool's reservation");
+  ASSERT_EQUALS_INT(32, getNumFrames(bm), "size kept");
+  TEST_CHECK(shutdownBufferPool(bm));
+  setenv(BM_POOL_MAX_FRAMES_ENV, "100", 1);
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 4, RS_LRU, NULL));
+  unsetenv(BM_POOL_MAX_FRAMES_ENV);
+  TEST_CHECK(resizeBufferPool(bm, 100));
+  ASSERT_EQUALS_INT(RC_BUFFER_POOL_FULL, resizeBufferPool(bm, 101), "past the configured maximum");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // every strategy keeps serving the right pages across resizes
+  for (s = 0; s < 7; s++)
+    {
+      TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 8, strategies[s], NULL));
+      for (r = 0; r < 4; r++)
+        {
+          TEST_CHECK(resizeBufferPool(bm, sizes[r]));
+          ASSERT_TRUE(getNumFrames(bm) == sizes[r], "resized");
+          for (i = 0; i < 100; i++)
+            {
+              seed = seed * 1103515245 + 12345;
+              TEST_CHECK(pinPage(bm, h, (seed >> 16) % 20));
+              sprintf(expected, "Page-%i", h->pageNum);
+              ASSERT_EQUALS_STRING(expected, h->data, "page content");
+              TEST_CHECK(unpinPage(bm, h));
+            }
+        }
+      TEST_CHECK(shutdownBufferPool(bm));
+    }
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  free(pinned);
+  TEST_DONE();
+}
+
+// count the frames of the pool holding pages of the view's file
+static int
+countViewFrames (BM_BufferPool *bm)
+{
+  PageNumber *frames = getFrameContents(bm);
+  int i, n = 0;
+
+  for (i = 0; i < getNumFrames(bm); i++)
+    if (frames[i] != NO_PAGE)
+      n++;
+  free(frames);
+  return n;
+}
+
+// ************************************************************
+void
+testSharedPool (void)
+{
+  BM_BufferPool *a = MAKE_POOL();
+  BM_BufferPool *b = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_PageHandle *pinned = MAKE_PAGE_HANDLE();
+  char expected[32];
+  int i, round;
+  testName = "Views of two files share the frames of one pool";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(a, "testbuffer.bin", 20);
+  TEST_CHECK(createPageFile("testshared.bin"));
+  createDummyPages(b, "testshared.bin", 20);
+  TEST_CHECK(createPageFileWithPageSize("testwide.bin", 2 * PAGE_SIZE));
+
+  TEST_CHECK(initSharedBufferPool(8, RS_LRU, NULL));
+  ASSERT_ERROR(initSharedBufferPool(8, RS_LRU, NULL), "one shared pool");
+  ASSERT_TRUE(initPoolView(a, "testwide.bin") == RC_PAGE_SIZE_MISMATCH, "pages of another size refused");
+  TEST_CHECK(initPoolView(a, "testbuffer.bin"));
+  TEST_CHECK(initPoolView(b, "testshared.bin"));
+  ASSERT_EQUALS_INT(8, getNumFrames(a), "frames of the shared pool");
+  ASSERT_EQUALS_INT(8, b->numPages, "size of the shared pool");
+
+  // each view pins the pages of its own file and only sees those
+  for (i = 0; i < 4; i++)
+    {
+      TEST_CHECK(pinPage(a, h, i));
+      sprintf(expected, "Page-%i", i);
+      ASSERT_EQUALS_STRING(expected, h->data, "page of the first file");
+      TEST_CHECK(unpinPage(a, h));
+      TEST_CHECK(pinPage(b, h, i + 10));
+      sprintf(expected, "Page-%i", i + 10);
+      ASSERT_EQUALS_STRING(expected, h->data, "page of the second file");
+      TEST_CHECK(unpinPage(b, h));
+    }
+  ASSERT_EQUALS_INT(4, countViewFrames(a), "frames of the first file");
+  ASSERT_EQUALS_INT(4, countViewFrames(b), "frames of the second file");
+
+  // the frames of the idle file go to the hot one
+  for (round = 0; round < 3; round++)
+    for (i = 0; i < 8; i++)
+      {
+        TEST_CHECK(pinPage(b, h, i));
+        TEST_CHECK(unpinPage(b, h));
+      }
+  ASSERT_EQUALS_INT(0, countViewFrames(a), "idle file evicted");
+  ASSERT_EQUALS_INT(8, countViewFrames(b), "hot file holds the pool");
+
+  // a view with pinned pages stays open, and so does the shared pool
+  TEST_CHECK(pinPage(a, pinned, 2));
+  sprintf(pinned->data, "%s", "Shared-2");
+  TEST_CHECK(markDirty(a, pinned));
+  ASSERT_ERROR(shutdownBufferPool(a), "pinned page of the view");
+  ASSERT_ERROR(shutdownSharedBufferPool(), "views still open");
+  TEST_CHECK(unpinPage(a, pinned));
+  TEST_CHECK(shutdownBufferPool(a));
+  ASSERT_EQUALS_INT(7, countViewFrames(b), "other file's pages kept");
+  TEST_CHECK(shutdownBufferPool(b));
+  TEST_CHECK(shutdownSharedBufferPool());
+  TEST_CHECK(shutdownSharedBufferPool());
+
+  // closing the view wrote its file's dirty page
+  TEST_CHECK(initBufferPool(a, "testbuffer.bin", 3, RS_FIFO, NULL));
+  TEST_CHECK(pinPage(a, h, 2));
+  ASSERT_EQUALS_STRING("Shared-2", h->data, "page written by the view");
+  TEST_CHECK(unpinPage(a, h));
+  TEST_CHECK(shutdownBufferPool(a));
+
+  // the first view sets up a default shared pool
+  TEST_CHECK(initPoolView(b, "testshared.bin"));
+  ASSERT_EQUALS_INT(BM_SHARED_POOL_FRAMES, getNumFrames(b), "default shared pool");
+  TEST_CHECK(pinPage(b, h, 19));
+  ASSERT_EQUALS_STRING("Page-19", h->data, "page through the default pool");
+  TEST_CHECK(unpinPage(b, h));
+  TEST_CHECK(shutdownBufferPool(b));
+  TEST_CHECK(shutdownSharedBufferPool());
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  TEST_CHECK(destroyPageFile("testshared.bin"));
+  TEST_CHECK(destroyPageFile("testwide.bin"));
+  free(a);
+  free(b);
+  free(h);
+  free(pinned);
+  TEST_DONE();
+}
+
+// ************************************************************
+// a view reaches every page of its file; the file is grown past 2^24 pages as a sparse file
+void
+testSharedPoolFarPages (void)
+{
+  BM_BufferPool *far = MAKE_POOL();
+  BM_BufferPool *near = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  PageNumber farPage = 1 << 24;
+  PageNumber *frames;
+  BM_Trace trace;
+  struct stat st;
+  int i, found;
+  testName = "Views pin pages past 2^24 without aliasing other files";
+
+  TEST_CHECK(createPageFile("testshared.bin"));
+  createDummyPages(near, "testshared.bin", 4);
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  ASSERT_TRUE(stat("testbuffer.bin", &st) == 0
+              && truncate("testbuffer.bin", st.st_size + (off_t) farPage * PAGE_SIZE + PAGE_SIZE) == 0,
+              "file grown past 2^24 pages");
+
+  // the far file takes the first slot, whose far pages an old 24-bit key would share with the next file's
+  TEST_CHECK(initSharedBufferPool(4, RS_LRU, NULL));
+  TEST_CHECK(initPoolView(far, "testbuffer.bin"));
+  TEST_CHECK(initPoolView(near, "testshared.bin"));
+  TEST_CHECK(startPoolTrace(far, "testshared.trace"));
+  for (i = 0; i < 2; i++)
+    {
+      TEST_CHECK(pinPage(far, h, farPage + i));
+      sprintf(h->data, "Far-%i", i);
+      TEST_CHECK(markDirty(far, h));
+      TEST_CHECK(unpinPage(far, h));
+    }
+  TEST_CHECK(pinPage(near, h, 0));
+  ASSERT_EQUALS_STRING("Page-0", h->data, "page 0 of the other file");
+  TEST_CHECK(unpinPage(near, h));
+  TEST_CHECK(pinPage(far, h, farPage));
+  ASSERT_EQUALS_STRING("Far-0", h->data, "far page kept apart");
+  TEST_CHECK(unpinPage(far, h));
+
+  frames = getFrameContents(far);
+  for (i = 0, found = 0; i < getNumFrames(far); i++)
+    if (frames[i] == farPage || frames[i] == farPage + 1)
+      found++;
+  free(frames);
+  ASSERT_EQUALS_INT(2, found, "far pages shown by their page numbers");
+  ASSERT_EQUALS_INT(1, countViewFrames(near), "other file's page");
+
+  TEST_CHECK(shutdownBufferPool(near));
+  TEST_CHECK(shutdownBufferPool(far));
+  TEST_CHECK(shutdownSharedBufferPool());
+
+  // the trace keeps each pin's file apart from its page number
+  TEST_CHECK(readPoolTrace("testshared.trace", &trace));
+  ASSERT_EQUALS_INT(4, (int) trace.numRecords, "every view's pins traced");
+  ASSERT_TRUE(trace.records[0].pageNum == farPage && trace.records[1].pageNum == farPage + 1
+              && trace.records[3].pageNum == farPage, "far pages traced by their page numbers");
+  ASSERT_TRUE(trace.records[2].pageNum == 0 && trace.records[2].fileSlot != trace.records[0].fileSlot,
+              "other file's page traced under its own slot");
+  ASSERT_TRUE(trace.records[1].fileSlot == trace.records[0].fileSlot
+              && trace.records[3].fileSlot == trace.records[0].fileSlot, "far file traced under one slot");
+  freePoolTrace(&trace);
+  unlink("testshared.trace");
+
+  // closing the view wrote the far pages to their own place in the file
+  TEST_CHECK(initBufferPool(far, "testbuffer.bin", 3, RS_FIFO, NULL));
+  TEST_CHECK(pinPage(far, h, farPage + 1));
+  ASSERT_EQUALS_STRING("Far-1", h->data, "far page written by the view");
+  TEST_CHECK(unpinPage(far, h));
+  TEST_CHECK(pinPage(far, h, 0));
+  ASSERT_EQUALS_STRING("", h->data, "first page untouched");
+  TEST_CHECK(unpinPage(far, h));
+  TEST_CHECK(shutdownBufferPool(far));
+  checkDummyPages(near, "testshared.bin", 4);
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  TEST_CHECK(destroyPageFile("testshared.bin"));
+  free(far);
+  free(near);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+// a dirty page whose write fails stays dirty and in the pool; the file size limit makes the writes fail
+void
+testWriteFailuresKeepPages (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  BM_CleanerStats stats;
+  struct rlimit old, tiny;
+  int waited;
+  RC rc;
+  testName = "Failed write-backs keep the page dirty in the pool";
+
+  TEST_CHECK(createPageFile("testbuffer.bin"));
+  createDummyPages(bm, "testbuffer.bin", 20);
+
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_FIFO, NULL));
+  TEST_CHECK(pinPage(bm, h, 15));
+  strcpy(h->data, "Changed-15");
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+
+  signal(SIGXFSZ, SIG_IGN);
+  ASSERT_TRUE(getrlimit(RLIMIT_FSIZE, &old) == 0, "file size limit read");
+  tiny = old;
+  tiny.rlim_cur = 2 * PAGE_SIZE;
+  ASSERT_TRUE(setrlimit(RLIMIT_FSIZE, &tiny) == 0, "file size limit lowered");
+
+  // evicting the dirty page fails and leaves it in its frame
+  TEST_CHECK(pinPage(bm, h, 1));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(pinPage(bm, h, 2));
+  TEST_CHECK(unpinPage(bm, h));
+  rc = pinPage(bm, h, 3);
+  ASSERT_TRUE(rc != RC_OK, "pin failing to write back its victim reports the error");
+  ASSERT_EQUALS_POOL("[15x0],[1 0],[2 0]", bm, "dirty page kept after failed eviction");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "no write counted");
+
+  // forcing it fails the same way
+  TEST_CHECK(pinPage(bm, h, 15));
+  rc = forcePage(bm, h);
+  ASSERT_TRUE(rc != RC_OK, "forcing the page reports the error");
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[15x0],[1 0],[2 0]", bm, "page still dirty after failed force");
+
+  // the cleaner's failed write leaves the page dirty too
+  TEST_CHECK(startPoolCleaner(bm, 3, 3));
+  for (waited = 0; waited < 500; waited++)
+    {
+      TEST_CHECK(getCleanerStats(bm, &stats));
+      if (stats.rounds > 0)
+        break;
+      usleep(10000);
+    }
+  TEST_CHECK(stopPoolCleaner(bm));
+  TEST_CHECK(getCleanerStats(bm, &stats));
+  ASSERT_TRUE(stats.rounds > 0, "cleaner woken");
+  ASSERT_EQUALS_INT(0, stats.pagesWritten, "failed cleaner write not counted");
+  ASSERT_EQUALS_POOL("[15x0],[1 0],[2 0]", bm, "page still dirty after failed cleaner write");
+
+  // so does a flush, for a run of adjacent pages as well as for a single page
+  TEST_CHECK(pinPage(bm, h, 1));
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(pinPage(bm, h, 2));
+  TEST_CHECK(markDirty(bm, h));
+  TEST_CHECK(unpinPage(bm, h));
+  rc = forceFlushPool(bm);
+  ASSERT_TRUE(rc != RC_OK, "flush reports the failed writes");
+  ASSERT_EQUALS_POOL("[15x0],[1x0],[2x0]", bm, "pages still dirty after failed flush");
+  ASSERT_EQUALS_INT(0, getNumWriteIO(bm), "no write counted");
+
+  // and shutting down, which leaves the pool up with its dirty pages
+  rc = shutdownBufferPool(bm);
+  ASSERT_TRUE(rc != RC_OK, "shutdown reports the failed writes");
+  ASSERT_EQUALS_POOL("[15x0],[1x0],[2x0]", bm, "pool kept after failed shutdown");
+
+  // once writes succeed again the page is written back on eviction
+  ASSERT_TRUE(setrlimit(RLIMIT_FSIZE, &old) == 0, "file size limit restored");
+  signal(SIGXFSZ, SIG_DFL);
+  TEST_CHECK(pinPage(bm, h, 3));
+  TEST_CHECK(unpinPage(bm, h));
+  ASSERT_EQUALS_POOL("[3 0],[1x0],[2x0]", bm, "dirty page evicted");
+  ASSERT_EQUALS_INT(1, getNumWriteIO(bm), "one write");
+  TEST_CHECK(pinPage(bm, h, 15));
+  ASSERT_EQUALS_STRING("Changed-15", h->data, "change written once writes succeed");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(forceFlushPool(bm));
+  ASSERT_EQUALS_INT(3, getNumWriteIO(bm), "every page written once writes succeed");
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+// a page that cannot be read is not pinned and does not stay in the pool; the test damages a
+// compressed page so that it no longer decompresses
+void
+testFailedReadsLeavePool (void)
+{
+  BM_BufferPool *bm = MAKE_POOL();
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char garbage[512];
+  FILE *f;
+  int i;
+  RC rc;
+  testName = "Pages that cannot be read are not pinned";
+
+  TEST_CHECK(createCompressedPageFile("testbuffer.bin", PAGE_SIZE));
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  for (i = 0; i < 5; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      memset(h->data, 0, PAGE_SIZE);
+      sprintf(h->data, "%s-%i", "Page", i);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm, h));
+    }
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  // page 0 was evicted first, into the first unit after the header
+  memset(garbage, 0xff, sizeof(garbage));
+  f = fopen("testbuffer.bin", "r+b");
+  ASSERT_TRUE(f != NULL && fseek(f, MIN_PAGE_SIZE, SEEK_SET) == 0
+              && fwrite(garbage, 1, sizeof(garbage), f) == sizeof(garbage) && fclose(f) == 0,
+              "compressed page damaged");
+
+  TEST_CHECK(initBufferPool(bm, "testbuffer.bin", 3, RS_LRU, NULL));
+  rc = pinPage(bm, h, 0);
+  ASSERT_TRUE(rc != RC_OK, "damaged page not pinned");
+  ASSERT_EQUALS_POOL("[-1 0],[-1 0],[-1 0]", bm, "damaged page not kept in the pool");
+  rc = pinPage(bm, h, 0);
+  ASSERT_TRUE(rc != RC_OK, "damaged page read again and not pinned");
+  ASSERT_EQUALS_INT(2, getNumReadIO(bm), "both reads counted");
+  TEST_CHECK(pinPage(bm, h, 1));
+  ASSERT_EQUALS_STRING("Page-1", h->data, "neighbour of the damaged page pinned");
+  TEST_CHECK(unpinPage(bm, h));
+
+  // a prefetched page that cannot be read leaves the pool as well
+  TEST_CHECK(prefetchPages(bm, 0, 3));
+  rc = pinPage(bm, h, 0);
+  ASSERT_TRUE(rc != RC_OK, "damaged prefetched page not pinned");
+  TEST_CHECK(pinPage(bm, h, 2));
+  ASSERT_EQUALS_STRING("Page-2", h->data, "prefetched neighbour pinned");
+  TEST_CHECK(unpinPage(bm, h));
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  TEST_CHECK(destroyPageFile("testbuffer.bin"));
+  free(bm);
+  free(h);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+createDummyPages(BM_BufferPool *bm, char *fileName, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+
+  TEST_CHECK(initBufferPool(bm, fileName, 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+      sprintf(h->data, "%s-%i", "Page", h->pageNum);
+      TEST_CHECK(markDirty(bm, h));
+      TEST_CHECK(unpinPage(bm,h));
+    }
+
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(h);
+}
+
+void
+checkDummyPages(BM_BufferPool *bm, char *fileName, int num)
+{
+  int i;
+  BM_PageHandle *h = MAKE_PAGE_HANDLE();
+  char *expected = malloc(sizeof(char) * 512);
+
+  TEST_CHECK(initBufferPool(bm, fileName, 3, RS_FIFO, NULL));
+
+  for (i = 0; i < num; i++)
+    {
+      TEST_CHECK(pinPage(bm, h, i));
+
+      sprintf(expected, "%s-%i", "Page", h->pageNum);
+      ASSERT_EQUALS_STRING(expected, h->data, "reading back dummy page content");
+
+      TEST_CHECK(unpinPage(bm,h));
+    }
+
+  TEST_CHECK(shutdownBufferPool(bm));
+
+  free(expected);
+  free(h);
+}
@@ -0,0 +1,615 @@
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "dberror.h"
+#include "expr.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "record_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+// test methods
+static void testChurnReusesFreePages (void);
+static void testScanRing (void);
+static void testReadOnlyTable (void);
+static void testLargePageTable (void);
+static void testCompressedTable (void);
+static void testSegmentedTable (void);
+static void testClosedTablesFreeViews (void);
+static void testUnreadablePage (void);
+
+// helper methods
+static Record *testRecord (Schema *schema, int a, char *b, int c);
+static Schema *testSchema (void);
+static void fillTable (RM_TableData *table, Schema *schema, int num, RID *rids);
+static int scanTable (RM_TableData *table, Schema *schema, RM_ScanAccess access);
+static void checkRecords (RM_TableData *table, Schema *schema, int num, RID *rids);
+
+// test name
+char *testName;
+
+// main method
+int
+main (void)
+{
+  testName = "";
+
+  testChurnReusesFreePages();
+  testScanRing();
+  testReadOnlyTable();
+  testLargePageTable();
+  testCompressedTable();
+  testSegmentedTable();
+  testClosedTablesFreeViews();
+  testUnreadablePage();
+
+  return 0;
+}
+
+// ************************************************************
+void
+testChurnReusesFreePages (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  SM_FileHandle fh;
+  Schema *schema;
+  Record *r;
+  Value *value;
+  RID *rids;
+  int perPage, numRecords, maxPage, numPages, round, i, emptied, trimmed;
+  testName = "test inserts reuse the pages deletes freed";
+
+  schema = testSchema();
+  perPage = PAGE_SIZE / getRecordSize(schema);
+  numRecords = 10 * perPage;
+  rids = (RID *) malloc(sizeof(RID) * numRecords);
+
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_churn", schema));
+  TEST_CHECK(openTable(table, "test_table_churn"));
+
+  // fill ten data pages
+  maxPage = 0;
+  for(i = 0; i < numRecords; i++)
+    {
+      r = testRecord(schema, i, "aaaa", 0);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+      if (r->id.page > maxPage)
+	maxPage = r->id.page;
+      freeRecord(r);
+    }
+  ASSERT_EQUALS_INT(10, maxPage, "records fill pages 1 to 10");
+
+  // each round empties one page, which is freed, and takes one record off another page, which
+  // the next insert starts from; putting the records back must not grow the table
+  for(round = 0; round < 20; round++)
+    {
+      emptied = 1 + (round * 3) % 10;
+      trimmed = 1 + (round * 7 + 5) % 10;
+      for(i = 0; i < numRecords; i++)
+	if (rids[i].page == emptied)
+	  TEST_CHECK(deleteRecord(table, rids[i]));
+      for(i = 0; i < numRecords; i++)
+	if (rids[i].page == trimmed && trimmed != emptied)
+	  {
+	    TEST_CHECK(deleteRecord(table, rids[i]));
+	    rids[i].page = emptied; // put back with the emptied page's records
+	    break;
+	  }
+      for(i = 0; i < numRecords; i++)
+	if (rids[i].page == emptied)
+	  {
+	    r = testRecord(schema, i, "bbbb", round);
+	    TEST_CHECK(insertRecord(table, r));
+	    rids[i] = r->id;
+	    if (r->id.page > maxPage)
+	      maxPage = r->id.page;
+	    freeRecord(r);
+	  }
+    }
+  ASSERT_EQUALS_INT(10, maxPage, "inserts fill freed pages before appending");
+
+  // records put back on freed pages read back
+  r = testRecord(schema, 0, "", 0);
+  for(i = 0; i < numRecords; i += perPage / 3)
+    {
+      TEST_CHECK(getRecord(table, rids[i], r));
+      TEST_CHECK(getAttr(r, schema, 0, &value));
+      ASSERT_EQUALS_INT(i, value->v.intV, "record found at its RID");
+      freeVal(value);
+    }
+  freeRecord(r);
+  TEST_CHECK(closeTable(table));
+
+  // the file holds the header page and the ten data pages
+  TEST_CHECK(openPageFile("test_table_churn", &fh));
+  numPages = fh.totalNumPages;
+  TEST_CHECK(closePageFile(&fh));
+  ASSERT_TRUE(numPages <= 11, "table file stopped growing");
+
+  TEST_CHECK(deleteTable("test_table_churn"));
+  TEST_CHECK(shutdownRecordManager());
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testScanRing (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 20000;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  Schema *schema;
+  testName = "test scanning a table through a scan ring";
+
+  schema = testSchema();
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_ring", schema));
+  TEST_CHECK(openTable(table, "test_table_ring"));
+  fillTable(table, schema, numInserts, rids);
+
+  // both scans read every page of the table, which spans far more pages than the ring has frames
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_RING), "ring scan finds every match");
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_SHARED), "shared scan finds every match");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  // reopened, the table reads the same
+  TEST_CHECK(openTable(table, "test_table_ring"));
+  checkRecords(table, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_RING), "ring scan finds every match after reopening");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  TEST_CHECK(deleteTable("test_table_ring"));
+  TEST_CHECK(shutdownRecordManager());
+  freeSchema(schema);
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testReadOnlyTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *readOnly = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 2000;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  Schema *schema;
+  Record *r;
+  testName = "test reading a table opened read only";
+
+  schema = testSchema();
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createTable("test_table_ro", schema));
+  TEST_CHECK(openTable(table, "test_table_ro"));
+  fillTable(table, schema, numInserts, rids);
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  // records and scans of the mapped table match what was written
+  TEST_CHECK(openTableReadOnly(readOnly, "test_table_ro"));
+  checkRecords(readOnly, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(readOnly, schema, RM_SCAN_SHARED), "scan finds every match");
+
+  // the table cannot be modified
+  r = testRecord(schema, 0, "aaaa", 0);
+  ASSERT_ERROR(insertRecord(readOnly, r), "insert fails");
+  r->id = rids[0];
+  ASSERT_ERROR(updateRecord(readOnly, r), "update fails");
+  ASSERT_ERROR(deleteRecord(readOnly, rids[0]), "delete fails");
+  freeRecord(r);
+
+  // opening it read only leaves openTable with the table created last
+  TEST_CHECK(openTable(table, "test_table_ro"));
+  r = testRecord(schema, -1, "zzzz", 1);
+  TEST_CHECK(insertRecord(table, r));
+  freeRecord(r);
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+  TEST_CHECK(closeTable(readOnly));
+  freeSchema(readOnly->schema);
+
+  // reopened, the mapping sees the record inserted since
+  TEST_CHECK(openTableReadOnly(readOnly, "test_table_ro"));
+  checkRecords(readOnly, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5 + 1, scanTable(readOnly, schema, RM_SCAN_SHARED), "scan finds the new record");
+  TEST_CHECK(closeTable(readOnly));
+  freeSchema(readOnly->schema);
+
+  TEST_CHECK(deleteTable("test_table_ro"));
+  TEST_CHECK(shutdownRecordManager());
+  freeSchema(schema);
+  free(rids);
+  free(readOnly);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testLargePageTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 5000, pageSize = 16384;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  Schema *schema;
+  testName = "test a table stored in 16 KB pages";
+
+  schema = testSchema();
+  TEST_CHECK(initRecordManager(NULL));
+  ASSERT_ERROR(createTableWithPageSize("test_table_16k", schema, 3000), "page size must be a power of two");
+  TEST_CHECK(createTableWithPageSize("test_table_16k", schema, pageSize));
+  TEST_CHECK(openTable(table, "test_table_16k"));
+  fillTable(table, schema, numInserts, rids);
+
+  // each page holds four times the records of a 4 KB page
+  ASSERT_EQUALS_INT(1 + (numInserts - 1) / (pageSize / getRecordSize(schema)), rids[numInserts - 1].page, "records fill 16 KB pages");
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_SHARED), "scan finds every match");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  // reopened, the table reads the same
+  TEST_CHECK(openTable(table, "test_table_16k"));
+  checkRecords(table, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_RING), "ring scan finds every match after reopening");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  TEST_CHECK(deleteTable("test_table_16k"));
+  TEST_CHECK(shutdownRecordManager());
+  freeSchema(schema);
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testCompressedTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_TableData *readOnly = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 5000;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  RID last;
+  SM_FileHandle fh;
+  char page[PAGE_SIZE];
+  Schema *schema;
+  struct stat st;
+  testName = "test a table stored in compressed pages";
+
+  schema = testSchema();
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createCompressedTable("test_table_z", schema));
+  TEST_CHECK(openTable(table, "test_table_z"));
+  fillTable(table, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_SHARED), "scan finds every match");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+  TEST_CHECK(shutdownRecordManager());
+
+  // closing the table wrote the file's slot table, so a handle of its own finds every page
+  last = rids[numInserts - 1];
+  TEST_CHECK(openPageFile("test_table_z", &fh));
+  ASSERT_EQUALS_INT(last.page + 1, fh.totalNumPages, "every page in the closed file");
+  TEST_CHECK(readBlock(last.page, &fh, page));
+  ASSERT_TRUE(page[last.slot * getRecordSize(schema)] == '+', "last record in the closed file");
+  TEST_CHECK(closePageFile(&fh));
+
+  // the records compress well, so the file takes less than their uncompressed pages
+  ASSERT_TRUE(stat("test_table_z", &st) == 0, "table file exists");
+  ASSERT_TRUE(st.st_size < (off_t) rids[numInserts - 1].page * PAGE_SIZE, "pages stored compressed");
+
+  // a compressed table cannot be mapped
+  ASSERT_ERROR(openTableReadOnly(readOnly, "test_table_z"), "compressed table not mapped");
+
+  // reopened after the record manager was shut down, the table reads the same
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(openTable(table, "test_table_z"));
+  checkRecords(table, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_RING), "ring scan finds every match after reopening");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  TEST_CHECK(deleteTable("test_table_z"));
+  TEST_CHECK(shutdownRecordManager());
+  freeSchema(schema);
+  free(rids);
+  free(readOnly);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testSegmentedTable (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  int numInserts = 5000;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  char *dirs[] = { "testsegs_a", "testsegs_b" };
+  SM_SegmentLayout layout = { 4, 2, dirs };
+  Schema *schema;
+  struct stat st;
+  testName = "test a table spread over segment files";
+
+  schema = testSchema();
+  mkdir("testsegs_a", 0777);
+  mkdir("testsegs_b", 0777);
+  TEST_CHECK(initRecordManager(NULL));
+  ASSERT_ERROR(createSegmentedTable("test_table_seg", schema, NULL), "layout required");
+  TEST_CHECK(createSegmentedTable("test_table_seg", schema, &layout));
+  TEST_CHECK(openTable(table, "test_table_seg"));
+  fillTable(table, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_SHARED), "scan finds every match");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  // four pages per segment, the segments after the first going to each directory in turn
+  ASSERT_TRUE(stat("testsegs_a/test_table_seg.1", &st) == 0 && stat("testsegs_b/test_table_seg.2", &st) == 0,
+              "segments in both directories");
+  ASSERT_EQUALS_INT(16, rids[numInserts - 1].page, "records fill pages 1 to 16");
+  ASSERT_TRUE(stat("testsegs_b/test_table_seg.4", &st) == 0 && stat("testsegs_a/test_table_seg.5", &st) != 0,
+              "segments up to the last page");
+
+  // reopened, the table reads the same
+  TEST_CHECK(openTable(table, "test_table_seg"));
+  checkRecords(table, schema, numInserts, rids);
+  ASSERT_EQUALS_INT(numInserts / 5, scanTable(table, schema, RM_SCAN_RING), "ring scan finds every match after reopening");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  TEST_CHECK(deleteTable("test_table_seg"));
+  ASSERT_TRUE(stat("testsegs_a/test_table_seg.1", &st) != 0 && rmdir("testsegs_a") == 0 && rmdir("testsegs_b") == 0,
+              "segments deleted with the table");
+  TEST_CHECK(shutdownRecordManager());
+  freeSchema(schema);
+  free(rids);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+void
+testClosedTablesFreeViews (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  BM_BufferPool *probe = MAKE_POOL();
+  Schema *schema;
+  Record *r;
+  int i;
+  testName = "test closed tables give their shared pool slots back";
+
+  schema = testSchema();
+  TEST_CHECK(initRecordManager(NULL));
+
+  // more tables than the shared pool has view slots, each closed before the next is created
+  for(i = 0; i < 200; i++)
+    {
+      TEST_CHECK(createTable("test_table_views", schema));
+      TEST_CHECK(openTable(table, "test_table_views"));
+      r = testRecord(schema, i, "aaaa", 0);
+      TEST_CHECK(insertRecord(table, r));
+      freeRecord(r);
+      TEST_CHECK(closeTable(table));
+      freeSchema(table->schema);
+      TEST_CHECK(deleteTable("test_table_views"));
+    }
+
+  // no slot is left taken: another file still opens as a view, and once it is closed the
+  // shared pool has no view left and shuts down
+  TEST_CHECK(createPageFile("test_table_probe"));
+  TEST_CHECK(initPoolView(probe, "test_table_probe"));
+  TEST_CHECK(shutdownBufferPool(probe));
+  TEST_CHECK(shutdownSharedBufferPool());
+  TEST_CHECK(destroyPageFile("test_table_probe"));
+
+  TEST_CHECK(shutdownRecordManager());
+  freeSchema(schema);
+  free(probe);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+// a page that cannot be read fails scans rather than ending them, and fails the calls on its
+// records; the test damages the first data page of a compressed table so that it no longer
+// decompresses
+void
+testUnreadablePage (void)
+{
+  RM_TableData *table = (RM_TableData *) malloc(sizeof(RM_TableData));
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  int numInserts = 2000;
+  RID *rids = (RID *) malloc(sizeof(RID) * numInserts);
+  char garbage[512];
+  Expr *sel, *left, *right;
+  Schema *schema;
+  Record *r;
+  FILE *f;
+  int i;
+  RC rc;
+  testName = "test pages that cannot be read fail scans and record calls";
+
+  schema = testSchema();
+  TEST_CHECK(initRecordManager(NULL));
+  TEST_CHECK(createCompressedTable("test_table_damaged", schema));
+  TEST_CHECK(openTable(table, "test_table_damaged"));
+  fillTable(table, schema, numInserts, rids);
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  // the header page is written into the first unit after the file header when the table is
+  // created and into the next when it is opened; the first data page written takes the third
+  memset(garbage, 0xff, sizeof(garbage));
+  f = fopen("test_table_damaged", "r+b");
+  ASSERT_TRUE(f != NULL && fseek(f, MIN_PAGE_SIZE + 2 * sizeof(garbage), SEEK_SET) == 0
+              && fwrite(garbage, 1, sizeof(garbage), f) == sizeof(garbage) && fclose(f) == 0,
+              "data page damaged");
+
+  TEST_CHECK(openTable(table, "test_table_damaged"));
+  ASSERT_EQUALS_INT(getRecordSize(schema), getRecordSize(table->schema), "header page intact");
+  TEST_CHECK(createRecord(&r, schema));
+  MAKE_CONS(left, stringToValue("i1"));
+  MAKE_ATTRREF(right, 2);
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+  TEST_CHECK(startScan(table, sc, sel));
+  while((rc = next(sc, r)) == RC_OK)
+    ;
+  ASSERT_TRUE(rc != RC_RM_NO_MORE_TUPLES, "scan fails at the damaged page");
+  ASSERT_TRUE(next(sc, r) == rc, "damaged page read again");
+  TEST_CHECK(closeScan(sc));
+
+  // calls on a record of the damaged page fail rather than use another page
+  for(i = 0; i < numInserts && getRecord(table, rids[i], r) == RC_OK; i++)
+    ;
+  ASSERT_TRUE(i < numInserts, "record of the damaged page not read");
+  r->id = rids[i];
+  ASSERT_ERROR(updateRecord(table, r), "record of the damaged page not updated");
+  ASSERT_ERROR(deleteRecord(table, rids[i]), "record of the damaged page not deleted");
+
+  // looking up a deleted record leaves its page unpinned, so the table closes
+  TEST_CHECK(deleteRecord(table, rids[numInserts - 1]));
+  ASSERT_EQUALS_INT(RC_RM_NO_TUPLE_WITH_GIVEN_RID, getRecord(table, rids[numInserts - 1], r), "deleted record not found");
+  TEST_CHECK(closeTable(table));
+  freeSchema(table->schema);
+
+  TEST_CHECK(deleteTable("test_table_damaged"));
+  TEST_CHECK(shutdownRecordManager());
+  freeExpr(sel);
+  freeRecord(r);
+  freeSchema(schema);
+  free(rids);
+  free(sc);
+  free(table);
+  TEST_DONE();
+}
+
+// ************************************************************
+Schema *
+testSchema (void)
+{
+  Schema *result;
+  char *names[] = { "a", "b", "c" };
+  DataType dt[] = { DT_INT, DT_STRING, DT_INT };
+  int sizes[] = { 0, 4, 0 };
+  int keys[] = {0};
+  int i;
+  char **cpNames = (char **) malloc(sizeof(char*) * 3);
+  DataType *cpDt = (DataType *) malloc(sizeof(DataType) * 3);
+  int *cpSizes = (int *) malloc(sizeof(int) * 3);
+  int *cpKeys = (int *) malloc(sizeof(int));
+
+  for(i = 0; i < 3; i++)
+    {
+      cpNames[i] = (char *) malloc(2);
+      strcpy(cpNames[i], names[i]);
+    }
+  memcpy(cpDt, dt, sizeof(DataType) * 3);
+  memcpy(cpSizes, sizes, sizeof(int) * 3);
+  memcpy(cpKeys, keys, sizeof(int));
+
+  result = createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+
+  return result;
+}
+
+Record *
+testRecord (Schema *schema, int a, char *b, int c)
+{
+  Record *result;
+  Value *value;
+
+  TEST_CHECK(createRecord(&result, schema));
+
+  MAKE_VALUE(value, DT_INT, a);
+  TEST_CHECK(setAttr(result, schema, 0, value));
+  freeVal(value);
+
+  MAKE_STRING_VALUE(value, b);
+  TEST_CHECK(setAttr(result, schema, 1, value));
+  freeVal(value);
+
+  MAKE_VALUE(value, DT_INT, c);
+  TEST_CHECK(setAttr(result, schema, 2, value));
+  freeVal(value);
+
+  return result;
+}
+
+// insert num records with a = i and c = i % 5, keeping their RIDs
+void
+fillTable (RM_TableData *table, Schema *schema, int num, RID *rids)
+{
+  Record *r;
+  int i;
+
+  for(i = 0; i < num; i++)
+    {
+      r = testRecord(schema, i, "aaaa", i % 5);
+      TEST_CHECK(insertRecord(table, r));
+      rids[i] = r->id;
+      freeRecord(r);
+    }
+}
+
+// count the records a scan for c = 1 returns, checking each of them
+int
+scanTable (RM_TableData *table, Schema *schema, RM_ScanAccess access)
+{
+  RM_ScanHandle *sc = (RM_ScanHandle *) malloc(sizeof(RM_ScanHandle));
+  Expr *sel, *left, *right;
+  Value *value;
+  Record *r;
+  int count = 0;
+  RC rc;
+
+  TEST_CHECK(createRecord(&r, schema));
+  MAKE_CONS(left, stringToValue("i1"));
+  MAKE_ATTRREF(right, 2);
+  MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+
+  TEST_CHECK(startScanWithAccess(table, sc, sel, access));
+  while((rc = next(sc, r)) == RC_OK)
+    {
+      TEST_CHECK(getAttr(r, schema, 2, &value));
+      ASSERT_TRUE(value->v.intV == 1, "scan returns matches only");
+      freeVal(value);
+      count++;
+    }
+  ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ends after the last page");
+  TEST_CHECK(closeScan(sc));
+
+  freeExpr(sel);
+  freeRecord(r);
+  free(sc);
+  return count;
+}
+
+// check that the records fillTable inserted are found at their RIDs
+void
+checkRecords (RM_TableData *table, Schema *schema, int num, RID *rids)
+{
+  Value *value;
+  Record *r;
+  int i;
+
+  TEST_CHECK(createRecord(&r, schema));
+  for(i = 0; i < num; i++)
+    {
+      TEST_CHECK(getRecord(table, rids[i], r));
+      TEST_CHECK(getAttr(r, schema, 0, &value));
+      if (value->v.intV != i)
+        ASSERT_EQUALS_INT(i, value->v.intV, "record found at its RID");
+      freeVal(value);
+    }
+  ASSERT_TRUE(true, "records found at their RIDs");
+  freeRecord(r);
+}
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "dberror.h"
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+
+/*
+ * Replacement policy simulator for buffer pool access traces.
+ *
+ * Reads traces recorded by startPoolTrace (or by any program run with BM_TRACE_DIR set) and
+ * replays each one against every replacement strategy at pool sizes doubling from SIM_MIN_FRAMES
+ * up to maxFrames, plus the size of the pool the trace was captured from. The replay goes
+ * through real buffer pools over a sparse page file, so the results are those of the strategies
+ * as the buffer manager implements them. Every pin is unpinned right away and nothing is marked
+ * dirty, so the simulated I/O is the pages read; a trace does not say which pins wrote. The
+ * distinct pages of a trace, which for a shared pool span several files, are numbered in file
+ * and page order onto one file that holds just those pages.
+ *
+ * For each trace, prints the number of pins and distinct pages, the hit ratio the traced pool
+ * had, and then one table of hit ratios and one of pages read, with a row per pool size.
+ *
+ * Usage: trace_sim [-m maxFrames] traceFile...
+ *   maxFrames defaults to the number of distinct pages of the trace, past which only the
+ *   first reference of each page misses.
+ */
+
+#define SIM_FILE "tracesim.bin"
+#define SIM_MIN_FRAMES 8
+
+static const ReplacementStrategy strategies[] = { RS_FIFO, RS_LRU, RS_CLOCK, RS_LFU, RS_LRU_K, RS_ARC, RS_2Q };
+static const char *strategyNames[] = { "FIFO", "LRU", "CLOCK", "LFU", "LRU-2", "ARC", "2Q" };
+#define NUM_STRATEGIES ((int) (sizeof(strategies) / sizeof(strategies[0])))
+
+// create a sparse page file of numPages pages of the given size
+static RC
+createSimFile (int pageSize, long long numPages)
+{
+  struct stat st;
+  RC rc;
+
+  // a new file holds its header and one page; keep the header and extend the pages
+  if ((rc = createPageFileWithPageSize(SIM_FILE, pageSize)) != RC_OK)
+    return rc;
+  if (stat(SIM_FILE, &st) != 0
+      || truncate(SIM_FILE, st.st_size - pageSize + (off_t) numPages * pageSize) != 0)
+    return RC_WRITE_FAILED;
+  return RC_OK;
+}
+
+// replay the pins of pages through a pool of numFrames frames; returns the pages read, or -1 on error
+static long long
+replay (const int *pages, long long pins, ReplacementStrategy strategy, int numFrames)
+{
+  BM_BufferPool bm;
+  BM_PageHandle h;
+  BM_PoolMetrics m;
+  long long i;
+
+  if (initBufferPool(&bm, SIM_FILE, numFrames, strategy, NULL) != RC_OK)
+    return -1;
+  for (i = 0; i < pins; i++)
+    {
+      if (pinPage(&bm, &h, pages[i]) != RC_OK || unpinPage(&bm, &h) != RC_OK)
+        {
+          shutdownBufferPool(&bm);
+          return -1;
+        }
+    }
+  getPoolMetrics(&bm, &m);
+  if (shutdownBufferPool(&bm) != RC_OK)
+    return -1;
+  return m.reads;
+}
+
+// order ints for qsort
+static int
+compareInts (const void *a, const void *b)
+{
+  int x = *(const int *) a, y = *(const int *) b;
+
+  return (x > y) - (x < y);
+}
+
+// order long longs for qsort
+static int
+compareLongs (const void *a, const void *b)
+{
+  long long x = *(const long long *) a, y = *(const long long *) b;
+
+  return (x > y) - (x < y);
+}
+
+// the file slot and page of a record as one number, ordered by file and then page
+static long long
+recordKey (const BM_TraceRecord *r)
+{
+  return (long long) r->fileSlot << 32 | (unsigned int) r->pageNum;
+}
+
+// simulate one trace file; returns 0 on success
+static int
+simulate (const char *fileName, int maxFrames)
+{
+  BM_Trace trace;
+  long long i, pins = 0, hits = 0, *reads, *keys, key;
+  int *pages, *sizes, numSizes = 0, distinct = 0, size, s, r;
+
+  if (readPoolTrace(fileName, &trace) != RC_OK)
+    {
+      fprintf(stderr, "%s: not a buffer pool trace\n", fileName);
+      return 1;
+    }
+
+  // count pins, hits and distinct pages, and number the pages in file and page order
+  keys = malloc(sizeof(long long) * (trace.numRecords > 0 ? trace.numRecords : 1));
+  pages = malloc(sizeof(int) * (trace.numRecords > 0 ? trace.numRecords : 1));
+  for (i = 0; i < trace.numRecords; i++)
+    {
+      if (trace.records[i].pageNum < 0)
+        continue;
+      keys[pins++] = recordKey(&trace.records[i]);
+      hits += trace.records[i].hit;
+    }
+  qsort(keys, pins, sizeof(long long), compareLongs);
+  for (i = 0; i < pins; i++)
+    if (i == 0 || keys[i] != keys[distinct - 1])
+      keys[distinct++] = keys[i];
+  for (i = 0, pins = 0; i < trace.numRecords; i++)
+    {
+      if (trace.records[i].pageNum < 0)
+        continue;
+      key = recordKey(&trace.records[i]);
+      pages[pins++] = (int) ((long long *) bsearch(&key, keys, distinct, sizeof(long long), compareLongs) - keys);
+    }
+  free(keys);
+
+  printf("%s: %lld pins of %d pages, %d-byte pages, captured with %d frames at %.1f%% hits\n",
+         fileName, pins, distinct, trace.pageSize, trace.numFrames, pins > 0 ? 100.0 * hits / pins : 0.0);
+  if (pins == 0)
+    {
+      free(pages);
+      freePoolTrace(&trace);
+      return 0;
+    }
+
+  // pool sizes doubling up to maxFrames, with the captured size in its place
+  if (maxFrames <= 0)
+    maxFrames = distinct;
+  sizes = malloc(sizeof(int) * 64);
+  for (size = SIM_MIN_FRAMES; size < maxFrames && numSizes < 62; size *= 2)
+    sizes[numSizes++] = size;
+  sizes[numSizes++] = maxFrames;
+  if (trace.numFrames > 0)
+    sizes[numSizes++] = trace.numFrames;
+  qsort(sizes, numSizes, sizeof(int), compareInts);
+  for (s = 1, r = 1; s < numSizes; s++)
+    if (sizes[s] != sizes[r - 1])
+      sizes[r++] = sizes[s];
+  numSizes = r;
+
+  reads = malloc(sizeof(long long) * numSizes * NUM_STRATEGIES);
+  if (createSimFile(trace.pageSize, distinct) != RC_OK)
+    {
+      fprintf(stderr, "could not create %s\n", SIM_FILE);
+      return 1;
+    }
+  for (s = 0; s < numSizes; s++)
+    for (r = 0; r < NUM_STRATEGIES; r++)
+      if ((reads[s * NUM_STRATEGIES + r] = replay(pages, pins, strategies[r], sizes[s])) < 0)
+        {
+          fprintf(stderr, "replay failed for %s with %d frames\n", strategyNames[r], sizes[s]);
+          destroyPageFile(SIM_FILE);
+          return 1;
+        }
+  destroyPageFile(SIM_FILE);
+
+  printf("%10s", "hit ratio");
+  for (r = 0; r < NUM_STRATEGIES; r++)
+    printf(" %8s", strategyNames[r]);
+  printf("\n");
+  for (s = 0; s < numSizes; s++)
+    {
+      printf("%10d", sizes[s]);
+      for (r = 0; r < NUM_STRATEGIES; r++)
+        printf(" %7.1f%%", 100.0 * (pins - reads[s * NUM_STRATEGIES + r]) / pins);
+      printf("%s\n", sizes[s] == trace.numFrames ? "  (captured)" : "");
+    }
+  printf("%10s", "reads");
+  for (r = 0; r < NUM_STRATEGIES; r++)
+    printf(" %8s", strategyNames[r]);
+  printf("\n");
+  for (s = 0; s < numSizes; s++)
+    {
+      printf("%10d", sizes[s]);
+      for (r = 0; r < NUM_STRATEGIES; r++)
+        printf(" %8lld", reads[s * NUM_STRATEGIES + r]);
+      printf("\n");
+    }
+  printf("\n");
+
+  free(reads);
+  free(sizes);
+  free(pages);
+  freePoolTrace(&trace);
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int maxFrames = 0, first = 1, i, failed = 0;
+
+  if (argc > 2 && strcmp(argv[1], "-m") == 0)
+    {
+      maxFrames = atoi(argv[2]);
+      first = 3;
+    }
+  if (first >= argc || maxFrames < 0)
+    {
+      fprintf(stderr, "usage: %s [-m maxFrames] traceFile...\n", argv[0]);
+      return 1;
+    }
+
+  // the simulated pools are not traced themselves
+  unsetenv(BM_TRACE_DIR_ENV);
+  initStorageManager();
+  for (i = first; i < argc; i++)
+    failed |= simulate(argv[i], maxFrames);
+  return failed;
+}